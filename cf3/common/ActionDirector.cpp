@@ -15,6 +15,7 @@
 #include "common/PropertyList.hpp"
 #include "common/OptionList.hpp"
 #include "common/PropertyList.hpp"
+#include "common/RegionProfiler.hpp"
 #include "common/Signal.hpp"
 #include "common/URI.hpp"
 
@@ -48,6 +49,7 @@ void ActionDirector::execute()
     if(!disabled)
     {
       CFdebug << name() << ": Executing action " << action->uri().path() << CFendl;
+      ScopedRegion region(*action);
       action->execute();
     }
     else
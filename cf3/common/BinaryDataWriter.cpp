@@ -12,6 +12,7 @@
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/device/file_descriptor.hpp>
 
+#include "common/BlockCompressor.hpp"
 #include "common/Log.hpp"
 #include "common/Signal.hpp"
 #include "common/PropertyList.hpp"
@@ -31,12 +32,14 @@ namespace common {
 
 struct BinaryDataWriter::Implementation
 {
-  Implementation(const URI& file) :
+  Implementation(const URI& file, const Uint nb_threads) :
     filename(build_filename(file, PE::Comm::instance().rank())),
     xml_filename(file),
     index(0),
     xml_doc("1.0", "ISO-8859-1"),
-    m_total_count(0)
+    m_total_count(0),
+    m_compressor(BlockCompressor::ZLIB, nb_threads),
+    discarded(false)
   {
     const Uint v = version();
     out_file.open(filename, std::ios_base::out | std::ios_base::binary);
@@ -64,6 +67,9 @@ struct BinaryDataWriter::Implementation
   {
     CFdebug << "wrote a total of " << m_total_count << " bytes with a compression ratio of " << static_cast<Real>(out_file.tellp()) / static_cast<Real>(m_total_count) * 100. << "%" << CFendl;
     out_file.close();
+    if(discarded)
+      return;
+
     if(PE::Comm::instance().rank() == 0)
       XML::to_file(xml_doc, xml_filename);
 
@@ -71,9 +77,14 @@ struct BinaryDataWriter::Implementation
   }
 
   Uint write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
+  {
+    return register_block(write_local_block(data, count, nb_rows, nb_cols), list_name, type_name);
+  }
+
+  // Compress and write a block to the file of this CPU, returning the information to put in the index. No communication happens here.
+  std::vector<Uint> write_local_block(const char* data, const std::streamsize count, const Uint nb_rows, const Uint nb_cols)
   {
     cf3_assert(out_file.is_open());
-    PE::Comm& comm = PE::Comm::instance();
     // Prefix and suffix markers
     static const std::string block_prefix("__CFDATA_BEGIN");
 
@@ -82,7 +93,13 @@ struct BinaryDataWriter::Implementation
     // Write the prefix
     out_file.write(block_prefix.c_str(), block_prefix.size());
     
-    if(count != 0)
+    if(count > chunksize && m_compressor.nb_threads() > 1)
+    {
+      // Compress chunks in parallel, into a single zlib stream
+      const std::string compressed = m_compressor.compress_zlib_stream(data, count, chunksize);
+      out_file.write(compressed.data(), compressed.size());
+    }
+    else if(count != 0)
     {
       // Build a compressed stream
       boost::iostreams::filtering_ostream compressing_stream;
@@ -95,9 +112,16 @@ struct BinaryDataWriter::Implementation
     }
 
     const Uint block_end = out_file.tellp();
+    m_total_count += count;
 
     // Data describing the block on the current CPU
-    const std::vector<Uint> my_block_info = boost::assign::list_of(nb_rows)(nb_cols)(block_begin)(block_end);
+    return boost::assign::list_of(nb_rows)(nb_cols)(block_begin)(block_end);
+  }
+
+  // Gather the block information from all CPUs and add it to the index
+  Uint register_block(const std::vector<Uint>& my_block_info, const std::string& list_name, const std::string& type_name)
+  {
+    PE::Comm& comm = PE::Comm::instance();
     const Uint block_info_size = my_block_info.size();
     std::vector<Uint> global_block_info;
     const Uint root = 0;
@@ -129,11 +153,19 @@ struct BinaryDataWriter::Implementation
     }
 
     ++index;
-    m_total_count += count;
 
     return index - 1;
   }
 
+  // Blocks written with write_local_block that are not in the index yet
+  struct LocalBlock
+  {
+    std::vector<Uint> info;
+    std::string list_name;
+    std::string type_name;
+  };
+  std::vector<LocalBlock> local_blocks;
+
   Uint version() const
   {
     static const Uint current_version = 1;
@@ -160,6 +192,13 @@ struct BinaryDataWriter::Implementation
 
   std::vector<XmlNode> node_xml_data;
   Uint m_total_count;
+
+  // Compressor for large blocks, using multiple threads
+  const BlockCompressor m_compressor;
+  static const std::streamsize chunksize = 1048576;
+
+  // If true, the index is not written on closing
+  bool discarded;
 };
   
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,6 +209,10 @@ BinaryDataWriter::BinaryDataWriter ( const std::string& name ) : Component(name)
     .pretty_name("File")
     .description("File name for the output file")
     .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
+
+  options().add("compression_threads", 1u)
+    .pretty_name("Compression Threads")
+    .description("Number of threads used to compress large blocks. 0 uses all hardware threads.");
 }
 
 BinaryDataWriter::~BinaryDataWriter()
@@ -182,14 +225,51 @@ void BinaryDataWriter::close()
   m_implementation.reset();
 }
 
+void BinaryDataWriter::discard()
+{
+  if(is_not_null(m_implementation.get()))
+    m_implementation->discarded = true;
+  m_implementation.reset();
+}
+
 Uint BinaryDataWriter::write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
+{
+  open();
+  return m_implementation->write_data_block(data, count, list_name, nb_rows, nb_cols, type_name);
+}
+
+void BinaryDataWriter::open()
 {
   if(is_null(m_implementation.get()))
   {
-    m_implementation.reset(new Implementation(options().value<URI>("file")));
+    m_implementation.reset(new Implementation(options().value<URI>("file"), options().value<Uint>("compression_threads")));
   }
+}
 
-  return m_implementation->write_data_block(data, count, list_name, nb_rows, nb_cols, type_name);
+void BinaryDataWriter::write_local_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
+{
+  if(is_null(m_implementation.get()))
+    throw SetupError(FromHere(), "BinaryDataWriter " + uri().path() + " must be opened before writing local blocks");
+
+  Implementation::LocalBlock block;
+  block.info = m_implementation->write_local_block(data, count, nb_rows, nb_cols);
+  block.list_name = list_name;
+  block.type_name = type_name;
+  m_implementation->local_blocks.push_back(block);
+}
+
+Uint BinaryDataWriter::register_local_blocks()
+{
+  if(is_null(m_implementation.get()))
+    throw SetupError(FromHere(), "BinaryDataWriter " + uri().path() + " is not open");
+
+  const Uint first_index = m_implementation->index;
+  BOOST_FOREACH(const Implementation::LocalBlock& block, m_implementation->local_blocks)
+  {
+    m_implementation->register_block(block.info, block.list_name, block.type_name);
+  }
+  m_implementation->local_blocks.clear();
+  return first_index;
 }
 
 void BinaryDataWriter::trigger_file()
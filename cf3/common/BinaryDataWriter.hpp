@@ -48,13 +48,36 @@ public: // functions
     return write_data_block(reinterpret_cast<const char*>(list.array().data()), sizeof(T)*list.size(), list.name(), list.size(), 1, class_name<T>());
   }
 
+  /// Append a data block to the file of this CPU only. No communication takes place, so this may be called from
+  /// a separate thread, provided the file was opened first. The block is added to the index by register_local_blocks()
+  template<typename T>
+  void append_local_data(const Table<T>& table)
+  {
+    write_local_block(reinterpret_cast<const char*>(table.array().data()), sizeof(T)*table.row_size()*table.size(), table.name(), table.size(), table.row_size(), class_name<T>());
+  }
+
+  /// Open the output file. This happens automatically when calling append_data, but must be done explicitly before append_local_data
+  void open();
+
+  /// Add all blocks written with append_local_data to the index, in the order they were written.
+  /// This must be called on all CPUs simultaneously. Returns the index of the first registered block
+  Uint register_local_blocks();
+
   /// Close the current file
   void close();
 
+  /// Close the current file without completing the index. No communication takes place, so this
+  /// is safe to call from a destructor or after the parallel environment was finalized.
+  /// Blocks written so far are lost.
+  void discard();
+
 private:
   // Write a data block to the binary file
   Uint write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name);
 
+  // Write a data block to the binary file of this CPU, without updating the index
+  void write_local_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name);
+
   // Trigger on output file change
   void trigger_file();
 
@@ -0,0 +1,245 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <zlib.h>
+
+#include "coolfluid-packages.hpp"
+
+#ifdef CF3_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "common/BasicExceptions.hpp"
+#include "common/BlockCompressor.hpp"
+#include "common/StringConversion.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+void compress_zlib(const char* data, const std::size_t size, std::string& result)
+{
+  uLongf compressed_size = compressBound(size);
+  result.resize(compressed_size);
+  const int status = compress2(reinterpret_cast<Bytef*>(&result[0]), &compressed_size, reinterpret_cast<const Bytef*>(data), size, Z_DEFAULT_COMPRESSION);
+  if(status != Z_OK)
+    throw FileSystemError(FromHere(), "zlib compression failed with code " + to_str(status));
+  result.resize(compressed_size);
+}
+
+#ifdef CF3_HAVE_LZ4
+void compress_lz4(const char* data, const std::size_t size, std::string& result)
+{
+  result.resize(LZ4_compressBound(size));
+  const int compressed_size = LZ4_compress_default(data, &result[0], size, result.size());
+  if(compressed_size <= 0)
+    throw FileSystemError(FromHere(), "LZ4 compression failed");
+  result.resize(compressed_size);
+}
+#endif
+
+/// Raw deflate of one chunk of a zlib stream, ending in a sync flush unless it is the last chunk
+void deflate_chunk(const char* data, const std::size_t size, const bool last, std::string& result)
+{
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    throw FileSystemError(FromHere(), "Failed to initialize zlib");
+
+  // Room for the data and the sync flush marker
+  result.resize(deflateBound(&stream, size) + 16);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+  stream.avail_out = result.size();
+  const int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  const std::size_t compressed_size = result.size() - stream.avail_out;
+  deflateEnd(&stream);
+  if(status != (last ? Z_STREAM_END : Z_OK) || stream.avail_in != 0)
+    throw FileSystemError(FromHere(), "zlib compression failed with code " + to_str(status));
+  result.resize(compressed_size);
+}
+
+/// Work shared by the compression threads: thread t handles blocks t, t+nb_threads, ...
+struct CompressionJob
+{
+  void compress_blocks(const Uint thread_idx)
+  {
+    try
+    {
+      for(Uint i = thread_idx; i < nb_blocks; i += nb_threads)
+      {
+        const std::size_t begin = static_cast<std::size_t>(i) * blocksize;
+        const std::size_t block_size = std::min(blocksize, size - begin);
+        switch(mode)
+        {
+          case ZLIB_BLOCKS:
+            compress_zlib(data + begin, block_size, (*results)[i]);
+            break;
+          case LZ4_BLOCKS:
+#ifdef CF3_HAVE_LZ4
+            compress_lz4(data + begin, block_size, (*results)[i]);
+#endif
+            break;
+          case DEFLATE_CHUNKS:
+            deflate_chunk(data + begin, block_size, i == nb_blocks-1, (*results)[i]);
+            checksums[i] = adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data + begin), block_size);
+            break;
+        }
+      }
+    }
+    catch(std::exception& e)
+    {
+      errors[thread_idx] = e.what();
+    }
+  }
+
+  /// Run on the given number of threads, rethrowing the first error
+  void run()
+  {
+    errors.assign(nb_threads, std::string());
+    if(nb_threads == 1)
+    {
+      compress_blocks(0);
+    }
+    else
+    {
+      boost::thread_group threads;
+      for(Uint t = 0; t != nb_threads; ++t)
+        threads.create_thread(boost::bind(&CompressionJob::compress_blocks, this, t));
+      threads.join_all();
+    }
+
+    for(Uint t = 0; t != nb_threads; ++t)
+    {
+      if(!errors[t].empty())
+        throw FileSystemError(FromHere(), errors[t]);
+    }
+  }
+
+  enum Mode { ZLIB_BLOCKS, LZ4_BLOCKS, DEFLATE_CHUNKS };
+  Mode mode;
+  const char* data;
+  std::size_t size;
+  std::size_t blocksize;
+  Uint nb_blocks;
+  Uint nb_threads;
+  std::vector<std::string>* results;
+  std::vector<uLong> checksums;
+  std::vector<std::string> errors;
+};
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+BlockCompressor::BlockCompressor(const BlockCompressor::Codec codec, const Uint nb_threads) :
+  m_codec(codec),
+  m_nb_threads(nb_threads)
+{
+  if(m_codec == LZ4 && !has_lz4())
+    throw NotSupported(FromHere(), "LZ4 compression was requested, but coolfluid was built without LZ4 support");
+
+  if(m_nb_threads == 0)
+    m_nb_threads = std::max(1u, boost::thread::hardware_concurrency());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BlockCompressor::compress_blocks(const char* data, const std::size_t size, const std::size_t blocksize, std::vector< std::string >& compressed_blocks) const
+{
+  cf3_assert(blocksize != 0);
+
+  detail::CompressionJob job;
+  job.mode = m_codec == LZ4 ? detail::CompressionJob::LZ4_BLOCKS : detail::CompressionJob::ZLIB_BLOCKS;
+  job.data = data;
+  job.size = size;
+  job.blocksize = blocksize;
+  job.nb_blocks = size == 0 ? 0 : (size - 1) / blocksize + 1;
+  job.nb_threads = std::max(1u, std::min(m_nb_threads, job.nb_blocks));
+  job.results = &compressed_blocks;
+
+  compressed_blocks.resize(job.nb_blocks);
+  job.run();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string BlockCompressor::compress_zlib_stream(const char* data, const std::size_t size, const std::size_t chunksize) const
+{
+  cf3_assert(chunksize != 0);
+
+  std::vector<std::string> chunks;
+
+  detail::CompressionJob job;
+  job.mode = detail::CompressionJob::DEFLATE_CHUNKS;
+  job.data = data;
+  job.size = size;
+  job.blocksize = chunksize;
+  job.nb_blocks = size == 0 ? 1 : (size - 1) / chunksize + 1;
+  job.nb_threads = std::max(1u, std::min(m_nb_threads, job.nb_blocks));
+  job.results = &chunks;
+  job.checksums.resize(job.nb_blocks);
+
+  chunks.resize(job.nb_blocks);
+  job.run();
+
+  // zlib header for the default compression level and a 32K window, as written by deflateInit
+  std::string result("\x78\x9c", 2);
+  uLong checksum = adler32(0L, Z_NULL, 0);
+  for(Uint i = 0; i != job.nb_blocks; ++i)
+  {
+    result += chunks[i];
+    const std::size_t begin = static_cast<std::size_t>(i) * chunksize;
+    checksum = adler32_combine(checksum, job.checksums[i], std::min(chunksize, size - begin));
+  }
+
+  // Adler-32 trailer, big endian
+  for(int shift = 24; shift >= 0; shift -= 8)
+    result.push_back(static_cast<char>((checksum >> shift) & 0xff));
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BlockCompressor::Codec BlockCompressor::codec_from_str(const std::string& name)
+{
+  if(name == "zlib")
+    return ZLIB;
+  if(name == "lz4")
+    return LZ4;
+  throw ValueNotFound(FromHere(), "Unknown compression codec " + name + ", valid values are zlib and lz4");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool BlockCompressor::has_lz4()
+{
+#ifdef CF3_HAVE_LZ4
+  return true;
+#else
+  return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
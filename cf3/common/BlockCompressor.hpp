@@ -0,0 +1,72 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_BlockCompressor_hpp
+#define cf3_common_BlockCompressor_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Compresses data as a sequence of blocks, using several threads.
+/// The zlib output is identical to what a boost::iostreams::zlib_compressor with default
+/// parameters produces for the same data, so files stay readable by the existing readers.
+class Common_API BlockCompressor
+{
+public:
+
+  /// Supported compression algorithms
+  enum Codec { ZLIB, LZ4 };
+
+  /// Constructor
+  /// @param codec       algorithm to use. LZ4 is only available if coolfluid was built with LZ4 support
+  /// @param nb_threads  number of threads to use. 0 means one per hardware thread
+  BlockCompressor(const Codec codec = ZLIB, const Uint nb_threads = 1);
+
+  /// Compress each block of blocksize bytes (the last one may be smaller) independently
+  /// @param [out] compressed_blocks  one string per block, containing the compressed data
+  void compress_blocks(const char* data, const std::size_t size, const std::size_t blocksize, std::vector<std::string>& compressed_blocks) const;
+
+  /// Compress the data into a single zlib stream, deflating chunks of chunksize bytes in parallel.
+  /// Every chunk but the last ends in a sync flush, so the result decompresses as one stream.
+  std::string compress_zlib_stream(const char* data, const std::size_t size, const std::size_t chunksize = 1048576) const;
+
+  /// The algorithm in use
+  Codec codec() const { return m_codec; }
+
+  /// Number of threads that will be used
+  Uint nb_threads() const { return m_nb_threads; }
+
+  /// Parse a codec name ("zlib" or "lz4")
+  static Codec codec_from_str(const std::string& name);
+
+  /// True if LZ4 support was compiled in
+  static bool has_lz4();
+
+private:
+  const Codec m_codec;
+  Uint m_nb_threads;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_BlockCompressor_hpp
@@ -0,0 +1,50 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/Builder.hpp"
+#include "common/StreamHelpers.hpp"
+
+#include "common/LibCommon.hpp"
+#include "common/CompressedDynTable.hpp"
+
+namespace cf3 {
+namespace common {
+
+common::ComponentBuilder < CompressedDynTable<Uint>, Component, LibCommon > CompressedDynTable_Uint_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, CompressedDynTable<Uint>::ConstRow row)
+{
+  print_vector(os, row);
+  return os;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const CompressedDynTable<Uint>& table)
+{
+  if (table.size())
+    os << "\n";
+  for (Uint i=0; i<table.size(); ++i)
+  {
+    os << "  " << i << ":  ";
+    if (table.row_size(i) == 0)
+      os << "~";
+    else
+    {
+      boost_foreach(const Uint entry, table[i])
+        os << entry << " ";
+    }
+    os << "\n";
+  }
+  return os;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
@@ -0,0 +1,165 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_CompressedDynTable_hpp
+#define cf3_common_CompressedDynTable_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/range/iterator_range.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Component.hpp"
+#include "common/DynTable.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Component holding a table with variable row-size per row, in compressed row storage.
+/// All rows are stored back to back in a single array, and the start of each row is stored
+/// in an offsets array. This avoids one allocation per row, as done in DynTable.
+/// The row size can not change after construction, so the table is built in two steps:
+/// - allocate(), given the size of each row
+/// - push_back() each value, in any row order
+/// After freeze() the rows can be accessed through operator[], as in DynTable.
+template<typename T>
+class CompressedDynTable : public common::Component {
+
+public:
+
+  typedef boost::iterator_range<T*> Row;
+  typedef boost::iterator_range<const T*> ConstRow;
+
+  /// Contructor
+  /// @param name of the component
+  CompressedDynTable ( const std::string& name ) : Component(name), m_is_frozen(true), m_offsets(1, 0u) { }
+
+  ~CompressedDynTable () {}
+
+  /// Get the class name
+  static std::string type_name () { return "CompressedDynTable<"+common::class_name<T>()+">"; }
+
+  /// Number of rows
+  Uint size() const { return m_offsets.size() - 1; }
+
+  /// Total number of values, summed over all rows
+  Uint nb_values() const { return m_values.size(); }
+
+  Uint row_size(const Uint i) const { return m_offsets[i+1] - m_offsets[i]; }
+
+  /// Start building the table, clearing any previous content
+  /// @param [in] row_sizes The final size of each row
+  template<typename VectorT>
+  void allocate(const VectorT& row_sizes)
+  {
+    const Uint nb_rows = row_sizes.size();
+    m_offsets.resize(nb_rows+1);
+    m_offsets[0] = 0;
+    for (Uint i=0; i<nb_rows; ++i)
+      m_offsets[i+1] = m_offsets[i] + row_sizes[i];
+    m_values.clear();
+    m_values.resize(m_offsets.back());
+    m_fill.assign(m_offsets.begin(), m_offsets.end()-1);
+    m_is_frozen = false;
+  }
+
+  /// Append a value to the given row
+  /// @pre allocate() must have been called, and the row may not be full yet
+  void push_back(const Uint row, const T& value)
+  {
+    cf3_assert(!m_is_frozen);
+    cf3_assert(row < size());
+    cf3_assert(m_fill[row] < m_offsets[row+1]);
+    m_values[m_fill[row]++] = value;
+  }
+
+  /// Finish building the table, making the rows available through operator[]
+  /// @throw common::InvalidStructure if not all rows were filled completely
+  void freeze()
+  {
+    for (Uint i=0; i<size(); ++i)
+    {
+      if (m_fill[i] != m_offsets[i+1])
+        throw InvalidStructure(FromHere(), "Row " + to_str(i) + " of " + uri().string() + " has "
+                               + to_str(m_fill[i]-m_offsets[i]) + " values, expected " + to_str(row_size(i)));
+    }
+    std::vector<Uint>().swap(m_fill);
+    m_is_frozen = true;
+  }
+
+  /// Build a frozen copy of a DynTable
+  void freeze(const DynTable<T>& table)
+  {
+    std::vector<Uint> row_sizes(table.size());
+    for (Uint i=0; i<table.size(); ++i)
+      row_sizes[i] = table.row_size(i);
+    allocate(row_sizes);
+    for (Uint i=0; i<table.size(); ++i)
+    {
+      boost_foreach(const T& value, table[i])
+        push_back(i, value);
+    }
+    freeze();
+  }
+
+  /// True if the table can be accessed
+  bool is_frozen() const { return m_is_frozen; }
+
+  Row operator[] (const Uint idx)
+  {
+    cf3_assert(m_is_frozen);
+    cf3_assert(idx < size());
+    T* values = m_values.empty() ? NULL : &m_values[0];
+    return Row(values + m_offsets[idx], values + m_offsets[idx+1]);
+  }
+
+  ConstRow operator[] (const Uint idx) const
+  {
+    cf3_assert(m_is_frozen);
+    cf3_assert(idx < size());
+    const T* values = m_values.empty() ? NULL : &m_values[0];
+    return ConstRow(values + m_offsets[idx], values + m_offsets[idx+1]);
+  }
+
+  /// @return The start of each row in values(), with one extra entry for the end of the last row
+  const std::vector<Uint>& offsets() const { return m_offsets; }
+
+  /// @return All values, stored row after row
+  const std::vector<T>& values() const { return m_values; }
+
+private: // data
+
+  /// True when building is finished
+  bool m_is_frozen;
+
+  /// Start of each row in m_values, with one extra entry for the end
+  std::vector<Uint> m_offsets;
+
+  /// Values of all rows
+  std::vector<T> m_values;
+
+  /// Insert position of each row, only used while building
+  std::vector<Uint> m_fill;
+
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, CompressedDynTable<Uint>::ConstRow row);
+std::ostream& operator<<(std::ostream& os, const CompressedDynTable<Uint>& table);
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_CompressedDynTable_hpp
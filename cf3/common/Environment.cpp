@@ -12,6 +12,7 @@
 #include "common/Log.hpp"
 #include "common/Environment.hpp"
 #include "common/PropertyList.hpp"
+#include "common/RegionProfiler.hpp"
 
 namespace cf3 {
 namespace common {
@@ -102,6 +103,22 @@ Environment::Environment ( const std::string& name) : Component ( name )
       .mark_basic()
       .attach_trigger(boost::bind(&Environment::trigger_log_level,this));
 
+  options().add("profile_regions", RegionProfiler::is_enabled())
+      .pretty_name("Profile Regions")
+      .description("If true, the execution of actions and other marked regions of code is timed. Use the WriteRegionProfile action to output the results.")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Environment::trigger_profile_regions,this));
+
+  options().add("profile_trace", RegionProfiler::instance().is_trace_enabled())
+      .pretty_name("Profile Trace")
+      .description("If true, each execution of a profiled region is stored, for output as a Chrome trace. Memory use grows with the number of calls.")
+      .attach_trigger(boost::bind(&Environment::trigger_profile_trace,this));
+
+  options().add("profile_hardware_counters", RegionProfiler::instance().is_hardware_counters_enabled())
+      .pretty_name("Profile Hardware Counters")
+      .description("If true, the CPU cycles and cache misses of each profiled region are counted. Only available on Linux, if perf events are permitted, otherwise the option is set back to false.")
+      .attach_trigger(boost::bind(&Environment::trigger_profile_hardware_counters,this));
+
   trigger_log_level();
 
   // signals
@@ -180,5 +197,31 @@ void Environment::trigger_log_level()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void Environment::trigger_profile_regions()
+{
+  if(options().value<bool>("profile_regions"))
+    RegionProfiler::instance().enable();
+  else
+    RegionProfiler::instance().disable();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::trigger_profile_trace()
+{
+  RegionProfiler::instance().enable_trace(options().value<bool>("profile_trace"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::trigger_profile_hardware_counters()
+{
+  // The profiler warns if the counters are not available, the option then shows they are off
+  if(!RegionProfiler::instance().enable_hardware_counters(options().value<bool>("profile_hardware_counters")))
+    options().set("profile_hardware_counters", false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
@@ -51,6 +51,12 @@ private: // functions
 
   void trigger_log_level();
 
+  void trigger_profile_regions();
+
+  void trigger_profile_trace();
+
+  void trigger_profile_hardware_counters();
+
 }; // Environment
 
 ////////////////////////////////////////////////////////////////////////////////
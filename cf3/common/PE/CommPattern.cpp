@@ -13,6 +13,8 @@
 #include "common/FindComponents.hpp"
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/RegionProfiler.hpp"
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
@@ -56,6 +58,13 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
   //self->regist_signal ( "update" , "Executes communication patterns on all the registered data.", "" ).connect ( boost::bind ( &CommPattern2::update, self, _1 ) );
   m_isUpToDate=false;
   m_isFreeze=false;
+  m_indexed_datatypes=false;
+
+  options().add("indexed_datatypes", m_indexed_datatypes)
+    .pretty_name("Indexed Datatypes")
+    .description("Exchange directly from and to the registered data using MPI indexed datatypes, instead of packing into buffers. "
+                 "Updatable values may then not be modified between begin_synchronize and end_synchronize.")
+    .link_to(&m_indexed_datatypes);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,6 +72,7 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
 CommPattern::~CommPattern()
 {
   if (m_gid.get()!=nullptr) m_gid->remove_tag("gid_of_"+this->name());
+  free_sync_buffers();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -270,6 +280,7 @@ PECheckPoint(1000,"004");
 
 void CommPattern::setup()
 {
+  ScopedRegion region(*this, "/setup");
 #define COMPUTE_IRANK(inode,nproc,nnode) ((((unsigned long long)(inode))*((unsigned long long)(nproc)))/((unsigned long long)(nnode)))
 #define COMPUTE_INODE(irank,nproc,nnode) (((unsigned long long)(nnode))>((unsigned long long)(nproc))?((((unsigned long long)(irank))*((unsigned long long)(nnode)))%((unsigned long long)(nproc))==0?(((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)):((((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)))+1ul):((unsigned long long)(irank)))
 
@@ -280,6 +291,9 @@ void CommPattern::setup()
   if (m_gid->stride()!=1) throw cf3::common::BadValue(FromHere(),"Gid is not of stride==1 for commpattern: " + name());
   if (m_gid->is_data_type_Uint()!=true) throw cf3::common::CastingFailed(FromHere(),"Gid is not of type Uint for commpattern: " + name());
 
+  // the persistent requests are tied to the old pattern
+  free_sync_buffers();
+
   // look around for max gid for the global array's size
   Uint nglobalarray=0;
   Uint maxgid_maxrank[2]={0,0};
@@ -465,6 +479,9 @@ void CommPattern::setup()
   Uint *gid=cwv_gid();
   BOOST_FOREACH(temp_buffer_item& i, m_add_buffer) *gid++=i.gid;
 
+  // neighbours and offsets in the maps, used by all synchronizations until the next setup
+  build_plan();
+
   // clear stuff and reset other things
   m_isUpToDate=true;
   m_add_buffer.clear();
@@ -566,11 +583,15 @@ void CommPattern::setup()
 
 void CommPattern::synchronize_all()
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
+  // all exchanges are started before waiting for any of them
+  std::vector<SyncHandle> handles;
   BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
   {
-    synchronize_this(pobj,sndbuf,rcvbuf);
+    handles.push_back(begin_synchronize(pobj));
+  }
+  BOOST_FOREACH( const SyncHandle& handle, handles )
+  {
+    end_synchronize(handle);
   }
 }
 
@@ -578,19 +599,14 @@ void CommPattern::synchronize_all()
 
 void CommPattern::synchronize( const std::string& name )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  Handle<CommWrapper> pobj(get_child(name));
-  synchronize_this(*pobj,sndbuf,rcvbuf);
+  end_synchronize(begin_synchronize(name));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void CommPattern::synchronize( const CommWrapper& pobj )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  synchronize_this(pobj,sndbuf,rcvbuf);
+  end_synchronize(begin_synchronize(pobj));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -611,6 +627,222 @@ void CommPattern::synchronize_this( const CommWrapper& pobj, std::vector<unsigne
 
 ////////////////////////////////////////////////////////////////////////////////
 
+CommPattern::SyncHandle CommPattern::begin_synchronize( const std::string& name )
+{
+  Handle<CommWrapper> pobj(get_child(name));
+  if (pobj.get()==nullptr) throw common::ValueNotFound(FromHere(), uri().path() + ": no data registered under the name " + name);
+  return begin_synchronize(*pobj);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+CommPattern::SyncHandle CommPattern::begin_synchronize( const CommWrapper& pobj )
+{
+  SyncHandle handle;
+  if ( !pobj.needs_update() )
+    return handle;
+
+  ScopedRegion region(pobj, "/begin_synchronize");
+  SyncBuffers& buffers = sync_buffers(pobj);
+  if (buffers.in_flight) throw common::ShouldNotBeHere(FromHere(), uri().path() + ": synchronization of " + pobj.name() + " was already started.");
+
+  if (buffers.use_datatypes && !buffers.requests.empty())
+  {
+    // send and receive in place, the view keeps the data accessible until end_synchronize
+    // the wrapped data is modified through the const wrapper, as is done by unpack
+    buffers.view.reset(new CommWrapperView<unsigned char>(const_cast<CommWrapper&>(pobj).handle<CommWrapper>()));
+    unsigned char* data=(*buffers.view)();
+    Communicator comm=PE::Comm::instance().communicator();
+    const int nrecv=(int)m_recvRanks.size();
+    for (int i=0; i<nrecv; i++)
+      MPI_CHECK_RESULT(MPI_Irecv,(data,1,buffers.types[i],m_recvRanks[i],buffers.tag,comm,&buffers.requests[i]));
+    for (int i=0; i<(const int)m_sendRanks.size(); i++)
+      MPI_CHECK_RESULT(MPI_Isend,(data,1,buffers.types[nrecv+i],m_sendRanks[i],buffers.tag,comm,&buffers.requests[nrecv+i]));
+  }
+  else if (!buffers.use_datatypes)
+  {
+    // packing goes directly into the registered buffer, the requests start from there
+    if (!m_sendMap.empty()) pobj.pack(m_sendMap,&buffers.sndbuf[0]);
+    if (!buffers.requests.empty()) MPI_CHECK_RESULT(MPI_Startall,((int)buffers.requests.size(),&buffers.requests[0]));
+  }
+  buffers.in_flight=true;
+
+  handle.m_wrapper=pobj.handle<CommWrapper>();
+  return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::end_synchronize( const SyncHandle& handle )
+{
+  if (!handle.is_active())
+    return;
+
+  const CommWrapper& pobj=*handle.m_wrapper;
+  // mostly time spent waiting for the messages
+  ScopedRegion region(pobj, "/end_synchronize");
+  std::map< std::string, boost::shared_ptr<SyncBuffers> >::iterator it=m_sync_buffers.find(pobj.name());
+  if (it==m_sync_buffers.end() || it->second.get()==nullptr || !it->second->in_flight) throw common::ShouldNotBeHere(FromHere(), uri().path() + ": synchronization of " + pobj.name() + " was not started.");
+  SyncBuffers& buffers=*it->second;
+
+  if (!buffers.requests.empty()) MPI_CHECK_RESULT(MPI_Waitall,((int)buffers.requests.size(),&buffers.requests[0],MPI_STATUSES_IGNORE));
+  buffers.in_flight=false;
+  if (buffers.use_datatypes) buffers.view.reset();
+  else if (!m_recvMap.empty()) pobj.unpack(&buffers.rcvbuf[0],m_recvMap);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::end_synchronize( const std::string& name )
+{
+  std::map< std::string, boost::shared_ptr<SyncBuffers> >::iterator it=m_sync_buffers.find(name);
+  if (it==m_sync_buffers.end() || it->second.get()==nullptr || !it->second->in_flight)
+    return;
+  SyncHandle handle;
+  handle.m_wrapper=Handle<CommWrapper const>(get_child(name));
+  end_synchronize(handle);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::build_plan()
+{
+  m_sendRanks.clear();
+  m_sendStarts.assign(1,0);
+  for (int i=0; i<(const int)m_sendCount.size(); i++)
+  {
+    if (m_sendCount[i]==0) continue;
+    m_sendRanks.push_back(i);
+    m_sendStarts.push_back(m_sendStarts.back()+m_sendCount[i]);
+  }
+  m_recvRanks.clear();
+  m_recvStarts.assign(1,0);
+  for (int i=0; i<(const int)m_recvCount.size(); i++)
+  {
+    if (m_recvCount[i]==0) continue;
+    m_recvRanks.push_back(i);
+    m_recvStarts.push_back(m_recvStarts.back()+m_recvCount[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+CommPattern::SyncBuffers& CommPattern::sync_buffers( const CommWrapper& pobj )
+{
+  const int item_size=pobj.size_of()*pobj.stride();
+  boost::shared_ptr<SyncBuffers>& buffers=m_sync_buffers[pobj.name()];
+  if (buffers.get()!=nullptr && buffers->item_size==item_size && buffers->use_datatypes==m_indexed_datatypes)
+    return *buffers;
+
+  // (re)build, the stride of the wrapped data or the exchange method may have changed
+  free_sync_buffers(pobj.name());
+  buffers.reset(new SyncBuffers());
+  buffers->item_size=item_size;
+  buffers->use_datatypes=m_indexed_datatypes;
+  buffers->tag=sync_tag(pobj.name());
+
+  const int nrecv=(int)m_recvRanks.size();
+  const int nsend=(int)m_sendRanks.size();
+  Communicator comm=PE::Comm::instance().communicator();
+
+  if (buffers->use_datatypes)
+  {
+    // one indexed datatype per neighbour, selecting the items of the map directly in the wrapped data
+    MPI_Datatype item_type;
+    MPI_CHECK_RESULT(MPI_Type_contiguous,(item_size,MPI_BYTE,&item_type));
+    for (int i=0; i<nrecv; i++)
+    {
+      MPI_Datatype type;
+      MPI_CHECK_RESULT(MPI_Type_create_indexed_block,(m_recvStarts[i+1]-m_recvStarts[i],1,&m_recvMap[m_recvStarts[i]],item_type,&type));
+      MPI_CHECK_RESULT(MPI_Type_commit,(&type));
+      buffers->types.push_back(type);
+    }
+    for (int i=0; i<nsend; i++)
+    {
+      MPI_Datatype type;
+      MPI_CHECK_RESULT(MPI_Type_create_indexed_block,(m_sendStarts[i+1]-m_sendStarts[i],1,&m_sendMap[m_sendStarts[i]],item_type,&type));
+      MPI_CHECK_RESULT(MPI_Type_commit,(&type));
+      buffers->types.push_back(type);
+    }
+    MPI_CHECK_RESULT(MPI_Type_free,(&item_type));
+    buffers->requests.assign(nrecv+nsend,MPI_REQUEST_NULL);
+  }
+  else
+  {
+    // one persistent request per neighbour, on contiguous parts of the buffers
+    buffers->sndbuf.resize(m_sendMap.size()*item_size);
+    buffers->rcvbuf.resize(m_recvMap.size()*item_size);
+    for (int i=0; i<nrecv; i++)
+    {
+      MPI_Request request;
+      MPI_CHECK_RESULT(MPI_Recv_init,(&buffers->rcvbuf[m_recvStarts[i]*item_size],(m_recvStarts[i+1]-m_recvStarts[i])*item_size,MPI_BYTE,m_recvRanks[i],buffers->tag,comm,&request));
+      buffers->requests.push_back(request);
+    }
+    for (int i=0; i<nsend; i++)
+    {
+      MPI_Request request;
+      MPI_CHECK_RESULT(MPI_Send_init,(&buffers->sndbuf[m_sendStarts[i]*item_size],(m_sendStarts[i+1]-m_sendStarts[i])*item_size,MPI_BYTE,m_sendRanks[i],buffers->tag,comm,&request));
+      buffers->requests.push_back(request);
+    }
+  }
+  return *buffers;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int CommPattern::sync_tag( const std::string& name )
+{
+  // tags below first_sync_tag are left to the fixed tags used elsewhere, 32767 is the smallest MPI_TAG_UB allowed by MPI
+  static const int first_sync_tag=100;
+  static const int nb_sync_tags=32767-first_sync_tag+1;
+  static int nb_allocated_tags=0;
+
+  std::map< std::string, int >::iterator it=m_sync_tags.find(name);
+  if (it!=m_sync_tags.end())
+    return it->second;
+
+  const int tag=first_sync_tag+nb_allocated_tags%nb_sync_tags;
+  ++nb_allocated_tags;
+  m_sync_tags[name]=tag;
+  return tag;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::free_sync_buffers( const std::string& name )
+{
+  std::map< std::string, boost::shared_ptr<SyncBuffers> >::iterator it=m_sync_buffers.find(name);
+  if (it==m_sync_buffers.end() || it->second.get()==nullptr)
+    return;
+  SyncBuffers& buffers=*it->second;
+  // requests and datatypes can not be freed anymore once MPI is finalized
+  if (PE::Comm::instance().is_active())
+  {
+    // a pending exchange still uses the buffers, so complete it first, its result is discarded
+    if (buffers.in_flight && !buffers.requests.empty())
+      MPI_CHECK_RESULT(MPI_Waitall,((int)buffers.requests.size(),&buffers.requests[0],MPI_STATUSES_IGNORE));
+    if (!buffers.use_datatypes)
+    {
+      BOOST_FOREACH(MPI_Request& request, buffers.requests)
+        MPI_CHECK_RESULT(MPI_Request_free,(&request));
+    }
+    BOOST_FOREACH(MPI_Datatype& type, buffers.types)
+      MPI_CHECK_RESULT(MPI_Type_free,(&type));
+  }
+  it->second.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::free_sync_buffers()
+{
+  for (std::map< std::string, boost::shared_ptr<SyncBuffers> >::iterator it=m_sync_buffers.begin(); it!=m_sync_buffers.end(); ++it)
+    free_sync_buffers(it->first);
+  m_sync_buffers.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void CommPattern::add_global(Uint gid, Uint rank)
 {
   // later a mechanism could be implemented when commpattern can give gids by calling a "reserve(int num)" beforehand, to optimize performance
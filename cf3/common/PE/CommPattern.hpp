@@ -7,6 +7,10 @@
 #ifndef cf3_common_PE_CommPattern_hpp
 #define cf3_common_PE_CommPattern_hpp
 
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+
 #include "common/Component.hpp"
 #include "common/BoostArray.hpp"
 #include "common/PE/Comm.hpp"
@@ -108,6 +112,16 @@ public:
       dist_struct_flags flags; // bookkeping flags
   };
 
+  /// handle to a synchronization started by begin_synchronize, to be passed to end_synchronize
+  class SyncHandle {
+    public:
+      /// true if the handle refers to a synchronization in progress
+      bool is_active() const { return m_wrapper.get()!=nullptr; }
+    private:
+      friend class CommPattern;
+      Handle<CommWrapper const> m_wrapper;
+  };
+
 
   //@} TYPEDEFS
 
@@ -189,7 +203,7 @@ public:
   void clear( const std::string& name)
   {
     remove_component(name);
-    // anything to be deallocated?
+    free_sync_buffers(name);
   }
 
   //@} END DATA REGISTRATION
@@ -229,6 +243,26 @@ public:
   /// @param name the name of the parallel object
   void synchronize( const CommWrapper& pobj );
 
+  /// start synchronizing the parallel object designated by its name, without waiting for the communication
+  /// the updatable values are packed before returning, so they may be modified afterwards (except with the indexed_datatypes option),
+  /// but the ghost values must not be accessed until end_synchronize is called
+  /// all ranks must start the synchronization of a given object in the same order
+  /// @param name the name of the parallel object
+  /// @return handle to pass to end_synchronize
+  SyncHandle begin_synchronize( const std::string& name );
+
+  /// start synchronizing the parallel object designated by its commwrapper reference
+  /// @see begin_synchronize( const std::string& name )
+  SyncHandle begin_synchronize( const CommWrapper& pobj );
+
+  /// wait for a synchronization started by begin_synchronize to complete and update the ghost values
+  /// @param handle the handle returned by begin_synchronize
+  void end_synchronize( const SyncHandle& handle );
+
+  /// wait for the synchronization of the parallel object designated by its name to complete, if it was started
+  /// @param name the name of the parallel object
+  void end_synchronize( const std::string& name );
+
   /// add element to the commpattern
   /// when all changes done, all needs to be committed by calling setup
   /// if global id is not on current rank, then a ghost is automatically created on current rank
@@ -284,6 +318,10 @@ public:
   /// Return the rank associated with the given local ID
   int rank(const Uint lid) const { return m_ranks[lid]; }
 
+  /// local ids of the items that are sent to other ranks by a synchronization, grouped per receiving rank
+  /// an item appears once for each rank where it is a ghost
+  const std::vector<CPint>& send_map() const { return m_sendMap; }
+
   //@} END ACCESSORS
 
 protected: // helper function
@@ -295,6 +333,41 @@ protected: // helper function
   /// @param rcvbuf vector for intermediate buffer for recieve
   void synchronize_this( const CommWrapper& pobj, std::vector<unsigned char>& sndbuf, std::vector<unsigned char>& rcvbuf );
 
+private: // helper functions
+
+  /// buffers and persistent point to point requests used by begin_synchronize and end_synchronize for one wrapper
+  class SyncBuffers {
+    public:
+      SyncBuffers() : item_size(0), tag(0), in_flight(false), use_datatypes(false) {}
+      int item_size;                     // size in bytes of one item, i.e. size_of()*stride()
+      int tag;                           // message tag, see sync_tag
+      bool in_flight;                    // true between begin_synchronize and end_synchronize
+      bool use_datatypes;                // exchange in place using types, otherwise through sndbuf and rcvbuf
+      std::vector<unsigned char> sndbuf; // send buffer, may not be reallocated while the requests exist
+      std::vector<unsigned char> rcvbuf; // receive buffer, may not be reallocated while the requests exist
+      std::vector<MPI_Datatype> types;   // indexed datatype per neighbour, receives first
+      std::vector<MPI_Request> requests; // one request per neighbour, receives first, persistent when not using datatypes
+      boost::shared_ptr< CommWrapperView<unsigned char> > view; // access to the data while exchanging in place
+  };
+
+  /// compute the neighbouring ranks and their offsets in the send and receive maps
+  void build_plan();
+
+  /// access to the buffers of the given wrapper, which are created on first use
+  SyncBuffers& sync_buffers( const CommWrapper& pobj );
+
+  /// message tag for the exchanges of the wrapper with the given name, allocated on first use
+  /// tags come from a counter that is shared by all patterns, so patterns and wrappers with an exchange in flight
+  /// between the same ranks never use the same tag. Since all ranks start the synchronizations in the same order,
+  /// they allocate the same tags.
+  int sync_tag( const std::string& name );
+
+  /// release the buffers and requests of the wrapper with the given name
+  void free_sync_buffers( const std::string& name );
+
+  /// release the buffers and requests of all wrappers, needed whenever the pattern changes
+  void free_sync_buffers();
+
 private:
 
   /// @name PROPERTIES
@@ -306,6 +379,9 @@ private:
   /// flag telling if pattern are set not to be allowed to change
   bool m_isFreeze;
 
+  /// flag telling if synchronization uses MPI indexed datatypes instead of buffers, linked to an option
+  bool m_indexed_datatypes;
+
   //@} END PROPERTIES
 
   /// @name BUFFERS HOLDING TEMPORARY DATA, TILL SETUP IS CALLED
@@ -349,6 +425,24 @@ private:
   /// Rank for all the gids in local index space
   std::vector<int> m_ranks;
 
+  /// ranks that items are sent to, i.e. ranks with non-zero m_sendCount
+  std::vector< CPint > m_sendRanks;
+
+  /// start of the items for each of m_sendRanks in m_sendMap, with one extra entry for the end
+  std::vector< CPint > m_sendStarts;
+
+  /// ranks that items are received from, i.e. ranks with non-zero m_recvCount
+  std::vector< CPint > m_recvRanks;
+
+  /// start of the items for each of m_recvRanks in m_recvMap, with one extra entry for the end
+  std::vector< CPint > m_recvStarts;
+
+  /// buffers for split-phase synchronization, per wrapper name
+  std::map< std::string, boost::shared_ptr<SyncBuffers> > m_sync_buffers;
+
+  /// message tag of each wrapper name, kept when the buffers are rebuilt
+  std::map< std::string, int > m_sync_tags;
+
 }; // CommPattern
 
 ////////////////////////////////////////////////////////////////////////////////////////////
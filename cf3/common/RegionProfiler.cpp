@@ -0,0 +1,510 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <set>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Component.hpp"
+#include "common/Log.hpp"
+#include "common/RegionProfiler.hpp"
+#include "common/Timer.hpp"
+#include "common/URI.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#ifdef CF3_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Cycle and cache miss counters for the calling thread
+struct PerfCounters
+{
+  PerfCounters() : cycles_fd(-1), cache_misses_fd(-1)
+  {
+#ifdef CF3_OS_LINUX
+    cycles_fd = open_counter(PERF_COUNT_HW_CPU_CYCLES);
+    cache_misses_fd = open_counter(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+  }
+
+  ~PerfCounters()
+  {
+#ifdef CF3_OS_LINUX
+    if(cycles_fd != -1)
+      close(cycles_fd);
+    if(cache_misses_fd != -1)
+      close(cache_misses_fd);
+#endif
+  }
+
+  bool is_valid() const
+  {
+    return cycles_fd != -1 && cache_misses_fd != -1;
+  }
+
+  Real read_cycles() const { return read_counter(cycles_fd); }
+  Real read_cache_misses() const { return read_counter(cache_misses_fd); }
+
+private:
+#ifdef CF3_OS_LINUX
+  static int open_counter(const unsigned long long config)
+  {
+    perf_event_attr attr;
+    std::fill(reinterpret_cast<char*>(&attr), reinterpret_cast<char*>(&attr) + sizeof(attr), 0);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Measure the calling thread, on any CPU
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  static Real read_counter(const int fd)
+  {
+#ifdef CF3_OS_LINUX
+    unsigned long long value = 0;
+    if(fd != -1 && read(fd, &value, sizeof(value)) == sizeof(value))
+      return static_cast<Real>(value);
+#endif
+    return 0.;
+  }
+
+  int cycles_fd;
+  int cache_misses_fd;
+};
+
+/// Escape a string for use in JSON output
+std::string json_string(const std::string& str)
+{
+  std::string result("\"");
+  for(std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    if(*it == '"' || *it == '\\')
+      result += '\\';
+    result += *it;
+  }
+  return result + "\"";
+}
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct RegionProfiler::Implementation
+{
+  Timer timer;
+  boost::mutex mutex;
+  std::map<boost::thread::id, Uint> thread_ids;
+  boost::thread_specific_ptr<detail::PerfCounters> counters;
+
+  Uint thread_id()
+  {
+    const boost::thread::id id = boost::this_thread::get_id();
+    std::map<boost::thread::id, Uint>::const_iterator it = thread_ids.find(id);
+    if(it != thread_ids.end())
+      return it->second;
+    const Uint result = thread_ids.size();
+    thread_ids[id] = result;
+    return result;
+  }
+
+  detail::PerfCounters& thread_counters()
+  {
+    if(counters.get() == nullptr)
+      counters.reset(new detail::PerfCounters());
+    return *counters;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool RegionProfiler::s_enabled = false;
+
+RegionProfiler& RegionProfiler::instance()
+{
+  static RegionProfiler profiler;
+  return profiler;
+}
+
+RegionProfiler::RegionProfiler() :
+  m_trace(false),
+  m_hardware_counters(false),
+  m_implementation(new Implementation())
+{
+}
+
+RegionProfiler::~RegionProfiler()
+{
+  s_enabled = false;
+}
+
+RegionProfiler::RegionStatistics::RegionStatistics() :
+  count(0),
+  total(0.),
+  minimum(std::numeric_limits<Real>::max()),
+  maximum(0.),
+  cycles(0.),
+  cache_misses(0.)
+{
+}
+
+void RegionProfiler::enable()
+{
+  s_enabled = true;
+}
+
+void RegionProfiler::disable()
+{
+  s_enabled = false;
+}
+
+void RegionProfiler::enable_trace(const bool trace)
+{
+  m_trace = trace;
+}
+
+bool RegionProfiler::enable_hardware_counters(const bool counters)
+{
+  if(counters && !m_implementation->thread_counters().is_valid())
+  {
+    CFwarn << "Hardware performance counters are not available, profiling without them" << CFendl;
+    m_hardware_counters = false;
+    return false;
+  }
+
+  m_hardware_counters = counters;
+  return true;
+}
+
+void RegionProfiler::reset()
+{
+  boost::lock_guard<boost::mutex> lock(m_implementation->mutex);
+  // Region ids stay valid, since they may be in use by active regions
+  std::fill(m_statistics.begin(), m_statistics.end(), RegionStatistics());
+  m_trace_events.clear();
+  m_implementation->timer.restart();
+}
+
+Uint RegionProfiler::region_id(const std::string& name)
+{
+  boost::lock_guard<boost::mutex> lock(m_implementation->mutex);
+  std::map<std::string, Uint>::const_iterator it = m_region_ids.find(name);
+  if(it != m_region_ids.end())
+    return it->second;
+
+  const Uint id = m_region_names.size();
+  m_region_ids[name] = id;
+  m_region_names.push_back(name);
+  m_statistics.push_back(RegionStatistics());
+  return id;
+}
+
+Real RegionProfiler::time() const
+{
+  return m_implementation->timer.elapsed();
+}
+
+void RegionProfiler::read_counters(Real& cycles, Real& cache_misses)
+{
+  if(m_hardware_counters)
+  {
+    detail::PerfCounters& counters = m_implementation->thread_counters();
+    cycles = counters.read_cycles();
+    cache_misses = counters.read_cache_misses();
+  }
+  else
+  {
+    cycles = 0.;
+    cache_misses = 0.;
+  }
+}
+
+void RegionProfiler::add_sample(const Uint region, const Real start, const Real cycles, const Real cache_misses)
+{
+  const Real duration = time() - start;
+  Real end_cycles, end_cache_misses;
+  read_counters(end_cycles, end_cache_misses);
+
+  boost::lock_guard<boost::mutex> lock(m_implementation->mutex);
+  RegionStatistics& stats = m_statistics[region];
+  ++stats.count;
+  stats.total += duration;
+  stats.minimum = std::min(stats.minimum, duration);
+  stats.maximum = std::max(stats.maximum, duration);
+  // Counters may have been switched on during the region
+  if(end_cycles >= cycles && end_cache_misses >= cache_misses)
+  {
+    stats.cycles += end_cycles - cycles;
+    stats.cache_misses += end_cache_misses - cache_misses;
+  }
+
+  if(m_trace)
+  {
+    TraceEvent event;
+    event.region = region;
+    event.thread = m_implementation->thread_id();
+    event.start = start;
+    event.duration = duration;
+    m_trace_events.push_back(event);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> RegionProfiler::global_region_names() const
+{
+  std::set<std::string> names(m_region_names.begin(), m_region_names.end());
+
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  {
+    // Exchange all names as a single string, separated by newlines
+    std::string local_names;
+    for(std::vector<std::string>::const_iterator it = m_region_names.begin(); it != m_region_names.end(); ++it)
+      local_names += *it + "\n";
+
+    std::vector<char> send_buf(local_names.begin(), local_names.end());
+    std::vector<char> recv_buf;
+    std::vector<int> recv_sizes(PE::Comm::instance().size(), -1);
+    PE::Comm::instance().all_gather(send_buf, send_buf.size(), recv_buf, recv_sizes);
+
+    std::string::size_type begin = 0;
+    const std::string all_names(recv_buf.begin(), recv_buf.end());
+    for(std::string::size_type end = all_names.find('\n'); end != std::string::npos; end = all_names.find('\n', begin))
+    {
+      names.insert(all_names.substr(begin, end - begin));
+      begin = end + 1;
+    }
+  }
+
+  return std::vector<std::string>(names.begin(), names.end());
+}
+
+std::vector<RegionSummary> RegionProfiler::summary() const
+{
+  const std::vector<std::string> names = global_region_names();
+  const Uint nb_regions = names.size();
+
+  // Local statistics in the global order
+  std::vector<Uint> count(nb_regions, 0);
+  std::vector<Real> total(nb_regions, 0.), call_min(nb_regions, std::numeric_limits<Real>::max()), call_max(nb_regions, 0.);
+  std::vector<Real> cycles(nb_regions, 0.), cache_misses(nb_regions, 0.);
+  for(Uint i = 0; i != nb_regions; ++i)
+  {
+    const std::map<std::string, Uint>::const_iterator it = m_region_ids.find(names[i]);
+    if(it == m_region_ids.end())
+      continue;
+    const RegionStatistics& stats = m_statistics[it->second];
+    count[i] = stats.count;
+    total[i] = stats.total;
+    call_min[i] = stats.minimum;
+    call_max[i] = stats.maximum;
+    cycles[i] = stats.cycles;
+    cache_misses[i] = stats.cache_misses;
+  }
+
+  std::vector<Real> total_min(total), total_max(total), total_sum(total);
+  Real nb_procs = 1.;
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1 && nb_regions != 0)
+  {
+    PE::Comm& comm = PE::Comm::instance();
+    nb_procs = static_cast<Real>(comm.size());
+    comm.all_reduce(PE::plus(), count, count);
+    comm.all_reduce(PE::min(), total, total_min);
+    comm.all_reduce(PE::max(), total, total_max);
+    comm.all_reduce(PE::plus(), total, total_sum);
+    comm.all_reduce(PE::min(), call_min, call_min);
+    comm.all_reduce(PE::max(), call_max, call_max);
+    comm.all_reduce(PE::plus(), cycles, cycles);
+    comm.all_reduce(PE::plus(), cache_misses, cache_misses);
+  }
+
+  std::vector<RegionSummary> result(nb_regions);
+  for(Uint i = 0; i != nb_regions; ++i)
+  {
+    RegionSummary& region = result[i];
+    region.name = names[i];
+    region.count = count[i];
+    region.total_min = total_min[i];
+    region.total_mean = total_sum[i] / nb_procs;
+    region.total_max = total_max[i];
+    region.call_min = count[i] == 0 ? 0. : call_min[i];
+    region.call_max = call_max[i];
+    region.imbalance = region.total_mean > 0. ? region.total_max / region.total_mean : 1.;
+    region.cycles = cycles[i];
+    region.cache_misses = cache_misses[i];
+  }
+
+  return result;
+}
+
+void RegionProfiler::print_summary(std::ostream& os) const
+{
+  const std::vector<RegionSummary> regions = summary();
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().rank() != 0)
+    return;
+
+  os << "Region timings in seconds, with [min, mean, max] of the total over CPUs\n";
+  for(std::vector<RegionSummary>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+  {
+    os << it->name
+       << ": count: " << it->count
+       << ", total: [" << it->total_min << ", " << it->total_mean << ", " << it->total_max << "]"
+       << ", call min: " << it->call_min
+       << ", call max: " << it->call_max
+       << ", imbalance: " << it->imbalance;
+    if(m_hardware_counters)
+      os << ", cycles: " << it->cycles << ", cache misses: " << it->cache_misses;
+    os << "\n";
+  }
+  os << std::flush;
+}
+
+void RegionProfiler::write_json(const URI& file) const
+{
+  const std::vector<RegionSummary> regions = summary();
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().rank() != 0)
+    return;
+
+  std::ofstream fout(file.path().c_str());
+  if(!fout)
+    throw FileSystemError(FromHere(), "Could not open file " + file.path() + " for writing");
+
+  fout << std::setprecision(std::numeric_limits<Real>::digits10) << "{\n  \"regions\": [";
+  for(std::vector<RegionSummary>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+  {
+    fout << (it == regions.begin() ? "\n" : ",\n")
+         << "    {\"name\": " << detail::json_string(it->name)
+         << ", \"count\": " << it->count
+         << ", \"total_min\": " << it->total_min
+         << ", \"total_mean\": " << it->total_mean
+         << ", \"total_max\": " << it->total_max
+         << ", \"call_min\": " << it->call_min
+         << ", \"call_max\": " << it->call_max
+         << ", \"imbalance\": " << it->imbalance
+         << ", \"cycles\": " << it->cycles
+         << ", \"cache_misses\": " << it->cache_misses << "}";
+  }
+  fout << "\n  ],\n  \"nb_procs\": " << (PE::Comm::instance().is_active() ? PE::Comm::instance().size() : 1u) << "\n}\n";
+}
+
+void RegionProfiler::write_chrome_trace(const URI& file) const
+{
+  const std::vector<std::string> names = global_region_names();
+
+  // The timer of each rank started at a different moment, so the times are made relative to a point that is common to all ranks,
+  // i.e. the end of a barrier
+  Real origin = 0.;
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  {
+    PE::Comm::instance().barrier();
+    origin = time();
+  }
+
+  // Pack the local events as region, thread, start, duration, with the region index in the global names
+  std::vector<Real> events;
+  events.reserve(4*m_trace_events.size());
+  for(std::vector<TraceEvent>::const_iterator it = m_trace_events.begin(); it != m_trace_events.end(); ++it)
+  {
+    const Uint global_region = std::lower_bound(names.begin(), names.end(), m_region_names[it->region]) - names.begin();
+    events.push_back(global_region);
+    events.push_back(it->thread);
+    events.push_back(it->start - origin);
+    events.push_back(it->duration);
+  }
+
+  std::vector<Real> all_events;
+  std::vector<int> nb_events;
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  {
+    nb_events.assign(PE::Comm::instance().size(), -1);
+    PE::Comm::instance().gather(events, events.size(), all_events, nb_events, 0);
+    if(PE::Comm::instance().rank() != 0)
+      return;
+  }
+  else
+  {
+    all_events.swap(events);
+    nb_events.assign(1, all_events.size());
+  }
+
+  // Start the trace at the first event, since times relative to the barrier are negative
+  Real first_start = 0.;
+  for(Uint event_idx = 0; event_idx < all_events.size(); event_idx += 4)
+    first_start = std::min(first_start, all_events[event_idx+2]);
+
+  std::ofstream fout(file.path().c_str());
+  if(!fout)
+    throw FileSystemError(FromHere(), "Could not open file " + file.path() + " for writing");
+
+  // Times are in microseconds
+  fout << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+  const char* separator = "\n";
+  Uint event_idx = 0;
+  for(Uint rank = 0; rank != nb_events.size(); ++rank)
+  {
+    const Uint rank_end = event_idx + nb_events[rank];
+    for(; event_idx != rank_end; event_idx += 4)
+    {
+      fout << separator
+           << "{\"name\": " << detail::json_string(names[static_cast<Uint>(all_events[event_idx])])
+           << ", \"ph\": \"X\", \"pid\": " << rank
+           << ", \"tid\": " << static_cast<Uint>(all_events[event_idx+1])
+           << ", \"ts\": " << (all_events[event_idx+2] - first_start)*1e6
+           << ", \"dur\": " << all_events[event_idx+3]*1e6 << "}";
+      separator = ",\n";
+    }
+  }
+  fout << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ScopedRegion::start(const std::string& name)
+{
+  RegionProfiler& profiler = RegionProfiler::instance();
+  m_region = profiler.region_id(name);
+  profiler.read_counters(m_cycles, m_cache_misses);
+  m_start = profiler.time();
+}
+
+void ScopedRegion::start(const Component& component, const char* suffix)
+{
+  start(component.uri().path() + suffix);
+}
+
+void ScopedRegion::stop()
+{
+  RegionProfiler::instance().add_sample(m_region, m_start, m_cycles, m_cache_misses);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
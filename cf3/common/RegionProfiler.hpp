@@ -0,0 +1,200 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_RegionProfiler_hpp
+#define cf3_common_RegionProfiler_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iosfwd>
+#include <map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+class Component;
+class URI;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Statistics of a profiled region, summarized over all ranks
+struct Common_API RegionSummary
+{
+  /// Name of the region
+  std::string name;
+  /// Number of calls, summed over all ranks
+  Uint count;
+  /// Minimum, mean and maximum over the ranks of the total time spent in the region
+  Real total_min, total_mean, total_max;
+  /// Fastest and slowest single call on any rank
+  Real call_min, call_max;
+  /// Load imbalance, as the maximum total time over the mean total time. 1 is perfect balance.
+  Real imbalance;
+  /// Hardware counters, summed over all ranks. Zero if the counters are disabled or unavailable.
+  Real cycles, cache_misses;
+};
+
+/// Lightweight profiler for named regions of code, that can be switched on at runtime.
+/// Regions are delimited using ScopedRegion. For each region, the number of calls and the minimum, maximum and total time are recorded,
+/// optionally with the CPU cycles and cache misses from the Linux perf_event interface.
+/// When tracing is on, each call is also stored as an event, for export to the Chrome trace format (chrome://tracing or Perfetto).
+/// Profiling is controlled through the profile_regions, profile_trace and profile_hardware_counters options of the Environment.
+/// When it is off, a ScopedRegion costs a single test of a static flag.
+class Common_API RegionProfiler : public boost::noncopyable
+{
+public:
+  /// Access the single instance
+  static RegionProfiler& instance();
+
+  /// True if regions are being timed
+  static bool is_enabled() { return s_enabled; }
+
+  /// Start profiling. Previously recorded data are kept.
+  void enable();
+  /// Stop profiling. Recorded data are kept until reset() is called.
+  void disable();
+
+  /// Record each call as a trace event
+  void enable_trace(const bool trace);
+  bool is_trace_enabled() const { return m_trace; }
+
+  /// Read the cycle and cache miss counters in each region
+  /// @return false if the counters are not available on this system
+  bool enable_hardware_counters(const bool counters);
+  bool is_hardware_counters_enabled() const { return m_hardware_counters; }
+
+  /// Remove all recorded data
+  void reset();
+
+  /// Summary of all regions, reduced over all ranks. Collective if PE::Comm is active.
+  /// Regions that are missing on some ranks count as taking zero time on these ranks.
+  std::vector<RegionSummary> summary() const;
+
+  /// Print a table with the summary. Collective, only rank 0 prints.
+  void print_summary(std::ostream& os) const;
+
+  /// Write the summary as JSON. Collective, only rank 0 writes.
+  void write_json(const URI& file) const;
+
+  /// Write the recorded trace events of all ranks in the Chrome trace format, with each rank as a process.
+  /// The clocks of the ranks are aligned at a barrier, and the trace starts at the first event.
+  /// Collective, only rank 0 writes.
+  void write_chrome_trace(const URI& file) const;
+
+private:
+  RegionProfiler();
+  ~RegionProfiler();
+
+  friend class ScopedRegion;
+
+  /// Statistics for one region on this rank
+  struct RegionStatistics
+  {
+    RegionStatistics();
+    Uint count;
+    Real total, minimum, maximum;
+    Real cycles, cache_misses;
+  };
+
+  /// Single call to a region
+  struct TraceEvent
+  {
+    Uint region;
+    Uint thread;
+    Real start;
+    Real duration;
+  };
+
+  /// Called by ScopedRegion
+  Uint region_id(const std::string& name);
+  Real time() const;
+  void read_counters(Real& cycles, Real& cache_misses);
+  void add_sample(const Uint region, const Real start, const Real cycles, const Real cache_misses);
+
+  /// Names of the regions of all ranks, in the same order on all ranks
+  std::vector<std::string> global_region_names() const;
+
+  static bool s_enabled;
+  bool m_trace;
+  bool m_hardware_counters;
+
+  std::map<std::string, Uint> m_region_ids;
+  std::vector<std::string> m_region_names;
+  std::vector<RegionStatistics> m_statistics;
+  std::vector<TraceEvent> m_trace_events;
+
+  /// Implementation details (timer, mutex, thread ids and performance counters)
+  struct Implementation;
+  boost::scoped_ptr<Implementation> m_implementation;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Times the code from its construction to the end of the scope, if the RegionProfiler is enabled.
+/// Example:
+/// @code
+/// {
+///   ScopedRegion region("assembly");
+///   ...
+/// }
+/// @endcode
+class Common_API ScopedRegion : public boost::noncopyable
+{
+public:
+  explicit ScopedRegion(const char* name) : m_active(RegionProfiler::is_enabled())
+  {
+    if(m_active)
+      start(std::string(name));
+  }
+
+  explicit ScopedRegion(const std::string& name) : m_active(RegionProfiler::is_enabled())
+  {
+    if(m_active)
+      start(name);
+  }
+
+  /// Use the path of the component as name, followed by the optional suffix
+  explicit ScopedRegion(const Component& component, const char* suffix = "") : m_active(RegionProfiler::is_enabled())
+  {
+    if(m_active)
+      start(component, suffix);
+  }
+
+  ~ScopedRegion()
+  {
+    if(m_active)
+      stop();
+  }
+
+private:
+  void start(const std::string& name);
+  void start(const Component& component, const char* suffix);
+  void stop();
+
+  const bool m_active;
+  Uint m_region;
+  Real m_start;
+  Real m_cycles;
+  Real m_cache_misses;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_RegionProfiler_hpp
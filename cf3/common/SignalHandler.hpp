@@ -61,6 +61,8 @@ public:
   SignalCPtr signal ( const SignalID& sname ) const;
 
   /// Calls the signal by providing its name and input
+  /// The frame is passed as is, without being encoded. Its options are stored as text in
+  /// the XML tree, so they are converted when added and when read by the signal.
   SignalRet call_signal ( const SignalID& sname, SignalArgs& sinput );
 
   /// Calls the signal by providing its name and input
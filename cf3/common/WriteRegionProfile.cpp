@@ -0,0 +1,61 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <iostream>
+
+#include "common/Builder.hpp"
+#include "common/OptionList.hpp"
+#include "common/RegionProfiler.hpp"
+
+#include "WriteRegionProfile.hpp"
+
+namespace cf3 {
+namespace common {
+
+ComponentBuilder < WriteRegionProfile, Action, LibCommon > WriteRegionProfile_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+WriteRegionProfile::WriteRegionProfile(const std::string& name): Action(name),
+  m_reset(false)
+{
+  options().add("file", m_file)
+    .description("JSON file for the summary of all regions. If empty, the summary is printed.")
+    .pretty_name("File")
+    .link_to(&m_file)
+    .mark_basic();
+
+  options().add("trace_file", m_trace_file)
+    .description("File for the trace events, in the Chrome trace format. Requires the profile_trace option of the Environment.")
+    .pretty_name("Trace File")
+    .link_to(&m_trace_file);
+
+  options().add("reset", m_reset)
+    .description("Clear the recorded data after writing")
+    .pretty_name("Reset")
+    .link_to(&m_reset);
+}
+
+void WriteRegionProfile::execute()
+{
+  RegionProfiler& profiler = RegionProfiler::instance();
+
+  if(m_file.empty())
+    profiler.print_summary(std::cout);
+  else
+    profiler.write_json(m_file);
+
+  if(!m_trace_file.empty())
+    profiler.write_chrome_trace(m_trace_file);
+
+  if(m_reset)
+    profiler.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
@@ -0,0 +1,52 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_WriteRegionProfile_hpp
+#define cf3_common_WriteRegionProfile_hpp
+
+#include "common/Action.hpp"
+#include "common/URI.hpp"
+
+#include "LibCommon.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+/// Outputs the results of the RegionProfiler. Must be executed on all ranks.
+/// The summary is printed if no file is given, otherwise it is written as JSON.
+class Common_API WriteRegionProfile : public Action
+{
+public: // functions
+
+  /// Contructor
+  /// @param name of the component
+  WriteRegionProfile ( const std::string& name );
+
+  /// Get the class name
+  static std::string type_name () { return "WriteRegionProfile"; }
+
+  virtual void execute();
+private:
+  /// JSON file for the summary
+  URI m_file;
+  /// Chrome trace output file
+  URI m_trace_file;
+  /// Reset the profiler after writing
+  bool m_reset;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_WriteRegionProfile_hpp
@@ -0,0 +1,682 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#include "rapidxml/rapidxml.hpp"
+
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+#include "common/TypeInfo.hpp"
+
+#include "common/XML/Protocol.hpp"
+#include "common/XML/SignalFrame.hpp"
+#include "common/XML/XmlDoc.hpp"
+
+#include "common/XML/BinaryFrame.hpp"
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+namespace XML {
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Marks the start of an encoded frame. The last byte is the format version.
+const char magic[] = { 'C', 'F', 'B', 1 };
+const std::size_t magic_size = sizeof(magic);
+
+/// Type of the encoded value of a node
+enum ValueTag
+{
+  VALUE_NONE     = 0,
+  VALUE_STRING   = 1,
+  VALUE_REAL     = 2,
+  VALUE_INTEGER  = 3,
+  VALUE_UNSIGNED = 4,
+  VALUE_BOOL     = 5,
+  VALUE_ARRAY    = 6
+};
+
+/// Encoding of a string reference: a new string that is added to the schema,
+/// a string that is sent in full, or the index in the schema offset by REF_INDEX
+enum StringRef
+{
+  REF_NEW    = 0,
+  REF_INLINE = 1,
+  REF_INDEX  = 2
+};
+
+/// Attributes that describe options or signals, and whose values are likely to be repeated
+bool is_schema_attribute ( const char * name )
+{
+  return std::strcmp( name, Protocol::Tags::attr_key() ) == 0
+      || std::strcmp( name, Protocol::Tags::attr_array_type() ) == 0
+      || std::strcmp( name, Protocol::Tags::attr_array_delimiter() ) == 0
+      || std::strcmp( name, "target" ) == 0
+      || std::strcmp( name, "sender" ) == 0
+      || std::strcmp( name, "receiver" ) == 0
+      || std::strcmp( name, "transaction" ) == 0;
+}
+
+/// Type of the values stored as text under the given type name
+ValueTag value_tag ( const char * type_name )
+{
+  static const std::string real_name = class_name<Real>();
+  static const std::string int_name = class_name<int>();
+  static const std::string uint_name = class_name<Uint>();
+  static const std::string bool_name = class_name<bool>();
+
+  if( real_name == type_name )
+    return VALUE_REAL;
+  if( int_name == type_name )
+    return VALUE_INTEGER;
+  if( uint_name == type_name )
+    return VALUE_UNSIGNED;
+  if( bool_name == type_name )
+    return VALUE_BOOL;
+
+  return VALUE_STRING;
+}
+
+/// Converts the string to TYPE, returning false if converting the result back does not give the same string.
+template<typename TYPE>
+bool exact_value ( const std::string & str, TYPE & value )
+{
+  try
+  {
+    value = from_str<TYPE>( str );
+  }
+  catch ( ... )
+  {
+    return false;
+  }
+
+  return to_str( value ) == str;
+}
+
+/// Reals are sent as double
+template<>
+bool exact_value<Real> ( const std::string & str, Real & value )
+{
+  try
+  {
+    value = from_str<Real>( str );
+  }
+  catch ( ... )
+  {
+    return false;
+  }
+
+  return Real( double(value) ) == value && to_str( value ) == str;
+}
+
+/// Converts each delimited part of the string, returning false if a part is not exact
+template<typename TYPE>
+bool exact_array ( const std::string & str, const std::string & delimiter, std::vector<TYPE> & values )
+{
+  std::size_t begin = 0;
+  while( true )
+  {
+    const std::size_t end = str.find( delimiter, begin );
+    TYPE value;
+    if( !exact_value( str.substr( begin, end == std::string::npos ? std::string::npos : end - begin ), value ) )
+      return false;
+    values.push_back( value );
+    if( end == std::string::npos )
+      return true;
+    begin = end + delimiter.size();
+  }
+}
+
+/// Copies a string to the memory pool of the document, with a null terminator
+char * allocate ( rapidxml::xml_document<> & doc, const char * str, const std::size_t size )
+{
+  char * result = doc.allocate_string( 0, size + 1 );
+  std::memcpy( result, str, size );
+  result[size] = '\0';
+  return result;
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+struct BinaryFrameCodec::Writer
+{
+  Writer ( BinaryFrameCodec & codec, std::string & out ) :
+    m_codec(codec),
+    m_out(out)
+  {
+  }
+
+  void write_byte ( const unsigned char b )
+  {
+    m_out.push_back( static_cast<char>(b) );
+  }
+
+  void write_varint ( boost::uint64_t v )
+  {
+    while( v >= 0x80 )
+    {
+      write_byte( static_cast<unsigned char>(v | 0x80) );
+      v >>= 7;
+    }
+    write_byte( static_cast<unsigned char>(v) );
+  }
+
+  void write_raw_string ( const char * str, const std::size_t size )
+  {
+    write_varint( size );
+    m_out.append( str, size );
+  }
+
+  void write_string_ref ( const char * str, const std::size_t size )
+  {
+    const std::string key( str, size );
+    std::map<std::string, Uint>::const_iterator it = m_codec.m_string_ids.find( key );
+    if( it != m_codec.m_string_ids.end() )
+    {
+      write_varint( it->second + REF_INDEX );
+      return;
+    }
+
+    if( m_codec.m_strings.size() < max_schema_size )
+    {
+      m_codec.m_string_ids[key] = m_codec.m_strings.size();
+      m_codec.m_strings.push_back( key );
+      write_varint( REF_NEW );
+    }
+    else
+    {
+      write_varint( REF_INLINE );
+    }
+
+    write_raw_string( str, size );
+  }
+
+  void write_element ( const Real value )
+  {
+    double d = value;
+    boost::uint64_t bits;
+    std::memcpy( &bits, &d, sizeof(bits) );
+    for( int i = 0; i != 8; ++i )
+      write_byte( static_cast<unsigned char>(bits >> (8*i)) );
+  }
+
+  void write_element ( const int value )
+  {
+    // zigzag encoding, so small negative values stay small
+    const boost::int64_t v = value;
+    write_varint( (static_cast<boost::uint64_t>(v) << 1) ^ static_cast<boost::uint64_t>(v >> 63) );
+  }
+
+  void write_element ( const Uint value )
+  {
+    write_varint( value );
+  }
+
+  void write_element ( const bool value )
+  {
+    write_byte( value ? 1 : 0 );
+  }
+
+  template<typename TYPE>
+  bool write_exact_value ( const ValueTag tag, const std::string & str )
+  {
+    TYPE value;
+    if( !exact_value( str, value ) )
+      return false;
+
+    write_byte( tag );
+    write_element( value );
+    return true;
+  }
+
+  template<typename TYPE>
+  bool write_exact_array ( const ValueTag tag, const std::string & str, const std::string & delimiter )
+  {
+    std::vector<TYPE> values;
+    if( !exact_array( str, delimiter, values ) )
+      return false;
+
+    write_byte( VALUE_ARRAY );
+    write_byte( tag );
+    write_varint( values.size() );
+    for( typename std::vector<TYPE>::const_iterator it = values.begin(); it != values.end(); ++it )
+      write_element( *it );
+    return true;
+  }
+
+  /// Writes the value of the node, in binary form when possible
+  void write_value ( const rapidxml::xml_node<> & node )
+  {
+    if( node.value_size() == 0 )
+    {
+      write_byte( VALUE_NONE );
+      return;
+    }
+
+    const std::string str( node.value(), node.value_size() );
+
+    if( std::strcmp( node.name(), Protocol::Tags::node_array() ) == 0 )
+    {
+      const rapidxml::xml_attribute<> * type_attr = node.first_attribute( Protocol::Tags::attr_array_type() );
+      const rapidxml::xml_attribute<> * delim_attr = node.first_attribute( Protocol::Tags::attr_array_delimiter() );
+      if( type_attr != nullptr && delim_attr != nullptr && delim_attr->value_size() != 0 )
+      {
+        const std::string delimiter( delim_attr->value(), delim_attr->value_size() );
+        bool written = false;
+        switch( value_tag( type_attr->value() ) )
+        {
+          case VALUE_REAL:     written = write_exact_array<Real>( VALUE_REAL, str, delimiter ); break;
+          case VALUE_INTEGER:  written = write_exact_array<int>( VALUE_INTEGER, str, delimiter ); break;
+          case VALUE_UNSIGNED: written = write_exact_array<Uint>( VALUE_UNSIGNED, str, delimiter ); break;
+          case VALUE_BOOL:     written = write_exact_array<bool>( VALUE_BOOL, str, delimiter ); break;
+          default: break;
+        }
+        if( written )
+          return;
+      }
+    }
+    else
+    {
+      bool written = false;
+      switch( value_tag( node.name() ) )
+      {
+        case VALUE_REAL:     written = write_exact_value<Real>( VALUE_REAL, str ); break;
+        case VALUE_INTEGER:  written = write_exact_value<int>( VALUE_INTEGER, str ); break;
+        case VALUE_UNSIGNED: written = write_exact_value<Uint>( VALUE_UNSIGNED, str ); break;
+        case VALUE_BOOL:     written = write_exact_value<bool>( VALUE_BOOL, str ); break;
+        default: break;
+      }
+      if( written )
+        return;
+    }
+
+    write_byte( VALUE_STRING );
+    write_raw_string( node.value(), node.value_size() );
+  }
+
+  void write_node ( const rapidxml::xml_node<> & node )
+  {
+    write_string_ref( node.name(), node.name_size() );
+
+    Uint nb_attributes = 0;
+    for( const rapidxml::xml_attribute<> * attr = node.first_attribute(); attr != nullptr; attr = attr->next_attribute() )
+      ++nb_attributes;
+
+    write_varint( nb_attributes );
+    for( const rapidxml::xml_attribute<> * attr = node.first_attribute(); attr != nullptr; attr = attr->next_attribute() )
+    {
+      write_string_ref( attr->name(), attr->name_size() );
+      if( is_schema_attribute( attr->name() ) )
+        write_string_ref( attr->value(), attr->value_size() );
+      else
+        write_raw_string( attr->value(), attr->value_size() );
+    }
+
+    write_value( node );
+    write_children( node );
+  }
+
+  /// Writes the element children of the node, other node types are skipped
+  void write_children ( const rapidxml::xml_node<> & node )
+  {
+    Uint nb_children = 0;
+    for( const rapidxml::xml_node<> * child = node.first_node(); child != nullptr; child = child->next_sibling() )
+    {
+      if( child->type() == rapidxml::node_element )
+        ++nb_children;
+    }
+
+    write_varint( nb_children );
+    for( const rapidxml::xml_node<> * child = node.first_node(); child != nullptr; child = child->next_sibling() )
+    {
+      if( child->type() == rapidxml::node_element )
+        write_node( *child );
+    }
+  }
+
+  BinaryFrameCodec & m_codec;
+  std::string & m_out;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+struct BinaryFrameCodec::Reader
+{
+  Reader ( BinaryFrameCodec & codec, rapidxml::xml_document<> & doc, const char * data, const std::size_t size ) :
+    m_codec(codec),
+    m_doc(doc),
+    m_pos(data),
+    m_end(data + size)
+  {
+  }
+
+  void check_available ( const std::size_t size )
+  {
+    if( size > std::size_t(m_end - m_pos) )
+      throw XmlError( FromHere(), "Binary frame is truncated" );
+  }
+
+  unsigned char read_byte ()
+  {
+    check_available( 1 );
+    return static_cast<unsigned char>(*m_pos++);
+  }
+
+  boost::uint64_t read_varint ()
+  {
+    boost::uint64_t result = 0;
+    for( int shift = 0; shift < 64; shift += 7 )
+    {
+      const unsigned char b = read_byte();
+      result |= boost::uint64_t(b & 0x7f) << shift;
+      if( (b & 0x80) == 0 )
+        return result;
+    }
+    throw XmlError( FromHere(), "Invalid integer in binary frame" );
+  }
+
+  std::size_t read_size ()
+  {
+    const boost::uint64_t size = read_varint();
+    check_available( size );
+    return size;
+  }
+
+  char * read_raw_string ( std::size_t & size )
+  {
+    size = read_size();
+    char * result = allocate( m_doc, m_pos, size );
+    m_pos += size;
+    return result;
+  }
+
+  char * read_string_ref ( std::size_t & size )
+  {
+    const boost::uint64_t ref = read_varint();
+    if( ref >= REF_INDEX )
+    {
+      if( ref - REF_INDEX >= m_codec.m_strings.size() )
+        throw XmlError( FromHere(), "Binary frame refers to unknown string " + to_str(ref - REF_INDEX) );
+
+      const std::string & str = m_codec.m_strings[ref - REF_INDEX];
+      size = str.size();
+      return allocate( m_doc, str.c_str(), size );
+    }
+
+    char * result = read_raw_string( size );
+    if( ref == REF_NEW )
+    {
+      if( m_codec.m_strings.size() >= max_schema_size )
+        throw XmlError( FromHere(), "Binary frame schema is full" );
+      m_codec.m_strings.push_back( std::string( result, size ) );
+    }
+
+    return result;
+  }
+
+  void read_element ( Real & value )
+  {
+    check_available( 8 );
+    boost::uint64_t bits = 0;
+    for( int i = 0; i != 8; ++i )
+      bits |= boost::uint64_t(read_byte()) << (8*i);
+    double d;
+    std::memcpy( &d, &bits, sizeof(d) );
+    value = d;
+  }
+
+  void read_element ( int & value )
+  {
+    const boost::uint64_t v = read_varint();
+    value = static_cast<int>( static_cast<boost::int64_t>(v >> 1) ^ -static_cast<boost::int64_t>(v & 1) );
+  }
+
+  void read_element ( Uint & value )
+  {
+    value = static_cast<Uint>( read_varint() );
+  }
+
+  void read_element ( bool & value )
+  {
+    value = read_byte() != 0;
+  }
+
+  template<typename TYPE>
+  std::string read_value ()
+  {
+    TYPE value;
+    read_element( value );
+    return to_str( value );
+  }
+
+  template<typename TYPE>
+  std::string read_array ( const std::string & delimiter )
+  {
+    const boost::uint64_t size = read_varint();
+    std::string result;
+    for( boost::uint64_t i = 0; i != size; ++i )
+    {
+      if( i != 0 )
+        result += delimiter;
+      result += read_value<TYPE>();
+    }
+    return result;
+  }
+
+  std::string read_typed_value ( const unsigned char tag )
+  {
+    switch( tag )
+    {
+      case VALUE_REAL:     return read_value<Real>();
+      case VALUE_INTEGER:  return read_value<int>();
+      case VALUE_UNSIGNED: return read_value<Uint>();
+      case VALUE_BOOL:     return read_value<bool>();
+      default:
+        throw XmlError( FromHere(), "Unknown value type " + to_str(Uint(tag)) + " in binary frame" );
+    }
+  }
+
+  void read_value ( rapidxml::xml_node<> & node )
+  {
+    const unsigned char tag = read_byte();
+    std::size_t size = 0;
+    char * value = nullptr;
+
+    if( tag == VALUE_NONE )
+      return;
+
+    if( tag == VALUE_STRING )
+    {
+      value = read_raw_string( size );
+    }
+    else if( tag == VALUE_ARRAY )
+    {
+      const rapidxml::xml_attribute<> * delim_attr = node.first_attribute( Protocol::Tags::attr_array_delimiter() );
+      if( delim_attr == nullptr )
+        throw XmlError( FromHere(), "Binary frame has an array without delimiter" );
+
+      const std::string delimiter( delim_attr->value(), delim_attr->value_size() );
+      std::string str;
+      switch( read_byte() )
+      {
+        case VALUE_REAL:     str = read_array<Real>( delimiter ); break;
+        case VALUE_INTEGER:  str = read_array<int>( delimiter ); break;
+        case VALUE_UNSIGNED: str = read_array<Uint>( delimiter ); break;
+        case VALUE_BOOL:     str = read_array<bool>( delimiter ); break;
+        default:
+          throw XmlError( FromHere(), "Unknown array type in binary frame" );
+      }
+      size = str.size();
+      value = allocate( m_doc, str.c_str(), size );
+    }
+    else
+    {
+      const std::string str = read_typed_value( tag );
+      size = str.size();
+      value = allocate( m_doc, str.c_str(), size );
+    }
+
+    node.value( value, size );
+  }
+
+  rapidxml::xml_node<> * read_node ()
+  {
+    std::size_t name_size = 0;
+    char * name = read_string_ref( name_size );
+    rapidxml::xml_node<> * node = m_doc.allocate_node( rapidxml::node_element );
+    node->name( name, name_size );
+
+    const boost::uint64_t nb_attributes = read_varint();
+    for( boost::uint64_t i = 0; i != nb_attributes; ++i )
+    {
+      std::size_t attr_name_size = 0;
+      std::size_t attr_value_size = 0;
+      char * attr_name = read_string_ref( attr_name_size );
+      char * attr_value = is_schema_attribute( attr_name ) ? read_string_ref( attr_value_size ) : read_raw_string( attr_value_size );
+      node->append_attribute( m_doc.allocate_attribute( attr_name, attr_value, attr_name_size, attr_value_size ) );
+    }
+
+    read_value( *node );
+    read_children( *node );
+
+    return node;
+  }
+
+  void read_children ( rapidxml::xml_node<> & node )
+  {
+    const boost::uint64_t nb_children = read_varint();
+    for( boost::uint64_t i = 0; i != nb_children; ++i )
+      node.append_node( read_node() );
+  }
+
+  BinaryFrameCodec & m_codec;
+  rapidxml::xml_document<> & m_doc;
+  const char * m_pos;
+  const char * m_end;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+BinaryFrameCodec::BinaryFrameCodec()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void BinaryFrameCodec::encode ( SignalFrame & frame, std::string & out )
+{
+  cf3_assert( frame.node.is_valid() );
+  cf3_assert( is_not_null(frame.xml_doc) );
+
+  frame.flush_maps();
+
+  encode( *frame.xml_doc, out );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void BinaryFrameCodec::encode ( const XmlDoc & doc, std::string & out )
+{
+  cf3_assert( doc.is_valid() );
+
+  out.clear();
+  out.append( magic, magic_size );
+
+  // the declaration is not encoded, decode() adds it
+  const Uint initial_schema_size = schema_size();
+  try
+  {
+    Writer writer( *this, out );
+    writer.write_children( *doc.content );
+  }
+  catch ( ... )
+  {
+    rollback_schema( initial_schema_size );
+    out.clear();
+    throw;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr<XmlDoc> BinaryFrameCodec::decode ( const char * data, std::size_t size )
+{
+  cf3_assert( is_not_null(data) );
+
+  if( !is_binary( data, size ) )
+    throw XmlError( FromHere(), "Data is not a binary frame" );
+
+  boost::shared_ptr<XmlDoc> doc( new XmlDoc("1.0", "UTF-8") );
+
+  // a frame that can't be decoded must not leave its strings in the schema
+  const Uint initial_schema_size = schema_size();
+  try
+  {
+    Reader reader( *this, *doc->content->document(), data + magic_size, size - magic_size );
+    reader.read_children( *doc->content );
+
+    if( reader.m_pos != reader.m_end )
+      throw XmlError( FromHere(), "Unexpected data after the end of the binary frame" );
+  }
+  catch ( ... )
+  {
+    rollback_schema( initial_schema_size );
+    throw;
+  }
+
+  return doc;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr<XmlDoc> BinaryFrameCodec::decode ( const std::string & data )
+{
+  return decode( data.data(), data.size() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool BinaryFrameCodec::is_binary ( const char * data, std::size_t size )
+{
+  return size >= magic_size && std::memcmp( data, magic, magic_size ) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void BinaryFrameCodec::reset()
+{
+  m_strings.clear();
+  m_string_ids.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void BinaryFrameCodec::rollback_schema ( const Uint size )
+{
+  cf3_assert( size <= m_strings.size() );
+
+  for( Uint i = size; i != m_strings.size(); ++i )
+    m_string_ids.erase( m_strings[i] );
+
+  m_strings.resize( size );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+} // XML
+} // common
+} // cf3
@@ -0,0 +1,120 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_XML_BinaryFrame_hpp
+#define cf3_common_XML_BinaryFrame_hpp
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+namespace XML {
+
+////////////////////////////////////////////////////////////////////////////
+
+class XmlDoc;
+class SignalFrame;
+
+////////////////////////////////////////////////////////////////////////////
+
+/// Compact binary encoding of signal frames, as an alternative to the XML text.
+/// The encoded data describes the same node tree as the XML, with two differences:
+/// @li values of the @c real, @c integer, @c unsigned and @c bool nodes and the
+/// elements of arrays of these types are stored in binary form. A value is only
+/// converted if converting it back gives exactly the original text, so
+/// decoding always restores the original document.
+/// @li node names, attribute names and the values of the attributes that
+/// describe the options (key, type, delimiter) and the frame target and
+/// sender/receiver are stored in a string table (the schema), that is kept
+/// between frames. Only the first use of a string sends its contents, later
+/// uses only send its index.
+///
+/// Because of the schema, the frames must be decoded in the order they were
+/// encoded, by a codec that has seen the same frames. Each direction of a
+/// connection therefore needs its own pair of codecs. XML remains the format
+/// for the journal and for debugging.
+///
+/// The encoding is only used between processes, by ui::network::TCPConnection.
+/// In-process calls (Component::call_signal, Python wrappers) pass the SignalFrame itself,
+/// whose option values are still stored as text by SignalOptions and Map.
+class Common_API BinaryFrameCodec
+{
+public:
+
+  /// Maximum number of strings in the schema. Strings that don't fit are sent
+  /// in full each time.
+  static const Uint max_schema_size = 4096;
+
+  /// Constructor, with an empty schema
+  BinaryFrameCodec();
+
+  /// Encodes a frame. @c flush_maps() is called on the frame before encoding.
+  /// @param frame The frame to encode. Must be valid.
+  /// @param out String where the data is written. It is cleared first.
+  void encode ( SignalFrame & frame, std::string & out );
+
+  /// Encodes all elements of a document
+  /// @param doc The document to encode.
+  /// @param out String where the data is written. It is cleared first.
+  void encode ( const XmlDoc & doc, std::string & out );
+
+  /// Decodes data produced by @c encode().
+  /// @param data The encoded data.
+  /// @param size Size of the data, in bytes.
+  /// @return Returns a shared pointer with the built XML document.
+  /// @throw XmlError If the data is not valid.
+  boost::shared_ptr<XmlDoc> decode ( const char * data, std::size_t size );
+
+  /// Decodes data produced by @c encode().
+  boost::shared_ptr<XmlDoc> decode ( const std::string & data );
+
+  /// Checks if data starts like an encoded frame.
+  static bool is_binary ( const char * data, std::size_t size );
+
+  /// Clears the schema. Both ends must be reset at the same point in the frame sequence.
+  void reset();
+
+  /// Number of strings in the schema
+  Uint schema_size() const { return m_strings.size(); }
+
+  /// Removes the strings that were added to the schema after it had the given size.
+  /// Used to undo the encoding of a frame that was not sent after all.
+  /// @param size The schema size to return to, as given by @c schema_size()
+  void rollback_schema ( const Uint size );
+
+private:
+
+  /// Helper classes for reading and writing
+  struct Reader;
+  struct Writer;
+
+  /// Strings in the schema, in the order they were added
+  std::vector<std::string> m_strings;
+
+  /// Index of each string in the schema, only used when encoding
+  std::map<std::string, Uint> m_string_ids;
+
+}; // BinaryFrameCodec
+
+////////////////////////////////////////////////////////////////////////////
+
+} // XML
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_XML_BinaryFrame_hpp
@@ -121,6 +121,7 @@ void AnalyticalFunction::parse (const std::string& function)
     msg += " Vars     [" + ss.str() + "]\n";
     throw common::ParsingFailed (FromHere(),msg);
   }
+  m_compiled.compile(*m_parser);
   m_is_parsed = true;
 }
 
@@ -149,6 +150,7 @@ void AnalyticalFunction::parse_and_deduce_variables (const std::string& function
     msg += " Vars     [" + ss.str() + "]\n";
     throw common::ParsingFailed (FromHere(),msg);
   }
+  m_compiled.compile(*m_parser);
   m_is_parsed = true;
 }
 
@@ -170,6 +172,17 @@ void AnalyticalFunction::parse (const std::string& function, const std::string&
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void AnalyticalFunction::evaluate_batch(const RealMatrix& var_values, RealVector& ret_values) const
+{
+  cf3_assert(m_is_parsed);
+  cf3_assert(static_cast<Uint>(var_values.cols()) == m_vars.size());
+
+  ret_values.resize(var_values.rows());
+  m_compiled.evaluate(var_values.data(), var_values.rows(), var_values.rows(), ret_values.data());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // math
 } // cf3
 
@@ -13,6 +13,7 @@
 
 #include "math/LibMath.hpp"
 #include "math/MatrixTypes.hpp"
+#include "math/CompiledFunction.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -89,6 +90,11 @@ public: // functions
   template <typename var_t>
   Real operator()(const var_t& var_values) const;
 
+  /// Evaluate the Analytical Function in many points at once, using the compiled form of the function.
+  /// @param var_values values of the variables, with one row for each point and one column for each variable.
+  /// @param ret_values the result for each point. Resized if needed.
+  void evaluate_batch(const RealMatrix& var_values, RealVector& ret_values) const;
+
 protected: // helper functions
 
   /// Clears the m_parser deallocating the memory.
@@ -108,6 +114,9 @@ private: // data
   /// vector holding the parsers, one for each entry in the vector
   boost::shared_ptr<FunctionParser> m_parser;
 
+  /// compiled form of the parser, for the batch evaluation
+  CompiledFunction m_compiled;
+
 }; // AnalyticalFunction
 
 ////////////////////////////////////////////////////////////////////////////////
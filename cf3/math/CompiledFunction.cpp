@@ -0,0 +1,457 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include "fparser/fpconfig.hh"
+#include "fparser/fparser.hh"
+#include "fparser/extrasrc/fptypes.hh"
+#include "fparser/extrasrc/fpaux.hh"
+
+#include "common/Assertions.hpp"
+
+#include "math/CompiledFunction.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace FUNCTIONPARSERTYPES;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Gives access to the bytecode of a parser, which fparser only exposes to derived classes
+struct ParserData : FunctionParser
+{
+  typedef FunctionParser::Data DataT;
+
+  static DataT& get(FunctionParser& parser)
+  {
+    return *(parser.*(&ParserData::getParserData))();
+  }
+};
+
+bool is_unary(const unsigned op)
+{
+  switch(op)
+  {
+    case cAbs: case cAcos: case cAcosh: case cAsin: case cAsinh: case cAtan: case cAtanh:
+    case cCbrt: case cCeil: case cCos: case cCosh: case cCot: case cCsc: case cExp: case cExp2:
+    case cFloor: case cInt: case cLog: case cLog10: case cLog2: case cSec: case cSin: case cSinh:
+    case cSqrt: case cTan: case cTanh: case cTrunc: case cNeg: case cNot: case cNotNot:
+    case cDeg: case cRad: case cAbsNot: case cAbsNotNot: case cInv: case cSqr: case cRSqrt:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool is_binary(const unsigned op)
+{
+  switch(op)
+  {
+    case cAtan2: case cHypot: case cMax: case cMin: case cPow: case cAdd: case cSub: case cMul:
+    case cDiv: case cMod: case cEqual: case cNEqual: case cLess: case cLessOrEq: case cGreater:
+    case cGreaterOrEq: case cAnd: case cOr: case cLog2by: case cAbsAnd: case cAbsOr: case cRDiv:
+    case cRSub:
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Uint CompiledFunction::block_size;
+
+CompiledFunction::CompiledFunction() :
+  m_parser(nullptr),
+  m_nb_vars(0),
+  m_nb_slots(0),
+  m_result_slot(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CompiledFunction::compile(FunctionParser& parser)
+{
+  m_parser = &parser;
+  m_program.clear();
+  m_constants.clear();
+  m_nb_slots = 0;
+  m_result_slot = 0;
+
+  const ParserData::DataT& data = ParserData::get(parser);
+  cf3_assert(data.mParseErrorType == FunctionParser::FP_NO_ERROR);
+  m_nb_vars = data.mVariablesAmount;
+  m_constants = data.mImmed;
+
+  // Follow the stack pointer through the bytecode, which gives a fixed slot for each operand
+  const std::vector<unsigned>& bytecode = data.mByteCode;
+  std::vector<Instruction> program;
+  program.reserve(bytecode.size());
+  int sp = -1;
+  Uint nb_slots = 0;
+  Uint dp = 0;
+  for(Uint ip = 0; ip != bytecode.size(); ++ip)
+  {
+    const unsigned op = bytecode[ip];
+    Instruction instruction = { op, 0, 0, 0 };
+    if(is_unary(op))
+    {
+      instruction.target = instruction.arg1 = sp;
+    }
+    else if(is_binary(op))
+    {
+      instruction.target = instruction.arg1 = sp-1;
+      instruction.arg2 = sp;
+      --sp;
+    }
+    else if(op == cImmed)
+    {
+      instruction.target = ++sp;
+      instruction.arg1 = dp++;
+    }
+    else if(op >= VarBegin)
+    {
+      instruction.opcode = VarBegin;
+      instruction.target = ++sp;
+      instruction.arg1 = op - VarBegin;
+    }
+    else if(op == cDup)
+    {
+      instruction.arg1 = sp;
+      instruction.target = ++sp;
+    }
+    else if(op == cFetch)
+    {
+      instruction.arg1 = bytecode[++ip];
+      instruction.target = ++sp;
+    }
+    else if(op == cPopNMov)
+    {
+      instruction.target = bytecode[++ip];
+      instruction.arg1 = bytecode[++ip];
+      sp = instruction.target;
+    }
+    else if(op == cSinCos || op == cSinhCosh)
+    {
+      // The sine goes to the current slot, the cosine to the next one
+      instruction.target = instruction.arg1 = sp;
+      instruction.arg2 = ++sp;
+    }
+    else if(op == cNop)
+    {
+      continue;
+    }
+    else
+    {
+      // Branches and calls to other functions: evaluate point by point
+      return;
+    }
+    program.push_back(instruction);
+    nb_slots = std::max(nb_slots, Uint(sp+1));
+  }
+
+  if(sp != 0)
+    return;
+
+  m_program.swap(program);
+  m_nb_slots = nb_slots;
+  m_result_slot = sp;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CompiledFunction::evaluate(const Real* vars, const Uint var_stride, const Uint nb_points, Real* result) const
+{
+  cf3_assert(is_compiled());
+
+  if(!is_vectorized())
+  {
+    evaluate_points(vars, var_stride, nb_points, result);
+    return;
+  }
+
+  // Stack slots for one block of points
+  std::vector<Real> stack(m_nb_slots*block_size);
+  std::vector<char> error(block_size);
+  for(Uint begin = 0; begin < nb_points; begin += block_size)
+  {
+    evaluate_block(vars + begin, var_stride, std::min(block_size, nb_points - begin), &stack[0], &error[0], result + begin);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CompiledFunction::evaluate_points(const Real* vars, const Uint var_stride, const Uint nb_points, Real* result) const
+{
+  std::vector<Real> point_vars(std::max(m_nb_vars, Uint(1)));
+  for(Uint p = 0; p != nb_points; ++p)
+  {
+    for(Uint v = 0; v != m_nb_vars; ++v)
+      point_vars[v] = vars[v*var_stride + p];
+    result[p] = m_parser->Eval(&point_vars[0]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CompiledFunction::evaluate_block(const Real* vars, const Uint var_stride, const Uint n, Real* stack, char* error, Real* result) const
+{
+  std::fill(error, error+n, 0);
+
+  // Operations with a domain check in FunctionParser::Eval flag the error and continue with a valid argument,
+  // so no floating point exception is raised for the points that evaluate to 0
+  const std::vector<Instruction>::const_iterator program_end = m_program.end();
+  for(std::vector<Instruction>::const_iterator instruction = m_program.begin(); instruction != program_end; ++instruction)
+  {
+    Real* t = stack + instruction->target*block_size;
+    const Real* a = stack + instruction->arg1*block_size;
+    const Real* b = stack + instruction->arg2*block_size;
+    switch(instruction->opcode)
+    {
+      case VarBegin:
+      {
+        const Real* var = vars + instruction->arg1*var_stride;
+        std::copy(var, var+n, t);
+        break;
+      }
+      case cImmed:
+        std::fill(t, t+n, m_constants[instruction->arg1]);
+        break;
+      case cDup:
+      case cFetch:
+      case cPopNMov:
+        std::copy(a, a+n, t);
+        break;
+
+      case cNeg: for(Uint i = 0; i != n; ++i) t[i] = -a[i]; break;
+      case cAdd: for(Uint i = 0; i != n; ++i) t[i] = a[i] + b[i]; break;
+      case cSub: for(Uint i = 0; i != n; ++i) t[i] = a[i] - b[i]; break;
+      case cRSub: for(Uint i = 0; i != n; ++i) t[i] = b[i] - a[i]; break;
+      case cMul: for(Uint i = 0; i != n; ++i) t[i] = a[i] * b[i]; break;
+      case cSqr: for(Uint i = 0; i != n; ++i) t[i] = a[i] * a[i]; break;
+      case cDiv:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = b[i] == 0.;
+          error[i] |= bad;
+          t[i] = a[i] / (bad ? 1. : b[i]);
+        }
+        break;
+      case cRDiv:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] == 0.;
+          error[i] |= bad;
+          t[i] = b[i] / (bad ? 1. : a[i]);
+        }
+        break;
+      case cInv:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] == 0.;
+          error[i] |= bad;
+          t[i] = 1. / (bad ? 1. : a[i]);
+        }
+        break;
+      case cMod:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = b[i] == 0.;
+          error[i] |= bad;
+          t[i] = fp_mod(a[i], bad ? 1. : b[i]);
+        }
+        break;
+      case cPow:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] == 0. && b[i] < 0.;
+          error[i] |= bad;
+          t[i] = fp_pow(bad ? 1. : a[i], b[i]);
+        }
+        break;
+
+      case cSqrt:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] < 0.;
+          error[i] |= bad;
+          t[i] = fp_sqrt(bad ? 0. : a[i]);
+        }
+        break;
+      case cRSqrt:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] == 0.;
+          error[i] |= bad;
+          t[i] = 1. / fp_sqrt(bad ? 1. : a[i]);
+        }
+        break;
+      case cLog:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = !(a[i] > 0.);
+          error[i] |= bad;
+          t[i] = fp_log(bad ? 1. : a[i]);
+        }
+        break;
+      case cLog10:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = !(a[i] > 0.);
+          error[i] |= bad;
+          t[i] = fp_log10(bad ? 1. : a[i]);
+        }
+        break;
+      case cLog2:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = !(a[i] > 0.);
+          error[i] |= bad;
+          t[i] = fp_log2(bad ? 1. : a[i]);
+        }
+        break;
+      case cLog2by:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = !(a[i] > 0.);
+          error[i] |= bad;
+          t[i] = fp_log2(bad ? 1. : a[i]) * b[i];
+        }
+        break;
+      case cExp: for(Uint i = 0; i != n; ++i) t[i] = fp_exp(a[i]); break;
+      case cExp2: for(Uint i = 0; i != n; ++i) t[i] = fp_exp2(a[i]); break;
+      case cCbrt: for(Uint i = 0; i != n; ++i) t[i] = fp_cbrt(a[i]); break;
+      case cHypot: for(Uint i = 0; i != n; ++i) t[i] = fp_hypot(a[i], b[i]); break;
+
+      case cSin: for(Uint i = 0; i != n; ++i) t[i] = fp_sin(a[i]); break;
+      case cCos: for(Uint i = 0; i != n; ++i) t[i] = fp_cos(a[i]); break;
+      case cTan: for(Uint i = 0; i != n; ++i) t[i] = fp_tan(a[i]); break;
+      case cSinCos:
+        for(Uint i = 0; i != n; ++i) fp_sinCos(t[i], stack[instruction->arg2*block_size + i], a[i]);
+        break;
+      case cCot:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const Real tangent = fp_tan(a[i]);
+          const bool bad = tangent == 0.;
+          error[i] |= bad;
+          t[i] = 1. / (bad ? 1. : tangent);
+        }
+        break;
+      case cCsc:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const Real sine = fp_sin(a[i]);
+          const bool bad = sine == 0.;
+          error[i] |= bad;
+          t[i] = 1. / (bad ? 1. : sine);
+        }
+        break;
+      case cSec:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const Real cosine = fp_cos(a[i]);
+          const bool bad = cosine == 0.;
+          error[i] |= bad;
+          t[i] = 1. / (bad ? 1. : cosine);
+        }
+        break;
+      case cAsin:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] < -1. || a[i] > 1.;
+          error[i] |= bad;
+          t[i] = fp_asin(bad ? 0. : a[i]);
+        }
+        break;
+      case cAcos:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] < -1. || a[i] > 1.;
+          error[i] |= bad;
+          t[i] = fp_acos(bad ? 0. : a[i]);
+        }
+        break;
+      case cAtan: for(Uint i = 0; i != n; ++i) t[i] = fp_atan(a[i]); break;
+      case cAtan2: for(Uint i = 0; i != n; ++i) t[i] = fp_atan2(a[i], b[i]); break;
+
+      case cSinh: for(Uint i = 0; i != n; ++i) t[i] = fp_sinh(a[i]); break;
+      case cCosh: for(Uint i = 0; i != n; ++i) t[i] = fp_cosh(a[i]); break;
+      case cTanh: for(Uint i = 0; i != n; ++i) t[i] = fp_tanh(a[i]); break;
+      case cSinhCosh:
+        for(Uint i = 0; i != n; ++i) fp_sinhCosh(t[i], stack[instruction->arg2*block_size + i], a[i]);
+        break;
+      case cAsinh: for(Uint i = 0; i != n; ++i) t[i] = fp_asinh(a[i]); break;
+      case cAcosh:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] < 1.;
+          error[i] |= bad;
+          t[i] = fp_acosh(bad ? 1. : a[i]);
+        }
+        break;
+      case cAtanh:
+        for(Uint i = 0; i != n; ++i)
+        {
+          const bool bad = a[i] <= -1. || a[i] >= 1.;
+          error[i] |= bad;
+          t[i] = fp_atanh(bad ? 0. : a[i]);
+        }
+        break;
+
+      case cAbs: for(Uint i = 0; i != n; ++i) t[i] = fp_abs(a[i]); break;
+      case cCeil: for(Uint i = 0; i != n; ++i) t[i] = fp_ceil(a[i]); break;
+      case cFloor: for(Uint i = 0; i != n; ++i) t[i] = fp_floor(a[i]); break;
+      case cTrunc: for(Uint i = 0; i != n; ++i) t[i] = fp_trunc(a[i]); break;
+      case cInt: for(Uint i = 0; i != n; ++i) t[i] = fp_int(a[i]); break;
+      case cMin: for(Uint i = 0; i != n; ++i) t[i] = fp_min(a[i], b[i]); break;
+      case cMax: for(Uint i = 0; i != n; ++i) t[i] = fp_max(a[i], b[i]); break;
+      case cDeg: for(Uint i = 0; i != n; ++i) t[i] = RadiansToDegrees(a[i]); break;
+      case cRad: for(Uint i = 0; i != n; ++i) t[i] = DegreesToRadians(a[i]); break;
+
+      case cEqual: for(Uint i = 0; i != n; ++i) t[i] = fp_equal(a[i], b[i]); break;
+      case cNEqual: for(Uint i = 0; i != n; ++i) t[i] = fp_nequal(a[i], b[i]); break;
+      case cLess: for(Uint i = 0; i != n; ++i) t[i] = fp_less(a[i], b[i]); break;
+      case cLessOrEq: for(Uint i = 0; i != n; ++i) t[i] = fp_lessOrEq(a[i], b[i]); break;
+      case cGreater: for(Uint i = 0; i != n; ++i) t[i] = fp_less(b[i], a[i]); break;
+      case cGreaterOrEq: for(Uint i = 0; i != n; ++i) t[i] = fp_lessOrEq(b[i], a[i]); break;
+      case cNot: for(Uint i = 0; i != n; ++i) t[i] = fp_not(a[i]); break;
+      case cNotNot: for(Uint i = 0; i != n; ++i) t[i] = fp_notNot(a[i]); break;
+      case cAnd: for(Uint i = 0; i != n; ++i) t[i] = fp_and(a[i], b[i]); break;
+      case cOr: for(Uint i = 0; i != n; ++i) t[i] = fp_or(a[i], b[i]); break;
+      case cAbsNot: for(Uint i = 0; i != n; ++i) t[i] = fp_absNot(a[i]); break;
+      case cAbsNotNot: for(Uint i = 0; i != n; ++i) t[i] = fp_absNotNot(a[i]); break;
+      case cAbsAnd: for(Uint i = 0; i != n; ++i) t[i] = fp_absAnd(a[i], b[i]); break;
+      case cAbsOr: for(Uint i = 0; i != n; ++i) t[i] = fp_absOr(a[i], b[i]); break;
+
+      default:
+        cf3_assert_desc("Unexpected opcode in compiled function", false);
+    }
+  }
+
+  const Real* values = stack + m_result_slot*block_size;
+  for(Uint i = 0; i != n; ++i)
+    result[i] = error[i] ? 0. : values[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // math
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
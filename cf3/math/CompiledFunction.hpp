@@ -0,0 +1,93 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_CompiledFunction_hpp
+#define cf3_Math_CompiledFunction_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include "fparser/fparser.hh"
+
+#include "math/LibMath.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Evaluates a parsed function for many points at once.
+/// The bytecode of the parser is translated once into a list of operations on fixed stack slots,
+/// where each slot holds the values for a block of points. Each operation is then a simple loop
+/// over the block, which the compiler can vectorize, and the variables are read directly from the
+/// arrays passed by the caller instead of being copied for each point.
+/// Functions that need branching (if, user-defined functions) can not be translated, and are evaluated
+/// point by point by the parser. As in FunctionParser::Eval, points with a domain error
+/// (division by zero, logarithm of a negative number, ...) evaluate to 0.
+class Math_API CompiledFunction
+{
+public:
+  /// Number of points evaluated together
+  static const Uint block_size = 64;
+
+  CompiledFunction();
+
+  /// Translate the bytecode of the given parser, which must have been parsed without errors.
+  /// The parser is also used for the functions that can't be translated, so it must outlive this object.
+  void compile(FunctionParser& parser);
+
+  /// True if compile was called
+  bool is_compiled() const { return m_parser != nullptr; }
+
+  /// True if the function was translated, false if it is evaluated point by point
+  bool is_vectorized() const { return !m_program.empty(); }
+
+  /// Number of variables of the function
+  Uint nb_vars() const { return m_nb_vars; }
+
+  /// Evaluate the function in a number of points.
+  /// @param vars Values of the variables. Variable v of point p is at vars[v*var_stride + p]
+  /// @param var_stride Distance between the values of two variables, at least nb_points
+  /// @param nb_points Number of points to evaluate
+  /// @param result Output, the result for point p is stored in result[p]
+  void evaluate(const Real* vars, const Uint var_stride, const Uint nb_points, Real* result) const;
+
+private:
+  /// Operation on the stack slots. The opcode is the fparser opcode,
+  /// with cImmed loading constant arg1 and VarBegin loading variable arg1.
+  struct Instruction
+  {
+    unsigned opcode;
+    Uint target;
+    Uint arg1;
+    Uint arg2;
+  };
+
+  /// Evaluate a block of at most block_size points
+  void evaluate_block(const Real* vars, const Uint var_stride, const Uint nb_points, Real* stack, char* error, Real* result) const;
+
+  /// Evaluate the points one by one using the parser
+  void evaluate_points(const Real* vars, const Uint var_stride, const Uint nb_points, Real* result) const;
+
+  FunctionParser* m_parser;
+  Uint m_nb_vars;
+  Uint m_nb_slots;
+  Uint m_result_slot;
+  std::vector<Instruction> m_program;
+  std::vector<Real> m_constants;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // math
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_Math_CompiledFunction_hpp
@@ -0,0 +1,118 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_AssemblyPlan_hpp
+#define cf3_Math_LSS_AssemblyPlan_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file AssemblyPlan.hpp Cache for the matrix storage positions used in LSS::Matrix::add_values
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Stores, for each distinct list of block indices passed to a matrix, a list of positions in the matrix storage.
+/// Since the positions only depend on the indices and on the sparsity pattern, the lookup of the positions in the matrix graph only
+/// needs to happen the first time an element is assembled. The meaning of the positions is up to the matrix implementation.
+/// The plan must be cleared each time the sparsity pattern changes.
+class AssemblyPlan
+{
+public:
+  AssemblyPlan() : m_enabled(false) {}
+
+  /// Caching is disabled by default, since the plan can take as much memory as the matrix itself
+  bool is_enabled() const { return m_enabled; }
+  void enable(const bool enabled)
+  {
+    m_enabled = enabled;
+    if(!enabled)
+      clear();
+  }
+
+  /// Positions for the given indices, or null if they were not stored yet or were stored as a miss
+  const int* find(const std::vector<Uint>& indices) const
+  {
+    const EntriesT::const_iterator it = m_entries.find(indices);
+    return it == m_entries.end() || it->second == miss ? nullptr : &m_positions[it->second];
+  }
+
+  /// Look up the given indices, telling apart indices that were never stored from stored misses
+  /// @param positions Set to the stored positions, or to null for a miss
+  /// @return false if the indices were not stored yet
+  bool lookup(const std::vector<Uint>& indices, const int*& positions) const
+  {
+    const EntriesT::const_iterator it = m_entries.find(indices);
+    if(it == m_entries.end())
+      return false;
+    positions = it->second == miss ? nullptr : &m_positions[it->second];
+    return true;
+  }
+
+  /// Store the positions for the given indices
+  /// @return A pointer to the stored positions, valid until the next call to insert or clear
+  const int* insert(const std::vector<Uint>& indices, const std::vector<int>& positions)
+  {
+    const Uint start = m_positions.size();
+    m_positions.insert(m_positions.end(), positions.begin(), positions.end());
+    m_entries[indices] = start;
+    return &m_positions[start];
+  }
+
+  /// Store that no positions can be used for the given indices, so the matrix takes its default code path
+  /// without repeating the lookup
+  void insert_miss(const std::vector<Uint>& indices)
+  {
+    m_entries[indices] = miss;
+  }
+
+  /// Remove all stored positions
+  void clear()
+  {
+    EntriesT().swap(m_entries);
+    std::vector<int>().swap(m_positions);
+  }
+
+  /// Number of distinct index lists in the plan
+  Uint size() const { return m_entries.size(); }
+
+private:
+  typedef boost::unordered_map<std::vector<Uint>, Uint, boost::hash< std::vector<Uint> > > EntriesT;
+
+  /// Start value for index lists stored as a miss
+  static const Uint miss = static_cast<Uint>(-1);
+
+  bool m_enabled;
+
+  /// Start of the positions in m_positions for each index list
+  EntriesT m_entries;
+
+  /// All positions, stored back to back
+  std::vector<int> m_positions;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_AssemblyPlan_hpp
@@ -47,6 +47,10 @@ public:
   /// Accessor to the flag if matrix, solution and rhs are tied together or not
   virtual const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) = 0;
 
+  /// True if set_values and add_values may be called from several threads at once, as long as the calls that run at the same
+  /// time don't share any block row. Implementations that use internal scratch storage for these calls keep the default.
+  virtual bool concurrent_assembly() { return false; }
+
   /// Default constructor
   Matrix(const std::string& name) : Component(name) { }
 
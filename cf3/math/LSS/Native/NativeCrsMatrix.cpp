@@ -0,0 +1,721 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/bind.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/PropertyList.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/Consts.hpp"
+#include "math/VariablesDescriptor.hpp"
+
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeCrsMatrix.cpp implementation of LSS::NativeCrsMatrix
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeCrsMatrix, LSS::Matrix, LSS::LibLSS > NativeCrsMatrix_Builder;
+
+NativeCrsMatrix::NativeCrsMatrix(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.NativeVector"));
+
+  options().add("assembly_plan", false)
+    .pretty_name("Assembly Plan")
+    .description("Remember the position in the matrix storage of each block passed to add_values, so that assembling the same element again does not need any lookup in the matrix graph.")
+    .attach_trigger(boost::bind(&NativeCrsMatrix::trigger_assembly_plan, this));
+
+  options().add("nb_threads", 0u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads for the matrix-vector product and the vector operations of the native solvers. 0 uses one thread per hardware thread.")
+    .attach_trigger(boost::bind(&NativeCrsMatrix::trigger_nb_threads, this))
+    .mark_basic();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::trigger_assembly_plan()
+{
+  m_assembly_plan.enable(options().value<bool>("assembly_plan"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::trigger_nb_threads()
+{
+  m_thread_team.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+LSS::detail::ThreadTeam& NativeCrsMatrix::thread_team()
+{
+  if(!m_thread_team)
+    m_thread_team.reset(new LSS::detail::ThreadTeam(options().value<Uint>("nb_threads")));
+  return *m_thread_team;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  const Uint nb_rows = LSS::detail::create_row_map(cp, periodic_links_nodes, periodic_links_active, m_node_to_row);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(starting_indices.size() == nb_nodes+1);
+
+  m_row_to_node.assign(nb_rows, math::Consts::uint_max());
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(m_row_to_node[m_node_to_row[i]] == math::Consts::uint_max())
+      m_row_to_node[m_node_to_row[i]] = i;
+  }
+
+  // Columns for each row. Periodic nodes contribute their connections to the row they share.
+  std::vector< std::vector<Uint> > row_columns(nb_rows);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    std::vector<Uint>& columns = row_columns[m_node_to_row[i]];
+    columns.push_back(m_node_to_row[i]);
+    for(Uint j = starting_indices[i]; j != starting_indices[i+1]; ++j)
+      columns.push_back(m_node_to_row[node_connectivity[j]]);
+  }
+
+  m_row_starts.resize(nb_rows+1);
+  m_row_starts[0] = 0;
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    std::vector<Uint>& columns = row_columns[row];
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+    m_row_starts[row+1] = m_row_starts[row] + columns.size();
+  }
+
+  m_block_columns.clear();
+  m_block_columns.reserve(m_row_starts.back());
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    m_block_columns.insert(m_block_columns.end(), row_columns[row].begin(), row_columns[row].end());
+    std::vector<Uint>().swap(row_columns[row]);
+  }
+
+  m_diagonal_blocks.resize(nb_rows);
+  for(Uint row = 0; row != nb_rows; ++row)
+    m_diagonal_blocks[row] = find_block(row, row);
+
+  m_neq = neq;
+  m_values.assign(m_block_columns.size()*m_neq*m_neq, 0.);
+  m_assembly_plan.clear();
+  m_symmetric_dirichlet_values.clear();
+  m_is_created = true;
+
+  CFdebug << "Created a " << nb_rows*m_neq << " x " << nb_rows*m_neq << " native matrix with " << m_block_columns.size() << " blocks of size " << m_neq << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), node_connectivity, starting_indices, solution, rhs, periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::destroy()
+{
+  std::vector<Uint>().swap(m_node_to_row);
+  std::vector<Uint>().swap(m_row_to_node);
+  std::vector<Uint>().swap(m_row_starts);
+  std::vector<Uint>().swap(m_block_columns);
+  std::vector<Uint>().swap(m_diagonal_blocks);
+  std::vector<Real>().swap(m_values);
+  m_symmetric_dirichlet_values.clear();
+  m_assembly_plan.clear();
+  m_neq=0;
+  m_is_created=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeCrsMatrix::find_block(const Uint row, const Uint col) const
+{
+  const std::vector<Uint>::const_iterator begin = m_block_columns.begin() + m_row_starts[row];
+  const std::vector<Uint>::const_iterator end = m_block_columns.begin() + m_row_starts[row+1];
+  const std::vector<Uint>::const_iterator found = std::lower_bound(begin, end, col);
+  if(found == end || *found != col)
+    return math::Consts::uint_max();
+  return found - m_block_columns.begin();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeCrsMatrix::get_block(const Uint row, const Uint col) const
+{
+  const Uint block = find_block(row, col);
+  if(block == math::Consts::uint_max())
+    throw common::BadValue(FromHere(),"Trying to access an illegal entry.");
+  return block;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  const Uint block = get_block(m_node_to_row[irow/m_neq], m_node_to_row[icol/m_neq]);
+  m_values[(block*m_neq + irow%m_neq)*m_neq + icol%m_neq] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  const Uint block = get_block(m_node_to_row[irow/m_neq], m_node_to_row[icol/m_neq]);
+  m_values[(block*m_neq + irow%m_neq)*m_neq + icol%m_neq] += value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  const Uint block = get_block(m_node_to_row[irow/m_neq], m_node_to_row[icol/m_neq]);
+  value = m_values[(block*m_neq + irow%m_neq)*m_neq + icol%m_neq];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+const int* NativeCrsMatrix::block_positions(const BlockAccumulator& values)
+{
+  if(m_assembly_plan.is_enabled())
+  {
+    const int* positions = m_assembly_plan.find(values.indices);
+    if(is_not_null(positions))
+      return positions;
+  }
+
+  if(is_null(m_block_positions.get()))
+    m_block_positions.reset(new std::vector<int>());
+  std::vector<int>& positions = *m_block_positions;
+
+  const Uint nb_nodes = values.indices.size();
+  positions.resize(nb_nodes*nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_to_row[values.indices[i]];
+    for(Uint j = 0; j != nb_nodes; ++j)
+      positions[i*nb_nodes + j] = get_block(row, m_node_to_row[values.indices[j]]);
+  }
+
+  if(m_assembly_plan.is_enabled())
+    return m_assembly_plan.insert(values.indices, positions);
+
+  return &positions[0];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  const Uint nb_cols = nb_nodes*m_neq;
+  cf3_assert(values.mat.rows() == nb_cols);
+  const int* blocks = block_positions(values);
+  const Real* mat = values.mat.data();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block = &m_values[blocks[i*nb_nodes + j]*m_neq*m_neq];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        const Real* source = mat + (i*m_neq + e)*nb_cols + j*m_neq;
+        for(Uint f = 0; f != m_neq; ++f)
+          block[e*m_neq + f] = source[f];
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  const Uint nb_cols = nb_nodes*m_neq;
+  cf3_assert(values.mat.rows() == nb_cols);
+  const int* blocks = block_positions(values);
+  const Real* mat = values.mat.data();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block = &m_values[blocks[i*nb_nodes + j]*m_neq*m_neq];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        const Real* source = mat + (i*m_neq + e)*nb_cols + j*m_neq;
+        for(Uint f = 0; f != m_neq; ++f)
+          block[e*m_neq + f] += source[f];
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  const Uint nb_cols = nb_nodes*m_neq;
+  cf3_assert(values.mat.rows() == nb_cols);
+  values.mat.setZero();
+  Real* mat = values.mat.data();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_to_row[values.indices[i]];
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      const Uint block_idx = find_block(row, m_node_to_row[values.indices[j]]);
+      if(block_idx == math::Consts::uint_max())
+        continue;
+      const Real* block = &m_values[block_idx*m_neq*m_neq];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        Real* target = mat + (i*m_neq + e)*nb_cols + j*m_neq;
+        for(Uint f = 0; f != m_neq; ++f)
+          target[f] = block[e*m_neq + f];
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  cf3_assert(m_is_created);
+  const Uint row = m_node_to_row[iblockrow];
+  for(Uint b = m_row_starts[row]; b != m_row_starts[row+1]; ++b)
+  {
+    Real* block_row = &m_values[(b*m_neq + ieq)*m_neq];
+    for(Uint f = 0; f != m_neq; ++f)
+      block_row[f] = offdiagval;
+  }
+  m_values[(m_diagonal_blocks[row]*m_neq + ieq)*m_neq + ieq] = diagval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  values.assign(m_node_to_row.size()*m_neq, 0.);
+  const Uint col = m_node_to_row[iblockcol];
+  const Uint nb_rows = this->nb_rows();
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    const Uint block_idx = find_block(row, col);
+    if(block_idx == math::Consts::uint_max())
+      continue;
+    Real* block = &m_values[block_idx*m_neq*m_neq];
+    for(Uint e = 0; e != m_neq; ++e)
+    {
+      values[m_row_to_node[row]*m_neq + e] = block[e*m_neq + ieq];
+      block[e*m_neq + ieq] = 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  cf3_assert(m_is_created);
+  NativeVector* native_rhs = dynamic_cast<NativeVector*>(&rhs);
+  if(is_null(native_rhs))
+    throw common::SetupError(FromHere(), "symmetric_dirichlet method of NativeCrsMatrix needs a NativeVector, but a " + rhs.derived_type_name() + " was supplied instead.");
+  std::vector<Real>& rhs_data = native_rhs->data();
+
+  const Uint bs = m_neq*m_neq;
+  const Uint bc_row = m_node_to_row[blockrow];
+  const Uint bc_idx = bc_row*m_neq + ieq;
+
+  DirichletEntryT& cached_col_values = m_symmetric_dirichlet_values[bc_idx];
+
+  if(cached_col_values.empty())
+  {
+    // The matrix is structurally symmetric, so the rows with an entry in the boundary column are the columns of the boundary row
+    for(Uint b = m_row_starts[bc_row]; b != m_row_starts[bc_row+1]; ++b)
+    {
+      const Uint other_row = m_block_columns[b];
+      Real* block = &m_values[(other_row == bc_row ? b : get_block(other_row, bc_row))*bs];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        const Uint other_idx = other_row*m_neq + e;
+        if(other_idx == bc_idx)
+          continue;
+        Real& entry = block[e*m_neq + ieq];
+        cached_col_values.push_back(std::make_pair(other_idx, entry));
+        rhs_data[other_idx] -= entry * value;
+        entry = 0.;
+      }
+    }
+    set_row(blockrow, ieq, 1., 0.);
+  }
+  else // Reuse the cached values, if the matrix wasn't reset since the previous BC application
+  {
+    for(DirichletEntryT::const_iterator it = cached_col_values.begin(); it != cached_col_values.end(); ++it)
+      rhs_data[it->first] -= it->second * value;
+  }
+
+  rhs.set_value(blockrow, ieq, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  cf3_assert(m_is_created);
+  const Uint row_to = m_node_to_row[iblockrow_to];
+  const Uint row_from = m_node_to_row[iblockrow_from];
+  if(row_to == row_from)
+    return;
+
+  const Uint nb_blocks = m_row_starts[row_to+1] - m_row_starts[row_to];
+  if(nb_blocks != m_row_starts[row_from+1] - m_row_starts[row_from])
+    throw common::BadValue(FromHere(),"Number of entries do not match for the two block rows to be tied together.");
+  if(!std::equal(m_block_columns.begin() + m_row_starts[row_to], m_block_columns.begin() + m_row_starts[row_to+1], m_block_columns.begin() + m_row_starts[row_from]))
+    throw common::BadValue(FromHere(),"Indices of the entries do not match for the two block rows to be tied together.");
+
+  const Uint bs = m_neq*m_neq;
+  Real* values_to = &m_values[m_row_starts[row_to]*bs];
+  Real* values_from = &m_values[m_row_starts[row_from]*bs];
+  const Uint nb_values = nb_blocks*bs;
+  for(Uint i = 0; i != nb_values; ++i)
+  {
+    values_to[i] += values_from[i];
+    values_from[i] = 0.;
+  }
+
+  // The from row now states that both nodes have the same value
+  Real* from_diag = &m_values[m_diagonal_blocks[row_from]*bs];
+  Real* from_pair = &m_values[get_block(row_from, row_to)*bs];
+  for(Uint e = 0; e != m_neq; ++e)
+  {
+    from_diag[e*m_neq + e] = 1.;
+    from_pair[e*m_neq + e] = -1.;
+  }
+
+  // Move the contributions of the from node to the to node in the to row
+  Real* to_diag = &m_values[m_diagonal_blocks[row_to]*bs];
+  Real* to_pair = &m_values[get_block(row_to, row_from)*bs];
+  for(Uint i = 0; i != bs; ++i)
+  {
+    to_diag[i] += to_pair[i];
+    to_pair[i] = 0.;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(diag.size() == nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    Real* block = &m_values[m_diagonal_blocks[m_node_to_row[i]]*m_neq*m_neq];
+    for(Uint e = 0; e != m_neq; ++e)
+      block[e*m_neq + e] = diag[i*m_neq + e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(diag.size() == nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    Real* block = &m_values[m_diagonal_blocks[m_node_to_row[i]]*m_neq*m_neq];
+    for(Uint e = 0; e != m_neq; ++e)
+      block[e*m_neq + e] += diag[i*m_neq + e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  diag.resize(nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Real* block = &m_values[m_diagonal_blocks[m_node_to_row[i]]*m_neq*m_neq];
+    for(Uint e = 0; e != m_neq; ++e)
+      diag[i*m_neq + e] = block[e*m_neq + e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  m_values.assign(m_values.size(), reset_to);
+  m_symmetric_dirichlet_values.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::clone_to(Matrix &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Matrix to clone " + uri().string() + " is not created");
+
+  NativeCrsMatrix* other_ptr = dynamic_cast<NativeCrsMatrix*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeCrsMatrix needs another NativeCrsMatrix, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->m_is_created = m_is_created;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_node_to_row = m_node_to_row;
+  other_ptr->m_row_to_node = m_row_to_node;
+  other_ptr->m_row_starts = m_row_starts;
+  other_ptr->m_block_columns = m_block_columns;
+  other_ptr->m_diagonal_blocks = m_diagonal_blocks;
+  other_ptr->m_values = m_values;
+  other_ptr->m_symmetric_dirichlet_values = m_symmetric_dirichlet_values;
+  other_ptr->m_assembly_plan.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::read_native(const common::URI& file)
+{
+  throw common::NotImplemented(FromHere(), "read_native method is not implemented for " + derived_type_name());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    const Uint nb_rows = this->nb_rows();
+    for(Uint row = 0; row != nb_rows; ++row)
+    {
+      for(Uint b = m_row_starts[row]; b != m_row_starts[row+1]; ++b)
+      {
+        const Uint col = m_block_columns[b];
+        for(Uint e = 0; e != m_neq; ++e)
+          for(Uint f = 0; f != m_neq; ++f)
+            stream << m_row_to_node[row]*m_neq + e << " " << -(int)(m_row_to_node[col]*m_neq + f) << " " << m_values[(b*m_neq + e)*m_neq + f] << CFendl;
+      }
+    }
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << nb_rows*m_neq << "\n";
+    stream << "# number of block rows: " << nb_rows << "\n";
+    stream << "# number of blocks:     " << m_block_columns.size() << "\n";
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    const Uint nb_rows = this->nb_rows();
+    for(Uint row = 0; row != nb_rows; ++row)
+    {
+      for(Uint b = m_row_starts[row]; b != m_row_starts[row+1]; ++b)
+      {
+        const Uint col = m_block_columns[b];
+        for(Uint e = 0; e != m_neq; ++e)
+          for(Uint f = 0; f != m_neq; ++f)
+            stream << m_row_to_node[col]*m_neq + f << " " << -(int)(m_row_to_node[row]*m_neq + e) << " " << m_values[(b*m_neq + e)*m_neq + f] << "\n";
+      }
+    }
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << nb_rows*m_neq << "\n";
+    stream << "# number of block rows: " << nb_rows << "\n";
+    stream << "# number of blocks:     " << m_block_columns.size() << "\n" << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(const std::string& filename, std::ios_base::openmode mode )
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print_native(std::ostream& stream)
+{
+  const Uint nb_rows = this->nb_rows();
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    stream << "block row " << row << ":";
+    for(Uint b = m_row_starts[row]; b != m_row_starts[row+1]; ++b)
+      stream << " " << m_block_columns[b];
+    stream << "\n";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  row_indices.clear(); col_indices.clear(); values.clear();
+  const Uint nb_rows = this->nb_rows();
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    for(Uint b = m_row_starts[row]; b != m_row_starts[row+1]; ++b)
+    {
+      const Uint col = m_block_columns[b];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        for(Uint f = 0; f != m_neq; ++f)
+        {
+          row_indices.push_back(m_row_to_node[row]*m_neq + e);
+          col_indices.push_back(m_row_to_node[col]*m_neq + f);
+          values.push_back(m_values[(b*m_neq + e)*m_neq + f]);
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::apply ( const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha, const Real beta )
+{
+  cf3_assert(m_is_created);
+  Handle<NativeVector> y_native(y);
+  Handle<NativeVector const> x_native(x);
+
+  if(is_null(y_native) || is_null(x_native))
+    throw common::SetupError(FromHere(), "NativeCrsMatrix::apply must be given NativeVector arguments");
+
+  const Uint size = nb_rows()*m_neq;
+  if(x_native->data().size() != size || y_native->data().size() != size)
+    throw common::SetupError(FromHere(), "NativeCrsMatrix::apply got a vector with incorrect size");
+
+  if(x_native.get() == y_native.get())
+  {
+    const std::vector<Real> x_copy(x_native->data());
+    multiply(&x_copy[0], &y_native->data()[0], alpha, beta);
+  }
+  else
+  {
+    multiply(&x_native->data()[0], &y_native->data()[0], alpha, beta);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::multiply(const Real* x, Real* y, const Real alpha, const Real beta)
+{
+  cf3_assert(m_is_created);
+  thread_team().run(nb_rows(), boost::bind(&NativeCrsMatrix::multiply_rows, this, x, y, alpha, beta, _2, _3));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::multiply_rows(const Real* x, Real* y, const Real alpha, const Real beta, const Uint begin, const Uint end) const
+{
+  const Uint* row_starts = &m_row_starts[0];
+  const Uint* columns = &m_block_columns[0];
+  const Real* values = &m_values[0];
+
+  if(m_neq == 1)
+  {
+    for(Uint row = begin; row != end; ++row)
+    {
+      Real sum = 0.;
+      for(Uint b = row_starts[row]; b != row_starts[row+1]; ++b)
+        sum += values[b] * x[columns[b]];
+      y[row] = beta == 0. ? alpha*sum : alpha*sum + beta*y[row];
+    }
+    return;
+  }
+
+  const Uint neq = m_neq;
+  const Uint bs = neq*neq;
+  Real sums[64];
+  std::vector<Real> large_sums(neq > 64 ? neq : 0);
+  Real* sum = neq > 64 ? &large_sums[0] : sums;
+  for(Uint row = begin; row != end; ++row)
+  {
+    std::fill(sum, sum+neq, 0.);
+    for(Uint b = row_starts[row]; b != row_starts[row+1]; ++b)
+    {
+      const Real* block = values + b*bs;
+      const Real* x_block = x + columns[b]*neq;
+      for(Uint e = 0; e != neq; ++e)
+      {
+        const Real* block_row = block + e*neq;
+        Real block_sum = 0.;
+        for(Uint f = 0; f != neq; ++f)
+          block_sum += block_row[f] * x_block[f];
+        sum[e] += block_sum;
+      }
+    }
+    Real* y_block = y + row*neq;
+    for(Uint e = 0; e != neq; ++e)
+      y_block[e] = beta == 0. ? alpha*sum[e] : alpha*sum[e] + beta*y_block[e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,261 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeCrsMatrix_hpp
+#define cf3_Math_LSS_NativeCrsMatrix_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/AssemblyPlan.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Vector.hpp"
+#include "math/LSS/Matrix.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeCrsMatrix.hpp definition of LSS::NativeCrsMatrix
+
+  Self-contained block compressed row storage matrix, for runs on a single process.
+  Each entry in the sparsity pattern is a dense neq x neq block, stored row-major.
+  Matrix-vector products are split over a number of threads.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeCrsMatrix : public LSS::Matrix {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeCrsMatrix"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// Accessor to the flag if matrix, solution and rhs are tied together or not
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return true; }
+
+  /// Supported unless the assembly plan is enabled, since it is filled during assembly, or periodic links make nodes share a row
+  bool concurrent_assembly() { return !m_assembly_plan.is_enabled() && m_row_to_node.size() == m_node_to_row.size(); }
+
+  /// Default constructor
+  NativeCrsMatrix(const std::string& name);
+
+  /// Setup sparsity structure
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// The equations of each node are always stored together, so this is the same as create with vars.size() equations
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Set value at given location in the matrix
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Add value at given location in the matrix
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Get value at given location in the matrix
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Set a list of values
+  void set_values(const BlockAccumulator& values);
+
+  /// Add a list of values
+  void add_values(const BlockAccumulator& values);
+
+  /// Add a list of values
+  void get_values(BlockAccumulator& values);
+
+  /// Set a row, diagonal and off-diagonals values separately (dirichlet-type boundaries)
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Get a column and replace it to zero (dirichlet-type boundaries, when trying to preserve symmetry)
+  /// Note that sparsity info is lost, values will contain zeros where no matrix entry is present
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs);
+
+  /// Add one line to another and tie to it via dirichlet-style (applying periodicity)
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Set the diagonal
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Get the diagonal
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Reset Matrix
+  void reset(Real reset_to=0.);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { cf3_assert(m_is_created); return m_neq; }
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { cf3_assert(m_is_created); return m_row_starts.size() - 1; }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { cf3_assert(m_is_created); return m_node_to_row.size(); }
+
+  void clone_to(Matrix &other);
+
+  void read_native(const common::URI& file);
+
+  //@} END MISCELLANEOUS
+
+  /// @name LINEAR ALGEBRA
+  //@{
+
+  /// Compute y = alpha*A*x + beta*y
+  void apply(const Handle<Vector>& y, const Handle<Vector const>& x, const Real alpha = 1., const Real beta = 0.);
+
+  /// Compute y = alpha*A*x + beta*y on raw NativeVector storage, using the threads of the matrix
+  void multiply(const Real* x, Real* y, const Real alpha = 1., const Real beta = 0.);
+
+  //@} END LINEAR ALGEBRA
+
+  /// @name NATIVE STORAGE
+  /// @attention these functions are not part of the LSS::Matrix interface, they are only used within the native backend
+  //@{
+
+  /// Number of rows in the storage. Nodes with an active periodic link don't have a row of their own
+  Uint nb_rows() const { return m_row_starts.empty() ? 0 : m_row_starts.size() - 1; }
+
+  /// For each row, the index of its first block. Has nb_rows()+1 entries
+  const std::vector<Uint>& row_starts() const { return m_row_starts; }
+
+  /// Column of each block. The columns in each row are sorted
+  const std::vector<Uint>& block_columns() const { return m_block_columns; }
+
+  /// Index of the diagonal block of each row
+  const std::vector<Uint>& diagonal_blocks() const { return m_diagonal_blocks; }
+
+  /// Values of all blocks, neq*neq values per block
+  const std::vector<Real>& values() const { return m_values; }
+
+  /// The threads used for the matrix-vector product
+  detail::ThreadTeam& thread_team();
+
+  //@} END NATIVE STORAGE
+
+  /// @name TEST ONLY
+  //@{
+
+  /// exports the matrix into big linear arrays
+  /// @attention only for debug and utest purposes
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+
+  void trigger_assembly_plan();
+  void trigger_nb_threads();
+
+  /// Index of the block at the given row and column, or uint_max if it is not in the sparsity pattern
+  Uint find_block(const Uint row, const Uint col) const;
+
+  /// Index of the block at the given row and column, throwing if it is not in the sparsity pattern
+  Uint get_block(const Uint row, const Uint col) const;
+
+  /// Look up the blocks for all pairs of nodes in values.indices
+  /// @return The index of the value of the first entry of each block, or a pointer to the assembly plan entry if the plan is used
+  const int* block_positions(const BlockAccumulator& values);
+
+  /// Multiply the given rows only
+  void multiply_rows(const Real* x, Real* y, const Real alpha, const Real beta, const Uint begin, const Uint end) const;
+
+  /// state of creation
+  bool m_is_created;
+
+  /// number of equations
+  Uint m_neq;
+
+  /// Matrix row for each node
+  std::vector<Uint> m_node_to_row;
+
+  /// First node for each matrix row
+  std::vector<Uint> m_row_to_node;
+
+  /// Block compressed row storage
+  std::vector<Uint> m_row_starts;
+  std::vector<Uint> m_block_columns;
+  std::vector<Uint> m_diagonal_blocks;
+  std::vector<Real> m_values;
+
+  /// Cache matrix values in case of symmetric dirichlet, so they can be applied multiple times even if the matrix is not changed.
+  /// Maps the value index of each Dirichlet column to the entries (row index, value) that were removed from it.
+  typedef std::vector< std::pair<Uint, Real> > DirichletEntryT;
+  typedef std::map<Uint, DirichletEntryT> DirichletMapT;
+  DirichletMapT m_symmetric_dirichlet_values;
+
+  /// Cached block positions for add_values, cleared each time the matrix is created
+  AssemblyPlan m_assembly_plan;
+
+  /// Helper array for the block positions, one per thread for concurrent assembly
+  boost::thread_specific_ptr< std::vector<int> > m_block_positions;
+
+  /// Threads for the matrix-vector product, created on first use
+  boost::scoped_ptr<detail::ThreadTeam> m_thread_team;
+}; // end of class NativeCrsMatrix
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeCrsMatrix_hpp
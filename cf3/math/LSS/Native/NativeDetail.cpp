@@ -0,0 +1,150 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/bind.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/Consts.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+namespace detail {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  /// Ranges shorter than this are not worth waking up the other threads for
+  const Uint min_parallel_size = 2048;
+}
+
+ThreadTeam::ThreadTeam(const Uint nb_threads) :
+  m_nb_threads(nb_threads == 0 ? std::max(1u, boost::thread::hardware_concurrency()) : nb_threads),
+  m_task(nullptr),
+  m_n(0),
+  m_stop(false)
+{
+  if(m_nb_threads == 1)
+    return;
+
+  m_start.reset(new boost::barrier(m_nb_threads));
+  m_done.reset(new boost::barrier(m_nb_threads));
+  for(Uint i = 1; i != m_nb_threads; ++i)
+    m_threads.create_thread(boost::bind(&ThreadTeam::work, this, i));
+}
+
+ThreadTeam::~ThreadTeam()
+{
+  if(m_nb_threads == 1)
+    return;
+
+  m_stop = true;
+  m_start->wait();
+  m_threads.join_all();
+}
+
+void ThreadTeam::run(const Uint n, const TaskT& task)
+{
+  if(m_nb_threads == 1 || n < min_parallel_size)
+  {
+    task(0, 0, n);
+    return;
+  }
+
+  m_task = &task;
+  m_n = n;
+  m_start->wait();
+  run_slice(0);
+  m_done->wait();
+  m_task = nullptr;
+}
+
+void ThreadTeam::work(const Uint thread_idx)
+{
+  while(true)
+  {
+    m_start->wait();
+    if(m_stop)
+      return;
+    run_slice(thread_idx);
+    m_done->wait();
+  }
+}
+
+void ThreadTeam::run_slice(const Uint thread_idx)
+{
+  // 64-bit products, so large ranges don't overflow
+  const Uint begin = static_cast<boost::uint64_t>(m_n) * thread_idx / m_nb_threads;
+  const Uint end = static_cast<boost::uint64_t>(m_n) * (thread_idx+1) / m_nb_threads;
+  (*m_task)(thread_idx, begin, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint create_row_map(common::PE::CommPattern& cp, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active, std::vector<Uint>& node_to_row)
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  if(comm.is_active() && comm.size() > 1)
+    throw common::NotSupported(FromHere(), "The native LSS backend only runs on a single process, but " + common::to_str(comm.size()) + " processes are in use. Use a Trilinos matrix for parallel runs.");
+
+  const Uint nb_nodes = cp.isUpdatable().size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(!cp.isUpdatable()[i])
+      throw common::NotSupported(FromHere(), "Node " + common::to_str(i) + " is a ghost node, which the native LSS backend does not support");
+  }
+
+  const bool has_periodic = !periodic_links_active.empty();
+  cf3_assert(!has_periodic || periodic_links_active.size() == nb_nodes);
+  cf3_assert(periodic_links_nodes.size() == periodic_links_active.size());
+
+  node_to_row.assign(nb_nodes, math::Consts::uint_max());
+  Uint nb_rows = 0;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(!has_periodic || !periodic_links_active[i])
+      node_to_row[i] = nb_rows++;
+  }
+
+  if(has_periodic)
+  {
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      if(!periodic_links_active[i])
+        continue;
+
+      // Follow the links to the node that has its own row
+      Uint target = periodic_links_nodes[i];
+      for(Uint hops = 0; periodic_links_active[target]; ++hops)
+      {
+        if(hops == nb_nodes)
+          throw common::BadValue(FromHere(), "Periodic links starting at node " + common::to_str(i) + " form a cycle");
+        target = periodic_links_nodes[target];
+      }
+      node_to_row[i] = node_to_row[target];
+    }
+  }
+
+  return nb_rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace detail
+} // namespace LSS
+} // namespace math
+} // namespace cf3
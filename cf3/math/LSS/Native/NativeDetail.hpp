@@ -0,0 +1,88 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeDetail_hpp
+#define cf3_Math_LSS_NativeDetail_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+#include "common/CF.hpp"
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeDetail.hpp Shared functions between the classes of the native LSS backend
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+  namespace common { namespace PE { class CommPattern; } }
+namespace math {
+namespace LSS {
+namespace detail {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Fixed group of threads that split loops over a range of indices between them.
+/// The threads are started once and wait between loops, so running short loops (like the
+/// matrix-vector products in a Krylov solver) does not pay for thread creation each time.
+class LSS_API ThreadTeam : boost::noncopyable
+{
+public:
+  /// Work for one thread: arguments are the thread index and the begin and end of its slice
+  typedef boost::function<void(const Uint, const Uint, const Uint)> TaskT;
+
+  /// @param nb_threads Number of threads, including the calling thread. 0 means one per hardware thread
+  explicit ThreadTeam(const Uint nb_threads);
+  ~ThreadTeam();
+
+  /// Number of threads, including the calling thread
+  Uint size() const { return m_nb_threads; }
+
+  /// Split [0, n) in contiguous slices and run task on each slice, one per thread.
+  /// Short ranges are handled by the calling thread only, as thread 0.
+  void run(const Uint n, const TaskT& task);
+
+private:
+  void work(const Uint thread_idx);
+  void run_slice(const Uint thread_idx);
+
+  Uint m_nb_threads;
+  boost::thread_group m_threads;
+  boost::scoped_ptr<boost::barrier> m_start;
+  boost::scoped_ptr<boost::barrier> m_done;
+  const TaskT* m_task;
+  Uint m_n;
+  bool m_stop;
+};
+
+/// Compute the matrix row for each node. Nodes with an active periodic link share the row of the node they are linked to.
+/// @param cp The comm pattern that governs the node distribution. All nodes must be owned by this process.
+/// @param node_to_row Output: the row for each node
+/// @return The number of rows
+Uint create_row_map(common::PE::CommPattern& cp,
+                    const std::vector<Uint>& periodic_links_nodes,
+                    const std::vector<bool>& periodic_links_active,
+                    std::vector<Uint>& node_to_row);
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace detail
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeDetail_hpp
@@ -0,0 +1,511 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/bind.hpp>
+
+#include "common/Action.hpp"
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionComponent.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/PropertyList.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "math/LSS/Native/NativeMatrixFree.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeMatrixFree.cpp implementation of LSS::NativeMatrixFree
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeMatrixFree, LSS::Matrix, LSS::LibLSS > NativeMatrixFree_Builder;
+
+NativeMatrixFree::NativeMatrixFree(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0),
+  m_nb_rows(0),
+  m_mode(IDLE),
+  m_x(nullptr)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.NativeVector"));
+
+  options().add("operator", m_operator)
+    .pretty_name("Operator")
+    .description("Action that assembles the system matrix, i.e. a Proto expression with system_matrix += ... Other contributions it makes to the RHS are undone after each execution, so this can be the assembly action itself.")
+    .mark_basic()
+    .link_to(&m_operator);
+
+  options().add("nb_threads", 0u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads for the vector operations of the native solvers. 0 uses one thread per hardware thread.")
+    .attach_trigger(boost::bind(&NativeMatrixFree::trigger_nb_threads, this))
+    .mark_basic();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::trigger_nb_threads()
+{
+  m_thread_team.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+LSS::detail::ThreadTeam& NativeMatrixFree::thread_team()
+{
+  if(!m_thread_team)
+    m_thread_team.reset(new LSS::detail::ThreadTeam(options().value<Uint>("nb_threads")));
+  return *m_thread_team;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  m_nb_rows = LSS::detail::create_row_map(cp, periodic_links_nodes, periodic_links_active, m_node_to_row);
+  m_neq = neq;
+  m_rhs = Handle<NativeVector>(rhs.handle());
+  m_is_row_set.assign(m_nb_rows*m_neq, false);
+  m_row_diagonal.assign(m_nb_rows*m_neq, 0.);
+  m_is_created = true;
+
+  CFdebug << "Created a " << m_nb_rows*m_neq << " x " << m_nb_rows*m_neq << " matrix-free operator" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), node_connectivity, starting_indices, solution, rhs, periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::destroy()
+{
+  std::vector<Uint>().swap(m_node_to_row);
+  std::vector<Real>().swap(m_result);
+  std::vector<Real>().swap(m_added_diagonal);
+  std::vector<bool>().swap(m_is_row_set);
+  std::vector<Real>().swap(m_row_diagonal);
+  std::vector<Uint>().swap(m_set_rows);
+  m_rhs.reset();
+  m_nb_rows=0;
+  m_neq=0;
+  m_is_created=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  throw common::NotSupported(FromHere(), "Individual entries can't be set in matrix-free operator " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  throw common::NotSupported(FromHere(), "Individual entries can't be added in matrix-free operator " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  throw common::NotSupported(FromHere(), "Individual entries can't be read from matrix-free operator " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::set_values(const BlockAccumulator& values)
+{
+  if(m_mode != IDLE)
+    throw common::NotSupported(FromHere(), "The operator of matrix-free operator " + uri().path() + " may only add element matrices");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::add_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  if(m_mode == IDLE)
+    return;
+
+  const Uint nb_nodes = values.indices.size();
+  const Uint nb_cols = nb_nodes*m_neq;
+  cf3_assert(values.mat.rows() == nb_cols);
+
+  if(m_mode == APPLY)
+  {
+    // Gather
+    m_element_x.resize(nb_cols);
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      const Real* x_block = m_x + m_node_to_row[values.indices[j]]*m_neq;
+      for(Uint f = 0; f != m_neq; ++f)
+        m_element_x[j*m_neq + f] = x_block[f];
+    }
+
+    // Compute
+    m_element_y.noalias() = values.mat * m_element_x;
+
+    // Scatter
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      const Uint row_begin = m_node_to_row[values.indices[i]]*m_neq;
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        if(!m_is_row_set[row_begin + e])
+          m_result[row_begin + e] += m_element_y[i*m_neq + e];
+      }
+    }
+    return;
+  }
+
+  // Diagonal mode: only the blocks that end up on the diagonal are kept
+  const Uint bs = m_neq*m_neq;
+  const Real* mat = values.mat.data();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_to_row[values.indices[i]];
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      if(m_node_to_row[values.indices[j]] != row)
+        continue;
+      Real* block = &m_result[row*bs];
+      for(Uint e = 0; e != m_neq; ++e)
+      {
+        if(m_is_row_set[row*m_neq + e])
+          continue;
+        const Real* source = mat + (i*m_neq + e)*nb_cols + j*m_neq;
+        for(Uint f = 0; f != m_neq; ++f)
+          block[e*m_neq + f] += source[f];
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::get_values(BlockAccumulator& values)
+{
+  throw common::NotSupported(FromHere(), "Values can't be read from matrix-free operator " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  cf3_assert(m_is_created);
+  if(offdiagval != 0.)
+    throw common::NotSupported(FromHere(), "Matrix-free operator " + uri().path() + " can only set rows with zero off-diagonal values");
+
+  const Uint idx = m_node_to_row[iblockrow]*m_neq + ieq;
+  if(!m_is_row_set[idx])
+  {
+    m_is_row_set[idx] = true;
+    m_set_rows.push_back(idx);
+  }
+  m_row_diagonal[idx] = diagval;
+  if(!m_added_diagonal.empty())
+    m_added_diagonal[idx] = 0.;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  throw common::NotSupported(FromHere(), "Columns can't be modified in matrix-free operator " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  throw common::NotSupported(FromHere(), "Symmetric Dirichlet conditions are not supported by matrix-free operator " + uri().path() + ". Disable preserve_symmetry for the boundary conditions.");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  throw common::NotSupported(FromHere(), "Rows can't be tied in matrix-free operator " + uri().path() + ". Use periodic links when creating the system.");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::set_diagonal(const std::vector<Real>& diag)
+{
+  throw common::NotSupported(FromHere(), "The diagonal can't be set in matrix-free operator " + uri().path() + ", only added to");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::add_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(diag.size() == nb_nodes*m_neq);
+  if(m_added_diagonal.empty())
+    m_added_diagonal.assign(m_nb_rows*m_neq, 0.);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    for(Uint e = 0; e != m_neq; ++e)
+      m_added_diagonal[m_node_to_row[i]*m_neq + e] += diag[i*m_neq + e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  std::vector<Real> blocks;
+  get_diagonal_blocks(blocks);
+  const Uint nb_nodes = m_node_to_row.size();
+  diag.resize(nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Real* block = &blocks[m_node_to_row[i]*m_neq*m_neq];
+    for(Uint e = 0; e != m_neq; ++e)
+      diag[i*m_neq + e] = block[e*m_neq + e];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::get_diagonal_blocks(std::vector<Real>& blocks)
+{
+  cf3_assert(m_is_created);
+  const Uint bs = m_neq*m_neq;
+  m_result.assign(m_nb_rows*bs, 0.);
+  run_operator(DIAGONAL);
+  blocks.swap(m_result);
+
+  if(!m_added_diagonal.empty())
+  {
+    for(Uint row = 0; row != m_nb_rows; ++row)
+      for(Uint e = 0; e != m_neq; ++e)
+        blocks[row*bs + e*m_neq + e] += m_added_diagonal[row*m_neq + e];
+  }
+
+  for(std::vector<Uint>::const_iterator it = m_set_rows.begin(); it != m_set_rows.end(); ++it)
+  {
+    const Uint row = *it / m_neq;
+    const Uint e = *it % m_neq;
+    blocks[row*bs + e*m_neq + e] += m_row_diagonal[*it];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  if(reset_to != 0.)
+    throw common::NotSupported(FromHere(), "Matrix-free operator " + uri().path() + " can only be reset to zero");
+
+  std::vector<Real>().swap(m_added_diagonal);
+  for(std::vector<Uint>::const_iterator it = m_set_rows.begin(); it != m_set_rows.end(); ++it)
+  {
+    m_is_row_set[*it] = false;
+    m_row_diagonal[*it] = 0.;
+  }
+  m_set_rows.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::clone_to(Matrix &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Matrix to clone " + uri().string() + " is not created");
+
+  NativeMatrixFree* other_ptr = dynamic_cast<NativeMatrixFree*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeMatrixFree needs another NativeMatrixFree, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->m_is_created = m_is_created;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_nb_rows = m_nb_rows;
+  other_ptr->m_node_to_row = m_node_to_row;
+  other_ptr->m_rhs = m_rhs;
+  other_ptr->m_added_diagonal = m_added_diagonal;
+  other_ptr->m_is_row_set = m_is_row_set;
+  other_ptr->m_row_diagonal = m_row_diagonal;
+  other_ptr->m_set_rows = m_set_rows;
+  other_ptr->options().set("operator", m_operator);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::read_native(const common::URI& file)
+{
+  throw common::NotSupported(FromHere(), "read_native method is not supported for " + derived_type_name());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# operator:             " << (is_null(m_operator) ? std::string("none") : m_operator->uri().path()) << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << m_nb_rows*m_neq << "\n";
+    stream << "# number of set rows:   " << m_set_rows.size() << "\n";
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# operator:             " << (is_null(m_operator) ? std::string("none") : m_operator->uri().path()) << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << m_nb_rows*m_neq << "\n";
+    stream << "# number of set rows:   " << m_set_rows.size() << "\n" << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::print(const std::string& filename, std::ios_base::openmode mode )
+{
+  std::ofstream stream(filename.c_str(),mode);
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::print_native(std::ostream& stream)
+{
+  print(stream);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  throw common::NotSupported(FromHere(), "Matrix-free operator " + uri().path() + " has no data to export");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::apply ( const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha, const Real beta )
+{
+  cf3_assert(m_is_created);
+  Handle<NativeVector> y_native(y);
+  Handle<NativeVector const> x_native(x);
+
+  if(is_null(y_native) || is_null(x_native))
+    throw common::SetupError(FromHere(), "NativeMatrixFree::apply must be given NativeVector arguments");
+
+  const Uint size = m_nb_rows*m_neq;
+  if(x_native->data().size() != size || y_native->data().size() != size)
+    throw common::SetupError(FromHere(), "NativeMatrixFree::apply got a vector with incorrect size");
+
+  // The element products are accumulated separately, so x and y may be the same vector
+  multiply(&x_native->data()[0], &y_native->data()[0], alpha, beta);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::multiply(const Real* x, Real* y, const Real alpha, const Real beta)
+{
+  cf3_assert(m_is_created);
+  const Uint size = m_nb_rows*m_neq;
+
+  // The operator may write to the RHS while it runs, so x must not point there
+  std::vector<Real> x_copy;
+  if(is_not_null(m_rhs) && size != 0 && x == &m_rhs->data()[0])
+  {
+    x_copy.assign(x, x+size);
+    x = &x_copy[0];
+  }
+
+  m_result.assign(size, 0.);
+  m_x = x;
+  run_operator(APPLY);
+  m_x = nullptr;
+
+  for(std::vector<Uint>::const_iterator it = m_set_rows.begin(); it != m_set_rows.end(); ++it)
+    m_result[*it] = m_row_diagonal[*it] * x[*it];
+
+  const Real* result = &m_result[0];
+  const Real* added_diagonal = m_added_diagonal.empty() ? nullptr : &m_added_diagonal[0];
+  thread_team().run(size, [=](const Uint, const Uint begin, const Uint end)
+  {
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Real ax = added_diagonal == nullptr ? result[i] : result[i] + added_diagonal[i]*x[i];
+      y[i] = beta == 0. ? alpha*ax : alpha*ax + beta*y[i];
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrixFree::run_operator(const ModeT mode)
+{
+  if(is_null(m_operator))
+    throw common::SetupError(FromHere(), "No operator set for matrix-free operator " + uri().path());
+
+  // Keep the RHS, in case the operator also assembles it
+  std::vector<Real> rhs_backup;
+  if(is_not_null(m_rhs))
+    rhs_backup = m_rhs->data();
+
+  m_mode = mode;
+  try
+  {
+    m_operator->execute();
+  }
+  catch(...)
+  {
+    m_mode = IDLE;
+    throw;
+  }
+  m_mode = IDLE;
+
+  if(is_not_null(m_rhs))
+    std::copy(rhs_backup.begin(), rhs_backup.end(), m_rhs->data().begin());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
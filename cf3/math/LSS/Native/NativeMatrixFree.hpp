@@ -0,0 +1,249 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeMatrixFree_hpp
+#define cf3_Math_LSS_NativeMatrixFree_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/scoped_ptr.hpp>
+
+#include "math/MatrixTypes.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Vector.hpp"
+#include "math/LSS/Matrix.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeMatrixFree.hpp definition of LSS::NativeMatrixFree
+
+  Matrix that is never stored: each product y = A*x executes the action set in the "operator" option,
+  which is expected to assemble the element matrices into this matrix (i.e. a Proto expression with
+  system_matrix += ...). Instead of storing them, each element matrix is multiplied with the entries of x
+  for the element nodes and the result is added to y.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+  namespace common { class Action; }
+namespace math {
+namespace LSS {
+
+  class NativeVector;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeMatrixFree : public LSS::Matrix {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeMatrixFree"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// Accessor to the flag if matrix, solution and rhs are tied together or not
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return true; }
+
+  /// Default constructor
+  NativeMatrixFree(const std::string& name);
+
+  /// Setup the numbering. The connectivity is not needed, since nothing is stored.
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// The equations of each node are always stored together, so this is the same as create with vars.size() equations
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  /// Not supported, since there is no stored matrix
+  //@{
+
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Only supported outside of an operator application, where it does nothing
+  void set_values(const BlockAccumulator& values);
+
+  /// Apply the element matrix to the solution values of its nodes when called by the operator. Does nothing otherwise, so the
+  /// operator may be part of the regular assembly without cost for the matrix part.
+  void add_values(const BlockAccumulator& values);
+
+  /// Not supported
+  void get_values(BlockAccumulator& values);
+
+  /// Replace the given row with diagval on the diagonal. offdiagval must be zero.
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Not supported
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  /// Not supported, use dirichlet conditions that don't preserve symmetry
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs);
+
+  /// Not supported, periodicity is only possible through the periodic links passed to create
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Not supported
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal. The values are stored and added in each product.
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Get the diagonal, by executing the operator once
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Clear the rows set by set_row and the diagonal set by add_diagonal. reset_to must be zero.
+  void reset(Real reset_to=0.);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { cf3_assert(m_is_created); return m_neq; }
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { cf3_assert(m_is_created); return m_nb_rows; }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { cf3_assert(m_is_created); return m_node_to_row.size(); }
+
+  void clone_to(Matrix &other);
+
+  void read_native(const common::URI& file);
+
+  //@} END MISCELLANEOUS
+
+  /// @name LINEAR ALGEBRA
+  //@{
+
+  /// Compute y = alpha*A*x + beta*y
+  void apply(const Handle<Vector>& y, const Handle<Vector const>& x, const Real alpha = 1., const Real beta = 0.);
+
+  /// Compute y = alpha*A*x + beta*y on raw NativeVector storage
+  void multiply(const Real* x, Real* y, const Real alpha = 1., const Real beta = 0.);
+
+  //@} END LINEAR ALGEBRA
+
+  /// @name NATIVE STORAGE
+  /// @attention these functions are not part of the LSS::Matrix interface, they are only used within the native backend
+  //@{
+
+  /// Number of rows. Nodes with an active periodic link don't have a row of their own
+  Uint nb_rows() const { return m_nb_rows; }
+
+  /// Compute the neq x neq diagonal blocks of each row, by executing the operator once
+  void get_diagonal_blocks(std::vector<Real>& blocks);
+
+  /// The threads used for the vector operations
+  detail::ThreadTeam& thread_team();
+
+  //@} END NATIVE STORAGE
+
+  /// @name TEST ONLY
+  //@{
+
+  /// Not supported
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+
+  /// What add_values does
+  enum ModeT { IDLE, APPLY, DIAGONAL };
+
+  void trigger_nb_threads();
+
+  /// Execute the operator with add_values in the given mode. The RHS is left unchanged.
+  void run_operator(const ModeT mode);
+
+  /// state of creation
+  bool m_is_created;
+
+  /// number of equations
+  Uint m_neq;
+
+  /// Number of rows in the vectors
+  Uint m_nb_rows;
+
+  /// Matrix row for each node
+  std::vector<Uint> m_node_to_row;
+
+  /// Action that assembles the matrix
+  Handle<common::Action> m_operator;
+
+  /// RHS vector passed to create, restored after running the operator
+  Handle<NativeVector> m_rhs;
+
+  ModeT m_mode;
+
+  /// Input vector for the product that is currently computed
+  const Real* m_x;
+
+  /// Result of the element products, or the diagonal blocks
+  std::vector<Real> m_result;
+
+  /// Element-local copies of x and the product
+  RealVector m_element_x;
+  RealVector m_element_y;
+
+  /// Diagonal added through add_diagonal, empty if not used
+  std::vector<Real> m_added_diagonal;
+
+  /// For each scalar row, the diagonal value if it was set by set_row
+  std::vector<bool> m_is_row_set;
+  std::vector<Real> m_row_diagonal;
+  std::vector<Uint> m_set_rows;
+
+  /// Threads for the vector operations, created on first use
+  boost::scoped_ptr<detail::ThreadTeam> m_thread_team;
+}; // end of class NativeMatrixFree
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeMatrixFree_hpp
@@ -0,0 +1,836 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+
+#include <boost/bind.hpp>
+
+#include <Eigen/Dense>
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeMatrixFree.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeStrategy.cpp Krylov solvers for the native LSS backend
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+common::ComponentBuilder<NativeStrategy, SolutionStrategy, LibLSS> NativeStrategy_builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+typedef Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> BlockT;
+
+/// y -= A*x for a row-major n x n block A
+inline void block_subtract_product(const Real* a, const Real* x, Real* y, const Uint n)
+{
+  for(Uint i = 0; i != n; ++i)
+  {
+    Real sum = 0.;
+    for(Uint j = 0; j != n; ++j)
+      sum += a[i*n+j] * x[j];
+    y[i] -= sum;
+  }
+}
+
+/// y = A*x for a row-major n x n block A
+inline void block_product(const Real* a, const Real* x, Real* y, const Uint n)
+{
+  for(Uint i = 0; i != n; ++i)
+  {
+    Real sum = 0.;
+    for(Uint j = 0; j != n; ++j)
+      sum += a[i*n+j] * x[j];
+    y[i] = sum;
+  }
+}
+
+/// C = A*B for row-major n x n blocks
+inline void block_matrix_product(const Real* a, const Real* b, Real* c, const Uint n)
+{
+  for(Uint i = 0; i != n; ++i)
+  {
+    for(Uint j = 0; j != n; ++j)
+    {
+      Real sum = 0.;
+      for(Uint k = 0; k != n; ++k)
+        sum += a[i*n+k] * b[k*n+j];
+      c[i*n+j] = sum;
+    }
+  }
+}
+
+/// C -= A*B for row-major n x n blocks
+inline void block_subtract_matrix_product(const Real* a, const Real* b, Real* c, const Uint n)
+{
+  for(Uint i = 0; i != n; ++i)
+  {
+    for(Uint j = 0; j != n; ++j)
+    {
+      Real sum = 0.;
+      for(Uint k = 0; k != n; ++k)
+        sum += a[i*n+k] * b[k*n+j];
+      c[i*n+j] -= sum;
+    }
+  }
+}
+
+/// Invert the diagonal block of the given row
+void invert_block(const Real* block, Real* inverse, const Uint n, const Uint row)
+{
+  if(n == 1)
+  {
+    if(block[0] == 0.)
+      throw common::BadValue(FromHere(), "Zero pivot in row " + common::to_str(row) + " while setting up the native preconditioner");
+    inverse[0] = 1. / block[0];
+    return;
+  }
+
+  Eigen::FullPivLU<BlockT> lu(Eigen::Map<const BlockT>(block, n, n));
+  if(!lu.isInvertible())
+    throw common::BadValue(FromHere(), "Singular diagonal block in block row " + common::to_str(row) + " while setting up the native preconditioner");
+  Eigen::Map<BlockT>(inverse, n, n) = lu.inverse();
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+struct NativeStrategy::Implementation
+{
+  Implementation(common::Component& self) :
+    m_self(self),
+    m_preconditioner_reset(1),
+    m_solve_count(0),
+    m_preconditioner_valid(false),
+    m_min_eigenvalue(0.),
+    m_max_eigenvalue(0.),
+    m_nb_iterations(0),
+    m_relative_residual(0.)
+  {
+    std::vector<boost::any> solvers;
+    solvers.push_back(std::string("CG"));
+    solvers.push_back(std::string("BiCGStab"));
+    solvers.push_back(std::string("GMRES"));
+    m_self.options().add("solver", std::string("GMRES"))
+      .pretty_name("Solver")
+      .description("Krylov method: CG (symmetric positive definite systems only), BiCGStab or GMRES")
+      .mark_basic()
+      .restricted_list() = solvers;
+
+    std::vector<boost::any> preconditioners;
+    preconditioners.push_back(std::string("None"));
+    preconditioners.push_back(std::string("Jacobi"));
+    preconditioners.push_back(std::string("ILU0"));
+    preconditioners.push_back(std::string("SGS"));
+    preconditioners.push_back(std::string("Chebyshev"));
+    m_self.options().add("preconditioner", std::string("ILU0"))
+      .pretty_name("Preconditioner")
+      .description("Preconditioner, working on the neq x neq blocks of the matrix: None, Jacobi, ILU0, SGS (symmetric Gauss-Seidel) or Chebyshev (Jacobi-Chebyshev polynomial). Only None, Jacobi and Chebyshev are available for a NativeMatrixFree.")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Implementation::trigger_preconditioner, this))
+      .restricted_list() = preconditioners;
+
+    m_self.options().add("max_iterations", 1000u)
+      .pretty_name("Maximum Iterations")
+      .description("Maximum number of iterations")
+      .mark_basic();
+
+    m_self.options().add("tolerance", 1e-8)
+      .pretty_name("Tolerance")
+      .description("Convergence criterion for the norm of the residual, relative to the norm of the right hand side")
+      .mark_basic();
+
+    m_self.options().add("gmres_restart", 30u)
+      .pretty_name("GMRES Restart")
+      .description("Number of GMRES iterations between restarts");
+
+    m_self.options().add("chebyshev_degree", 4u)
+      .pretty_name("Chebyshev Degree")
+      .description("Degree of the polynomial for the Chebyshev preconditioner, i.e. the number of matrix-vector products per application plus one")
+      .attach_trigger(boost::bind(&Implementation::trigger_preconditioner, this));
+
+    m_self.options().add("chebyshev_eigenvalue_ratio", 30.)
+      .pretty_name("Chebyshev Eigenvalue Ratio")
+      .description("Ratio between the largest eigenvalue of the Jacobi-preconditioned matrix, which is estimated, and the smallest eigenvalue targeted by the Chebyshev preconditioner")
+      .attach_trigger(boost::bind(&Implementation::trigger_preconditioner, this));
+
+    m_self.options().add("preconditioner_reset", m_preconditioner_reset)
+      .pretty_name("Preconditioner Reset")
+      .description("Number of iterations after which the preconditioner is reset")
+      .mark_basic()
+      .link_to(&m_preconditioner_reset);
+  }
+
+  void trigger_preconditioner()
+  {
+    m_preconditioner_valid = false;
+  }
+
+  void check_setup()
+  {
+    if(is_null(m_matrix) && is_null(m_matrix_free))
+      throw common::SetupError(FromHere(), "Null matrix for " + m_self.uri().path());
+
+    if(is_null(m_rhs))
+      throw common::SetupError(FromHere(), "Null RHS for " + m_self.uri().path());
+
+    if(is_null(m_solution))
+      throw common::SetupError(FromHere(), "Null solution vector for " + m_self.uri().path());
+  }
+
+  /// @name OPERATOR
+  /// Dispatch to the stored or the matrix-free matrix
+  //@{
+
+  detail::ThreadTeam& thread_team()
+  {
+    return is_not_null(m_matrix) ? m_matrix->thread_team() : m_matrix_free->thread_team();
+  }
+
+  /// y = alpha*A*x + beta*y
+  void multiply(const Real* x, Real* y, const Real alpha = 1., const Real beta = 0.)
+  {
+    if(is_not_null(m_matrix))
+      m_matrix->multiply(x, y, alpha, beta);
+    else
+      m_matrix_free->multiply(x, y, alpha, beta);
+  }
+
+  Uint nb_rows()
+  {
+    return is_not_null(m_matrix) ? m_matrix->nb_rows() : m_matrix_free->nb_rows();
+  }
+
+  Uint neq()
+  {
+    return is_not_null(m_matrix) ? m_matrix->neq() : m_matrix_free->neq();
+  }
+
+  //@} END OPERATOR
+
+  /// @name VECTOR OPERATIONS
+  /// Split over the threads of the matrix
+  //@{
+
+  Real dot(const std::vector<Real>& a, const std::vector<Real>& b)
+  {
+    detail::ThreadTeam& team = thread_team();
+    std::vector<Real> partial_sums(team.size(), 0.);
+    const Real* a_data = &a[0];
+    const Real* b_data = &b[0];
+    team.run(a.size(), [&](const Uint thread_idx, const Uint begin, const Uint end)
+    {
+      Real sum = 0.;
+      for(Uint i = begin; i != end; ++i)
+        sum += a_data[i] * b_data[i];
+      partial_sums[thread_idx] = sum;
+    });
+
+    Real result = 0.;
+    for(Uint i = 0; i != partial_sums.size(); ++i)
+      result += partial_sums[i];
+    return result;
+  }
+
+  Real norm(const std::vector<Real>& a)
+  {
+    return std::sqrt(dot(a, a));
+  }
+
+  /// y = alpha*x + beta*y
+  void axpby(const Real alpha, const std::vector<Real>& x, const Real beta, std::vector<Real>& y)
+  {
+    const Real* x_data = &x[0];
+    Real* y_data = &y[0];
+    thread_team().run(x.size(), [=](const Uint, const Uint begin, const Uint end)
+    {
+      for(Uint i = begin; i != end; ++i)
+        y_data[i] = alpha*x_data[i] + beta*y_data[i];
+    });
+  }
+
+  /// r = b - A*x
+  void residual(const std::vector<Real>& b, const std::vector<Real>& x, std::vector<Real>& r)
+  {
+    r = b;
+    multiply(&x[0], &r[0], -1., 1.);
+  }
+
+  //@} END VECTOR OPERATIONS
+
+  /// @name PRECONDITIONERS
+  //@{
+
+  void setup_preconditioner()
+  {
+    const std::string preconditioner = m_self.options().value<std::string>("preconditioner");
+    const Uint neq = this->neq();
+    const Uint bs = neq*neq;
+    const Uint nb_rows = this->nb_rows();
+
+    m_inverse_diagonal.resize(nb_rows*bs);
+    if(is_not_null(m_matrix_free))
+    {
+      if(preconditioner == "ILU0" || preconditioner == "SGS")
+        throw common::NotSupported(FromHere(), "Preconditioner " + preconditioner + " needs a stored matrix. Use Jacobi or Chebyshev with matrix-free operator " + m_matrix_free->uri().path());
+      if(preconditioner != "None")
+      {
+        std::vector<Real> diagonal_blocks;
+        m_matrix_free->get_diagonal_blocks(diagonal_blocks);
+        for(Uint row = 0; row != nb_rows; ++row)
+          invert_block(&diagonal_blocks[row*bs], &m_inverse_diagonal[row*bs], neq, row);
+      }
+    }
+    else if(preconditioner == "Jacobi" || preconditioner == "SGS" || preconditioner == "Chebyshev")
+    {
+      const std::vector<Uint>& diagonal_blocks = m_matrix->diagonal_blocks();
+      const std::vector<Real>& values = m_matrix->values();
+      for(Uint row = 0; row != nb_rows; ++row)
+        invert_block(&values[diagonal_blocks[row]*bs], &m_inverse_diagonal[row*bs], neq, row);
+    }
+    else if(preconditioner == "ILU0")
+    {
+      const std::vector<Uint>& row_starts = m_matrix->row_starts();
+      const std::vector<Uint>& columns = m_matrix->block_columns();
+      const std::vector<Uint>& diagonal_blocks = m_matrix->diagonal_blocks();
+      const std::vector<Real>& values = m_matrix->values();
+
+      // Block ILU(0): the factors are stored in the sparsity pattern of the matrix, with the inverse of the diagonal of U kept apart
+      m_lu_values = values;
+      std::vector<Real> product(bs);
+      for(Uint row = 0; row != nb_rows; ++row)
+      {
+        const Uint row_end = row_starts[row+1];
+        for(Uint k = row_starts[row]; k != row_end && columns[k] < row; ++k)
+        {
+          const Uint pivot_row = columns[k];
+          block_matrix_product(&m_lu_values[k*bs], &m_inverse_diagonal[pivot_row*bs], &product[0], neq);
+          std::copy(product.begin(), product.end(), m_lu_values.begin() + k*bs);
+
+          // Update the blocks of this row that are also present in the upper part of the pivot row
+          Uint j = k+1;
+          Uint pivot_j = diagonal_blocks[pivot_row]+1;
+          const Uint pivot_end = row_starts[pivot_row+1];
+          while(j != row_end && pivot_j != pivot_end)
+          {
+            if(columns[j] < columns[pivot_j])
+            {
+              ++j;
+            }
+            else if(columns[pivot_j] < columns[j])
+            {
+              ++pivot_j;
+            }
+            else
+            {
+              block_subtract_matrix_product(&m_lu_values[k*bs], &m_lu_values[pivot_j*bs], &m_lu_values[j*bs], neq);
+              ++j;
+              ++pivot_j;
+            }
+          }
+        }
+        invert_block(&m_lu_values[diagonal_blocks[row]*bs], &m_inverse_diagonal[row*bs], neq, row);
+      }
+    }
+
+    if(preconditioner == "Chebyshev")
+      estimate_eigenvalues();
+
+    m_preconditioner_valid = true;
+  }
+
+  /// z = D^-1 r, with D the block diagonal
+  void apply_jacobi(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    const Uint neq = this->neq();
+    const Uint bs = neq*neq;
+    const Real* inverse_diagonal = &m_inverse_diagonal[0];
+    const Real* r_data = &r[0];
+    Real* z_data = &z[0];
+    thread_team().run(nb_rows(), [=](const Uint, const Uint begin, const Uint end)
+    {
+      for(Uint row = begin; row != end; ++row)
+        block_product(inverse_diagonal + row*bs, r_data + row*neq, z_data + row*neq, neq);
+    });
+  }
+
+  /// Estimate the largest eigenvalue of D^-1 A using power iterations, and derive the interval targeted by the Chebyshev preconditioner
+  void estimate_eigenvalues()
+  {
+    const Uint n = nb_rows()*neq();
+    std::vector<Real> v(n), av(n);
+    for(Uint i = 0; i != n; ++i)
+      v[i] = 1. + 0.1*static_cast<Real>(i % 7);
+
+    Real lambda = 0.;
+    for(Uint iter = 0; iter != 10; ++iter)
+    {
+      const Real v_norm = norm(v);
+      if(v_norm == 0.)
+        break;
+      axpby(0., v, 1. / v_norm, v);
+      multiply(&v[0], &av[0]);
+      apply_jacobi(av, v);
+      lambda = norm(v);
+    }
+
+    if(lambda == 0.)
+      throw common::BadValue(FromHere(), "Could not estimate the largest eigenvalue for the Chebyshev preconditioner of " + m_self.uri().path());
+
+    // Power iterations underestimate the largest eigenvalue, so add a safety margin
+    m_max_eigenvalue = 1.1*lambda;
+    m_min_eigenvalue = m_max_eigenvalue / std::max(1.1, m_self.options().value<Real>("chebyshev_eigenvalue_ratio"));
+    CFdebug << "Chebyshev preconditioner for " << m_self.uri().path() << " targets eigenvalues in [" << m_min_eigenvalue << ", " << m_max_eigenvalue << "]" << CFendl;
+  }
+
+  /// Approximate the solution of A z = r with a fixed number of Jacobi-preconditioned Chebyshev iterations, starting from zero
+  void apply_chebyshev(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    const Uint n = r.size();
+    const Uint degree = std::max(1u, m_self.options().value<Uint>("chebyshev_degree"));
+    const Real theta = 0.5*(m_max_eigenvalue + m_min_eigenvalue);
+    const Real delta = 0.5*(m_max_eigenvalue - m_min_eigenvalue);
+    const Real sigma = theta / delta;
+
+    std::vector<Real> d(n), res(n), w(n);
+    apply_jacobi(r, d);
+    axpby(0., d, 1. / theta, d);
+    z = d;
+
+    Real rho = 1. / sigma;
+    res = r;
+    for(Uint k = 1; k != degree; ++k)
+    {
+      // res = r - A z
+      multiply(&d[0], &res[0], -1., 1.);
+      apply_jacobi(res, w);
+      const Real rho_new = 1. / (2.*sigma - rho);
+      axpby(2.*rho_new / delta, w, rho_new*rho, d);
+      axpby(1., d, 1., z);
+      rho = rho_new;
+    }
+  }
+
+  /// z = M^-1 r
+  void apply_preconditioner(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    const std::string& preconditioner = m_preconditioner_name;
+
+    if(preconditioner == "None")
+    {
+      z = r;
+      return;
+    }
+    else if(preconditioner == "Jacobi")
+    {
+      apply_jacobi(r, z);
+      return;
+    }
+    else if(preconditioner == "Chebyshev")
+    {
+      apply_chebyshev(r, z);
+      return;
+    }
+
+    const Uint neq = m_matrix->neq();
+    const Uint bs = neq*neq;
+    const Uint nb_rows = m_matrix->nb_rows();
+    const std::vector<Uint>& row_starts = m_matrix->row_starts();
+    const std::vector<Uint>& columns = m_matrix->block_columns();
+    const std::vector<Uint>& diagonal_blocks = m_matrix->diagonal_blocks();
+
+    if(preconditioner == "SGS")
+    {
+      const std::vector<Real>& values = m_matrix->values();
+      std::vector<Real> rhs(neq);
+      // Forward sweep: (D+L) w = r
+      for(Uint row = 0; row != nb_rows; ++row)
+      {
+        std::copy(r.begin() + row*neq, r.begin() + (row+1)*neq, rhs.begin());
+        for(Uint k = row_starts[row]; k != diagonal_blocks[row]; ++k)
+          block_subtract_product(&values[k*bs], &z[columns[k]*neq], &rhs[0], neq);
+        block_product(&m_inverse_diagonal[row*bs], &rhs[0], &z[row*neq], neq);
+      }
+      // Backward sweep: (D+U) z = D w
+      std::vector<Real> correction(neq);
+      for(Uint row = nb_rows; row-- != 0;)
+      {
+        std::fill(rhs.begin(), rhs.end(), 0.);
+        for(Uint k = diagonal_blocks[row]+1; k != row_starts[row+1]; ++k)
+          block_subtract_product(&values[k*bs], &z[columns[k]*neq], &rhs[0], neq);
+        block_product(&m_inverse_diagonal[row*bs], &rhs[0], &correction[0], neq);
+        for(Uint e = 0; e != neq; ++e)
+          z[row*neq + e] += correction[e];
+      }
+    }
+    else if(preconditioner == "ILU0")
+    {
+      // Forward substitution with the unit lower factor
+      for(Uint row = 0; row != nb_rows; ++row)
+      {
+        Real* z_row = &z[row*neq];
+        std::copy(r.begin() + row*neq, r.begin() + (row+1)*neq, z_row);
+        for(Uint k = row_starts[row]; k != diagonal_blocks[row]; ++k)
+          block_subtract_product(&m_lu_values[k*bs], &z[columns[k]*neq], z_row, neq);
+      }
+      // Backward substitution with the upper factor
+      std::vector<Real> rhs(neq);
+      for(Uint row = nb_rows; row-- != 0;)
+      {
+        std::copy(z.begin() + row*neq, z.begin() + (row+1)*neq, rhs.begin());
+        for(Uint k = diagonal_blocks[row]+1; k != row_starts[row+1]; ++k)
+          block_subtract_product(&m_lu_values[k*bs], &z[columns[k]*neq], &rhs[0], neq);
+        block_product(&m_inverse_diagonal[row*bs], &rhs[0], &z[row*neq], neq);
+      }
+    }
+  }
+
+  //@} END PRECONDITIONERS
+
+  /// @name KRYLOV METHODS
+  /// Each returns true on convergence. b_norm is nonzero.
+  //@{
+
+  bool solve_cg(const std::vector<Real>& b, std::vector<Real>& x, const Real b_norm, const Real tolerance, const Uint max_iterations)
+  {
+    const Uint n = b.size();
+    std::vector<Real> r(n), z(n), p(n), q(n);
+    residual(b, x, r);
+    m_relative_residual = norm(r) / b_norm;
+    if(m_relative_residual <= tolerance)
+      return true;
+
+    apply_preconditioner(r, z);
+    p = z;
+    Real rz = dot(r, z);
+    for(m_nb_iterations = 1; m_nb_iterations <= max_iterations; ++m_nb_iterations)
+    {
+      multiply(&p[0], &q[0]);
+      const Real pq = dot(p, q);
+      if(pq == 0.)
+        return false;
+      const Real alpha = rz / pq;
+      axpby(alpha, p, 1., x);
+      axpby(-alpha, q, 1., r);
+      m_relative_residual = norm(r) / b_norm;
+      if(m_relative_residual <= tolerance)
+        return true;
+      apply_preconditioner(r, z);
+      const Real rz_new = dot(r, z);
+      axpby(1., z, rz_new / rz, p);
+      rz = rz_new;
+    }
+    m_nb_iterations = max_iterations;
+    return false;
+  }
+
+  bool solve_bicgstab(const std::vector<Real>& b, std::vector<Real>& x, const Real b_norm, const Real tolerance, const Uint max_iterations)
+  {
+    const Uint n = b.size();
+    std::vector<Real> r(n), r0(n), p(n, 0.), v(n, 0.), p_hat(n), s(n), s_hat(n), t(n);
+    residual(b, x, r);
+    m_relative_residual = norm(r) / b_norm;
+    if(m_relative_residual <= tolerance)
+      return true;
+
+    r0 = r;
+    Real rho = 1., alpha = 1., omega = 1.;
+    for(m_nb_iterations = 1; m_nb_iterations <= max_iterations; ++m_nb_iterations)
+    {
+      const Real rho_new = dot(r0, r);
+      if(rho_new == 0.)
+        return false;
+      const Real beta = (rho_new / rho) * (alpha / omega);
+      // p = r + beta*(p - omega*v)
+      axpby(-omega, v, 1., p);
+      axpby(1., r, beta, p);
+      apply_preconditioner(p, p_hat);
+      multiply(&p_hat[0], &v[0]);
+      const Real r0v = dot(r0, v);
+      if(r0v == 0.)
+        return false;
+      alpha = rho_new / r0v;
+      s = r;
+      axpby(-alpha, v, 1., s);
+      m_relative_residual = norm(s) / b_norm;
+      if(m_relative_residual <= tolerance)
+      {
+        axpby(alpha, p_hat, 1., x);
+        return true;
+      }
+      apply_preconditioner(s, s_hat);
+      multiply(&s_hat[0], &t[0]);
+      const Real tt = dot(t, t);
+      omega = tt == 0. ? 0. : dot(t, s) / tt;
+      axpby(alpha, p_hat, 1., x);
+      axpby(omega, s_hat, 1., x);
+      r = s;
+      axpby(-omega, t, 1., r);
+      m_relative_residual = norm(r) / b_norm;
+      if(m_relative_residual <= tolerance)
+        return true;
+      if(omega == 0.)
+        return false;
+      rho = rho_new;
+    }
+    m_nb_iterations = max_iterations;
+    return false;
+  }
+
+  /// Restarted GMRES with right preconditioning, using modified Gram-Schmidt and Givens rotations
+  bool solve_gmres(const std::vector<Real>& b, std::vector<Real>& x, const Real b_norm, const Real tolerance, const Uint max_iterations)
+  {
+    const Uint n = b.size();
+    const Uint restart = std::max(1u, m_self.options().value<Uint>("gmres_restart"));
+    std::vector< std::vector<Real> > basis(restart+1, std::vector<Real>(n));
+    std::vector<Real> w(n), z(n);
+    std::vector<Real> hessenberg((restart+1)*restart);
+    std::vector<Real> cs(restart), sn(restart), g(restart+1), y(restart);
+
+    m_nb_iterations = 0;
+    while(true)
+    {
+      residual(b, x, basis[0]);
+      const Real beta = norm(basis[0]);
+      m_relative_residual = beta / b_norm;
+      if(m_relative_residual <= tolerance)
+        return true;
+      if(m_nb_iterations >= max_iterations)
+        return false;
+
+      axpby(0., basis[0], 1. / beta, basis[0]);
+      std::fill(g.begin(), g.end(), 0.);
+      g[0] = beta;
+
+      Uint nb_vectors = 0;
+      bool converged = false;
+      for(Uint j = 0; j != restart && m_nb_iterations != max_iterations; ++j)
+      {
+        ++m_nb_iterations;
+        ++nb_vectors;
+        apply_preconditioner(basis[j], z);
+        multiply(&z[0], &w[0]);
+        for(Uint i = 0; i <= j; ++i)
+        {
+          const Real h = dot(w, basis[i]);
+          hessenberg[i*restart + j] = h;
+          axpby(-h, basis[i], 1., w);
+        }
+        const Real h_next = norm(w);
+        if(h_next != 0.)
+          axpby(1. / h_next, w, 0., basis[j+1]);
+
+        // Apply the previous rotations to the new column
+        for(Uint i = 0; i != j; ++i)
+        {
+          const Real h_i = hessenberg[i*restart + j];
+          const Real h_i1 = hessenberg[(i+1)*restart + j];
+          hessenberg[i*restart + j] = cs[i]*h_i + sn[i]*h_i1;
+          hessenberg[(i+1)*restart + j] = -sn[i]*h_i + cs[i]*h_i1;
+        }
+        const Real h_j = hessenberg[j*restart + j];
+        const Real denominator = std::sqrt(h_j*h_j + h_next*h_next);
+        cs[j] = denominator == 0. ? 1. : h_j / denominator;
+        sn[j] = denominator == 0. ? 0. : h_next / denominator;
+        hessenberg[j*restart + j] = denominator;
+        g[j+1] = -sn[j]*g[j];
+        g[j] = cs[j]*g[j];
+
+        m_relative_residual = std::abs(g[j+1]) / b_norm;
+        if(m_relative_residual <= tolerance || h_next == 0.)
+        {
+          converged = true;
+          break;
+        }
+      }
+
+      // Solve the triangular system and update x with the preconditioned combination of the basis
+      for(Uint i = nb_vectors; i-- != 0;)
+      {
+        Real sum = g[i];
+        for(Uint k = i+1; k != nb_vectors; ++k)
+          sum -= hessenberg[i*restart + k] * y[k];
+        y[i] = sum / hessenberg[i*restart + i];
+      }
+      std::fill(w.begin(), w.end(), 0.);
+      for(Uint i = 0; i != nb_vectors; ++i)
+        axpby(y[i], basis[i], 1., w);
+      apply_preconditioner(w, z);
+      axpby(1., z, 1., x);
+
+      if(converged)
+      {
+        // Report the true residual rather than the estimate from the rotations
+        residual(b, x, w);
+        m_relative_residual = norm(w) / b_norm;
+        return true;
+      }
+    }
+  }
+
+  //@} END KRYLOV METHODS
+
+  void solve()
+  {
+    check_setup();
+
+    std::vector<Real>& x = m_solution->data();
+    const std::vector<Real>& b = m_rhs->data();
+    if(x.size() != b.size() || b.size() != nb_rows()*neq())
+      throw common::SetupError(FromHere(), "Inconsistent sizes for the linear system solved by " + m_self.uri().path());
+
+    if(!m_preconditioner_valid || m_solve_count % std::max(1u, m_preconditioner_reset) == 0)
+    {
+      m_preconditioner_name = m_self.options().value<std::string>("preconditioner");
+      setup_preconditioner();
+    }
+    ++m_solve_count;
+
+    m_nb_iterations = 0;
+    m_relative_residual = 0.;
+    const Real b_norm = norm(b);
+    if(b_norm == 0.)
+    {
+      x.assign(x.size(), 0.);
+      return;
+    }
+
+    const std::string solver = m_self.options().value<std::string>("solver");
+    const Real tolerance = m_self.options().value<Real>("tolerance");
+    const Uint max_iterations = m_self.options().value<Uint>("max_iterations");
+
+    bool converged = false;
+    if(solver == "CG")
+      converged = solve_cg(b, x, b_norm, tolerance, max_iterations);
+    else if(solver == "BiCGStab")
+      converged = solve_bicgstab(b, x, b_norm, tolerance, max_iterations);
+    else
+      converged = solve_gmres(b, x, b_norm, tolerance, max_iterations);
+
+    if(converged)
+      CFinfo << solver << " with " << m_preconditioner_name << " preconditioner converged in " << m_nb_iterations << " iterations, relative residual " << m_relative_residual << CFendl;
+    else
+      CFwarn << solver << " with " << m_preconditioner_name << " preconditioner did not converge after " << m_nb_iterations << " iterations, relative residual " << m_relative_residual << CFendl;
+  }
+
+  Real compute_residual()
+  {
+    check_setup();
+    std::vector<Real> r(m_rhs->data().size());
+    residual(m_rhs->data(), m_solution->data(), r);
+    return norm(r);
+  }
+
+  common::Component& m_self;
+  /// The matrix, only one of both is set
+  Handle<NativeCrsMatrix> m_matrix;
+  Handle<NativeMatrixFree> m_matrix_free;
+  Handle<NativeVector> m_rhs;
+  Handle<NativeVector> m_solution;
+
+  Uint m_preconditioner_reset;
+  Uint m_solve_count;
+  bool m_preconditioner_valid;
+  /// Preconditioner that was set up
+  std::string m_preconditioner_name;
+
+  /// Inverse of the diagonal blocks for Jacobi and SGS, or of the diagonal blocks of U for ILU(0)
+  std::vector<Real> m_inverse_diagonal;
+  /// ILU(0) factors
+  std::vector<Real> m_lu_values;
+  /// Eigenvalue interval for the Chebyshev preconditioner
+  Real m_min_eigenvalue;
+  Real m_max_eigenvalue;
+
+  Uint m_nb_iterations;
+  Real m_relative_residual;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeStrategy::NativeStrategy(const std::string& name) :
+  SolutionStrategy(name),
+  m_implementation(new Implementation(*this))
+{
+}
+
+NativeStrategy::~NativeStrategy()
+{
+}
+
+void NativeStrategy::set_matrix(const Handle< Matrix >& matrix)
+{
+  m_implementation->m_matrix = Handle<NativeCrsMatrix>(matrix);
+  m_implementation->m_matrix_free = Handle<NativeMatrixFree>(matrix);
+  if(is_null(m_implementation->m_matrix) && is_null(m_implementation->m_matrix_free))
+    throw common::SetupError(FromHere(), "NativeStrategy needs a NativeCrsMatrix or a NativeMatrixFree, but a " + matrix->derived_type_name() + " was supplied instead.");
+  m_implementation->m_preconditioner_valid = false;
+}
+
+void NativeStrategy::set_rhs(const Handle< Vector >& rhs)
+{
+  m_implementation->m_rhs = Handle<NativeVector>(rhs);
+  if(is_null(m_implementation->m_rhs))
+    throw common::SetupError(FromHere(), "NativeStrategy needs a NativeVector as RHS, but a " + rhs->derived_type_name() + " was supplied instead.");
+}
+
+void NativeStrategy::set_solution(const Handle< Vector >& solution)
+{
+  m_implementation->m_solution = Handle<NativeVector>(solution);
+  if(is_null(m_implementation->m_solution))
+    throw common::SetupError(FromHere(), "NativeStrategy needs a NativeVector as solution, but a " + solution->derived_type_name() + " was supplied instead.");
+}
+
+void NativeStrategy::solve()
+{
+  m_implementation->solve();
+}
+
+Real NativeStrategy::compute_residual()
+{
+  return m_implementation->compute_residual();
+}
+
+void NativeStrategy::set_coordinates(common::PE::CommPattern& cp, const common::Table< Real >& coords, const common::List< Uint >& used_nodes, const std::vector< bool >& periodic_links_active)
+{
+}
+
+Uint NativeStrategy::nb_iterations() const
+{
+  return m_implementation->m_nb_iterations;
+}
+
+Real NativeStrategy::relative_residual() const
+{
+  return m_implementation->m_relative_residual;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
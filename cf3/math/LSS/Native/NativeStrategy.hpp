@@ -0,0 +1,74 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeStrategy_hpp
+#define cf3_Math_LSS_NativeStrategy_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/scoped_ptr.hpp>
+
+#include "math/LSS/SolutionStrategy.hpp"
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeStrategy.hpp Krylov solvers for the native LSS backend
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Solves a system built from a NativeCrsMatrix or a NativeMatrixFree and NativeVectors, using CG, BiCGStab or restarted GMRES.
+/// The available preconditioners are block Jacobi, block ILU(0), block symmetric Gauss-Seidel and Jacobi-Chebyshev, where
+/// the blocks are the neq x neq blocks of the matrix. Only the Jacobi and Chebyshev preconditioners work without a stored matrix.
+/// The solution vector is used as initial guess.
+class LSS_API NativeStrategy : public SolutionStrategy
+{
+public:
+
+  /// Default constructor
+  NativeStrategy(const std::string& name);
+
+  ~NativeStrategy();
+
+  /// name of the type
+  static std::string type_name () { return "NativeStrategy"; }
+
+  void set_matrix(const Handle<LSS::Matrix>& matrix);
+  void set_rhs(const Handle<LSS::Vector>& rhs);
+  void set_solution(const Handle<LSS::Vector>& solution);
+  void solve();
+  Real compute_residual();
+
+  /// Coordinates are not used by any of the native preconditioners, so this does nothing
+  virtual void set_coordinates(common::PE::CommPattern& cp, const common::Table< Real >& coords, const common::List< Uint >& used_nodes, const std::vector< bool >& periodic_links_active);
+
+  /// Number of iterations used by the last solve
+  Uint nb_iterations() const;
+
+  /// Residual norm relative to the norm of the right hand side at the end of the last solve
+  Real relative_residual() const;
+
+private:
+  struct Implementation;
+  boost::scoped_ptr<Implementation> m_implementation;
+
+}; // end of class NativeStrategy
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeStrategy_hpp
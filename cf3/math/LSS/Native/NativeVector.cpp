@@ -0,0 +1,386 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+
+#include "common/Builder.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeVector.cpp implementation of LSS::NativeVector
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeVector, LSS::Vector, LSS::LibLSS > NativeVector_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeVector::NativeVector(const std::string& name) :
+  LSS::Vector(name),
+  m_neq(0),
+  m_is_created(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::create(common::PE::CommPattern& cp, Uint neq, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  const Uint nb_rows = LSS::detail::create_row_map(cp, periodic_links_nodes, periodic_links_active, m_node_to_row);
+  m_neq = neq;
+  m_data.assign(nb_rows*m_neq, 0.);
+  m_is_created = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::destroy()
+{
+  std::vector<Real>().swap(m_data);
+  std::vector<Uint>().swap(m_node_to_row);
+  m_neq=0;
+  m_is_created=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_value(const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(irow/m_neq, irow%m_neq)]=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_value(const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(irow/m_neq, irow%m_neq)]+=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_value(const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  value=m_data[index(irow/m_neq, irow%m_neq)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_value(const Uint iblockrow, const Uint ieq, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(iblockrow, ieq)]=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_value(const Uint iblockrow, const Uint ieq, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(iblockrow, ieq)]+=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_value(const Uint iblockrow, const Uint ieq, Real& value)
+{
+  cf3_assert(m_is_created);
+  value=m_data[index(iblockrow, ieq)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_rhs_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  const Real* vals = values.rhs.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      row[j] = *vals++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_rhs_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  const Real* vals = values.rhs.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      row[j] += *vals++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_rhs_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  Real* vals = values.rhs.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    const Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      *vals++ = row[j];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_sol_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  const Real* vals = values.sol.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      row[j] = *vals++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_sol_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  const Real* vals = values.sol.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      row[j] += *vals++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_sol_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_blocks = values.indices.size();
+  Real* vals = values.sol.data();
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    const Real* row = &m_data[index(values.indices[i], 0)];
+    for(Uint j = 0; j != m_neq; ++j)
+      *vals++ = row[j];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  m_data.assign(m_data.size(), reset_to);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get( boost::multi_array<Real, 2>& data)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(data.shape()[0]==nb_nodes);
+  cf3_assert(data.shape()[1]==m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      data[i][j]=m_data[index(i, j)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set( boost::multi_array<Real, 2>& data)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  cf3_assert(data.shape()[0]==nb_nodes);
+  cf3_assert(data.shape()[1]==m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      m_data[index(i, j)]=data[i][j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    const Uint nb_nodes = m_node_to_row.size();
+    for(Uint i = 0; i != nb_nodes; ++i)
+      for(Uint j = 0; j != m_neq; ++j)
+        stream << 0 << " " << -(int)(i*m_neq+j) << " " << m_data[index(i, j)] << "\n";
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << nb_nodes*m_neq << "\n";
+    stream << "# number of block rows: " << nb_nodes << "\n";
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    const Uint nb_nodes = m_node_to_row.size();
+    for(Uint i = 0; i != nb_nodes; ++i)
+      for(Uint j = 0; j != m_neq; ++j)
+        stream << 0 << " " << -(int)(i*m_neq+j) << " " << m_data[index(i, j)] << "\n";
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << nb_nodes*m_neq << "\n";
+    stream << "# number of block rows: " << nb_nodes << "\n" << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(const std::string& filename, std::ios_base::openmode mode)
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print_native(std::ostream& stream)
+{
+  const Uint size = m_data.size();
+  for(Uint i = 0; i != size; ++i)
+    stream << i << " " << m_data[i] << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::debug_data(std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_node_to_row.size();
+  values.clear();
+  values.reserve(nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      values.push_back(m_data[index(i, j)]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::clone_to(Vector &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Vector to clone " + uri().string() + " is not created");
+
+  NativeVector* other_ptr = dynamic_cast<NativeVector*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeVector needs another NativeVector, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->m_data = m_data;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_node_to_row = m_node_to_row;
+  other_ptr->m_is_created = m_is_created;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::assign(const Vector& source)
+{
+  NativeVector const* source_ptr = dynamic_cast<NativeVector const*>(&source);
+
+  if(is_null(source_ptr))
+    throw common::SetupError(FromHere(), "assign method of NativeVector needs another NativeVector, but a " + source.derived_type_name() + " was supplied instead.");
+
+  if(source_ptr->m_data.size() != m_data.size())
+    throw common::SetupError(FromHere(), "assign method of NativeVector got a vector with incorrect size");
+
+  m_data.assign(source_ptr->m_data.begin(), source_ptr->m_data.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::update ( const Vector& source, const Real alpha )
+{
+  NativeVector const* source_ptr = dynamic_cast<NativeVector const*>(&source);
+
+  if(is_null(source_ptr))
+    throw common::SetupError(FromHere(), "update method of NativeVector needs another NativeVector, but a " + source.derived_type_name() + " was supplied instead.");
+
+  if(source_ptr->m_data.size() != m_data.size())
+    throw common::SetupError(FromHere(), "update method of NativeVector got a vector with incorrect size");
+
+  const Uint size = m_data.size();
+  for(Uint i = 0; i != size; ++i)
+    m_data[i] += alpha*source_ptr->m_data[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::scale ( const Real alpha )
+{
+  const Uint size = m_data.size();
+  if(alpha != 1.)
+  {
+    for(Uint i = 0; i != size; ++i)
+      m_data[i] *= alpha;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::read_native(const common::URI& filename, const std::string type)
+{
+  throw common::NotImplemented(FromHere(), "read_native method is not implemented for " + derived_type_name());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
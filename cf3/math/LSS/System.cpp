@@ -15,6 +15,7 @@
 #include "common/Component.hpp"
 #include "common/OptionT.hpp"
 #include "common/PE/CommPattern.hpp"
+#include "common/RegionProfiler.hpp"
 #include "common/Signal.hpp"
 
 #include "common/XML/Protocol.hpp"
@@ -84,8 +85,10 @@ LSS::System::System(const std::string& name) :
 
 void LSS::System::create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector<Uint>& node_connectivity, std::vector<Uint>& starting_indices, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
 {
+  common::ScopedRegion region(*this, "/create");
   if (is_created())
     destroy();
+  clear_dependency_stamps();
 
   const std::string matrix_builder = options().option("matrix_builder").value_str();
   m_mat = create_component<LSS::Matrix>("Matrix", matrix_builder);
@@ -116,8 +119,10 @@ void LSS::System::create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector
 
 void LSS::System::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, std::vector< Uint >& node_connectivity, std::vector< Uint >& starting_indices, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
 {
+  common::ScopedRegion region(*this, "/create");
   if (is_created())
     destroy();
+  clear_dependency_stamps();
 
   const std::string matrix_builder = options().option("matrix_builder").value_str();
   m_mat = create_component<LSS::Matrix>("Matrix", matrix_builder);
@@ -170,6 +175,7 @@ void LSS::System::swap( const boost::shared_ptr< LSS::Matrix >& matrix, const bo
   m_mat = make_handle(matrix);
   m_rhs = make_handle(rhs);
   m_sol = make_handle(solution);
+  clear_dependency_stamps();
 
   add_component(matrix);
   add_component(solution);
@@ -198,6 +204,7 @@ void LSS::System::destroy()
   m_mat.reset();
   m_sol.reset();
   m_rhs.reset();
+  clear_dependency_stamps();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -205,7 +212,11 @@ void LSS::System::destroy()
 void LSS::System::solve()
 {
   cf3_assert(is_created());
-  dirichlet_apply(m_preserve_symmetry);
+  {
+    common::ScopedRegion region(*this, "/dirichlet");
+    dirichlet_apply(m_preserve_symmetry);
+  }
+  common::ScopedRegion region(*this, "/solve");
   m_solution_strategy->solve();
 }
 
@@ -337,6 +348,31 @@ void LSS::System::reset(Real reset_to)
   m_mat->reset(reset_to);
   m_sol->reset(reset_to);
   m_rhs->reset(reset_to);
+  clear_dependency_stamps();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LSS::System::dependency_changed(const std::string& name, const std::size_t stamp) const
+{
+  std::map<std::string, std::size_t>::const_iterator it = m_dependency_stamps.find(name);
+  return it == m_dependency_stamps.end() || it->second != stamp;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void LSS::System::set_dependency_stamp(const std::string& name, const std::size_t stamp)
+{
+  m_dependency_stamps[name] = stamp;
+  m_has_dependency_stamps = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void LSS::System::clear_dependency_stamps()
+{
+  if(m_has_dependency_stamps.exchange(false))
+    m_dependency_stamps.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -381,6 +417,7 @@ void LSS::System::read_native(const common::URI& filename)
 {
   if (is_created())
     destroy();
+  clear_dependency_stamps();
 
   const std::string matrix_builder = options().option("matrix_builder").value_str();
   m_mat = create_component<LSS::Matrix>("Matrix", matrix_builder);
@@ -9,6 +9,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <atomic>
+
 //#include <boost/utility.hpp>
 
 #include "math/LSS/LibLSS.hpp"
@@ -166,6 +168,24 @@ public:
 
   //@} END MISCELLANEOUS
 
+  /// @name DEPENDENCY TRACKING
+  /// Version stamps of the inputs the matrix was assembled from, allowing to skip an assembly that would give the same matrix
+  //@{
+
+  /// True if the stamp differs from the one recorded for the named dependency, or if none was recorded,
+  /// i.e. if the matrix needs to be assembled again
+  bool dependency_changed(const std::string& name, const std::size_t stamp) const;
+
+  /// Record the stamp of the named dependency, after assembling the matrix
+  void set_dependency_stamp(const std::string& name, const std::size_t stamp);
+
+  /// Forget all recorded stamps. Called by create, destroy and reset, and for each block of values that a Proto
+  /// expression writes into the matrix, so any modification outside of the tracked assembly forces a new assembly.
+  /// May be called from several threads at once, but not at the same time as the other dependency functions.
+  void clear_dependency_stamps();
+
+  //@} END DEPENDENCY TRACKING
+
   /// @name SIGNALS
   //@{
 
@@ -195,6 +215,13 @@ private:
   DirichletMapT m_symmetric_dirichlet_values_buffer;
   bool m_preserve_symmetry = true;
 
+  /// Stamp for each dependency of the current matrix
+  std::map<std::string, std::size_t> m_dependency_stamps;
+
+  /// False if m_dependency_stamps is known to be empty. Threaded element loops clear the stamps concurrently, and only the
+  /// first thread to reset this flag touches the map.
+  std::atomic<bool> m_has_dependency_stamps{false};
+
 }; // end of class System
 
 ////////////////////////////////////////////////////////////////////////////////////////////
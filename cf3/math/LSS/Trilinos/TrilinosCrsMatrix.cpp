@@ -6,9 +6,11 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 
+#include <boost/bind.hpp>
 #include <boost/pointer_cast.hpp>
 
 #include "Teuchos_ConfigDefs.hpp"
@@ -73,6 +75,18 @@ TrilinosCrsMatrix::TrilinosCrsMatrix(const std::string& name) :
   m_comm(common::PE::Comm::instance().communicator())
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
+
+  options().add("assembly_plan", false)
+    .pretty_name("Assembly Plan")
+    .description("Remember the position in the matrix storage of each entry passed to add_values, so that assembling the same element again does not need any lookup in the matrix graph. This speeds up repeated assembly on a fixed mesh, at the cost of memory comparable to the matrix itself.")
+    .attach_trigger(boost::bind(&TrilinosCrsMatrix::trigger_assembly_plan, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosCrsMatrix::trigger_assembly_plan()
+{
+  m_assembly_plan.enable(options().value<bool>("assembly_plan"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -91,6 +105,7 @@ void TrilinosCrsMatrix::create_blocked(common::PE::CommPattern& cp, const Variab
 {
   // if already created
   if (m_is_created) destroy();
+  m_assembly_plan.clear();
 
   // Copy node connectivity
   m_node_connectivity.resize(node_connectivity.size());
@@ -156,6 +171,7 @@ void TrilinosCrsMatrix::destroy()
   }
   m_p2m.resize(0);
   m_p2m.reserve(0);
+  m_assembly_plan.clear();
   m_neq=0;
   m_num_my_elements=0;
   m_is_created=false;
@@ -231,6 +247,28 @@ void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
+  if(m_assembly_plan.is_enabled())
+  {
+    const int* positions = nullptr;
+    if(!m_assembly_plan.lookup(values.indices, positions))
+      positions = add_assembly_positions(values);
+    // Direct scatter into the value array, skipping rows that are not owned by this process
+    if(is_not_null(positions))
+    {
+      int* row_offsets;
+      int* column_indices;
+      Real* matrix_values;
+      TRILINOS_THROW(m_mat->ExtractCrsDataPointers(row_offsets, column_indices, matrix_values));
+      const int nb_values = num_entries*num_entries;
+      const Real* block_values = values.mat.data();
+      for(int i = 0; i != nb_values; ++i)
+      {
+        if(positions[i] >= 0)
+          matrix_values[positions[i]] += block_values[i];
+      }
+      return;
+    }
+  }
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
@@ -251,6 +289,56 @@ void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+const int* TrilinosCrsMatrix::add_assembly_positions(const BlockAccumulator& values)
+{
+  // Positions are relative to the start of the value array, which is only contiguous with optimized storage
+  if(!m_mat->StorageOptimized())
+  {
+    m_assembly_plan.insert_miss(values.indices);
+    return nullptr;
+  }
+
+  int* row_offsets;
+  int* column_indices;
+  Real* matrix_values;
+  TRILINOS_THROW(m_mat->ExtractCrsDataPointers(row_offsets, column_indices, matrix_values));
+
+  const Uint nb_nodes = values.indices.size();
+  const int num_entries = nb_nodes*m_neq;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint local_start_idx = values.indices[i]*m_neq;
+    for(int j = 0; j != m_neq; ++j)
+      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+  }
+
+  m_assembly_positions.assign(num_entries*num_entries, -1);
+  for(int row = 0; row != num_entries; ++row)
+  {
+    const int matrix_row = m_converted_indices[row];
+    if(matrix_row >= m_num_my_elements)
+      continue;
+
+    const int row_begin = row_offsets[matrix_row];
+    const int row_end = row_offsets[matrix_row+1];
+    for(int col = 0; col != num_entries; ++col)
+    {
+      const int* found = std::find(column_indices + row_begin, column_indices + row_end, m_converted_indices[col]);
+      // Let the default code path report entries that are not in the sparsity pattern
+      if(found == column_indices + row_end)
+      {
+        m_assembly_plan.insert_miss(values.indices);
+        return nullptr;
+      }
+      m_assembly_positions[row*num_entries + col] = found - column_indices;
+    }
+  }
+
+  return m_assembly_plan.insert(values.indices, m_assembly_positions);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
 {
   cf3_assert(m_is_created);
@@ -333,8 +421,6 @@ void TrilinosCrsMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq,
 
   const int bc_col = m_p2m[blockrow*m_neq+ieq];
 
-  m_dirichlet_nodes.push_back(std::make_pair(blockrow, ieq));
-
   const Uint nb_connected_nodes = m_starting_indices[blockrow+1] - m_starting_indices[blockrow];
   std::vector<int> row_indices; row_indices.reserve(m_neq*nb_connected_nodes);
   const Uint conn_start = m_starting_indices[blockrow];
@@ -351,6 +437,9 @@ void TrilinosCrsMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq,
 
   if(cached_col_values.empty())
   {
+    // Only recorded the first time, the condition may be applied again to the same matrix
+    m_dirichlet_nodes.push_back(std::make_pair(blockrow, ieq));
+
     BOOST_FOREACH(const int other_row, row_indices)
     {
       if(other_row >= m_num_my_elements)
@@ -533,6 +622,7 @@ void TrilinosCrsMatrix::clone_to(Matrix &other)
   other_ptr->m_node_connectivity = m_node_connectivity;
   other_ptr->m_starting_indices = m_starting_indices;
   other_ptr->m_symmetric_dirichlet_values = m_symmetric_dirichlet_values;
+  other_ptr->m_assembly_plan.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -540,6 +630,7 @@ void TrilinosCrsMatrix::clone_to(Matrix &other)
 void TrilinosCrsMatrix::read_native(const common::URI& file)
 {  
   EpetraExt::readEpetraLinearSystem(file.path(), m_comm, &m_mat);
+  m_assembly_plan.clear();
   
   m_is_created = true;
 }
@@ -14,6 +14,7 @@
 #include <Teuchos_RCP.hpp>
 
 #include "math/LSS/LibLSS.hpp"
+#include "math/LSS/AssemblyPlan.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
 #include "math/LSS/Vector.hpp"
 #include "math/LSS/Matrix.hpp"
@@ -163,6 +164,7 @@ public:
   void replace_epetra_matrix(const Teuchos::RCP<Epetra_CrsMatrix>& mat)
   {
     m_mat = mat;
+    m_assembly_plan.clear();
   }
   
   /// Store the local matrix GIDs belonging to each variable in the given vector
@@ -204,6 +206,12 @@ public:
 
 private:
 
+  void trigger_assembly_plan();
+
+  /// Look up the storage positions of the entries of values in the matrix graph and add them to the assembly plan
+  /// @return The positions, or null if they can't be used. In that case a miss is stored, so the lookup is not repeated.
+  const int* add_assembly_positions(const BlockAccumulator& values);
+
   /// teuchos style smart pointer wrapping the matrix
   Teuchos::RCP<Epetra_CrsMatrix> m_mat;
 
@@ -234,6 +242,12 @@ private:
   DirichletMapT m_symmetric_dirichlet_values;
 
   std::vector< std::pair<Uint,Uint> > m_dirichlet_nodes;
+
+  /// Cached storage positions for add_values, cleared each time the matrix is created
+  AssemblyPlan m_assembly_plan;
+
+  /// Helper array to build the assembly plan
+  std::vector<int> m_assembly_positions;
 }; // end of class Matrix
 
 ////////////////////////////////////////////////////////////////////////////////////////////
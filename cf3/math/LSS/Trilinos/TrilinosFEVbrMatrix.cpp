@@ -6,8 +6,10 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <iostream>
 
+#include <boost/bind.hpp>
 #include <boost/pointer_cast.hpp>
 
 #include "Stratimikos_DefaultLinearSolverBuilder.hpp"
@@ -64,6 +66,18 @@ TrilinosFEVbrMatrix::TrilinosFEVbrMatrix(const std::string& name) :
   m_comm(common::PE::Comm::instance().communicator())
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
+
+  options().add("assembly_plan", false)
+    .pretty_name("Assembly Plan")
+    .description("Remember the position of each block passed to add_values in its block row, so that assembling the same element again does not need to search the block rows.")
+    .attach_trigger(boost::bind(&TrilinosFEVbrMatrix::trigger_assembly_plan, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosFEVbrMatrix::trigger_assembly_plan()
+{
+  m_assembly_plan.enable(options().value<bool>("assembly_plan"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -75,6 +89,7 @@ void TrilinosFEVbrMatrix::create(cf3::common::PE::CommPattern& cp, const Uint ne
 
   // if already created
   if (m_is_created) destroy();
+  m_assembly_plan.clear();
 
   // Copy node connectivity
   m_node_connectivity.resize(node_connectivity.size());
@@ -146,6 +161,7 @@ void TrilinosFEVbrMatrix::destroy()
   if (m_is_created) m_mat.reset();
   m_p2m.resize(0);
   m_p2m.reserve(0);
+  m_assembly_plan.clear();
   m_neq=0;
   m_blockrow_size=0;
   m_blockcol_size=0;
@@ -325,6 +341,27 @@ void TrilinosFEVbrMatrix::add_values(const BlockAccumulator& values)
   if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
   for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
   int* idxs=(int*)&m_converted_indices[0];
+  if (m_assembly_plan.is_enabled())
+  {
+    const int* positions=m_assembly_plan.find(values.indices);
+    if (positions==nullptr) positions=add_assembly_positions(values);
+    // positions holds the index of each block in its block row, so the block rows don't need to be searched
+    for (int irow=0; irow<(const int)numblocks; irow++)
+    {
+      if (idxs[irow]<m_blockrow_size)
+      {
+        TRILINOS_ASSERT(m_mat->ExtractMyBlockRowView(idxs[irow],dummyneq,blockrowsize,colindices,val));
+        for (int icol=0; icol<(const int)numblocks; icol++)
+        {
+          double *emv=val[positions[irow*numblocks+icol]][0].A();
+          for (int l=0; l<(const int)m_neq; l++)
+            for (int m=0; m<(const int)m_neq; m++)
+              *emv++ += values.mat(irow*m_neq+m, icol*m_neq+l);
+        }
+      }
+    }
+    return;
+  }
   for (int irow=0; irow<(const int)numblocks; irow++)
   {
     if (idxs[irow]<m_blockrow_size)
@@ -356,6 +393,34 @@ void TrilinosFEVbrMatrix::add_values(const BlockAccumulator& values)
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+const int* TrilinosFEVbrMatrix::add_assembly_positions(const BlockAccumulator& values)
+{
+  Epetra_SerialDenseMatrix **val;
+  int* colindices;
+  int blockrowsize;
+  int dummyneq;
+  const int numblocks=values.indices.size();
+  const int* idxs=&m_converted_indices[0];
+  m_assembly_positions.assign(numblocks*numblocks,-1);
+  for (int irow=0; irow<(const int)numblocks; irow++)
+  {
+    if (idxs[irow]<m_blockrow_size)
+    {
+      TRILINOS_ASSERT(m_mat->ExtractMyBlockRowView(idxs[irow],dummyneq,blockrowsize,colindices,val));
+      for (int icol=0; icol<(const int)numblocks; icol++)
+      {
+        const int* found=std::find(colindices,colindices+blockrowsize,idxs[icol]);
+        if (found==colindices+blockrowsize)
+          throw common::BadValue(FromHere(),"Trying to access an illegal entry.");
+        m_assembly_positions[irow*numblocks+icol]=found-colindices;
+      }
+    }
+  }
+  return m_assembly_plan.insert(values.indices,m_assembly_positions);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void TrilinosFEVbrMatrix::get_values(BlockAccumulator& values)
 {
   cf3_assert(m_is_created);
@@ -14,6 +14,7 @@
 #include <Teuchos_RCP.hpp>
 
 #include "math/LSS/LibLSS.hpp"
+#include "math/LSS/AssemblyPlan.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
 #include "math/LSS/Vector.hpp"
 #include "math/LSS/Matrix.hpp"
@@ -173,6 +174,12 @@ public:
 
 private:
 
+  void trigger_assembly_plan();
+
+  /// Look up the index of each block of values in its block row and add them to the assembly plan
+  /// @pre m_converted_indices contains the matrix indices of the blocks
+  const int* add_assembly_positions(const BlockAccumulator& values);
+
   /// teuchos style smart pointer wrapping an epetra fevbrmatrix
   Teuchos::RCP<Epetra_FEVbrMatrix> m_mat;
 
@@ -200,6 +207,12 @@ private:
   /// Copy of the connectivity data
   std::vector<int> m_node_connectivity, m_starting_indices;
 
+  /// Cached block positions for add_values, cleared each time the matrix is created
+  AssemblyPlan m_assembly_plan;
+
+  /// Helper array to build the assembly plan
+  std::vector<int> m_assembly_positions;
+
 }; // end of class Matrix
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,6 +45,10 @@ public:
   /// Accessor to solver type
   virtual const std::string solvertype() = 0;
 
+  /// True if set_rhs_values and add_rhs_values may be called from several threads at once, as long as the calls that run at the
+  /// same time don't share any block row. Implementations that use internal scratch storage for these calls keep the default.
+  virtual bool concurrent_assembly() { return false; }
+
   /// Default constructor
   Vector(const std::string& name) : Component(name) { }
 
@@ -31,6 +31,7 @@ VectorialFunction::VectorialFunction()
     m_nbvars(0),
     m_functions(0),
     m_parsers(),
+    m_compiled(),
     m_result()
 {
 }
@@ -41,6 +42,7 @@ VectorialFunction::VectorialFunction( const std::string& funcs, const std::strin
     m_nbvars(0),
     m_functions(0),
     m_parsers(),
+    m_compiled(),
     m_result()
 {
   functions( funcs );
@@ -66,6 +68,7 @@ void VectorialFunction::clear()
       delete_ptr(m_parsers[i]);
   }
   vector<FunctionParser*>().swap(m_parsers);
+  vector<CompiledFunction>().swap(m_compiled);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -173,6 +176,10 @@ void VectorialFunction::parse()
     }
   }
 
+  m_compiled.resize(m_parsers.size());
+  for(Uint i = 0; i < m_parsers.size(); ++i)
+    m_compiled[i].compile(*m_parsers[i]);
+
   m_result.resize(m_functions.size());
   m_is_parsed = true;
 }
@@ -213,6 +220,21 @@ RealVector& VectorialFunction::operator()( const RealVector& var_values)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void VectorialFunction::evaluate_batch(const RealMatrix& var_values, RealMatrix& ret_values) const
+{
+  cf3_assert(m_is_parsed);
+  cf3_assert(var_values.cols() == m_nbvars);
+
+  const Uint nb_points = var_values.rows();
+  ret_values.resize(nb_points, m_compiled.size());
+
+  // Both matrices are column major, so each variable and each result is contiguous over the points
+  for(Uint i = 0; i != m_compiled.size(); ++i)
+    m_compiled[i].evaluate(var_values.data(), nb_points, nb_points, ret_values.data() + i*nb_points);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // math
 } // cf3
 
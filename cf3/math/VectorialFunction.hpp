@@ -15,6 +15,7 @@
 
 #include "math/LibMath.hpp"
 #include "math/MatrixTypes.hpp"
+#include "math/CompiledFunction.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -65,6 +66,11 @@ public: // functions
   /// @param var_values values of the variables to substitute in the function.
   RealVector& operator()(const VariablesT& var_values);
 
+  /// Evaluate the Vectorial Function in many points at once, using the compiled form of the functions.
+  /// @param var_values values of the variables, with one row for each point and one column for each variable.
+  /// @param ret_values the results, with one row for each point and one column for each function. Resized if needed.
+  void evaluate_batch(const RealMatrix& var_values, RealMatrix& ret_values) const;
+
   /// Evaluate the Vectorial Function given the values of the variables
   /// and return it in the stored result. This function allows this class to work
   /// as a functor.
@@ -122,6 +128,9 @@ private: // data
   /// vector holding the parsers, one for each entry in the vector
   std::vector<FunctionParser*> m_parsers;
 
+  /// compiled form of each parser, for the batch evaluation
+  std::vector<CompiledFunction> m_compiled;
+
   /// storage of the result for using the class as functor
   RealVector m_result;
 
@@ -4,6 +4,9 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
 #include "common/OptionT.hpp"
@@ -17,6 +20,7 @@
 #include "math/Consts.hpp"
 
 #include "mesh/FaceCellConnectivity.hpp"
+#include "mesh/FaceHashTable.hpp"
 #include "mesh/NodeElementConnectivity.hpp"
 #include "mesh/Dictionary.hpp"
 #include "mesh/Mesh.hpp"
@@ -39,16 +43,85 @@ common::ComponentBuilder < FaceCellConnectivity , Component, LibMesh > FaceCellC
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+
+/// Range of elements of which the faces are hashed together
+struct ElementRange
+{
+  Elements* elements;
+  Handle< common::List<bool> > is_bdry_elem;
+  Uint begin;
+  Uint end;
+};
+
+/// Sorted nodes and hash of the faces of a range of elements, in the order in which the faces are numbered
+struct HashedFaces
+{
+  std::vector<std::size_t> keys;  ///< Hash of each face
+  std::vector<Uint> nodes_begin;  ///< Start of the sorted nodes of each face, with one extra entry for the end
+  std::vector<Uint> sorted_nodes; ///< Sorted nodes of all faces
+};
+
+/// Hash the faces of the elements in the range, skipping the elements that are not at the boundary of a region
+void hash_faces(const ElementRange& range, HashedFaces& hashed)
+{
+  const ElementType& etype = range.elements->element_type();
+  const Uint nb_faces_in_elem = etype.nb_faces();
+  const Connectivity& connectivity = range.elements->geometry_space().connectivity();
+
+  hashed.keys.clear();
+  hashed.nodes_begin.assign(1,0);
+  hashed.sorted_nodes.clear();
+
+  std::vector<Uint> face_nodes;  face_nodes.reserve(100);
+  for (Uint e=range.begin; e!=range.end; ++e)
+  {
+    if ( is_not_null(range.is_bdry_elem) && (*range.is_bdry_elem)[e] == false )
+      continue;
+
+    Connectivity::ConstRow elem_nodes = connectivity[e];
+    for (Uint face_idx = 0; face_idx != nb_faces_in_elem; ++face_idx)
+    {
+      face_nodes.clear();
+      boost_foreach(const Uint face_node_idx, etype.faces().nodes_range(face_idx))
+        face_nodes.push_back(elem_nodes[face_node_idx]);
+
+      hashed.keys.push_back(FaceHashTable::make_key(face_nodes));
+      hashed.sorted_nodes.insert(hashed.sorted_nodes.end(),face_nodes.begin(),face_nodes.end());
+      hashed.nodes_begin.push_back(hashed.sorted_nodes.size());
+    }
+  }
+}
+
+/// Hash the ranges thread_idx, thread_idx+nb_threads, ...
+void hash_faces_of_thread(const std::vector<ElementRange>& ranges, std::vector<HashedFaces>& hashed, const Uint thread_idx, const Uint nb_threads)
+{
+  for (Uint r=thread_idx; r<ranges.size(); r+=nb_threads)
+    hash_faces(ranges[r],hashed[r]);
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 FaceCellConnectivity::FaceCellConnectivity ( const std::string& name ) :
   Component(name),
   m_nb_faces(0),
-  m_face_building_algorithm(false)
+  m_face_building_algorithm(false),
+  m_nb_threads(1)
 {
 
   options().add("face_building_algorithm", m_face_building_algorithm)
       .link_to(&m_face_building_algorithm)
       .description("Improves efficiency for face building algorithm");
 
+  options().add("nb_threads", m_nb_threads)
+      .link_to(&m_nb_threads)
+      .pretty_name("Number of Threads")
+      .description("Number of threads used to hash the faces of the elements. The faces are numbered in the same order for any number of threads.");
+  options().option("nb_threads").add_tag("performance");
+
   m_used_components = create_static_component<Group>("used_components");
   m_connectivity = create_static_component<common::Table<Entity> >(mesh::Tags::connectivity_table());
   m_face_nb_in_elem = create_static_component<common::Table<Uint> >("face_number");
@@ -125,10 +198,8 @@ void FaceCellConnectivity::build_connectivity()
   common::Table<Uint>::Buffer cell_rotation = m_cell_rotation->create_buffer();
   common::Table<bool>::Buffer cell_orientation = m_cell_orientation->create_buffer();
 
-  Dictionary& geometry_fields = find_parent_component<Mesh>(*used()[0]).geometry_fields();
-  Uint tot_nb_nodes = geometry_fields.size();
-  std::vector < std::vector<Uint> > mapNodeFace(tot_nb_nodes);
   std::vector<Uint> face_nodes;  face_nodes.reserve(100);
+  std::vector<Uint> sorted_face_nodes;  sorted_face_nodes.reserve(100);
   std::vector<Entity> dummy_element_row(2);
   std::vector<Uint> tmp_row(2);
   Uint max_nb_faces(0);
@@ -165,140 +236,125 @@ void FaceCellConnectivity::build_connectivity()
     }
   }
 
+  // Split the elements in ranges, that are hashed independently. Sorting and hashing the face nodes
+  // can be done by several threads, while the faces are numbered afterwards in the order of the
+  // ranges, so the numbering doesn't depend on the number of threads.
+  const Uint nb_threads = std::max(m_nb_threads, 1u);
+  std::vector<ElementRange> ranges;
+  boost_foreach (Handle< Component > elements_comp, used() )
+  {
+    ElementRange range;
+    range.elements = &dynamic_cast<Elements&>(*elements_comp);
+    if (m_face_building_algorithm)
+      range.is_bdry_elem = Handle< common::List<bool> >(range.elements->get_child("is_bdry"));
+    const Uint nb_elems = range.elements->size();
+    const Uint range_size = std::max((nb_elems + nb_threads - 1) / nb_threads, 1u);
+    for (range.begin = 0; range.begin < nb_elems; range.begin += range_size)
+    {
+      range.end = std::min(range.begin + range_size, nb_elems);
+      ranges.push_back(range);
+    }
+  }
+
+  const bool threaded = nb_threads > 1 && ranges.size() > 1;
+  std::vector<HashedFaces> hashed_ranges(threaded ? ranges.size() : 1);
+  if (threaded)
+  {
+    boost::thread_group threads;
+    for (Uint t=1; t<nb_threads; ++t)
+      threads.create_thread(boost::bind(&hash_faces_of_thread, boost::cref(ranges), boost::ref(hashed_ranges), t, nb_threads));
+    hash_faces_of_thread(ranges, hashed_ranges, 0, nb_threads);
+    threads.join_all();
+  }
+
+  // Faces are looked up by their sorted nodes. Most faces are shared by two cells,
+  // so about half of the faces visited end up in the table.
+  FaceHashTable face_table(max_nb_faces/2);
+
   // Declarations to save frequent allocations in the loop algorithm
   Uint nb_inner_faces = 0;
-  Uint nb_matched_nodes = 1;
-  Uint face_node_idx;
-  Uint face_node;
   Uint face;
-  Uint connected_face;
-  Uint node;
   Uint nb_nodes;
-  bool found_face = false;
-  Handle< Component > elem_location_comp;
-  Uint elem_location_idx;
 
-  // loop over the element types
+  // loop over the element ranges, in the order of the element types
   m_nb_faces=0;
-  boost_foreach (Handle< Component > elements_comp, used() )
+  for (Uint r=0; r<ranges.size(); ++r)
   {
-    Elements& elements = dynamic_cast<Elements&>(*elements_comp);
+    const ElementRange& range = ranges[r];
+    Elements& elements = *range.elements;
     const Uint nb_faces_in_elem = elements.element_type().nb_faces();
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
 
-    Handle< common::List<bool> > is_bdry_elem;
-
-    if (m_face_building_algorithm)
-      is_bdry_elem = Handle< common::List<bool> >(elements.get_child("is_bdry"));
+    HashedFaces& hashed = threaded ? hashed_ranges[r] : hashed_ranges[0];
+    if (!threaded)
+      hash_faces(range, hashed);
 
-    // loop over the elements of this type
-    Uint loc_elem_idx=0;
-    boost_foreach(Connectivity::ConstRow elem_nodes, elements.geometry_space().connectivity().array() )
+    // loop over the elements of this range, visiting the faces in the order in which they were hashed
+    Uint hashed_face = 0;
+    for (Uint loc_elem_idx=range.begin; loc_elem_idx!=range.end; ++loc_elem_idx)
     {
-      if ( is_not_null(is_bdry_elem) )
-        if ( (*is_bdry_elem)[loc_elem_idx] == false )
+      if ( is_not_null(range.is_bdry_elem) )
+        if ( (*range.is_bdry_elem)[loc_elem_idx] == false )
           continue;
 
       Entity element(elements,loc_elem_idx);
+      Connectivity::ConstRow elem_nodes = connectivity[loc_elem_idx];
 
       // loop over the faces in the current element
-      for (Uint face_idx = 0; face_idx != nb_faces_in_elem; ++face_idx)
+      for (Uint face_idx = 0; face_idx != nb_faces_in_elem; ++face_idx, ++hashed_face)
       {
-        // construct sets of nodes that make the corresponding face in this element
-        nb_nodes = elements.element_type().face_type(face_idx).nb_nodes();
-        face_nodes.resize(nb_nodes);
+        sorted_face_nodes.assign(hashed.sorted_nodes.begin()+hashed.nodes_begin[hashed_face],
+                                 hashed.sorted_nodes.begin()+hashed.nodes_begin[hashed_face+1]);
+        const std::size_t key = hashed.keys[hashed_face];
+        nb_nodes = sorted_face_nodes.size();
 
-        Uint i(0);
-        boost_foreach(const Uint face_node_idx, elements.element_type().faces().nodes_range(face_idx))
-            face_nodes[i++] = elem_nodes[face_node_idx];
-
-
-        // consider the first node belonging to the current face
-        // check if you find a face ID shared between all the other
-        // nodes building a face
-        node = face_nodes[0];
-        cf3_assert(node<tot_nb_nodes);
-
-        found_face = false;
-        // search for matching face if they are registered to the node yet
-        boost_foreach( face, mapNodeFace[node] )
+        face = face_table.find(sorted_face_nodes,key);
+        if (face != math::Consts::uint_max())
         {
-          nb_matched_nodes = 1;
-          if (nb_nodes > 1)
+          // the corresponding face already exists, meaning
+          // that the face is an internal one, shared by two elements
+          // here you set the second element (==state) neighbor of the face
+          f2c.get_row(face)[1]=element;
+          face_number.get_row(face)[1]=face_idx;
+          // since it has two neighbor cells,
+          // this face is surely NOT a boundary face
+          is_bdry_face.get_row(face)=false;
+
+          if (nb_nodes > 1) // rotation is meaningless in the 1D case
           {
-            for (face_node_idx=1; face_node_idx!=nb_nodes; ++face_node_idx)
+            // construct the nodes that make the corresponding face in this element
+            face_nodes.resize(nb_nodes);
+            Uint i(0);
+            boost_foreach(const Uint face_node_idx, elements.element_type().faces().nodes_range(face_idx))
+                face_nodes[i++] = elem_nodes[face_node_idx];
+
+            // First node in first face element:
+            Uint first_node_loc_idx = f2c.get_row(face)[0].get_nodes()[
+                                        f2c.get_row(face)[0].element_type().faces().nodes_range(
+                                          face_number.get_row(face)[0])[0]
+                                      ];
+
+            // Find orientation ( or find match between first face-nodes of both neighbouring elements )
+            Uint rotation;
+            for (rotation=0; rotation<nb_nodes; ++rotation)
             {
-              boost_foreach (connected_face, mapNodeFace[face_nodes[face_node_idx]])
-              {
-                if (connected_face == face)
-                {
-                  ++nb_matched_nodes;
-                  break;
-                }
-              }
-
-
-              if (nb_matched_nodes == nb_nodes) // face matches the nodes
+              if (face_nodes[rotation] == first_node_loc_idx)
               {
-                // the corresponding face already exists, meaning
-                // that the face is an internal one, shared by two elements
-                // here you set the second element (==state) neighbor of the face
-                found_face = true;
-                f2c.get_row(face)[1]=element;
-                face_number.get_row(face)[1]=face_idx;
-                // since it has two neighbor cells,
-                // this face is surely NOT a boundary face
-                is_bdry_face.get_row(face)=false;
-
-                // First node in first face element:
-                Uint first_node_loc_idx = f2c.get_row(face)[0].get_nodes()[
-                                            f2c.get_row(face)[0].element_type().faces().nodes_range(
-                                              face_number.get_row(face)[0])[0]
-                                          ];
-
-                // Find orientation ( or find match between first face-nodes of both neighbouring elements )
-                Uint rotation;
-                for (rotation=0; rotation<=nb_nodes; ++rotation)
-                {
-                  if (face_nodes[rotation] == first_node_loc_idx)
-                  {
-                    cell_rotation.get_row(face)[1]=rotation;
-                    break;
-                  }
-                }
-                // Following assertion fails, it means the correct orientation was not found! This should never happen!
-                cf3_always_assert(rotation != nb_nodes);
-
-                // increment number of inner faces (they always have 2 states)
-                ++nb_inner_faces;
+                cell_rotation.get_row(face)[1]=rotation;
                 break;
               }
             }
+            // Following assertion fails, it means the correct orientation was not found! This should never happen!
+            cf3_always_assert(rotation != nb_nodes);
           }
-          else // this only applies to the 1D case
-          {
-            // the corresponding faceID already exists, meaning
-            // that the face is an internal one, shared by two elements
-            // here you set the second element (==state) neighbor of the face
-            found_face = true;
-            //(*elem_to_face)[elemID][iFace] = currFaceID;
-            f2c.get_row(face)[1]=element;
-            face_number.get_row(face)[1]=face_idx;
-            is_bdry_face.get_row(face)=false;
-
-            // increment number of inner faces (they always have 2 states)
-            ++nb_inner_faces;
-            break;
-          }
+
+          // increment number of inner faces (they always have 2 states)
+          ++nb_inner_faces;
         }
-        if (found_face == false)
+        else
         {
           // a new face has been found
-          // add the ID of the new face in the corresponding nodes
-          // referencing it
-          boost_foreach (face_node, face_nodes)
-          {
-            mapNodeFace[face_node].push_back(m_nb_faces);
-          }
+          face_table.insert(sorted_face_nodes,key,m_nb_faces);
 
           // increment the number of faces
           dummy_element_row[0]=element;
@@ -316,9 +372,13 @@ void FaceCellConnectivity::build_connectivity()
           ++m_nb_faces;
         }
       }
-      ++loc_elem_idx;
     } // end foreach element
-  } // end foreach elements component
+    cf3_assert(hashed_face == hashed.keys.size());
+
+    // The hashed faces of this range are no longer needed
+    if (threaded)
+      hashed = HashedFaces();
+  } // end foreach element range
 
   f2c.flush();
   face_number.flush();
@@ -116,6 +116,9 @@ private: // data
 
   bool m_face_building_algorithm;
 
+  /// Number of threads used to hash the faces in build_connectivity()
+  Uint m_nb_threads;
+
 }; // FaceCellConnectivity
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,106 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/functional/hash.hpp>
+
+#include "math/Consts.hpp"
+
+#include "mesh/FaceHashTable.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+using math::Consts::uint_max;
+
+////////////////////////////////////////////////////////////////////////////////
+
+FaceHashTable::FaceHashTable(const Uint expected_nb_faces)
+{
+  reserve(expected_nb_faces);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FaceHashTable::reserve(const Uint nb_faces)
+{
+  // Keep the load factor below 1/2, so probe sequences stay short
+  Uint nb_slots = 16;
+  while (nb_slots < 2*nb_faces)
+    nb_slots *= 2;
+  if (nb_slots > m_slots.size())
+    rehash(nb_slots);
+  m_entries.reserve(nb_faces);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FaceHashTable::make_key(std::vector<Uint>& nodes)
+{
+  std::sort(nodes.begin(),nodes.end());
+  return boost::hash_range(nodes.begin(),nodes.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint FaceHashTable::find(const std::vector<Uint>& sorted_nodes, const std::size_t hash) const
+{
+  const Uint mask = m_slots.size()-1;
+  for (Uint slot = hash & mask; m_slots[slot] != uint_max(); slot = (slot+1) & mask)
+  {
+    const Entry& entry = m_entries[m_slots[slot]];
+    if (entry.hash == hash &&
+        entry.nb_nodes == sorted_nodes.size() &&
+        std::equal(sorted_nodes.begin(),sorted_nodes.end(),m_nodes.begin()+entry.nodes_begin))
+      return entry.value;
+  }
+  return uint_max();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FaceHashTable::insert(const std::vector<Uint>& sorted_nodes, const std::size_t hash, const Uint value)
+{
+  if (2*(m_entries.size()+1) > m_slots.size())
+    rehash(2*m_slots.size());
+
+  Entry entry;
+  entry.hash = hash;
+  entry.nodes_begin = m_nodes.size();
+  entry.nb_nodes = sorted_nodes.size();
+  entry.value = value;
+  m_nodes.insert(m_nodes.end(),sorted_nodes.begin(),sorted_nodes.end());
+
+  const Uint mask = m_slots.size()-1;
+  Uint slot = hash & mask;
+  while (m_slots[slot] != uint_max())
+    slot = (slot+1) & mask;
+  m_slots[slot] = m_entries.size();
+  m_entries.push_back(entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FaceHashTable::rehash(const Uint nb_slots)
+{
+  m_slots.assign(nb_slots,uint_max());
+  const Uint mask = nb_slots-1;
+  for (Uint e=0; e<m_entries.size(); ++e)
+  {
+    Uint slot = m_entries[e].hash & mask;
+    while (m_slots[slot] != uint_max())
+      slot = (slot+1) & mask;
+    m_slots[slot] = e;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,90 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_FaceHashTable_hpp
+#define cf3_mesh_FaceHashTable_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include "mesh/LibMesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// @brief Hash table to look up faces by their nodes, independent of the node order
+///
+/// Faces are stored with their sorted node indices and a value chosen by the user,
+/// typically a face index. The table uses open addressing with linear probing in
+/// one contiguous array, so a lookup touches only a few cache lines, instead of
+/// scanning the faces attached to every node of the face.
+class Mesh_API FaceHashTable
+{
+public:
+
+  /// Constructor
+  /// @param expected_nb_faces  number of faces that will be inserted, to avoid rehashing
+  FaceHashTable(const Uint expected_nb_faces=0);
+
+  /// Make room for the given number of faces
+  void reserve(const Uint nb_faces);
+
+  /// Sort the given face nodes in place, and return the hash of the sorted nodes
+  static std::size_t make_key(std::vector<Uint>& nodes);
+
+  /// Find a face
+  /// @param sorted_nodes  face nodes, sorted with make_key()
+  /// @param hash          hash returned by make_key()
+  /// @return the value stored with the face, or math::Consts::uint_max() if not found
+  Uint find(const std::vector<Uint>& sorted_nodes, const std::size_t hash) const;
+
+  /// Add a face, that must not be in the table yet
+  /// @param sorted_nodes  face nodes, sorted with make_key()
+  /// @param hash          hash returned by make_key()
+  /// @param value         value to return when the face is found
+  void insert(const std::vector<Uint>& sorted_nodes, const std::size_t hash, const Uint value);
+
+  /// Number of faces in the table
+  Uint size() const { return m_entries.size(); }
+
+private: // functions
+
+  void rehash(const Uint nb_slots);
+
+private: // data
+
+  struct Entry
+  {
+    std::size_t hash;
+    Uint nodes_begin;
+    Uint nb_nodes;
+    Uint value;
+  };
+
+  /// Index in m_entries for every slot, or uint_max for an empty slot. The size is a power of 2.
+  std::vector<Uint> m_slots;
+
+  /// The inserted faces
+  std::vector<Entry> m_entries;
+
+  /// Sorted nodes of all faces
+  std::vector<Uint> m_nodes;
+
+}; // FaceHashTable
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_FaceHashTable_hpp
@@ -124,6 +124,13 @@ public: // functions
 
   void synchronize();
 
+  /// Start synchronizing the ghost values, without waiting for the communication to complete.
+  /// The ghost values may only be used after end_synchronize() was called.
+  void begin_synchronize();
+
+  /// Complete a synchronization started with begin_synchronize(). Does nothing if none was started.
+  void end_synchronize();
+
   math::VariablesDescriptor& descriptor() const { return *m_descriptor; }
 
   void set_descriptor(math::VariablesDescriptor& descriptor);
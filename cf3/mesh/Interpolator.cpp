@@ -20,6 +20,7 @@
 #include "mesh/Interpolator.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Field.hpp"
+#include "mesh/Octtree.hpp"
 
 #include "mesh/PointInterpolator.hpp"
 
@@ -58,111 +59,221 @@ Interpolator::Interpolator(const std::string &name) :
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Exchange data with the processors for which the send or receive buffer is not empty.
+/// The receive buffers must be sized beforehand, so no sizes are exchanged.
 template <typename T>
-void Interpolator_send_receive(const Uint send_to_pid, std::vector<T>& send, const Uint receive_from_pid, std::vector<T>& receive)
+void Interpolator_exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& receive)
 {
-  if (send_to_pid == PE::Comm::instance().rank() &&
-      receive_from_pid == PE::Comm::instance().rank())
+  const Uint my_rank = PE::Comm::instance().rank();
+  receive[my_rank] = send[my_rank];
+  if (!PE::Comm::instance().is_active())
+    return;
+
+  const int tag = 41;
+  std::vector<MPI_Request> requests; requests.reserve(2*send.size());
+  for (Uint pid=0; pid<receive.size(); ++pid)
   {
-    receive = send;
-      return;
+    if (pid != my_rank && !receive[pid].empty())
+    {
+      requests.push_back(MPI_Request());
+      MPI_Irecv(&receive[pid][0], (int)receive[pid].size(), PE::get_mpi_datatype<T>(), (int)pid, tag,
+                PE::Comm::instance().communicator(), &requests.back());
+    }
   }
-  size_t recv_size;
-  size_t send_size = send.size();
-  MPI_Sendrecv(&send_size, 1, PE::get_mpi_datatype<size_t>(), (int)send_to_pid, 0,
-               &recv_size, 1, PE::get_mpi_datatype<size_t>(), (int)receive_from_pid, 0,
-               PE::Comm::instance().communicator(), MPI_STATUS_IGNORE);
-  receive.resize(recv_size);
-  MPI_Sendrecv(&send[0], (int)send.size(), PE::get_mpi_datatype<T>(), (int)send_to_pid, 0,
-               &receive[0], (int)receive.size(), PE::get_mpi_datatype<T>(), (int)receive_from_pid, 0,
-               PE::Comm::instance().communicator(), MPI_STATUS_IGNORE);
+  for (Uint pid=0; pid<send.size(); ++pid)
+  {
+    if (pid != my_rank && !send[pid].empty())
+    {
+      requests.push_back(MPI_Request());
+      MPI_Isend(const_cast<T*>(&send[pid][0]), (int)send[pid].size(), PE::get_mpi_datatype<T>(), (int)pid, tag,
+                PE::Comm::instance().communicator(), &requests.back());
+    }
+  }
+  if (!requests.empty())
+    MPI_Waitall((int)requests.size(), &requests[0], MPI_STATUSES_IGNORE);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-
-void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coords)
+/// Tag for the next sparse exchange.
+/// A processor can only start sending the messages of the next exchange once all processors
+/// entered the reduction of the current one, so it is at most one exchange ahead of the slowest processor.
+/// Alternating between two tags therefore keeps those messages from being matched by a
+/// processor that is still probing for the messages of the current exchange.
+/// The count is shared by the exchanges of all value types, since these follow each other.
+int Interpolator_sparse_exchange_tag()
 {
-  m_dict  = dict.handle<Dictionary>();
-  m_table = target_coords.handle< Table<Real> >();
+  static Uint exchange_count = 0;
+  return 42 + static_cast<int>(exchange_count++ % 2);
+}
 
-  cf3_assert(m_point_interpolator);
-  m_point_interpolator->options().set("dict", const_cast<Dictionary*>(m_dict.get())->handle<Dictionary>());
+////////////////////////////////////////////////////////////////////////////////
 
-  Uint nb_coords = target_coords.size();
-  Uint dim = target_coords.row_size();
+/// Exchange data with the processors for which the send buffer is not empty,
+/// when the receiving side does not know who sends, or how much.
+/// Only the number of messages to expect is reduced over all processors; the messages
+/// themselves are only exchanged between communicating processors.
+template <typename T>
+void Interpolator_sparse_exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& receive)
+{
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint my_rank = PE::Comm::instance().rank();
+  receive.assign(nb_procs,std::vector<T>());
+  receive[my_rank] = send[my_rank];
+  if (!PE::Comm::instance().is_active())
+    return;
+
+  const int tag = Interpolator_sparse_exchange_tag();
+  std::vector<int> sends_to(nb_procs,0);
+  std::vector<MPI_Request> requests; requests.reserve(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    if (pid != my_rank && !send[pid].empty())
+    {
+      sends_to[pid] = 1;
+      requests.push_back(MPI_Request());
+      MPI_Isend(const_cast<T*>(&send[pid][0]), (int)send[pid].size(), PE::get_mpi_datatype<T>(), (int)pid, tag,
+                PE::Comm::instance().communicator(), &requests.back());
+    }
+  }
 
-  std::vector<Uint> not_found; not_found.reserve(nb_coords);
-  for (Uint i=0; i<nb_coords; ++i)
-    not_found.push_back(i);
+  int nb_messages = 0;
+  MPI_Reduce_scatter_block(&sends_to[0], &nb_messages, 1, MPI_INT, MPI_SUM, PE::Comm::instance().communicator());
 
-  m_proc.resize(nb_coords,-1);
+  for (int m=0; m<nb_messages; ++m)
+  {
+    MPI_Status status;
+    MPI_Probe(MPI_ANY_SOURCE, tag, PE::Comm::instance().communicator(), &status);
+    int count;
+    MPI_Get_count(&status, PE::get_mpi_datatype<T>(), &count);
+    std::vector<T>& recv_buffer = receive[status.MPI_SOURCE];
+    recv_buffer.resize(count);
+    MPI_Recv(&recv_buffer[0], count, PE::get_mpi_datatype<T>(), status.MPI_SOURCE, tag,
+             PE::Comm::instance().communicator(), MPI_STATUS_IGNORE);
+  }
 
-  m_proc.clear();
-  m_expect_recv.clear();
-  m_stored_element.clear();
-  m_stored_stencil.clear();
-  m_stored_source_field_points.clear();
-  m_stored_source_field_weights.clear();
+  if (!requests.empty())
+    MPI_Waitall((int)requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+}
 
-  m_expect_recv.resize(PE::Comm::instance().size());
-  m_stored_element.resize(PE::Comm::instance().size());
-  m_stored_stencil.resize(PE::Comm::instance().size());
-  m_stored_source_field_points.resize(PE::Comm::instance().size());
-  m_stored_source_field_weights.resize(PE::Comm::instance().size());
+template Mesh_API void Interpolator_sparse_exchange<Real>(const std::vector< std::vector<Real> >&, std::vector< std::vector<Real> >&);
+template Mesh_API void Interpolator_sparse_exchange<Uint>(const std::vector< std::vector<Uint> >&, std::vector< std::vector<Uint> >&);
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// Fill per processor the coordinates to send, and remember which coordinates were sent.
+/// The octtree of the source mesh knows the bounding box of every processor,
+/// so coordinates are only sent to the processors that can contain them.
+void Interpolator_route_coordinates(const Dictionary& dict, const Table<Real>& target_coords,
+                                    std::vector< std::vector<Real> >& send_coords,
+                                    std::vector< std::vector<Uint> >& sent_coords)
+{
+  const Uint nb_coords = target_coords.size();
+  const Uint nb_procs = PE::Comm::instance().size();
+  send_coords.assign(nb_procs,std::vector<Real>());
+  sent_coords.assign(nb_procs,std::vector<Uint>());
 
-  // Now find missing on other procs.
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
+  Handle<Octtree> octtree;
+  if (Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(dict))
   {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_coords = (PE::Comm::instance().rank() + pid) %
-                                  PE::Comm::instance().size();
-    const Uint pid_recv_coords = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                  PE::Comm::instance().size();
+    if (Handle<Component> found = mesh->get_child("octtree"))
+      octtree = Handle<Octtree>(found);
+    else
+    {
+      octtree = mesh->create_component<Octtree>("octtree");
+      octtree->options().set("mesh",mesh);
+    }
+  }
 
-    std::vector<Real> send_coords; send_coords.reserve(not_found.size()*target_coords.row_size());
-    std::vector<Real> received_coords;
+  if (is_not_null(octtree))
+  {
+    // Collective, so it must be called by every processor, even without coordinates to route
+    octtree->rank_bounding_boxes();
 
-    // fill in coords to send
-    boost_foreach (const Uint t, not_found)
+    std::vector<Uint> candidate_ranks;
+    RealVector t_coord(target_coords.row_size());
+    for (Uint t=0; t<nb_coords; ++t)
     {
-      boost_foreach (const Real& xyz, target_coords[t])
+      for (Uint d=0; d<t_coord.size(); ++d)
+        t_coord[d] = target_coords[t][d];
+      octtree->find_candidate_ranks(t_coord,candidate_ranks);
+      boost_foreach(const Uint pid, candidate_ranks)
       {
-        send_coords.push_back(xyz);
+        send_coords[pid].insert(send_coords[pid].end(),target_coords[t].begin(),target_coords[t].end());
+        sent_coords[pid].push_back(t);
       }
     }
+  }
+  else
+  {
+    for (Uint pid=0; pid<nb_procs; ++pid)
+    {
+      sent_coords[pid].reserve(nb_coords);
+      for (Uint t=0; t<nb_coords; ++t)
+      {
+        send_coords[pid].insert(send_coords[pid].end(),target_coords[t].begin(),target_coords[t].end());
+        sent_coords[pid].push_back(t);
+      }
+    }
+  }
+}
 
-    // send coords, and receive coords
-    Interpolator_send_receive(pid_send_coords,   send_coords,
-                              pid_recv_coords,   received_coords);
+////////////////////////////////////////////////////////////////////////////////
 
-    Uint nb_received_coords = received_coords.size()/dim;
+void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coords)
+{
+  m_dict  = dict.handle<Dictionary>();
+  m_table = target_coords.handle< Table<Real> >();
 
-    // Find interpolated
+  cf3_assert(m_point_interpolator);
+  m_point_interpolator->options().set("dict", const_cast<Dictionary*>(m_dict.get())->handle<Dictionary>());
 
-    m_stored_element[pid_recv_coords].clear();
-    m_stored_stencil[pid_recv_coords].clear();
-    m_stored_source_field_points[pid_recv_coords].clear();
-    m_stored_source_field_weights[pid_recv_coords].clear();
+  const Uint nb_coords = target_coords.size();
+  const Uint dim = target_coords.row_size();
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint my_rank = PE::Comm::instance().rank();
 
-    m_stored_element[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_stencil[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_source_field_points[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_source_field_weights[pid_recv_coords].reserve(nb_received_coords);
+  m_proc.assign(nb_coords,-1);
 
-    std::vector<Uint> send_found_coords;  send_found_coords.reserve(nb_received_coords);
+  m_expect_recv.clear();
+  m_stored_element.clear();
+  m_stored_stencil.clear();
+  m_stored_source_field_points.clear();
+  m_stored_source_field_weights.clear();
+
+  m_expect_recv.resize(nb_procs);
+  m_stored_element.resize(nb_procs);
+  m_stored_stencil.resize(nb_procs);
+  m_stored_source_field_points.resize(nb_procs);
+  m_stored_source_field_weights.resize(nb_procs);
+
+  std::vector< std::vector<Real> > send_coords;
+  std::vector< std::vector<Uint> > sent_coords;
+  Interpolator_route_coordinates(dict,target_coords,send_coords,sent_coords);
+
+  // send coords, and receive coords
+  std::vector< std::vector<Real> > received_coords;
+  Interpolator_sparse_exchange(send_coords,received_coords);
+
+  // Find interpolated, and send back which of the received coordinates were found
+  std::vector< std::vector<Uint> > send_found_coords(nb_procs);
+  RealVector t_point(dim);
+  SpaceElem element;
+  std::vector<SpaceElem> stencil;
+  std::vector<Uint> points;
+  std::vector<Real> weights;
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const Uint nb_received_coords = received_coords[pid].size()/dim;
 
-    Uint dim = target_coords.row_size();
-    RealVector t_point(dim);
-    SpaceElem element;
-    std::vector<SpaceElem> stencil;
-    std::vector<Uint> points;
-    std::vector<Real> weights;
+    m_stored_element[pid].reserve(nb_received_coords);
+    m_stored_stencil[pid].reserve(nb_received_coords);
+    m_stored_source_field_points[pid].reserve(nb_received_coords);
+    m_stored_source_field_weights[pid].reserve(nb_received_coords);
 
     for (Uint t=0; t<nb_received_coords; ++t)
     {
-      t_point = RealVector::MapType(&received_coords[t*dim],dim);
+      t_point = RealVector::MapType(&received_coords[pid][t*dim],dim);
       bool interpolation_possible_on_this_proc =
           m_point_interpolator->compute_storage(t_point,
                                                 element,
@@ -172,71 +283,95 @@ void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coord
 
       if (interpolation_possible_on_this_proc)
       {
-        m_stored_element[pid_recv_coords].push_back(element);
-        m_stored_stencil[pid_recv_coords].push_back(stencil);
-        m_stored_source_field_points[pid_recv_coords].push_back(points);
-        m_stored_source_field_weights[pid_recv_coords].push_back(weights);
+        m_stored_element[pid].push_back(element);
+        m_stored_stencil[pid].push_back(stencil);
+        m_stored_source_field_points[pid].push_back(points);
+        m_stored_source_field_weights[pid].push_back(weights);
 
         // mark found
-        send_found_coords.push_back(t);
+        send_found_coords[pid].push_back(t);
       }
-
     }
+  }
 
-    std::vector<Uint> recv_found_coords;
-
-    const Uint pid_send_back = pid_recv_coords;
-    const Uint pid_recv_back = pid_send_coords;
-
-    Interpolator_send_receive (pid_send_back, send_found_coords,
-                               pid_recv_back, recv_found_coords);
-
-    m_expect_recv[pid_recv_back].reserve(recv_found_coords.size());
+  std::vector< std::vector<Uint> > recv_found_coords;
+  Interpolator_sparse_exchange(send_found_coords,recv_found_coords);
 
-    boost_foreach(const Uint i, recv_found_coords)
+  // A coordinate found on several processors is interpolated by the first one
+  // in the order this processor, next processor, ... as before.
+  for (Uint offset=0; offset<nb_procs; ++offset)
+  {
+    const Uint pid = (my_rank + offset) % nb_procs;
+    boost_foreach(const Uint i, recv_found_coords[pid])
     {
-      cf3_assert(i<not_found.size());
-      const Uint t = not_found[i];
+      cf3_assert(i<sent_coords[pid].size());
+      const Uint t = sent_coords[pid][i];
       cf3_assert(t<nb_coords);
-      m_proc[t] = pid_recv_back;
-      m_expect_recv[pid_recv_back].push_back(t);
+      if (m_proc[t] < 0)
+        m_proc[t] = pid;
     }
+  }
 
-    not_found.clear();
-    for (Uint t=0; t<nb_coords; ++t)
+  // Tell every processor which of its found coordinates are kept
+  std::vector< std::vector<Uint> > send_kept_coords(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    for (Uint j=0; j<recv_found_coords[pid].size(); ++j)
     {
-      if (m_proc[t]<0)
-        not_found.push_back(t);
+      const Uint t = sent_coords[pid][recv_found_coords[pid][j]];
+      if (m_proc[t] == static_cast<int>(pid))
+      {
+        m_expect_recv[pid].push_back(t);
+        send_kept_coords[pid].push_back(j);
+      }
     }
   }
+
+  std::vector< std::vector<Uint> > recv_kept_coords;
+  Interpolator_sparse_exchange(send_kept_coords,recv_kept_coords);
+
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const std::vector<Uint>& kept = recv_kept_coords[pid];
+    for (Uint j=0; j<kept.size(); ++j)
+    {
+      cf3_assert(kept[j]>=j);
+      m_stored_element[pid][j] = m_stored_element[pid][kept[j]];
+      m_stored_stencil[pid][j].swap(m_stored_stencil[pid][kept[j]]);
+      m_stored_source_field_points[pid][j].swap(m_stored_source_field_points[pid][kept[j]]);
+      m_stored_source_field_weights[pid][j].swap(m_stored_source_field_weights[pid][kept[j]]);
+    }
+    m_stored_element[pid].resize(kept.size());
+    m_stored_stencil[pid].resize(kept.size());
+    m_stored_source_field_points[pid].resize(kept.size());
+    m_stored_source_field_weights[pid].resize(kept.size());
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void Interpolator::stored_interpolation(const Field& source_field, Table<Real>& target)
 {
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  // number of variables for each point to be interpolated
+  const Uint nb_vars = m_source_vars.size();
+
   // Do interpolation on processors that can do the interpolation,
   // and send back an array of interpolated values
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
+  std::vector< std::vector<Real> > send_interpolated(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
   {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_interpolated = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                        PE::Comm::instance().size();
-    const Uint pid_recv_interpolated = (PE::Comm::instance().rank() + pid) %
-                                        PE::Comm::instance().size();
-
     // number of points to be interpolated
-    const Uint nb_points = m_stored_element[pid_send_interpolated].size();
+    const Uint nb_points = m_stored_element[pid].size();
 
-    // number of variables for each point to be interpolated
-    const Uint nb_vars = m_source_vars.size();
-
-    // storage for interpolated variables, which will be sent to the pid that reqests it (pid_recv_interpolated)
-    std::vector<Real> interpolated; interpolated.reserve(nb_points*nb_vars);
+    // storage for interpolated variables, which will be sent to the pid that requests it
+    std::vector<Real>& interpolated = send_interpolated[pid];
+    interpolated.reserve(nb_points*nb_vars);
 
     // Interpolation points and weights
-    const std::vector< std::vector<Uint> >& s_points  = m_stored_source_field_points[pid_send_interpolated];
-    const std::vector< std::vector<Real> >& s_weights = m_stored_source_field_weights[pid_send_interpolated];
+    const std::vector< std::vector<Uint> >& s_points  = m_stored_source_field_points[pid];
+    const std::vector< std::vector<Real> >& s_weights = m_stored_source_field_weights[pid];
 
     // Do interpolation
     for (Uint t=0; t<nb_points; ++t)
@@ -251,20 +386,25 @@ void Interpolator::stored_interpolation(const Field& source_field, Table<Real>&
         }
       }
     }
+  }
 
-    // Send/Receive interpolated variables
-    std::vector<Real> recv_interpolated;
-    Interpolator_send_receive(pid_send_interpolated   , interpolated,
-                              pid_recv_interpolated   , recv_interpolated);
+  // The stored plan tells how much is received from which processor,
+  // so only the communicating processors exchange, without exchanging sizes first
+  std::vector< std::vector<Real> > recv_interpolated(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+    recv_interpolated[pid].resize(m_expect_recv[pid].size()*nb_vars);
+  Interpolator_exchange(send_interpolated,recv_interpolated);
 
-    // Fill the target_field with received interpolated variables from requested processor
+  // Fill the target_field with received interpolated variables from requested processor
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
     Uint it=0;
-    boost_foreach( const Uint t, m_expect_recv[pid_recv_interpolated] )
+    boost_foreach( const Uint t, m_expect_recv[pid] )
     {
       for (Uint v=0; v<nb_vars; ++v)
       {
         cf3_assert(t<target.size());
-        target[t][ m_target_vars[v] ] = recv_interpolated[it++];
+        target[t][ m_target_vars[v] ] = recv_interpolated[pid][it++];
       }
     }
   }
@@ -283,95 +423,77 @@ void Interpolator::unstored_interpolation(const Field& source_field, const commo
 
   const Uint nb_coords = target_coords.size();
   const Uint dim = target_coords.row_size();
-
-  std::vector<int> not_found; not_found.reserve(nb_coords);
-  for (Uint i=0; i<nb_coords; ++i)
-    not_found.push_back(i);
-
-  // Now find missing on other procs.
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint my_rank = PE::Comm::instance().rank();
+
+  // number of variables for each point to be interpolated
+  const Uint nb_vars = m_source_vars.size();
+
+  // send coords, and receive coords
+  std::vector< std::vector<Real> > send_coords;
+  std::vector< std::vector<Uint> > sent_coords;
+  Interpolator_route_coordinates(source_field.dict(),target_coords,send_coords,sent_coords);
+
+  std::vector< std::vector<Real> > received_coords;
+  Interpolator_sparse_exchange(send_coords,received_coords);
+
+  // Interpolate the received coordinates where possible, and send back
+  // which coordinates were found, with their interpolated variables
+  std::vector< std::vector<Uint> > send_found_coords(nb_procs);
+  std::vector< std::vector<Real> > send_interpolated(nb_procs);
+  RealVector t_point(dim);
+  RealVector t_val(source_field.row_size());
+  for (Uint pid=0; pid<nb_procs; ++pid)
   {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_coords = (PE::Comm::instance().rank() + pid) %
-                                  PE::Comm::instance().size();
-    const Uint pid_recv_coords = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                  PE::Comm::instance().size();
-
-    std::vector<Real> send_coords; send_coords.reserve(not_found.size()*target_coords.row_size());
-    std::vector<Uint>  unknown_ids; unknown_ids.reserve(not_found.size());
-    std::vector<Real> received_coords;
-
-    // fill in coords to send
-    boost_foreach (const int t, not_found)
-    {
-      if (t>=0)
-      {
-        unknown_ids.push_back(t);
-        boost_foreach (const Real& xyz, target_coords[t])
-        {
-          send_coords.push_back(xyz);
-        }
-      }
-    }
-
-    // send coords, and receive coords
-    Interpolator_send_receive(pid_send_coords,   send_coords,
-                              pid_recv_coords,   received_coords);
-
-    Uint nb_received_coords = received_coords.size()/dim;
-
-    // Find interpolated
-
-    std::vector<Uint> send_found_coords;  send_found_coords.reserve(nb_received_coords);
-
-    // number of variables for each point to be interpolated
-    const Uint nb_vars = m_source_vars.size();
-
-    // storage for interpolated variables, which will be sent to the pid that reqests it (pid_recv_interpolated)
-    std::vector<Real> send_interpolated; send_interpolated.reserve(nb_received_coords*nb_vars);
-
-    Uint dim = target_coords.row_size();
-    RealVector t_point(dim);
-    RealVector t_val(source_field.row_size());
-
+    const Uint nb_received_coords = received_coords[pid].size()/dim;
     for (Uint t=0; t<nb_received_coords; ++t)
     {
-      t_point = RealVector::MapType(&received_coords[t*dim],dim);
+      t_point = RealVector::MapType(&received_coords[pid][t*dim],dim);
       bool interpolation_possible_on_this_proc =
           m_point_interpolator->interpolate(source_field,t_point,t_val);
       if (interpolation_possible_on_this_proc)
       {
         // mark found
-        send_found_coords.push_back(t);
+        send_found_coords[pid].push_back(t);
 
         for (Uint v=0; v<nb_vars; ++v)
-          send_interpolated.push_back(t_val[ m_source_vars[v] ] );
+          send_interpolated[pid].push_back(t_val[ m_source_vars[v] ] );
       }
     }
+  }
 
-    std::vector<Uint> recv_found_coords;
-    std::vector<Real> recv_interpolated;
-
-    const Uint pid_send_back = pid_recv_coords;
-    const Uint pid_recv_back = pid_send_coords;
+  std::vector< std::vector<Uint> > recv_found_coords;
+  std::vector< std::vector<Real> > recv_interpolated;
+  Interpolator_sparse_exchange(send_found_coords,recv_found_coords);
 
-    Interpolator_send_receive (pid_send_back, send_found_coords,
-                               pid_recv_back, recv_found_coords);
-    Interpolator_send_receive (pid_send_back, send_interpolated,
-                               pid_recv_back, recv_interpolated);
+  // The amount of interpolated values follows from the found coordinates
+  recv_interpolated.resize(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+    recv_interpolated[pid].resize(recv_found_coords[pid].size()*nb_vars);
+  Interpolator_exchange(send_interpolated,recv_interpolated);
 
+  // A coordinate found on several processors takes the values of the first one
+  // in the order this processor, next processor, ... as before.
+  std::vector<bool> found(nb_coords,false);
+  for (Uint offset=0; offset<nb_procs; ++offset)
+  {
+    const Uint pid = (my_rank + offset) % nb_procs;
     Uint it=0;
-    boost_foreach(const Uint i, recv_found_coords)
+    boost_foreach(const Uint i, recv_found_coords[pid])
     {
-      cf3_assert(i<unknown_ids.size());
-      const int t = unknown_ids[i];
-      not_found[t] = -1;
-      cf3_assert_desc(common::to_str(t)+'<'+common::to_str(nb_coords),t<(int)nb_coords);
-      for (Uint v=0; v<nb_vars; ++v)
+      cf3_assert(i<sent_coords[pid].size());
+      const Uint t = sent_coords[pid][i];
+      cf3_assert_desc(common::to_str(t)+'<'+common::to_str(nb_coords),t<nb_coords);
+      if (!found[t])
       {
-        cf3_assert(t<target.size());
-        target[t][ m_target_vars[v] ] = recv_interpolated[it++];
+        found[t] = true;
+        for (Uint v=0; v<nb_vars; ++v)
+        {
+          cf3_assert(t<target.size());
+          target[t][ m_target_vars[v] ] = recv_interpolated[pid][it+v];
+        }
       }
+      it += nb_vars;
     }
   }
 }
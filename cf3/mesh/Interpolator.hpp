@@ -117,6 +117,16 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Exchange data with the processors for which the send buffer is not empty,
+/// when the receiving side does not know who sends, or how much.
+/// This is a collective operation, available for Real and Uint data.
+/// @param [in] send Data to send to each processor
+/// @param [out] receive Data received from each processor, empty for processors that sent nothing
+template <typename T>
+void Interpolator_sparse_exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& receive);
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // mesh
 } // cf3
 
@@ -14,6 +14,7 @@
 #include "common/OptionArray.hpp"
 #include "common/OptionURI.hpp"
 #include "common/FindComponents.hpp"
+#include "common/RegionProfiler.hpp"
 
 
 #include "common/PE/Comm.hpp"
@@ -83,6 +84,7 @@ void MeshReader::execute()
     throw SetupError(FromHere(), "Mesh is not configured");
 
   // Call the concrete implementation
+  ScopedRegion region(*this, "/read");
   do_read_mesh_into(m_file_path, *m_mesh);
 }
 
@@ -109,6 +111,7 @@ void MeshReader::signal_read( SignalArgs& node  )
     {
       // Call the concrete implementation
       mesh->block_mesh_changed(true);
+      ScopedRegion region(*this, "/read");
       do_read_mesh_into(file, *mesh);
       mesh->block_mesh_changed(false);
     }
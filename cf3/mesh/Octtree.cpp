@@ -5,6 +5,7 @@
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
 #include <set>
+#include <vector>
 
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
@@ -79,6 +80,7 @@ void Octtree::create_octtree()
     throw SetupError(FromHere(), "Option \"mesh\" has not been configured");
 
   m_bounding_box.define(*m_mesh->local_bounding_box());
+  m_rank_bounding_boxes.clear();
 
   m_dim = m_mesh->dimension();
 
@@ -186,86 +188,187 @@ void Octtree::create_octtree()
 
 void Octtree::find_cell_ranks( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks )
 {
-  ranks.resize(coordinates.size());
+  std::vector<Uint> entities_idx;
+  std::vector<Uint> element_idx;
+  boost::multi_array<Real,2> mapped_coordinates;
+  find_cells(coordinates, ranks, entities_idx, element_idx, mapped_coordinates);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Octtree::find_cells( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks,
+                          std::vector<Uint>& entities_idx, std::vector<Uint>& element_idx,
+                          boost::multi_array<Real,2>& mapped_coordinates )
+{
+  if ( !is_created() )
+    create_octtree();
+
+  const Uint nb_coords = coordinates.size();
+  const Uint my_rank = Comm::instance().rank();
 
-  Entity dummy;
-  std::deque<Uint> missing_cells;
+  ranks.assign(nb_coords, uint_max());
+  entities_idx.assign(nb_coords, uint_max());
+  element_idx.assign(nb_coords, uint_max());
+  mapped_coordinates.resize(boost::extents[nb_coords][m_dim]);
 
+  Entity element;
   RealVector coord(m_dim);
+  RealVector mapped_coord(m_dim);
 
-  for(Uint i=0; i<coordinates.size(); ++i)
+  // First look on this rank
+  std::vector<Uint> missing_cells;
+  for(Uint i=0; i<nb_coords; ++i)
   {
     for (Uint d=0; d<m_dim; ++d)
       coord[d] = coordinates[i][d];
-    if( find_element(coord,dummy) ) // if element is found on this rank
+    if( find_element(coord,element) )
     {
-      ranks[i] = Comm::instance().rank();
+      ranks[i] = my_rank;
+      entities_idx[i] = element.comp->entities_idx();
+      element_idx[i] = element.idx;
+      element.element_type().compute_mapped_coordinate(coord,element.get_coordinates(),mapped_coord);
+      for (Uint d=0; d<m_dim; ++d)
+        mapped_coordinates[i][d] = mapped_coord[d];
     }
     else
     {
-      ranks[i] = math::Consts::uint_max();
       missing_cells.push_back(i);
     }
   }
 
-  std::vector<Real> send_coords(m_dim*missing_cells.size());
-  std::vector<Real> recv_coords;
+  if (!Comm::instance().is_active() || Comm::instance().size() == 1)
+    return;
+
+  // Collective, so it must be called by every rank, also when all coordinates were found locally
+  rank_bounding_boxes();
 
-  Uint c(0);
+  // Send the missing coordinates only to the ranks that may contain them
+  const Uint nb_procs = Comm::instance().size();
+  std::vector< std::vector<Real> > send_coords(nb_procs);
+  std::vector< std::vector<Uint> > sent_cells(nb_procs);
+  std::vector<Uint> candidate_ranks;
   boost_foreach(const Uint i, missing_cells)
   {
-    for(Uint d=0; d<m_dim; ++d)
-      send_coords[c++]=coordinates[i][d];
+    for (Uint d=0; d<m_dim; ++d)
+      coord[d] = coordinates[i][d];
+    find_candidate_ranks(coord,candidate_ranks);
+    boost_foreach(const Uint rank, candidate_ranks)
+    {
+      if (rank == my_rank)
+        continue;
+      for (Uint d=0; d<m_dim; ++d)
+        send_coords[rank].push_back(coordinates[i][d]);
+      sent_cells[rank].push_back(i);
+    }
   }
 
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+  std::vector< std::vector<Real> > recv_coords;
+  Comm::instance().all_to_all(send_coords,recv_coords);
+
+  // Look for the received coordinates, answering with the element and the mapped coordinates
+  std::vector< std::vector<Uint> > send_found(nb_procs);
+  std::vector< std::vector<Real> > send_mapped(nb_procs);
+  for (Uint rank=0; rank<nb_procs; ++rank)
   {
+    const Uint nb_recv = recv_coords[rank].size()/m_dim;
+    send_found[rank].reserve(2*nb_recv);
+    send_mapped[rank].reserve(m_dim*nb_recv);
+    for (Uint i=0; i<nb_recv; ++i)
+    {
+      for (Uint d=0; d<m_dim; ++d)
+        coord[d] = recv_coords[rank][i*m_dim+d];
+      if( find_element(coord,element) )
+      {
+        send_found[rank].push_back(element.comp->entities_idx());
+        send_found[rank].push_back(element.idx);
+        element.element_type().compute_mapped_coordinate(coord,element.get_coordinates(),mapped_coord);
+      }
+      else
+      {
+        send_found[rank].push_back(uint_max());
+        send_found[rank].push_back(uint_max());
+        mapped_coord.setZero();
+      }
+      for (Uint d=0; d<m_dim; ++d)
+        send_mapped[rank].push_back(mapped_coord[d]);
+    }
+  }
 
-    recv_coords.resize(0);
-    PE::Comm::instance().broadcast(send_coords,recv_coords,root,m_dim);
+  std::vector< std::vector<Uint> > recv_found;
+  std::vector< std::vector<Real> > recv_mapped;
+  Comm::instance().all_to_all(send_found,recv_found);
+  Comm::instance().all_to_all(send_mapped,recv_mapped);
 
-    // size is only because it doesn't get resized for this rank
-    std::vector<Uint> send_found(missing_cells.size(),math::Consts::uint_max());
+  // Only coordinates that were not found locally were sent, so a local hit always takes precedence.
+  // Ranks are processed in increasing order, so otherwise the lowest rank that found a coordinate is kept.
+  for (Uint rank=0; rank<nb_procs; ++rank)
+  {
+    for (Uint j=0; j<sent_cells[rank].size(); ++j)
+    {
+      const Uint i = sent_cells[rank][j];
+      if (recv_found[rank][2*j] == uint_max() || ranks[i] != uint_max())
+        continue;
+      ranks[i] = rank;
+      entities_idx[i] = recv_found[rank][2*j];
+      element_idx[i] = recv_found[rank][2*j+1];
+      for (Uint d=0; d<m_dim; ++d)
+        mapped_coordinates[i][d] = recv_mapped[rank][j*m_dim+d];
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const std::vector<math::BoundingBox>& Octtree::rank_bounding_boxes()
+{
+  if ( !is_created() )
+    create_octtree();
 
-    if (root!=Comm::instance().rank())
+  if (m_rank_bounding_boxes.empty())
+  {
+    std::vector<Real> local_box(2*m_dim);
+    for (Uint d=0; d<m_dim; ++d)
     {
-      std::vector<RealVector> recv_coordinates(recv_coords.size()/m_dim) ;
-      boost_foreach(RealVector& realvec, recv_coordinates)
-          realvec.resize(m_dim);
+      local_box[d] = m_bounding_box.min()[d];
+      local_box[m_dim+d] = m_bounding_box.max()[d];
+    }
 
-      c=0;
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
-      {
-        for(Uint d=0; d<m_dim; ++d)
-          recv_coordinates[i][d]=recv_coords[c++];
-      }
+    std::vector<Real> boxes;
+    if (Comm::instance().is_active())
+      Comm::instance().all_gather(local_box,boxes);
+    else
+      boxes = local_box;
 
-      send_found.resize(recv_coordinates.size());
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
-      {
-        if( find_element(recv_coordinates[i],dummy) ) // if element found on this rank
-        {
-          send_found[i] = Comm::instance().rank();
-        }
-        else
-          send_found[i] = math::Consts::uint_max();
-      }
+    const Uint nb_boxes = boxes.size()/(2*m_dim);
+    m_rank_bounding_boxes.resize(nb_boxes);
+    for (Uint rank=0; rank<nb_boxes; ++rank)
+    {
+      const std::vector<Real>::const_iterator box = boxes.begin()+2*m_dim*rank;
+      m_rank_bounding_boxes[rank].define(std::vector<Real>(box,box+m_dim),std::vector<Real>(box+m_dim,box+2*m_dim));
     }
+  }
+  return m_rank_bounding_boxes;
+}
 
-    std::vector<Uint> recv_found(missing_cells.size()*Comm::instance().size());
-    PE::Comm::instance().gather(send_found,recv_found,root);
+//////////////////////////////////////////////////////////////////////////////
 
-    if( root==Comm::instance().rank())
+void Octtree::find_candidate_ranks( const RealVector& coordinate, std::vector<Uint>& ranks )
+{
+  // Same tolerance as find_octtree_cell, so a rank that can find the coordinate is always a candidate
+  static const Real tolerance = 100*math::Consts::eps();
+
+  const std::vector<math::BoundingBox>& boxes = rank_bounding_boxes();
+  ranks.clear();
+  for (Uint rank=0; rank<boxes.size(); ++rank)
+  {
+    bool inside = true;
+    for (Uint d=0; d<m_dim && inside; ++d)
     {
-      const Uint stride = missing_cells.size();
-      for (Uint i=0; i<missing_cells.size(); ++i)
-      {
-        for(Uint p=0; p<Comm::instance().size(); ++p)
-        {
-          ranks[missing_cells[i]] = std::min(recv_found[i+p*stride] , ranks[missing_cells[i]]);
-        }
-      }
+      inside = coordinate[d] <= boxes[rank].max()[d] + tolerance &&
+               coordinate[d] >= boxes[rank].min()[d] - tolerance;
     }
+    if (inside)
+      ranks.push_back(rank);
   }
 }
 
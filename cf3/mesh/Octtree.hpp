@@ -69,8 +69,35 @@ public: // functions
   /// @note subsequent calls with increasing value for ring starting from 0, will assemble everything within the last passed ring value.
   void gather_elements_around_idx(const std::vector<Uint>& octtree_idx, const Uint ring, std::vector<Entity>& element_pool);
 
+  /// @brief Find which rank has an element containing each of the given coordinates
+  /// @see find_cells
   void find_cell_ranks( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks );
 
+  /// @brief Locate coordinates in the distributed mesh
+  ///
+  /// Coordinates that are not found on this rank are sent only to the ranks whose bounding box
+  /// contains them, in a single exchange. A coordinate found on this rank is always kept on this rank.
+  /// Otherwise, if several ranks find a coordinate, the lowest rank is used.
+  /// Outputs for coordinates that are not found anywhere are set to uint_max.
+  /// This is a collective operation.
+  /// @param [in]  coordinates        Coordinates to look for, one per row
+  /// @param [out] ranks              Rank that has the element containing each coordinate
+  /// @param [out] entities_idx       Index of the element's Entities in Mesh::elements() on that rank
+  /// @param [out] element_idx        Index of the element in its Entities on that rank
+  /// @param [out] mapped_coordinates Mapped coordinates of each coordinate in its element
+  void find_cells( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks,
+                   std::vector<Uint>& entities_idx, std::vector<Uint>& element_idx,
+                   boost::multi_array<Real,2>& mapped_coordinates );
+
+  /// @brief Find the ranks of which the bounding box contains the given coordinate
+  /// @param [in]  coordinate The coordinate to look for
+  /// @param [out] ranks      The candidate ranks, in increasing order. This rank is included if it is a candidate.
+  void find_candidate_ranks( const RealVector& coordinate, std::vector<Uint>& ranks );
+
+  /// Bounding box of the mesh on each rank, exchanged the first time it is needed.
+  /// The first call is a collective operation.
+  const std::vector<math::BoundingBox>& rank_bounding_boxes();
+
   bool is_created() const { return m_octtree.num_elements()!=0; }
 
   const Uint dimension() { return m_dim; }
@@ -91,6 +118,8 @@ private: // data
 
   math::BoundingBox m_bounding_box;
 
+  std::vector<math::BoundingBox> m_rank_bounding_boxes;
+
 }; // end Octtree
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,8 +135,11 @@ Uint ParallelDistribution::start_idx_in_proc(const Uint proc) const
 
 Uint ParallelDistribution::end_idx_in_proc(const Uint proc) const
 {
-  Uint part_end = (proc == PE::Comm::instance().size()-1) ? m_nb_parts : m_nb_parts/PE::Comm::instance().size()*(proc+1);
-  return end_idx_in_part(part_end);
+  if (proc == PE::Comm::instance().size()-1)
+    return m_nb_obj;
+  // first part of the next proc
+  Uint part_end = m_nb_parts/PE::Comm::instance().size()*(proc+1);
+  return start_idx_in_part(part_end);
 }
 
 //////////////////////////////////////////////////////////////////////////////
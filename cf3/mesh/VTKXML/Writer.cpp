@@ -4,17 +4,20 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 
 #include <boost/algorithm/string.hpp>
 #include "common/BoostAssign.hpp"
+#include <boost/bind.hpp>
 #include <boost/cstdint.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "rapidxml/rapidxml.hpp"
 
+#include "common/BasicExceptions.hpp"
+#include "common/BlockCompressor.hpp"
 #include "common/BoostFilesystem.hpp"
 #include "common/Foreach.hpp"
 #include "common/Log.hpp"
@@ -66,9 +69,9 @@ namespace detail
 
   struct CompressedStream
   {
-    CompressedStream() :
+    CompressedStream(const BlockCompressor& compressor) :
       data_stream(std::ios_base::in | std::ios_base::out | std::ios_base::binary),
-      m_current_block(std::ios_base::in | std::ios_base::out | std::ios_base::binary)
+      m_compressor(compressor)
     {
       // VTK data starts with a _
       data_stream.write("_", 1);
@@ -91,86 +94,58 @@ namespace detail
         m_header.nb_blocks = nb_bytes / m_header.blocksize;
       }
 
-      m_header.compressed_blocksizes.clear();
-      m_header.compressed_blocksizes.reserve(m_header.nb_blocks);
-
-      // Write known header info
-      data_stream.write(reinterpret_cast<const char*>(&m_header.nb_blocks), 4);
-      data_stream.write(reinterpret_cast<const char*>(&m_header.blocksize), 4);
-      data_stream.write(reinterpret_cast<const char*>(&m_header.last_blocksize), 4);
-
-      // save filepointer
-      m_compressed_sizes_start = data_stream.tellp();
-
-      // Reserve space for compressed block sizes
-      for(Uint i = 0; i != m_header.nb_blocks; ++i)
-        data_stream.write(reinterpret_cast<const char*>(&m_header.nb_blocks), 4);
+      m_current_array.clear();
+      m_current_array.reserve(nb_bytes);
     }
 
-    /// Finish writing the current array
+    /// Finish writing the current array, compressing all of its blocks concurrently
     void finish_array()
     {
-      // Write the last block
-      cf3_assert(static_cast<Uint>(m_current_block.tellp()) == static_cast<Uint>(m_header.last_blocksize));
-      compress_block();
+      std::vector<std::string> compressed_blocks;
+      m_compressor.compress_blocks(m_current_array.data(), m_current_array.size(), m_header.blocksize, compressed_blocks);
+      cf3_assert(compressed_blocks.size() == m_header.nb_blocks);
 
-      // go back to the header
-      const Uint stream_end = data_stream.tellp();
-      data_stream.seekp(m_compressed_sizes_start);
+      m_header.compressed_blocksizes.resize(m_header.nb_blocks);
+      for(Uint i = 0; i != m_header.nb_blocks; ++i)
+        m_header.compressed_blocksizes[i] = compressed_blocks[i].size();
 
-      // Write actual compressed block sizes
+      // Write the header
+      data_stream.write(reinterpret_cast<const char*>(&m_header.nb_blocks), 4);
+      data_stream.write(reinterpret_cast<const char*>(&m_header.blocksize), 4);
+      data_stream.write(reinterpret_cast<const char*>(&m_header.last_blocksize), 4);
       for(Uint i = 0; i != m_header.nb_blocks; ++i)
         data_stream.write(reinterpret_cast<const char*>(&m_header.compressed_blocksizes[i]), 4);
 
-      // go back to the stream end
-      data_stream.seekp(stream_end);
+      // Write the compressed data
+      boost_foreach(const std::string& block, compressed_blocks)
+        data_stream.write(block.data(), block.size());
+
+      m_current_array.clear();
     }
 
     /// Append a value to the stream
     template<typename ValueT>
     void push_back(const ValueT& value)
     {
-      // Block is full, write it to the compressed stream
-      if(m_current_block.tellp() == static_cast<std::streampos>(m_header.blocksize))
-        compress_block();
-
-      m_current_block.write(reinterpret_cast<const char*>(&value), m_wordsize);
+      m_current_array.append(reinterpret_cast<const char*>(&value), m_wordsize);
     }
 
     // Offset to put in the VTK XML (= offset after the _)
-    Uint offset()
-    {
-      return static_cast<Uint>(data_stream.tellp()) - 1u;
-    }
-
-    // Compress the current block and append it to the data stream
-    void compress_block()
+    unsigned long long offset()
     {
-      // set up zlib compressor
-      boost::iostreams::filtering_stream<boost::iostreams::input> compressed_stream;
-      compressed_stream.push(boost::iostreams::zlib_compressor());
-      compressed_stream.push(m_current_block);
-
-      // write data and store compressed size
-      const Uint before = data_stream.tellp();
-      data_stream << compressed_stream.rdbuf();
-      m_header.compressed_blocksizes.push_back(static_cast<Uint>(data_stream.tellp()) - before);
-
-      // clear current block
-      m_current_block.str(std::string());
+      return static_cast<unsigned long long>(data_stream.tellp()) - 1u;
     }
 
     CompressedStreamHeader m_header;
 
-    /// File pointer where the compressed sizes start
-    Uint m_compressed_sizes_start;
-
     Uint m_wordsize;
 
-    // Uncompressed data for the block that is being appended to
-    std::stringstream m_current_block;
+    // Uncompressed data for the array that is being appended to
+    std::string m_current_array;
 
     std::stringstream data_stream;
+
+    const BlockCompressor& m_compressor;
   };
 
   // Recursively transform nodes to their parallel counterparts
@@ -192,6 +167,92 @@ namespace detail
     }
   }
 
+  // Add base to all offset attributes of the given node and its children
+  void shift_offsets(XmlNode& node, const unsigned long long base)
+  {
+    rapidxml::xml_attribute<char>* attr = node.content->first_attribute("offset");
+    if(attr)
+      node.set_attribute("offset", to_str(from_str<unsigned long long>(std::string(attr->value(), attr->value_size())) + base));
+    XmlNode child;
+    for (child.content = node.content->first_node(); child.is_valid() ; child.content = child.content->next_sibling() )
+    {
+      shift_offsets(child, base);
+    }
+  }
+
+  // Gather a string from all processes of comm on its rank 0.
+  // The strings are sent in chunks that fit in an int count, so pieces and files of any size can be gathered.
+  void gather_string(MPI_Comm comm, const std::string& in, std::vector<std::string>& out)
+  {
+    int comm_size, comm_rank;
+    MPI_CHECK_RESULT(MPI_Comm_size, (comm, &comm_size));
+    MPI_CHECK_RESULT(MPI_Comm_rank, (comm, &comm_rank));
+
+    unsigned long long my_length = in.size();
+    std::vector<unsigned long long> lengths(comm_size, 0);
+    MPI_CHECK_RESULT(MPI_Gather, (&my_length, 1, MPI_UNSIGNED_LONG_LONG, &lengths[0], 1, MPI_UNSIGNED_LONG_LONG, 0, comm));
+
+    const unsigned long long chunk_size = 1ull << 30;
+    const int tag = 0;
+
+    out.clear();
+    if(comm_rank == 0)
+    {
+      out.resize(comm_size);
+      out[0] = in;
+      for(int i = 1; i != comm_size; ++i)
+      {
+        out[i].resize(lengths[i]);
+        for(unsigned long long begin = 0; begin < lengths[i]; begin += chunk_size)
+        {
+          const int count = static_cast<int>(std::min(chunk_size, lengths[i] - begin));
+          MPI_CHECK_RESULT(MPI_Recv, (&out[i][begin], count, MPI_CHAR, i, tag, comm, MPI_STATUS_IGNORE));
+        }
+      }
+    }
+    else
+    {
+      for(unsigned long long begin = 0; begin < my_length; begin += chunk_size)
+      {
+        const int count = static_cast<int>(std::min(chunk_size, my_length - begin));
+        MPI_CHECK_RESULT(MPI_Send, (const_cast<char*>(in.data() + begin), count, MPI_CHAR, 0, tag, comm));
+      }
+    }
+  }
+
+  // Write a vtu file, given the XML up to the pieces and the raw appended data (without the leading _)
+  void write_vtu(const std::string& path, const std::string& xml_string, const std::string& appended_data)
+  {
+    boost::filesystem::fstream fout(path, std::ios_base::out | std::ios_base::binary);
+    if(!fout)
+      throw common::FileSystemError(FromHere(), "Could not open file " + path + " for writing");
+
+    // Write XML meta data
+    fout << xml_string;
+
+    // Append  compressed data
+    fout << "\n<AppendedData encoding=\"raw\">\n_";
+    fout.write(appended_data.data(), appended_data.size());
+    fout << "\n</AppendedData>\n</VTKFile>\n";
+
+    fout.close();
+    if(!fout)
+      throw common::FileSystemError(FromHere(), "Error writing file " + path);
+  }
+
+  // Same as write_vtu, for use on a separate thread. Errors are stored in error, to be thrown when the thread is joined
+  void write_vtu_in_background(const boost::shared_ptr<std::string>& path, const boost::shared_ptr<std::string>& xml_string, const boost::shared_ptr<std::string>& appended_data, std::string& error)
+  {
+    try
+    {
+      write_vtu(*path, *xml_string, *appended_data);
+    }
+    catch(std::exception& e)
+    {
+      error = "Error writing " + *path + ": " + e.what();
+    }
+  }
+
 } // namespace detail
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -211,6 +272,58 @@ Writer::Writer( const std::string& name )
       .pretty_name("Dictionary")
       .description("Dictionary used to get the node coordinates and continuous fields")
       .link_to(&m_dictionary);
+
+    options().add("compressor", std::string("zlib"))
+      .pretty_name("Compressor")
+      .description("Compression algorithm for the data arrays: zlib or lz4. lz4 needs ParaView 5.4 or newer, and coolfluid built with LZ4.");
+
+    options().add("compression_threads", 1u)
+      .pretty_name("Compression Threads")
+      .description("Number of threads used to compress the data blocks. 0 uses all hardware threads.");
+
+    options().add("nb_files", 0u)
+      .pretty_name("Number of Files")
+      .description("Number of vtu files to write. Groups of consecutive ranks send their pieces to the first rank of the group, which writes them to a single file. 0 means one file per rank.");
+
+    options().add("background_write", false)
+      .pretty_name("Background Write")
+      .description("Write the vtu files on a separate thread, which is waited for at the next write");
+}
+
+Writer::~Writer()
+{
+  try
+  {
+    wait();
+  }
+  catch(common::FileSystemError& e)
+  {
+    CFerror << e.what() << CFendl;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Writer::wait()
+{
+  const std::string error = join_write_thread();
+  if(!error.empty())
+    throw common::FileSystemError(FromHere(), error);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::string Writer::join_write_thread()
+{
+  if(is_null(m_write_thread.get()))
+    return std::string();
+
+  m_write_thread->join();
+  m_write_thread.reset();
+
+  const std::string error = m_write_error;
+  m_write_error.clear();
+  return error;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -227,11 +340,35 @@ std::vector<std::string> Writer::get_extensions()
 
 void Writer::write()
 {
-  // Path for the file written by the current node
+  PE::Comm& comm = PE::Comm::instance();
+
+  // Finish the previous write first. Only the writing ranks know if it failed, so the error
+  // is shared before the collective operations below, to stop all ranks together.
+  std::string previous_error = join_write_thread();
+  if(comm.is_active())
+  {
+    const int my_failed = previous_error.empty() ? 0 : 1;
+    int failed = 0;
+    comm.all_reduce(PE::max(), &my_failed, 1, &failed);
+    if(failed && previous_error.empty())
+      previous_error = "Background write of the previous file failed on another rank";
+  }
+  if(!previous_error.empty())
+    throw common::FileSystemError(FromHere(), previous_error);
+
+  const Uint nb_procs = comm.size();
+  const Uint rank = comm.rank();
+  Uint nb_files = options().value<Uint>("nb_files");
+  if(nb_files == 0 || nb_files > nb_procs || !comm.is_active())
+    nb_files = nb_procs;
+  // Consecutive ranks share a file, so a group usually ends up on the same node
+  const Uint file_idx = rank * nb_files / nb_procs;
+
+  // Path for the file written by the current group
   URI my_path(m_file_path.path());
   const URI my_dir = my_path.base_path();
   const std::string basename = my_path.base_name();
-  my_path = my_dir / (basename + "_P" + to_str(PE::Comm::instance().rank()) + ".vtu");
+  my_path = my_dir / (basename + "_P" + to_str(file_idx) + ".vtu");
 
   XmlDoc doc("1.0", "ISO-8859-1");
   
@@ -242,7 +379,8 @@ void Writer::write()
   vtkfile.set_attribute("type", "UnstructuredGrid");
   vtkfile.set_attribute("version", "0.1");
   vtkfile.set_attribute("byte_order", "LittleEndian");
-  vtkfile.set_attribute("compressor", "vtkZLibDataCompressor");
+  const BlockCompressor compressor(BlockCompressor::codec_from_str(options().value<std::string>("compressor")), options().value<Uint>("compression_threads"));
+  vtkfile.set_attribute("compressor", compressor.codec() == BlockCompressor::LZ4 ? "vtkLZ4DataCompressor" : "vtkZLibDataCompressor");
 
   XmlNode unstructured_grid = vtkfile.add_node("UnstructuredGrid");
 
@@ -285,7 +423,7 @@ void Writer::write()
   piece.set_attribute("NumberOfCells", to_str(nb_elems));
 
   // Points output
-  detail::CompressedStream appended_data;
+  detail::CompressedStream appended_data(compressor);
 
   XmlNode points_data = piece.add_node("Points").add_node("DataArray");
   points_data.set_attribute("type", sizeof(Real) == 4 ? "Float32" : "Float64");
@@ -461,28 +599,70 @@ void Writer::write()
     }
   }
 
-  // Write to file, inserting the binary data at the end
-  std::cout << "writing file " << my_path.path() << std::endl;
-  boost::filesystem::fstream fout(my_path.path(), std::ios_base::out | std::ios_base::binary);
+  // Raw appended data, without the leading _
+  boost::shared_ptr<std::string> data(new std::string(appended_data.data_stream.str(), 1));
+  bool write_file = true;
+  std::string other_pieces;
 
-  // Remove the closing tag
-  std::string xml_string;
-  to_string(doc, xml_string);
-  boost::algorithm::erase_last(xml_string, "</VTKFile>");
-  boost::algorithm::trim_right(xml_string);
-
-  // Write XML meta data
-  fout << xml_string;
+  if(nb_files != nb_procs)
+  {
+    MPI_Comm group_comm;
+    MPI_CHECK_RESULT(MPI_Comm_split, (comm.communicator(), file_idx, rank, &group_comm));
+    int group_rank;
+    MPI_CHECK_RESULT(MPI_Comm_rank, (group_comm, &group_rank));
+
+    // Data offsets of this piece in the combined file
+    unsigned long long my_data_size = data->size();
+    unsigned long long base_offset = 0;
+    MPI_CHECK_RESULT(MPI_Exscan, (&my_data_size, &base_offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, group_comm));
+    if(group_rank == 0)
+      base_offset = 0;
+    detail::shift_offsets(piece, base_offset);
+
+    std::string piece_string;
+    to_string(piece, piece_string);
+    std::vector<std::string> pieces, piece_data;
+    detail::gather_string(group_comm, piece_string, pieces);
+    detail::gather_string(group_comm, *data, piece_data);
+    MPI_CHECK_RESULT(MPI_Comm_free, (&group_comm));
+
+    write_file = group_rank == 0;
+    if(write_file)
+    {
+      // Pieces of the other ranks go after our own
+      for(Uint i = 1; i < pieces.size(); ++i)
+        other_pieces += pieces[i];
 
-  // Append  compressed data
-  fout << "\n<AppendedData encoding=\"raw\">\n";
-  fout << appended_data.data_stream.rdbuf();
-  fout << "\n</AppendedData>\n</VTKFile>\n";
+      data->clear();
+      BOOST_FOREACH(const std::string& d, piece_data)
+        data->append(d);
+    }
+  }
 
-  fout.close();
+  if(write_file)
+  {
+    // XML meta data, without the closing tag
+    boost::shared_ptr<std::string> xml_string(new std::string());
+    to_string(doc, *xml_string);
+    boost::algorithm::erase_last(*xml_string, "</VTKFile>");
+    boost::algorithm::trim_right(*xml_string);
+    if(!other_pieces.empty())
+      xml_string->insert(xml_string->rfind("</UnstructuredGrid>"), other_pieces);
+
+    std::cout << "writing file " << my_path.path() << std::endl;
+    if(options().value<bool>("background_write"))
+    {
+      boost::shared_ptr<std::string> path(new std::string(my_path.path()));
+      m_write_thread.reset(new boost::thread(boost::bind(&detail::write_vtu_in_background, path, xml_string, data, boost::ref(m_write_error))));
+    }
+    else
+    {
+      detail::write_vtu(my_path.path(), *xml_string, *data);
+    }
+  }
 
   // Write the parallel header, if needed
-  if(PE::Comm::instance().rank() == 0 || options().value<bool>("distributed_files"))
+  if(rank == 0 || options().value<bool>("distributed_files"))
   {
     URI pvtu_path = my_dir / (basename + ".pvtu");
 
@@ -501,7 +681,7 @@ void Writer::write()
     detail::make_pvtu(punstruc);
     punstruc.set_attribute("GhostLevel", "0");
 
-    for(Uint i = 0; i != PE::Comm::instance().size(); ++i)
+    for(Uint i = 0; i != nb_files; ++i)
     {
       const std::string piece_path = basename + "_P" + to_str(i) + ".vtu";
       punstruc.add_node("Piece").set_attribute("Source", piece_path);
@@ -9,6 +9,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mesh/MeshWriter.hpp"
 #include "mesh/GeoShape.hpp"
 
@@ -16,6 +18,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace boost { class thread; }
+
 namespace cf3 {
 namespace mesh {
   class ElementType;
@@ -25,6 +29,9 @@ namespace VTKXML {
 //////////////////////////////////////////////////////////////////////////////
 
 /// This class defines VTKXML mesh format writer
+/// By default each rank writes its own vtu file. With the nb_files option, the pieces of consecutive
+/// ranks are gathered and written into a single vtu file (containing multiple Piece elements) by the
+/// first rank of each group.
 /// @author Bart Janssens
 class VTKXML_API Writer : public MeshWriter
 {
@@ -38,6 +45,8 @@ public: // functions
   /// constructor
   Writer( const std::string& name );
 
+  virtual ~Writer();
+
   /// Gets the Class name
   static std::string type_name() { return "Writer"; }
 
@@ -46,9 +55,22 @@ public: // functions
   virtual std::string get_format() { return "VTKXML"; }
 
   virtual std::vector<std::string> get_extensions();
+
+  /// Wait until the background write of the previous file is finished.
+  /// @throw common::FileSystemError if that write failed
+  void wait();
   
 private:
+  /// Join the background write thread, if any, and return its error message, which is empty if it succeeded
+  std::string join_write_thread();
+
   Handle<mesh::Dictionary const> m_dictionary;
+
+  /// Thread writing the previous file, if background_write is enabled
+  boost::scoped_ptr<boost::thread> m_write_thread;
+
+  /// Error message of the background write, empty if it succeeded
+  std::string m_write_error;
 }; // end Writer
 
 
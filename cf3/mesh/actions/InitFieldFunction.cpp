@@ -197,25 +197,35 @@ void InitFieldFunction::execute()
   std::vector<Real> constants;
   constants.push_back( options().value<Real>("time") );
 
-  std::vector<Real> variables(variable_names.size());
-
-  for (Uint pt=0; pt<dict.size(); ++pt)
+  // Evaluate the functions for blocks of points, gathering the variables of each block column by column
+  const Uint nb_vars = variable_names.size();
+  const Uint block_size = 1024;
+  RealMatrix variables;
+  RealVector values;
+  for (Uint begin=0; begin<dict.size(); begin+=block_size)
   {
-    // Assemble variables per point
+    const Uint nb_pts = std::min(block_size, dict.size()-begin);
+    variables.resize(nb_pts,nb_vars);
+
+    // Assemble variables of the block
     Uint c=0;
     for (Uint j=0; j<field_comps.size(); ++j, ++c)
     {
-      variables[c] = field_comps[j]->array()[pt][field_cols[j]];
+      const Field::ArrayT& array = field_comps[j]->array();
+      for (Uint pt=0; pt<nb_pts; ++pt)
+        variables(pt,c) = array[begin+pt][field_cols[j]];
     }
     for (Uint j=0; j<constants.size(); ++j, ++c)
     {
-      variables[c] = constants[j];
+      variables.col(c).setConstant(constants[j]);
     }
 
     // Evaluate functions
     for (Uint f=0; f<cols.size(); ++f)
     {
-      m_field->array()[pt][f] = functions[f](variables);
+      functions[f].evaluate_batch(variables,values);
+      for (Uint pt=0; pt<nb_pts; ++pt)
+        m_field->array()[begin+pt][f] = values[pt];
     }
   }
 }
@@ -0,0 +1,409 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+
+#include "common/Log.hpp"
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/Table.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "math/BoundingBox.hpp"
+#include "math/Hilbert.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+  using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < Renumber, MeshTransformer, mesh::actions::LibActions> Renumber_Builder;
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Orders indices by increasing key
+template<typename KeyT>
+struct KeyLess
+{
+  KeyLess(const std::vector<KeyT>& keys) : m_keys(keys) {}
+  bool operator()(const Uint a, const Uint b) const { return m_keys[a] < m_keys[b]; }
+  const std::vector<KeyT>& m_keys;
+};
+
+/// Fill new_to_old with the indices sorted by key, keeping the original order for equal keys
+template<typename KeyT>
+void sort_by_key(const std::vector<KeyT>& keys, std::vector<Uint>& new_to_old)
+{
+  new_to_old.resize(keys.size());
+  for(Uint i = 0; i != keys.size(); ++i)
+    new_to_old[i] = i;
+  std::stable_sort(new_to_old.begin(), new_to_old.end(), KeyLess<KeyT>(keys));
+}
+
+/// Inverse of the permutation
+void invert(const std::vector<Uint>& new_to_old, std::vector<Uint>& old_to_new)
+{
+  old_to_new.resize(new_to_old.size());
+  for(Uint i = 0; i != new_to_old.size(); ++i)
+    old_to_new[new_to_old[i]] = i;
+}
+
+/// Move the rows of a table to their new position
+template<typename ValueT>
+void permute_rows(Table<ValueT>& table, const std::vector<Uint>& new_to_old)
+{
+  cf3_assert(table.size() == new_to_old.size());
+  const typename Table<ValueT>::ArrayT old_array = table.array();
+  typename Table<ValueT>::ArrayT& array = table.array();
+  for(Uint i = 0; i != new_to_old.size(); ++i)
+    array[i] = old_array[new_to_old[i]];
+}
+
+/// Move the entries of a list to their new position
+template<typename ValueT>
+void permute_rows(List<ValueT>& list, const std::vector<Uint>& new_to_old)
+{
+  cf3_assert(list.size() == new_to_old.size());
+  const std::vector<ValueT> old_list(list.array().begin(), list.array().end());
+  for(Uint i = 0; i != new_to_old.size(); ++i)
+    list[i] = old_list[new_to_old[i]];
+}
+
+/// Replace the node indices in a connectivity table
+void renumber_values(Table<Uint>& table, const std::vector<Uint>& old_to_new)
+{
+  boost_foreach(Table<Uint>::Row row, table.array())
+  {
+    boost_foreach(Uint& node, row)
+      node = old_to_new[node];
+  }
+}
+
+/// Bounding box of all geometry nodes on this rank
+void compute_bounding_box(const Dictionary& geometry, math::BoundingBox& bounding_box)
+{
+  const Field& coordinates = geometry.coordinates();
+  RealVector point(coordinates.row_size());
+  for(Uint i = 0; i != coordinates.size(); ++i)
+  {
+    for(Uint d = 0; d != point.size(); ++d)
+      point[d] = coordinates[i][d];
+    bounding_box.extend(point);
+  }
+}
+
+/// Order the geometry nodes along the Hilbert curve
+void hilbert_node_order(const Dictionary& geometry, const math::BoundingBox& bounding_box, std::vector<Uint>& new_to_old)
+{
+  const Field& coordinates = geometry.coordinates();
+  math::Hilbert compute_hilbert_idx(bounding_box, 20);
+  std::vector<boost::uint64_t> keys(coordinates.size());
+  RealVector point(coordinates.row_size());
+  for(Uint i = 0; i != coordinates.size(); ++i)
+  {
+    for(Uint d = 0; d != point.size(); ++d)
+      point[d] = coordinates[i][d];
+    keys[i] = compute_hilbert_idx(point);
+  }
+  sort_by_key(keys, new_to_old);
+}
+
+/// Order the geometry nodes using the Reverse Cuthill-McKee algorithm on the graph of nodes sharing an element
+void rcm_node_order(const Dictionary& geometry, std::vector<Uint>& new_to_old)
+{
+  const Uint nb_nodes = geometry.size();
+
+  std::vector< std::vector<Uint> > neighbours(nb_nodes);
+  boost_foreach(const Handle<Space>& space, geometry.spaces())
+  {
+    boost_foreach(Connectivity::ConstRow nodes, space->connectivity().array())
+    {
+      boost_foreach(const Uint a, nodes)
+      {
+        boost_foreach(const Uint b, nodes)
+        {
+          if(a != b)
+            neighbours[a].push_back(b);
+        }
+      }
+    }
+  }
+
+  std::vector<Uint> degree(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    std::vector<Uint>& node_neighbours = neighbours[i];
+    std::sort(node_neighbours.begin(), node_neighbours.end());
+    node_neighbours.erase(std::unique(node_neighbours.begin(), node_neighbours.end()), node_neighbours.end());
+    degree[i] = node_neighbours.size();
+  }
+
+  // Each connected part of the graph is started from its node with the lowest degree
+  std::vector<Uint> start_nodes;
+  sort_by_key(degree, start_nodes);
+
+  std::vector<bool> visited(nb_nodes, false);
+  new_to_old.clear();
+  new_to_old.reserve(nb_nodes);
+  boost_foreach(const Uint start, start_nodes)
+  {
+    if(visited[start])
+      continue;
+
+    visited[start] = true;
+    new_to_old.push_back(start);
+    for(Uint front = new_to_old.size()-1; front != new_to_old.size(); ++front)
+    {
+      const Uint level_begin = new_to_old.size();
+      boost_foreach(const Uint neighbour, neighbours[new_to_old[front]])
+      {
+        if(!visited[neighbour])
+        {
+          visited[neighbour] = true;
+          new_to_old.push_back(neighbour);
+        }
+      }
+      std::stable_sort(new_to_old.begin()+level_begin, new_to_old.end(), KeyLess<Uint>(degree));
+    }
+  }
+
+  std::reverse(new_to_old.begin(), new_to_old.end());
+}
+
+/// Order the elements along the Hilbert curve through their centroids
+void hilbert_element_order(const Entities& entities, const math::BoundingBox& bounding_box, std::vector<Uint>& new_to_old)
+{
+  const Field& coordinates = entities.geometry_fields().coordinates();
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  math::Hilbert compute_hilbert_idx(bounding_box, 20);
+  std::vector<boost::uint64_t> keys(connectivity.size());
+  RealVector centroid(coordinates.row_size());
+  for(Uint e = 0; e != connectivity.size(); ++e)
+  {
+    centroid.setZero();
+    boost_foreach(const Uint node, connectivity[e])
+    {
+      for(Uint d = 0; d != centroid.size(); ++d)
+        centroid[d] += coordinates[node][d];
+    }
+    centroid /= static_cast<Real>(connectivity.row_size());
+    keys[e] = compute_hilbert_idx(centroid);
+  }
+  sort_by_key(keys, new_to_old);
+}
+
+/// Order the elements by their lowest (renumbered) geometry node
+void lowest_node_element_order(const Entities& entities, std::vector<Uint>& new_to_old)
+{
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  std::vector<Uint> keys(connectivity.size());
+  for(Uint e = 0; e != connectivity.size(); ++e)
+  {
+    const Connectivity::ConstRow nodes = connectivity[e];
+    keys[e] = *std::min_element(nodes.begin(), nodes.end());
+  }
+  sort_by_key(keys, new_to_old);
+}
+
+/// Number the nodes of a dictionary in the order they are first used by the elements
+void first_use_node_order(const Mesh& mesh, const Dictionary& dict, std::vector<Uint>& new_to_old)
+{
+  const Uint nb_nodes = dict.size();
+  std::vector<bool> used(nb_nodes, false);
+  new_to_old.clear();
+  new_to_old.reserve(nb_nodes);
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    if(!dict.defined_for_entities(entities))
+      continue;
+
+    boost_foreach(Connectivity::ConstRow nodes, dict.space(*entities).connectivity().array())
+    {
+      boost_foreach(const Uint node, nodes)
+      {
+        if(!used[node])
+        {
+          used[node] = true;
+          new_to_old.push_back(node);
+        }
+      }
+    }
+  }
+
+  // Nodes that are not used by any element keep their relative order at the end
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(!used[i])
+      new_to_old.push_back(i);
+  }
+}
+
+/// Apply the new order to all the data stored per node of the given dictionary
+void renumber_nodes(Mesh& mesh, Dictionary& dict, const std::vector<Uint>& new_to_old)
+{
+  std::vector<Uint> old_to_new;
+  invert(new_to_old, old_to_new);
+
+  boost_foreach(const Handle<Field>& field, dict.fields())
+  {
+    permute_rows(*field, new_to_old);
+  }
+  permute_rows(dict.glb_idx(), new_to_old);
+  permute_rows(dict.rank(), new_to_old);
+
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    renumber_values(space->connectivity(), old_to_new);
+  }
+
+  Handle< List<Uint> > periodic_links_nodes(dict.get_child("periodic_links_nodes"));
+  Handle< List<bool> > periodic_links_active(dict.get_child("periodic_links_active"));
+  if(is_not_null(periodic_links_nodes))
+  {
+    cf3_assert(is_not_null(periodic_links_active));
+    permute_rows(*periodic_links_nodes, new_to_old);
+    permute_rows(*periodic_links_active, new_to_old);
+    for(Uint i = 0; i != periodic_links_nodes->size(); ++i)
+    {
+      if((*periodic_links_active)[i])
+        (*periodic_links_nodes)[i] = old_to_new[(*periodic_links_nodes)[i]];
+    }
+  }
+
+  if(&dict == &mesh.geometry_fields())
+  {
+    boost_foreach(List<Uint>& used_nodes, find_components_recursively_with_tag< List<Uint> >(mesh.topology(), mesh::Tags::nodes_used()))
+    {
+      boost_foreach(Uint& node, used_nodes.array())
+        node = old_to_new[node];
+      std::sort(used_nodes.array().begin(), used_nodes.array().end());
+    }
+  }
+
+  // The comm pattern stores local indices, so it is rebuilt on the next synchronization
+  if(is_not_null(dict.get_child("CommPattern")))
+    dict.remove_component("CommPattern");
+}
+
+/// Apply the new order to all the data stored per element
+void renumber_elements(Entities& entities, const std::vector<Uint>& new_to_old)
+{
+  permute_rows(entities.glb_idx(), new_to_old);
+  permute_rows(entities.rank(), new_to_old);
+  boost_foreach(const Handle<Space>& space, entities.spaces())
+  {
+    permute_rows(space->connectivity(), new_to_old);
+  }
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+
+Renumber::Renumber( const std::string& name )
+: MeshTransformer(name)
+{
+
+  properties()["brief"] = std::string("Reorder nodes and elements for memory locality");
+  std::string desc;
+  desc =
+    "  Usage: Renumber algorithm:string=Hilbert\n\n"
+    "  Orders the geometry nodes and the elements along a Hilbert space filling curve (Hilbert)\n"
+    "  or using the Reverse Cuthill-McKee algorithm (RCM)\n";
+
+  properties()["description"] = desc;
+
+  std::vector<boost::any> algorithms;
+  algorithms.push_back(std::string("Hilbert"));
+  algorithms.push_back(std::string("RCM"));
+  options().add("algorithm", std::string("Hilbert"))
+      .description("Algorithm used to order the nodes and elements (Hilbert or RCM)")
+      .mark_basic()
+      .restricted_list() = algorithms;
+
+  options().add("renumber_elements", true)
+      .description("Also reorder the elements, not only the nodes")
+      .pretty_name("Renumber Elements");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Renumber::execute()
+{
+  Mesh& mesh = *m_mesh;
+  const std::string algorithm = options().value<std::string>("algorithm");
+  if(algorithm != "Hilbert" && algorithm != "RCM")
+    throw SetupError(FromHere(), "Unknown renumbering algorithm " + algorithm + " for " + uri().string());
+
+  if(count(find_components_recursively< Table<Entity> >(mesh)) != 0)
+    throw SetupError(FromHere(), "Mesh " + mesh.uri().string() + " has element connectivity that can't be renumbered by " + uri().string() + ". Renumber before building faces.");
+
+  Dictionary& geometry = mesh.geometry_fields();
+  if(geometry.size() == 0)
+    return;
+
+  math::BoundingBox bounding_box;
+  compute_bounding_box(geometry, bounding_box);
+
+  std::vector<Uint> new_to_old;
+  if(algorithm == "Hilbert")
+    hilbert_node_order(geometry, bounding_box, new_to_old);
+  else
+    rcm_node_order(geometry, new_to_old);
+  renumber_nodes(mesh, geometry, new_to_old);
+
+  if(options().value<bool>("renumber_elements"))
+  {
+    boost_foreach(const Handle<Entities>& entities, mesh.elements())
+    {
+      if(algorithm == "Hilbert")
+        hilbert_element_order(*entities, bounding_box, new_to_old);
+      else
+        lowest_node_element_order(*entities, new_to_old);
+      renumber_elements(*entities, new_to_old);
+    }
+  }
+
+  boost_foreach(const Handle<Dictionary>& dict, mesh.dictionaries())
+  {
+    if(dict.get() == &geometry)
+      continue;
+    first_use_node_order(mesh, *dict, new_to_old);
+    renumber_nodes(mesh, *dict, new_to_old);
+  }
+
+  mesh.raise_mesh_changed();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
@@ -0,0 +1,61 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_actions_Renumber_hpp
+#define cf3_mesh_actions_Renumber_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/actions/LibActions.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// This class defines a mesh transformer that reorders the local storage of
+/// nodes and elements, so that entities close to each other in space are also
+/// close to each other in memory.
+///
+/// The geometry nodes are ordered either along a Hilbert space filling curve
+/// or by the Reverse Cuthill-McKee algorithm on the node graph. The elements of
+/// each Entities are ordered along the Hilbert curve through their centroids, or
+/// by their lowest node index for RCM. The nodes of the other dictionaries are
+/// numbered in the order they are first used by the reordered elements.
+///
+/// Fields, global indices, ranks, connectivity tables and periodic links are permuted
+/// along. Global indices themselves are not changed. The comm patterns of the dictionaries
+/// are removed, and are rebuilt when a field is synchronized next.
+///
+/// This should be used right after reading the mesh, before building faces or
+/// any other element-to-element connectivity, which is not renumbered.
+class mesh_actions_API Renumber : public MeshTransformer
+{
+public: // functions
+
+  /// constructor
+  Renumber( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "Renumber"; }
+
+  virtual void execute();
+
+}; // end Renumber
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_actions_Renumber_hpp
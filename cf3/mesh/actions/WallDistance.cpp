@@ -4,6 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <set>
 
 #include "common/Builder.hpp"
@@ -13,6 +14,8 @@
 #include "common/Option.hpp"
 #include "common/OptionList.hpp"
 #include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/PE/Comm.hpp"
 
 #include "mesh/ConnectivityData.hpp"
 #include "mesh/DiscontinuousDictionary.hpp"
@@ -29,6 +32,7 @@
 #include "mesh/LagrangeP1/Triag2D.hpp"
 #include "mesh/LagrangeP1/Quad2D.hpp"
 
+#include "MakeBoundaryGlobal.hpp"
 #include "WallDistance.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
@@ -201,6 +205,114 @@ struct WallProjection
   bool m_has_nearest_element = false;
   NodeConnectivity::ElementReferenceT m_last_nearest_element;
 };
+
+/// KD-tree over the surface nodes, to find the nearest surface node in logarithmic time.
+/// The tree is implicit: the median of each range of m_nodes is the splitting node for that range.
+/// Of nodes at the same distance, the one with the lowest index is returned.
+class SurfaceNodeTree
+{
+public:
+  SurfaceNodeTree(const Field& coordinates, const common::List<Uint>& surface_nodes) :
+    m_coords(coordinates),
+    m_dim(coordinates.row_size()),
+    m_nodes(surface_nodes.array().begin(), surface_nodes.array().end())
+  {
+    build(0, m_nodes.size(), 0);
+  }
+
+  /// Find the surface node that is nearest to the given point
+  /// @param [out] nearest_node Index of the nearest node, unchanged if there are no surface nodes
+  /// @param [out] distance2 Squared distance to the nearest node
+  void nearest(const Field::ConstRow point, Uint& nearest_node, Real& distance2) const
+  {
+    search(0, m_nodes.size(), 0, point, nearest_node, distance2);
+  }
+
+private:
+  struct CoordinateLess
+  {
+    CoordinateLess(const Field& coordinates, const Uint dim) : coords(coordinates), d(dim) {}
+    bool operator()(const Uint a, const Uint b) const { return coords[a][d] < coords[b][d]; }
+    const Field& coords;
+    const Uint d;
+  };
+
+  void build(const Uint begin, const Uint end, const Uint depth)
+  {
+    if(end - begin < 2)
+      return;
+    const Uint middle = begin + (end - begin) / 2;
+    std::nth_element(m_nodes.begin() + begin, m_nodes.begin() + middle, m_nodes.begin() + end, CoordinateLess(m_coords, depth % m_dim));
+    build(begin, middle, depth + 1);
+    build(middle + 1, end, depth + 1);
+  }
+
+  void search(const Uint begin, const Uint end, const Uint depth, const Field::ConstRow point, Uint& nearest_node, Real& distance2) const
+  {
+    if(begin == end)
+      return;
+
+    const Uint middle = begin + (end - begin) / 2;
+    const Uint node = m_nodes[middle];
+    const Field::ConstRow node_coord = m_coords[node];
+    Real d2 = 0.;
+    for(Uint i = 0; i != m_dim; ++i)
+      d2 += (point[i] - node_coord[i]) * (point[i] - node_coord[i]);
+    if(d2 < distance2 || (d2 == distance2 && node < nearest_node))
+    {
+      distance2 = d2;
+      nearest_node = node;
+    }
+
+    // Search the side of the splitting plane containing the point first, and the other side only if it can contain a nearer node
+    const Uint d = depth % m_dim;
+    const Real plane_distance = point[d] - node_coord[d];
+    if(plane_distance < 0.)
+    {
+      search(begin, middle, depth + 1, point, nearest_node, distance2);
+      if(plane_distance * plane_distance <= distance2)
+        search(middle + 1, end, depth + 1, point, nearest_node, distance2);
+    }
+    else
+    {
+      search(middle + 1, end, depth + 1, point, nearest_node, distance2);
+      if(plane_distance * plane_distance <= distance2)
+        search(begin, middle, depth + 1, point, nearest_node, distance2);
+    }
+  }
+
+  const Field& m_coords;
+  const Uint m_dim;
+  std::vector<Uint> m_nodes;
+};
+
+/// True if every rank has all the elements of the given surface entities
+bool is_replicated(const std::vector< Handle<Entities> >& surface_entities)
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  if(!comm.is_active() || comm.size() == 1)
+    return true;
+
+  Uint nb_elems = 0;
+  Uint nb_owned_elems = 0;
+  for(const auto& entities : surface_entities)
+  {
+    nb_elems += entities->size();
+    for(Uint i = 0; i != entities->size(); ++i)
+    {
+      if(!entities->is_ghost(i))
+        ++nb_owned_elems;
+    }
+  }
+
+  Uint glb_nb_elems = 0;
+  comm.all_reduce(common::PE::plus(), &nb_owned_elems, 1, &glb_nb_elems);
+  const Uint replicated_here = nb_elems == glb_nb_elems ? 1 : 0;
+  Uint replicated_everywhere = 0;
+  comm.all_reduce(common::PE::min(), &replicated_here, 1, &replicated_everywhere);
+  return replicated_everywhere == 1;
+}
+
 }
 
 WallDistance::WallDistance(const std::string& name) : MeshTransformer(name)
@@ -216,11 +328,6 @@ void WallDistance::execute()
 {
   Mesh& mesh = *m_mesh;
 
-  const Field& coords = mesh.geometry_fields().coordinates();
-  const Uint nb_nodes = coords.size();
-  const Uint dim = coords.row_size();
-
-  Handle<NodeConnectivity> node_connectivity = mesh.create_component<NodeConnectivity>("wall_node_connectivity");
   std::vector< Handle<Entities> > surface_entities;
   std::vector< Handle<Entities const> > const_surface_entities;
   for(const Handle<Region>& region : m_regions)
@@ -232,6 +339,20 @@ void WallDistance::execute()
     }
   }
 
+  // The nearest wall may be on another rank, so each rank needs the complete wall
+  if(!detail::is_replicated(surface_entities))
+  {
+    CFinfo << "Wall regions are not available on all ranks, making the boundary global for " << uri().path() << CFendl;
+    boost::shared_ptr<MakeBoundaryGlobal> make_boundary_global = common::allocate_component<MakeBoundaryGlobal>("MakeBoundaryGlobal");
+    make_boundary_global->transform(mesh);
+  }
+
+  const Field& coords = mesh.geometry_fields().coordinates();
+  const Uint nb_nodes = coords.size();
+  const Uint dim = coords.row_size();
+
+  Handle<NodeConnectivity> node_connectivity = mesh.create_component<NodeConnectivity>("wall_node_connectivity");
+
   node_connectivity->initialize(nb_nodes, const_surface_entities);
 
   // Wall distance field
@@ -275,28 +396,24 @@ void WallDistance::execute()
     std::fill(row.begin(), row.end(), 0);
   }
 
+  std::vector<bool> is_surface_node(nb_nodes, false);
+  for(Uint j = 0; j != nb_surface_nodes; ++j)
+  {
+    is_surface_node[surface_nodes[j]] = true;
+  }
+
+  const detail::SurfaceNodeTree surface_node_tree(coords, surface_nodes);
+
   for(Uint inner_node_idx = 0; inner_node_idx != nb_nodes; ++inner_node_idx)
   {
-    bool is_surface_node = false;
     Real shortest_distance = 1e20;
     Uint closest_surface_node = 0;
-    for(Uint j = 0; j != nb_surface_nodes; ++j)
+    if(!is_surface_node[inner_node_idx])
     {
-      const Uint surface_node_idx = surface_nodes[j];
-      if(surface_node_idx == inner_node_idx)
-      {
-        is_surface_node = true;
-        break;
-      }
-      const Real d2 = (to_vector(coords[inner_node_idx]) - to_vector(coords[surface_node_idx])).squaredNorm();
-      if(d2 < shortest_distance)
-      {
-        shortest_distance = d2;
-        closest_surface_node = surface_node_idx;
-      }
+      surface_node_tree.nearest(coords[inner_node_idx], closest_surface_node, shortest_distance);
     }
 
-    if(is_surface_node)
+    if(is_surface_node[inner_node_idx])
     {
       d[inner_node_idx][0] = 0.;
       // Eigen::Map<RealVector> node_normal(&nodal_normals[inner_node_idx][0], dim);
@@ -4,6 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include <boost/cstdint.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/regex.hpp>
@@ -28,8 +34,6 @@
 #include "mesh/DiscontinuousDictionary.hpp"
 #include "mesh/MeshElements.hpp"
 #include "mesh/ConnectivityData.hpp"
-#include "mesh/MergedParallelDistribution.hpp"
-#include "mesh/ParallelDistribution.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Cells.hpp"
@@ -51,6 +55,177 @@ cf3::common::ComponentBuilder < gmsh::Reader, MeshReader, LibGmsh> aGmshReader_B
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+/// Parser for the ASCII parts of a memory-mapped gmsh file.
+/// It avoids the locale and state handling of std::istream, which dominates the reading time of large meshes.
+struct AsciiParser
+{
+  AsciiParser(const char* begin, const char* end) : position(begin), end(end) {}
+
+  void skip_whitespace()
+  {
+    while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+      ++position;
+  }
+
+  Uint next_uint()
+  {
+    skip_whitespace();
+    if (position == end || *position < '0' || *position > '9')
+      throw ParsingFailed(FromHere(),"Expected an unsigned integer in gmsh file, found \""+std::string(position,std::min(position+16,end))+"\"");
+    Uint result = 0;
+    while (position != end && *position >= '0' && *position <= '9')
+      result = 10*result + static_cast<Uint>(*position++ - '0');
+    return result;
+  }
+
+  Real next_real()
+  {
+    skip_whitespace();
+    char* real_end;
+    const Real result = std::strtod(position,&real_end);
+    if (real_end == position)
+      throw ParsingFailed(FromHere(),"Expected a real number in gmsh file, found \""+std::string(position,std::min(position+16,end))+"\"");
+    position = real_end;
+    return result;
+  }
+
+  /// Next sequence of non-whitespace characters
+  std::string next_word()
+  {
+    skip_whitespace();
+    const char* word_begin = position;
+    while (position != end && *position != ' ' && *position != '\t' && *position != '\n' && *position != '\r')
+      ++position;
+    return std::string(word_begin,position);
+  }
+
+  /// Move to the start of the next line
+  void skip_line()
+  {
+    const char* newline = static_cast<const char*>(std::memchr(position,'\n',end-position));
+    position = newline ? newline+1 : end;
+  }
+
+  const char* position;
+  const char* end;
+};
+
+/// Read a value from a binary section, and advance the position
+template<typename T>
+T read_binary(const char*& position)
+{
+  T result;
+  std::memcpy(&result,position,sizeof(T));
+  position += sizeof(T);
+  return result;
+}
+
+/// Find the next section keyword, which is a '$' at the start of a line
+const char* find_section(const char* begin, const char* position, const char* end)
+{
+  while (position != end)
+  {
+    position = static_cast<const char*>(std::memchr(position,'$',end-position));
+    if (!position)
+      return end;
+    if (position == begin || *(position-1) == '\n')
+      return position;
+    ++position;
+  }
+  return end;
+}
+
+/// Start of the first line in [first,last) that begins at or after position
+const char* line_start(const char* first, const char* position, const char* last)
+{
+  if (position == first || *(position-1) == '\n')
+    return position;
+  const char* newline = static_cast<const char*>(std::memchr(position,'\n',last-position));
+  return newline ? newline+1 : last;
+}
+
+/// Part of the bytes in [first,last) that is read by a rank, when they are split in equal parts
+void byte_chunk(const char* first, const char* last, const Uint rank, const Uint nb_ranks, const char*& chunk_begin, const char*& chunk_end)
+{
+  const boost::uint64_t size = last-first;
+  chunk_begin = first + size*rank/nb_ranks;
+  chunk_end = first + size*(rank+1)/nb_ranks;
+}
+
+/// Part of the ASCII lines in [first,last) that is parsed by a rank. The bytes are split in equal parts, moved to the
+/// next line start, so a line belongs to the rank whose part contains the start of the line.
+void ascii_chunk(const char* first, const char* last, const Uint rank, const Uint nb_ranks, const char*& chunk_begin, const char*& chunk_end)
+{
+  byte_chunk(first,last,rank,nb_ranks,chunk_begin,chunk_end);
+  chunk_begin = line_start(first,chunk_begin,last);
+  chunk_end = line_start(first,chunk_end,last);
+}
+
+/// Index of the first of nb_records fixed-size records starting at data that begins at or after position.
+/// A binary record belongs to the rank whose part of the bytes contains the start of the record, like an ASCII line.
+Uint first_record_at(const char* data, const Uint nb_records, const Uint record_size, const char* position)
+{
+  if (position <= data)
+    return 0;
+  const boost::uint64_t index = (static_cast<boost::uint64_t>(position-data) + record_size-1) / record_size;
+  return static_cast<Uint>(std::min(index, static_cast<boost::uint64_t>(nb_records)));
+}
+
+/// Header of a block of elements with the same type and number of tags in a binary file
+struct BinaryElementBlock
+{
+  const char* data;
+  Uint elem_type;
+  Uint nb_elems;
+  Uint nb_tags;
+  Uint record_size;
+};
+
+/// Size of a node record in a binary file: the node number and 3 coordinates
+const Uint binary_node_size = sizeof(int) + 3*sizeof(double);
+
+/// Parse the coordinates of a node, from the position following the node number.
+/// Only the first dimension coordinates are used, gmsh always stores 3 coordinates, even for 2D meshes
+template<typename RowT>
+void read_node_coordinates(const char* position, const char* end, const bool binary, const Uint dimension, RowT coordinates)
+{
+  if (binary)
+  {
+    for (Uint dim=0; dim<dimension; ++dim)
+      coordinates[dim] = read_binary<double>(position);
+  }
+  else
+  {
+    AsciiParser parser(position,end);
+    for (Uint dim=0; dim<dimension; ++dim)
+      coordinates[dim] = parser.next_real();
+  }
+}
+
+/// True if the mesh is read by more than one rank
+bool is_parallel()
+{
+  return PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+}
+
+/// Rank of this process among the ranks that read the mesh together
+Uint reading_rank()
+{
+  return is_parallel() ? PE::Comm::instance().rank() : 0;
+}
+
+/// Number of ranks that read the mesh together, each reading an equal part of the nodes and elements
+Uint nb_reading_ranks()
+{
+  return is_parallel() ? PE::Comm::instance().size() : 1;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+
 Reader::Reader( const std::string& name )
 : MeshReader(name),
   Shared()
@@ -58,14 +233,6 @@ Reader::Reader( const std::string& name )
 
   // options
 
-  options().add("part", PE::Comm::instance().rank() )
-      .description("Number of the part of the mesh to read. (e.g. rank of processor)")
-      .pretty_name("Part");
-
-  options().add("nb_parts", PE::Comm::instance().size() )
-      .description("Total number of parts. (e.g. number of processors)")
-      .pretty_name("nb_parts");
-
   options().add("read_fields", true)
       .description("Read the data from the mesh")
       .pretty_name("Read Fields")
@@ -105,7 +272,7 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   if( boost::filesystem::exists(fp) )
   {
     CFinfo <<  "Opening file " <<  fp.string() << CFendl;
-    m_file.open(fp,std::ios_base::in); // exists so open it
+    m_mapped_file.open(fp.string()); // exists so map it
   }
   else // doesnt exist so throw exception
   {
@@ -121,9 +288,8 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   // NOTE: since gmsh contains several 'physical entities' in one mesh, we create one region per physical entity
   m_region = Handle<Region>(m_mesh->topology().handle<Component>());
 
-  // Read file once and store positions
+  // Read file once, store positions and parse the owned elements
   get_file_positions();
-  cf3_assert(m_hash);
 
   m_mesh->initialize_nodes(0, m_mesh_dimension);
 
@@ -133,24 +299,28 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 
   fix_negative_volumes(*m_mesh);
 
+  // close the file
+  m_mapped_file.close();
+
   if (options().value<bool>("read_fields"))
   {
-    read_element_node_data();
-    read_node_data();
+    if (m_binary)
+    {
+      if (m_element_node_data_positions.size() || m_node_data_positions.size())
+        CFwarn << "Fields in binary gmsh file " << fp.string() << " are not read" << CFendl;
+    }
+    else
+    {
+      m_file.open(fp,std::ios_base::in);
+      read_element_node_data();
+      read_node_data();
+      m_file.close();
+    }
   }
 
-  m_node_idx_gmsh_to_cf.clear();
-  m_elem_idx_gmsh_to_cf.clear();
-
   // clean-up
-  m_ghost_nodes.clear();
-  m_used_nodes.clear();
   m_node_idx_gmsh_to_cf.clear();
-  if (is_not_null(m_hash))
-    remove_component(*m_hash);
-
-  // close the file
-  m_file.close();
+  m_elem_idx_gmsh_to_cf.clear();
 
   mesh.raise_mesh_loaded();
 }
@@ -159,26 +329,47 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 
 void Reader::get_file_positions()
 {
-  std::string region_names("$PhysicalNames");
-  std::string nodes("$Nodes");
-  std::string elements("$Elements");
-  std::string element_data("$ElementData");
-  std::string node_data("$NodeData");
-  std::string element_node_data("$ElementNodeData");
+  const char* begin = m_mapped_file.data();
+  const char* end = begin + m_mapped_file.size();
 
+  m_binary = false;
   m_element_data_positions.clear();
   m_node_data_positions.clear();
   m_element_node_data_positions.clear();
   m_elements_position=0;
-  std::streampos p;
-  std::string line;
-  while (!m_file.eof())
+  m_nodes_end_offset=0;
+  m_elements_end_offset=0;
+  m_mesh_dimension = options().value<Uint>("dimension");
+
+  // In ASCII files, the sections following the nodes are located by all ranks together
+  std::vector<const char*> sections;
+  bool sections_located = false;
+  Uint next_section = 0;
+
+  const char* p = find_section(begin,begin,end);
+  while (p != end)
   {
-    p = m_file.tellg();
-    getline(m_file,line);
-    if (line.find(region_names)!=std::string::npos) {
-      m_region_names_position=p;
-      m_file >> m_nb_regions;
+    AsciiParser parser(p,end);
+    const std::string section = parser.next_word();
+    parser.skip_line();
+
+    if (section == "$MeshFormat")
+    {
+      parser.next_word(); // version
+      m_binary = parser.next_uint() == 1;
+      if (parser.next_uint() != sizeof(double))
+        throw ParsingFailed(FromHere(),"Only gmsh files with a data size of "+to_str(sizeof(double))+" are supported");
+      parser.skip_line();
+      if (m_binary)
+      {
+        if (read_binary<int>(parser.position) != 1)
+          throw ParsingFailed(FromHere(),"Binary gmsh file was written on a machine with a different endianness");
+      }
+    }
+    else if (section == "$PhysicalNames")
+    {
+      m_region_names_position=p-begin;
+      m_nb_regions = parser.next_uint();
       m_region_list.resize(m_nb_regions);
 
       m_nb_gmsh_elem_in_region.resize(m_nb_regions);
@@ -189,13 +380,11 @@ void Reader::get_file_positions()
            (m_nb_gmsh_elem_in_region[ir])[type] = 0;
       }
 
-      m_mesh_dimension = options().value<Uint>("dimension");
       for(Uint ir = 0; ir < m_nb_regions; ++ir)
       {
-        Uint phys_group_dimensionality;
-        Uint phys_group_index;
-        std::string phys_group_name;
-        m_file >> phys_group_dimensionality >> phys_group_index >> phys_group_name;
+        const Uint phys_group_dimensionality = parser.next_uint();
+        const Uint phys_group_index = parser.next_uint();
+        const std::string phys_group_name = parser.next_word();
         m_region_list[phys_group_index-1].dim=phys_group_dimensionality;
         m_region_list[phys_group_index-1].index=phys_group_index;
         //The original name of the region in the mesh file has quotes, we want to strip them off
@@ -204,62 +393,234 @@ void Reader::get_file_positions()
         m_mesh_dimension = std::max(m_region_list[phys_group_index-1].dim,m_mesh_dimension);
       }
     }
-    else if (line.find(nodes)!=std::string::npos) {
-      m_coordinates_position=p;
-      m_file >> m_total_nb_nodes;
-//      CFinfo << "The total number of nodes is " << m_total_nb_nodes << CFendl;
-      if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
-    }
-    else if (line.find(elements)!=std::string::npos)
+    else if (section == "$Nodes")
     {
-      m_elements_position = p;
-      m_file >> m_total_nb_elements;
-//      CFinfo << "The total number of elements is " << m_total_nb_elements << CFendl;
-      if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
-      //Create a hash
-      m_hash = create_component<MergedParallelDistribution>("hash");
-      std::vector<Uint> num_obj(2);
-      num_obj[0] = m_total_nb_nodes;
-      num_obj[1] = m_total_nb_elements;
-      m_hash->options().set("nb_parts",options().value<Uint>("nb_parts"));
-      m_hash->options().set("nb_obj",num_obj);
-
-
-      Uint elem_idx, elem_type, nb_tags, phys_tag;
-
-      //Let's count how many elements of each type are present
-      for(Uint ie = 0; ie < m_total_nb_elements; ++ie)
+      m_coordinates_position=p-begin;
+      m_total_nb_nodes = parser.next_uint();
+      if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+      parser.skip_line();
+      m_first_node_offset = parser.position-begin;
+      // skip the binary data, which may contain '$' characters
+      if (m_binary)
+      {
+        parser.position += m_total_nb_nodes*binary_node_size;
+      }
+      else if (!sections_located)
       {
-          m_file >> elem_idx;
-          m_file >> elem_type;
-          m_file >> nb_tags;
-          m_file >> phys_tag;
-          cf3_assert(phys_tag > 0);
-          getline(m_file,line);
-          if (m_hash->subhash(ELEMS).owns(ie))
-            (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
-          m_region_list[phys_tag-1].element_types.insert(elem_type);
+        // searching the rest of the file for sections would read the nodes and elements of all ranks
+        sections = find_ascii_sections(parser.position);
+        sections_located = true;
       }
     }
-    else if (line.find(element_data)!=std::string::npos)
+    else if (section == "$EndNodes")
     {
-      m_element_data_positions.push_back(p);
+      m_nodes_end_offset = p-begin;
     }
-    else if (line.find(node_data)!=std::string::npos)
+    else if (section == "$Elements")
     {
-      m_node_data_positions.push_back(p);
+      m_elements_position = p-begin;
+      m_total_nb_elements = parser.next_uint();
+      if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
+      parser.skip_line();
+
+      m_first_element_offset = parser.position-begin;
+      if (m_binary)
+        read_owned_binary_elements(parser.position);
     }
-    else if (line.find(element_node_data)!=std::string::npos)
+    else if (section == "$EndElements")
     {
-      m_element_node_data_positions.push_back(p);
+      m_elements_end_offset = p-begin;
+      if (!m_binary)
+        read_owned_ascii_elements(begin+m_first_element_offset,p);
+    }
+    else if (section == "$ElementData" || section == "$NodeData" || section == "$ElementNodeData")
+    {
+      if (section == "$ElementData")
+        m_element_data_positions.push_back(p-begin);
+      else if (section == "$NodeData")
+        m_node_data_positions.push_back(p-begin);
+      else
+        m_element_node_data_positions.push_back(p-begin);
+
+      // skip the binary data, which may contain '$' characters
+      if (m_binary)
+      {
+        const std::string end_section = "\n$End"+section.substr(1);
+        parser.position = std::search(parser.position,end,end_section.begin(),end_section.end());
+      }
     }
 
+    if (!sections_located)
+      p = find_section(begin,parser.position,end);
+    else
+      p = next_section < sections.size() ? sections[next_section++] : end;
   }
   if (m_elements_position==0)
   {
     throw ParsingFailed(FromHere(),"File does not contain any elements");
   }
-  m_file.clear();
+  if (m_nodes_end_offset==0 || m_elements_end_offset==0)
+  {
+    throw ParsingFailed(FromHere(),"File does not contain the end of the nodes or elements section");
+  }
+
+  gather_element_types();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::vector<const char*> Reader::find_ascii_sections(const char* first)
+{
+  const char* begin = m_mapped_file.data();
+  const char* end = begin + m_mapped_file.size();
+
+  // Each rank searches an equal part of the bytes. A section keyword is found by the rank whose part contains the '$'.
+  const char* search_begin;
+  const char* search_end;
+  byte_chunk(first,end,reading_rank(),nb_reading_ranks(),search_begin,search_end);
+  std::vector<boost::uint64_t> local_offsets;
+  for (const char* p = find_section(begin, search_begin, search_end); p != search_end; p = find_section(begin, p+1, search_end))
+    local_offsets.push_back(p-begin);
+
+  std::vector<std::vector<boost::uint64_t> > offsets(1,local_offsets);
+  if (is_parallel())
+    PE::Comm::instance().all_gather(local_offsets,offsets);
+
+  // the parts are in file order, so the sections are too
+  std::vector<const char*> sections;
+  boost_foreach(const std::vector<boost::uint64_t>& rank_offsets, offsets)
+    boost_foreach(const boost::uint64_t offset, rank_offsets)
+      sections.push_back(begin+offset);
+  return sections;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_owned_binary_elements(const char*& position)
+{
+  const char* begin = m_mapped_file.data();
+
+  // The binary data consists of blocks of elements with the same type and number of tags. Only the block headers are read to
+  // find the end of the data, then each rank reads the records that start in its part of the bytes, as for ASCII files.
+  std::vector<BinaryElementBlock> blocks;
+  Uint nb_elements = 0;
+  while (nb_elements < m_total_nb_elements)
+  {
+    BinaryElementBlock block;
+    block.elem_type = read_binary<int>(position);
+    block.nb_elems = read_binary<int>(position);
+    block.nb_tags = read_binary<int>(position);
+    if (block.elem_type == 0 || block.elem_type >= Shared::nb_gmsh_types || block.nb_tags == 0)
+      throw ParsingFailed(FromHere(),"Invalid element block in binary gmsh file");
+    block.record_size = (1+block.nb_tags+Shared::m_nodes_in_gmsh_elem[block.elem_type])*sizeof(int);
+    block.data = position;
+    position += static_cast<std::size_t>(block.nb_elems)*block.record_size;
+    nb_elements += block.nb_elems;
+    blocks.push_back(block);
+  }
+
+  const char* chunk_begin;
+  const char* chunk_end;
+  byte_chunk(begin+m_first_element_offset,position,reading_rank(),nb_reading_ranks(),chunk_begin,chunk_end);
+
+  m_owned_elements.clear();
+
+  boost_foreach(const BinaryElementBlock& block, blocks)
+  {
+    const Uint elem_type = block.elem_type;
+    const Uint nb_elem_nodes = Shared::m_nodes_in_gmsh_elem[elem_type];
+    const Uint record_begin = first_record_at(block.data,block.nb_elems,block.record_size,chunk_begin);
+    const Uint record_end = first_record_at(block.data,block.nb_elems,block.record_size,chunk_end);
+    for (Uint i=record_begin; i<record_end; ++i)
+    {
+      const char* record = block.data + static_cast<std::size_t>(i)*block.record_size;
+      const Uint elem_number = read_binary<int>(record);
+      const Uint phys_tag = read_binary<int>(record);
+      cf3_assert(phys_tag > 0);
+      record += (block.nb_tags-1)*sizeof(int);
+
+      m_owned_elements.push_back(elem_number);
+      m_owned_elements.push_back(elem_type);
+      m_owned_elements.push_back(phys_tag);
+      for (Uint n=0; n<nb_elem_nodes; ++n)
+        m_owned_elements.push_back(read_binary<int>(record));
+
+      (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
+      m_region_list[phys_tag-1].element_types.insert(elem_type);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_owned_ascii_elements(const char* first, const char* last)
+{
+  // The lines of the other ranks are never read
+  const char* chunk_begin;
+  const char* chunk_end;
+  ascii_chunk(first,last,reading_rank(),nb_reading_ranks(),chunk_begin,chunk_end);
+
+  m_owned_elements.clear();
+
+  Uint nb_owned_elements = 0;
+  AsciiParser parser(chunk_begin,last);
+  while (true)
+  {
+    parser.skip_whitespace();
+    if (parser.position >= chunk_end)
+      break;
+
+    const Uint elem_number = parser.next_uint();
+    const Uint elem_type = parser.next_uint();
+    const Uint nb_tags = parser.next_uint();
+    if (elem_type == 0 || elem_type >= Shared::nb_gmsh_types || nb_tags == 0)
+      throw ParsingFailed(FromHere(),"Invalid element "+to_str(elem_number)+" in gmsh file");
+    const Uint phys_tag = parser.next_uint();
+    cf3_assert(phys_tag > 0);
+    // other tags can be negative, e.g. partition tags of ghost elements
+    for(Uint itag = 0; itag < (nb_tags-1); ++itag)
+      parser.next_word();
+
+    const Uint nb_elem_nodes = Shared::m_nodes_in_gmsh_elem[elem_type];
+    m_owned_elements.push_back(elem_number);
+    m_owned_elements.push_back(elem_type);
+    m_owned_elements.push_back(phys_tag);
+    for (Uint n=0; n<nb_elem_nodes; ++n)
+      m_owned_elements.push_back(parser.next_uint());
+    parser.skip_line();
+    ++nb_owned_elements;
+
+    (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
+    m_region_list[phys_tag-1].element_types.insert(elem_type);
+  }
+
+  Uint nb_elements = nb_owned_elements;
+  if (is_parallel())
+    PE::Comm::instance().all_reduce(PE::plus(),&nb_owned_elements,1,&nb_elements);
+  if (nb_elements != m_total_nb_elements)
+    throw ParsingFailed(FromHere(),"Found "+to_str(nb_elements)+" elements in gmsh file, expected "+to_str(m_total_nb_elements));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::gather_element_types()
+{
+  // Every rank creates the same element components, also for the element types it does not own
+  if (is_parallel())
+  {
+    std::vector<Uint> local_types(m_nb_regions*Shared::nb_gmsh_types,0);
+    for(Uint ir = 0; ir < m_nb_regions; ++ir)
+      boost_foreach(const Uint etype, m_region_list[ir].element_types)
+        local_types[ir*Shared::nb_gmsh_types+etype] = 1;
+
+    std::vector<Uint> global_types(local_types.size());
+    PE::Comm::instance().all_reduce(PE::max(),local_types,global_types);
+
+    for(Uint ir = 0; ir < m_nb_regions; ++ir)
+      for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
+        if (global_types[ir*Shared::nb_gmsh_types+etype])
+          m_region_list[ir].element_types.insert(etype);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -286,214 +647,206 @@ Handle< Region > Reader::create_region(std::string const& relative_path)
 void Reader::find_used_nodes()
 {
   m_used_nodes.clear();
-  std::string line;
+  m_used_nodes.reserve(m_owned_elements.size());
 
-  m_file.seekg(m_elements_position,std::ios::beg);
-  // skip next line
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  //Skip the line containing the actual number of elements
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_elems = " << line << std::endl;
-
-  // read every line and store the connectivity in the correct region through the buffer
-  Uint elementNumber, elementType, nbElementNodes;
-  Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
-
-  std::set<Uint>::iterator it=m_used_nodes.begin();
-
-//  if (PE::Comm::instance().rank()==IO_rank)
-//  {
-//    std::cout << "nb_obj = "   << m_hash->subhash(ELEMS).options()["nb_obj"].value<Uint>() << std::endl;
-//    std::cout << "nb_parts = " <<m_hash->subhash(ELEMS).options()["nb_parts"].value<Uint>() << std::endl;
-//  }
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  Uint idx = 0;
+  while (idx < m_owned_elements.size())
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//    }
-
-    cf3_assert(m_hash);
-    if (m_hash->subhash(ELEMS).owns(i))
-    {
-      // element description
-      m_file >> elementNumber >> elementType;
-      nbElementNodes = Shared::m_nodes_in_gmsh_elem[elementType];
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << i << ":  elem["<<m_hash->subhash(ELEMS).part_of_obj(i)<<"] " << elementNumber << " :    ";
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-      for (Uint j=0; j<nbElementNodes; ++j)
-      {
-        m_file >> gmsh_node_number;
-        it = m_used_nodes.insert(it,gmsh_node_number);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number;
-      }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "\n";
-    }
-    getline(m_file,line); // finnish the line
+    const Uint nb_elem_nodes = Shared::m_nodes_in_gmsh_elem[m_owned_elements[idx+1]];
+    m_used_nodes.insert(m_used_nodes.end(),m_owned_elements.begin()+idx+3,m_owned_elements.begin()+idx+3+nb_elem_nodes);
+    idx += 3+nb_elem_nodes;
   }
 
-  // Now we have all nodes, used by the elements
+  std::sort(m_used_nodes.begin(),m_used_nodes.end());
+  m_used_nodes.erase(std::unique(m_used_nodes.begin(),m_used_nodes.end()),m_used_nodes.end());
+}
 
-  // Now add owned nodes
-  m_file.seekg(m_coordinates_position,std::ios::beg);
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_nodes = " << line << std::endl;
+//////////////////////////////////////////////////////////////////////////////
 
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+void Reader::read_coordinates()
+{
+  const char* begin = m_mapped_file.data();
+  const char* end = begin + m_mapped_file.size();
+
+  const bool parallel = is_parallel();
+  const Uint rank = reading_rank();
+  const Uint nb_ranks = nb_reading_ranks();
+
+  // First find the owned nodes. Only the node numbers are parsed in this pass, the coordinates are parsed afterwards
+  // from the stored positions.
+  std::vector<Uint> gmsh_node_numbers;
+  std::vector<const char*> coordinates_positions;
+  if (m_binary)
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if (node_idx == m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-
-    std::stringstream ss(line);
-    ss >> gmsh_node_number;
-    getline(ss,line);
-    if (m_hash->subhash(NODES).owns(node_idx))
+    // Binary records have a fixed size, so the owned records are accessed directly
+    const char* first = begin + m_first_node_offset;
+    const char* chunk_begin;
+    const char* chunk_end;
+    byte_chunk(first,first+static_cast<std::size_t>(m_total_nb_nodes)*binary_node_size,rank,nb_ranks,chunk_begin,chunk_end);
+    const Uint node_begin = first_record_at(first,m_total_nb_nodes,binary_node_size,chunk_begin);
+    const Uint node_end = first_record_at(first,m_total_nb_nodes,binary_node_size,chunk_end);
+    gmsh_node_numbers.reserve(node_end-node_begin);
+    coordinates_positions.reserve(node_end-node_begin);
+    for (Uint node_idx=node_begin; node_idx<node_end; ++node_idx)
     {
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "node " << gmsh_node_number << "\n";
-
-      it = m_used_nodes.insert(it,gmsh_node_number);
+      const char* record = first + static_cast<std::size_t>(node_idx)*binary_node_size;
+      gmsh_node_numbers.push_back(read_binary<int>(record));
+      coordinates_positions.push_back(record);
     }
-    else
+  }
+  else
+  {
+    // The lines of the other ranks are never read
+    const char* chunk_begin;
+    const char* chunk_end;
+    ascii_chunk(begin+m_first_node_offset,begin+m_nodes_end_offset,rank,nb_ranks,chunk_begin,chunk_end);
+    AsciiParser parser(chunk_begin,end);
+    while (true)
     {
-      it = m_used_nodes.find(gmsh_node_number);
-      if (it != m_used_nodes.end())
-      {
-        m_ghost_nodes.insert(node_idx);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "ghostnode " << gmsh_node_number << "\n";
-      }
+      parser.skip_whitespace();
+      if (parser.position >= chunk_end)
+        break;
+      gmsh_node_numbers.push_back(parser.next_uint());
+      coordinates_positions.push_back(parser.position);
+      parser.skip_line();
     }
+
+    const Uint nb_owned_nodes = gmsh_node_numbers.size();
+    Uint nb_nodes = nb_owned_nodes;
+    if (parallel)
+      PE::Comm::instance().all_reduce(PE::plus(),&nb_owned_nodes,1,&nb_nodes);
+    if (nb_nodes != m_total_nb_nodes)
+      throw ParsingFailed(FromHere(),"Found "+to_str(nb_nodes)+" nodes in gmsh file, expected "+to_str(m_total_nb_nodes));
   }
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << std::flush;
-}
 
-//////////////////////////////////////////////////////////////////////////////
+  const Uint nb_owned_nodes = gmsh_node_numbers.size();
+  m_node_idx_gmsh_to_cf.clear();
+  m_node_idx_gmsh_to_cf.rehash(nb_owned_nodes+m_used_nodes.size());
+  for (Uint node=0; node<nb_owned_nodes; ++node)
+    m_node_idx_gmsh_to_cf[gmsh_node_numbers[node]] = node;
 
-void Reader::read_coordinates()
-{
+  // The owned elements can also use nodes that were read by other ranks
+  std::vector<Uint> missing_nodes;
+  boost_foreach(const Uint gmsh_node_number, m_used_nodes)
+  {
+    if (m_node_idx_gmsh_to_cf.find(gmsh_node_number) == m_node_idx_gmsh_to_cf.end())
+      missing_nodes.push_back(gmsh_node_number);
+  }
+  m_used_nodes.clear();
 
-  m_file.seekg(m_coordinates_position,std::ios::beg);
+  std::vector<Uint> ghost_numbers;
+  std::vector<Uint> ghost_ranks;
+  std::vector<Real> ghost_coordinates;
+  if (parallel)
+    receive_ghost_nodes(gmsh_node_numbers,coordinates_positions,missing_nodes,ghost_numbers,ghost_ranks,ghost_coordinates);
+  if (ghost_numbers.size() != missing_nodes.size())
+    throw ParsingFailed(FromHere(),"Elements in gmsh file use "+to_str(missing_nodes.size()-ghost_numbers.size())+" nodes that are not in the file");
 
   Dictionary& nodes = m_mesh->geometry_fields();
-  nodes.resize(m_used_nodes.size());
-  m_used_nodes.clear();
+  nodes.resize(nb_owned_nodes+ghost_numbers.size());
 
-  Uint part = options().value<Uint>("part");
-
-  std::string line;
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
+  for (Uint node=0; node<nb_owned_nodes; ++node)
+  {
+    read_node_coordinates(coordinates_positions[node],end,m_binary,m_mesh_dimension,nodes.coordinates()[node]);
+    nodes.rank()[node] = rank;
+    nodes.glb_idx()[node] = gmsh_node_numbers[node]-1;
+  }
 
+  for (Uint ghost=0; ghost<ghost_numbers.size(); ++ghost)
+  {
+    const Uint node = nb_owned_nodes+ghost;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[node][dim] = ghost_coordinates[ghost*m_mesh_dimension+dim];
+    nodes.rank()[node] = ghost_ranks[ghost];
+    nodes.glb_idx()[node] = ghost_numbers[ghost]-1;
+    m_node_idx_gmsh_to_cf[ghost_numbers[ghost]] = node;
+  }
+}
 
-  // declare and allocate one coordinate row
-//  std::vector<Real> rowVector(m_mesh_dimension);
+//////////////////////////////////////////////////////////////////////////////
 
-  std::set<Uint>::const_iterator it;
+void Reader::receive_ghost_nodes(const std::vector<Uint>& owned_numbers, const std::vector<const char*>& owned_positions,
+                                 const std::vector<Uint>& missing_numbers,
+                                 std::vector<Uint>& ghost_numbers, std::vector<Uint>& ghost_ranks, std::vector<Real>& ghost_coordinates)
+{
+  const char* end = m_mapped_file.data() + m_mapped_file.size();
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_ranks = PE::Comm::instance().size();
+
+  // Nodes are usually numbered in increasing order, so each rank owns a range of node numbers and a request only has
+  // to be sent to the owner of that range. Otherwise each request is sent to all other ranks.
+  std::vector<Uint> local_range(3,0); // first number, last number, sorted
+  if (owned_numbers.size())
+  {
+    local_range[0] = *std::min_element(owned_numbers.begin(),owned_numbers.end());
+    local_range[1] = *std::max_element(owned_numbers.begin(),owned_numbers.end());
+    local_range[2] = std::adjacent_find(owned_numbers.begin(),owned_numbers.end(),std::greater_equal<Uint>()) == owned_numbers.end();
+  }
+  std::vector<Uint> ranges(3*nb_ranks);
+  PE::Comm::instance().all_gather(local_range,ranges);
 
-  Uint coord_idx=0;
-  Uint gmsh_node_number;
+  std::vector<Uint> range_owners;
+  std::vector<Uint> range_ends;
+  bool ranges_ordered = true;
+  for (Uint r=0; r<nb_ranks && ranges_ordered; ++r)
+  {
+    if (ranges[3*r+1] == 0) // no owned nodes, gmsh numbers start at 1
+      continue;
+    ranges_ordered = ranges[3*r+2] && (range_ends.empty() || ranges[3*r] > range_ends.back());
+    range_owners.push_back(r);
+    range_ends.push_back(ranges[3*r+1]);
+  }
 
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+  std::vector<std::vector<Uint> > requests(nb_ranks);
+  boost_foreach(const Uint gmsh_node_number, missing_numbers)
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if(node_idx==m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-//    CFinfo << line << CFendl;
-    if (m_hash->subhash(NODES).owns(node_idx))
+    if (ranges_ordered)
     {
-      std::stringstream ss(line);
-      ss >> gmsh_node_number;
-      m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-      for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-      if(m_mesh_dimension < DIM_3D) getline(ss,line); //Gmsh always stores 3 coordinates, even for 2D meshes
-
-      nodes.rank()[coord_idx] = part;
-      nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-      coord_idx++;
+      const Uint range = std::lower_bound(range_ends.begin(),range_ends.end(),gmsh_node_number) - range_ends.begin();
+      if (range < range_owners.size())
+        requests[range_owners[range]].push_back(gmsh_node_number);
     }
     else
     {
-      it = m_ghost_nodes.find(node_idx);
-      if (it != m_ghost_nodes.end())
-      {
-        std::stringstream ss(line);
-        ss >> gmsh_node_number;
-        m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-        for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-        if(m_mesh_dimension < DIM_3D) getline(ss, line);
-
-        nodes.rank()[coord_idx] = m_hash->subhash(NODES).part_of_obj(node_idx);
-        nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-        coord_idx++;
-      }
+      for (Uint r=0; r<nb_ranks; ++r)
+        if (r != rank)
+          requests[r].push_back(gmsh_node_number);
     }
+  }
 
+  std::vector<std::vector<Uint> > received_requests;
+  PE::Comm::instance().all_to_all(requests,received_requests);
 
-  } //loop over nodes
-
+  // Reply with the requested nodes that were read by this rank
+  std::vector<std::vector<Uint> > found_numbers(nb_ranks);
+  std::vector<std::vector<Real> > found_coordinates(nb_ranks);
+  for (Uint r=0; r<nb_ranks; ++r)
+  {
+    boost_foreach(const Uint gmsh_node_number, received_requests[r])
+    {
+      boost::unordered_map<Uint,Uint>::const_iterator owned = m_node_idx_gmsh_to_cf.find(gmsh_node_number);
+      if (owned == m_node_idx_gmsh_to_cf.end())
+        continue;
+      found_numbers[r].push_back(gmsh_node_number);
+      found_coordinates[r].resize(found_coordinates[r].size()+m_mesh_dimension);
+      read_node_coordinates(owned_positions[owned->second],end,m_binary,m_mesh_dimension,&found_coordinates[r][found_coordinates[r].size()-m_mesh_dimension]);
+    }
+  }
 
+  std::vector<std::vector<Uint> > received_numbers;
+  std::vector<std::vector<Real> > received_coordinates;
+  PE::Comm::instance().all_to_all(found_numbers,received_numbers);
+  PE::Comm::instance().all_to_all(found_coordinates,received_coordinates);
 
-  /*
-  CFinfo << "Printing all nodal coordinates:" << CFendl;
-  for(Uint i = 0; i < m_total_nb_nodes; ++i)
+  ghost_numbers.clear();
+  ghost_ranks.clear();
+  ghost_coordinates.clear();
+  for (Uint r=0; r<nb_ranks; ++r)
   {
-      CFinfo << "\t";
-      for(Uint dim = 0; dim < m_mesh_dimension; ++dim)
-        {
-            CFinfo << nodes.coordinates()[i][dim] << " ";
-        }
-      CFinfo << CFendl;
+    ghost_numbers.insert(ghost_numbers.end(),received_numbers[r].begin(),received_numbers[r].end());
+    ghost_ranks.insert(ghost_ranks.end(),received_numbers[r].size(),r);
+    ghost_coordinates.insert(ghost_coordinates.end(),received_coordinates[r].begin(),received_coordinates[r].end());
   }
-  */
-
-  getline(m_file,line);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -504,7 +857,7 @@ void Reader::read_connectivity()
   Dictionary& nodes = m_mesh->geometry_fields();
 
 
-  Uint part = options().value<Uint>("part");
+  const Uint rank = reading_rank();
 
   //Each entry of this vector holds a map (gmsh_type_idx, pointer to connectivity table of this gmsh type).
  //Each row corresponds to one region of the mesh
@@ -517,11 +870,8 @@ void Reader::read_connectivity()
 
  std::map<Uint, Entities*>::iterator elem_table_iter;
 
-// std::vector<std::map<std::string,Handle< Elements > > > elements(m_nb_regions);
-// std::vector<std::map<std::string,Handle< Connectivity::Buffer > > > buffer(m_nb_regions);
-
-
  m_elem_idx_gmsh_to_cf.clear();
+ m_elem_idx_gmsh_to_cf.rehash(m_owned_elements.size()/4);
  //Loop over all regions and allocate a connectivity table of proper size for each element type that
  //is present in each region. Counting of elements was done during the first pass in the function
  //get_file_positions
@@ -530,10 +880,6 @@ void Reader::read_connectivity()
    // create new region
    Handle< Region > region = m_region_list[ir].region;
 
-//   elements[ir] = create_cells_in_region(*region,m_mesh->geometry_fields(),m_supported_types);
-//   buffer[ir] = create_connectivity_buffermap(elements[ir]);
-
-
    // Take the gmsh element types present in this region and generate new names of elements which correspond
    // to coolfuid naming:
    for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
@@ -563,92 +909,38 @@ void Reader::read_connectivity()
    }
  }
 
-   std::string etype_CF;
-   std::set<Uint>::const_iterator it;
-   std::vector<Uint> cf_element;
-   Uint element_number, gmsh_element_type, nb_element_nodes;
-   Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
-   Uint cf_node_number;
-   Uint cf_idx;
-
-   m_file.seekg(m_elements_position,std::ios::beg);
-   // skip next line
-   std::string line;
-   //Re-read the line that contains the keyword '$Elements':
-   getline(m_file,line);
-   //Parse the following line (containing the actual number of elements)
-   getline(m_file,line);
-
    for(Uint ir = 0; ir < m_nb_regions; ++ir)
      for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
       (m_nb_gmsh_elem_in_region[ir])[etype] = 0;
 
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  // The owned elements were stored in the first pass, as element number, type, physical tag and nodes
+  Uint idx = 0;
+  while (idx < m_owned_elements.size())
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//      if(i==m_total_nb_elements-1)
-//        CFinfo << CFendl;
-//    }
+    const Uint element_number = m_owned_elements[idx];
+    const Uint gmsh_element_type = m_owned_elements[idx+1];
+    const Uint phys_tag = m_owned_elements[idx+2];
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
+    idx += 3;
 
-    // element description
-    m_file >> element_number >> gmsh_element_type;
+    elem_table_iter = conn_table_idx[phys_tag-1].find(gmsh_element_type);
+    const Uint row_idx = (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type];
 
-    nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
+    Handle< Elements > elements_region = Handle<Elements>(elem_table_iter->second->handle<Component>());
+    Connectivity::Row element_nodes = elements_region->geometry_space().connectivity()[row_idx];
 
-    // get element nodes
-    if (m_hash->subhash(ELEMS).owns(i))
-    {
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-//      CFinfo << "Reading element " << element_number << " of type " << gmsh_element_type;
-//      CFinfo << " in region " << phys_tag << " with " << nb_element_nodes << " nodes " << CFendl;
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << element_number << "   -->   ";
-
-      cf_element.resize(nb_element_nodes);
-      for (Uint j=0; j<nb_element_nodes; ++j)
-      {
-        cf_idx = Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j];
-        m_file >> gmsh_node_number;
-        cf_node_number = m_node_idx_gmsh_to_cf[gmsh_node_number];
-        cf_element[cf_idx] = cf_node_number;
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number << "("<<m_node_idx_gmsh_to_cf[gmsh_node_number]<<")";
-      }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << std::endl;
-
-      elem_table_iter = conn_table_idx[phys_tag-1].find(gmsh_element_type);
-      const Uint row_idx = (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type];
+    m_elem_idx_gmsh_to_cf[element_number] = std::make_pair( elements_region , row_idx);
 
-      Handle< Elements > elements_region = Handle<Elements>(elem_table_iter->second->handle<Component>());
-      Connectivity::Row element_nodes = elements_region->geometry_space().connectivity()[row_idx];
+    for (Uint j=0; j<nb_element_nodes; ++j)
+      element_nodes[Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j]] = m_node_idx_gmsh_to_cf[m_owned_elements[idx+j]];
+    idx += nb_element_nodes;
 
-      m_elem_idx_gmsh_to_cf[element_number] = std::make_pair( elements_region , row_idx);
-
-      for(Uint node = 0; node < nb_element_nodes; ++node)
-      {
-         element_nodes[node] = cf_element[node];
-      }
-
-      elements_region->rank()[row_idx] = part;
-      elements_region->glb_idx()[row_idx] = element_number-1;
-
-      (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type]++;
-
-    }
+    elements_region->rank()[row_idx] = rank;
+    elements_region->glb_idx()[row_idx] = element_number-1;
 
-    // finish the line
-    getline(m_file,line);
+    (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type]++;
   }
-  getline(m_file,line);  // ENDOFSECTION
+  std::vector<Uint>().swap(m_owned_elements);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -724,7 +1016,7 @@ void Reader::read_element_node_data()
         Handle< Space > space;
         Uint d,n;
         std::vector<Real> data(gmsh_field.var_types[var]);
-        std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it;
+        boost::unordered_map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it;
         for (Uint e=0; e<gmsh_field.nb_entries; ++e)
         {
           m_file >> gmsh_elem_idx >> gmsh_nb_elem_nodes;
@@ -822,7 +1114,7 @@ void Reader::read_element_data()
           for (d=0; d<data.size(); ++d)
             m_file >> data[d];
 
-          std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
+          boost::unordered_map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
           if (it != m_elem_idx_gmsh_to_cf.end())
           {
             boost::tie(elements,cf_idx) = it->second;
@@ -892,7 +1184,7 @@ void Reader::read_node_data()
         for (d=0; d<data.size(); ++d)
           m_file >> data[d];
 
-        std::map<Uint, Uint>::iterator it = m_node_idx_gmsh_to_cf.find(gmsh_node_idx);
+        boost::unordered_map<Uint, Uint>::iterator it = m_node_idx_gmsh_to_cf.find(gmsh_node_idx);
         if (it != m_node_idx_gmsh_to_cf.end())
         {
           cf_idx = it->second;
@@ -11,6 +11,8 @@
 
 #include <set>
 #include <boost/tuple/tuple.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "mesh/MeshReader.hpp"
 
@@ -24,7 +26,6 @@ namespace mesh {
 
 class Elements;
 class Region;
-class MergedParallelDistribution;
 class Dictionary;
 
 class Mesh;
@@ -34,6 +35,13 @@ namespace gmsh {
 //////////////////////////////////////////////////////////////////////////////
 
 /// This class defines gmsh mesh format reader
+/// The file is memory-mapped. A first pass locates the sections and parses only the chunk of elements owned by this rank,
+/// a second pass parses only the chunk of owned nodes. Nodes of other ranks that are used by the owned elements are
+/// requested from the ranks that read them. No rank ever holds, nor reads, the complete mesh.
+/// The chunks are equal byte ranges of the element and node sections, one per rank of the communicator. A line of an
+/// ASCII file, or a record of a binary file, belongs to the rank whose range contains its start.
+/// Both the ASCII and the binary variant of the format (version 2.2) are supported.
+/// Fields can only be read from ASCII files.
 /// @author Willem Deconinck
 /// @author Martin Vymazal
 class gmsh_API Reader : public MeshReader, public Shared
@@ -53,12 +61,24 @@ private: // functions
 
   void get_file_positions();
 
+  std::vector<const char*> find_ascii_sections(const char* first);
+
+  void read_owned_binary_elements(const char*& position);
+
+  void read_owned_ascii_elements(const char* first, const char* last);
+
+  void gather_element_types();
+
   Handle<Region> create_region(std::string const& relative_path);
 
   void find_used_nodes();
 
   void read_coordinates();
 
+  void receive_ghost_nodes(const std::vector<Uint>& owned_numbers, const std::vector<const char*>& owned_positions,
+                           const std::vector<Uint>& missing_numbers,
+                           std::vector<Uint>& ghost_numbers, std::vector<Uint>& ghost_ranks, std::vector<Real>& ghost_coordinates);
+
   void read_connectivity();
 
   void read_element_node_data();
@@ -71,14 +91,13 @@ private: // data
 
   virtual void do_read_mesh_into(const common::URI& fp, Mesh& mesh);
 
-  enum HashType { NODES=0, ELEMS=1 };
-  Handle<MergedParallelDistribution> m_hash;
-
   // map< gmsh index , pair< elements, index in elements > >
-  std::map<Uint, std::pair<Handle<Elements>,Uint> > m_elem_idx_gmsh_to_cf;
-  std::map<Uint, Uint> m_node_idx_gmsh_to_cf;
+  boost::unordered_map<Uint, std::pair<Handle<Elements>,Uint> > m_elem_idx_gmsh_to_cf;
+  boost::unordered_map<Uint, Uint> m_node_idx_gmsh_to_cf;
 
+  boost::iostreams::mapped_file_source m_mapped_file;
   boost::filesystem::fstream m_file;
+  bool m_binary;
   Handle<Mesh> m_mesh;
   Handle<Region> m_region;
 
@@ -100,9 +119,11 @@ private: // data
 
   std::vector<RegionData> m_region_list;
 
-  std::set<Uint> m_ghost_nodes;
-  //std::set<Uint> m_ghost_elems;
-  std::set<Uint> m_used_nodes;
+  // sorted gmsh numbers of the nodes used by the owned elements
+  std::vector<Uint> m_used_nodes;
+
+  // owned elements, in file order: gmsh number, gmsh type, physical tag, followed by the gmsh node numbers
+  std::vector<Uint> m_owned_elements;
   
   std::vector<std::set<Uint> > m_node_to_glb_elements;
 
@@ -110,6 +131,10 @@ private: // data
   std::streampos m_region_names_position;
   std::streampos m_coordinates_position;
   std::streampos m_elements_position;
+  std::size_t m_first_node_offset;
+  std::size_t m_nodes_end_offset;
+  std::size_t m_first_element_offset;
+  std::size_t m_elements_end_offset;
   std::vector<std::streampos> m_element_data_positions;
   std::vector<std::streampos> m_node_data_positions;
   std::vector<std::streampos> m_element_node_data_positions;
@@ -0,0 +1,60 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "python/BoostPython.hpp"
+
+#include "common/Component.hpp"
+
+#include "python/ArrayView.hpp"
+
+namespace cf3 {
+namespace python {
+
+using namespace boost::python;
+
+ArrayView::ArrayView(const boost::shared_ptr<common::Component const>& owner, const void* data, const std::string& typestr, const tuple& shape, const bool read_only) :
+  m_owner(owner),
+  m_data(data),
+  m_typestr(typestr),
+  m_shape(shape),
+  m_read_only(read_only)
+{
+}
+
+dict ArrayView::array_interface() const
+{
+  dict result;
+  result["version"] = 3;
+  result["shape"] = m_shape;
+  result["typestr"] = m_typestr;
+  result["data"] = make_tuple(reinterpret_cast<std::size_t>(m_data), m_read_only);
+  return result;
+}
+
+object ArrayView::to_numpy(const object& dtype) const
+{
+  object numpy = import("numpy");
+
+  // Empty storage may not have a valid data pointer, and there is nothing to share anyway
+  Uint nb_elements = 1;
+  const Uint nb_dims = len(m_shape);
+  for(Uint i = 0; i != nb_dims; ++i)
+    nb_elements *= extract<Uint>(m_shape[i]);
+  if(nb_elements == 0 || m_data == 0)
+    return numpy.attr("empty")(m_shape, dtype.is_none() ? object(m_typestr) : dtype);
+
+  // The view is the base of the returned array, keeping the component alive for as long as the array exists
+  return numpy.attr("asarray")(object(*this), dtype);
+}
+
+void def_array_view()
+{
+  class_<ArrayView>("ArrayView", "Zero-copy view on the storage of a component, for use with numpy", no_init)
+    .add_property("__array_interface__", &ArrayView::array_interface);
+}
+
+} // python
+} // cf3
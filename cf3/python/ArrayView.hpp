@@ -0,0 +1,67 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef CF3_Python_ArrayView_hpp
+#define CF3_Python_ArrayView_hpp
+
+#include "python/BoostPython.hpp"
+
+#include <limits>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+namespace cf3 {
+  namespace common { class Component; }
+namespace python {
+
+/// Typestring describing ValueT in the numpy array interface, e.g. "<f8" for a double on a little endian machine
+template<typename ValueT>
+std::string array_typestr()
+{
+  if(boost::is_same<ValueT, bool>::value)
+    return "|b1";
+
+  const unsigned int one = 1;
+  const bool little_endian = *reinterpret_cast<const char*>(&one) == 1;
+  const char kind = boost::is_floating_point<ValueT>::value ? 'f' : (std::numeric_limits<ValueT>::is_signed ? 'i' : 'u');
+  return std::string(little_endian ? "<" : ">") + kind + boost::lexical_cast<std::string>(sizeof(ValueT));
+}
+
+/// Exposes the storage of a component (i.e. the data of a Table or List) to numpy through the array interface, without copying.
+/// The view keeps the component alive, but resizing the component invalidates the data pointer, so arrays obtained through
+/// the view must not be used after a resize.
+class ArrayView
+{
+public:
+  ArrayView(const boost::shared_ptr<common::Component const>& owner, const void* data, const std::string& typestr, const boost::python::tuple& shape, const bool read_only);
+
+  /// The __array_interface__ dict
+  boost::python::dict array_interface() const;
+
+  /// Numpy array sharing the data of the component, or a copy if dtype is not None and differs from the stored type
+  boost::python::object to_numpy(const boost::python::object& dtype = boost::python::object()) const;
+
+private:
+  boost::shared_ptr<common::Component const> m_owner;
+  const void* m_data;
+  std::string m_typestr;
+  boost::python::tuple m_shape;
+  bool m_read_only;
+};
+
+/// Python wrapping for the ArrayView class
+void def_array_view();
+
+} // python
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // CF3_Python_ArrayView_hpp
@@ -15,6 +15,7 @@
 
 #include "common/List.hpp"
 
+#include "python/ArrayView.hpp"
 #include "python/ComponentWrapper.hpp"
 #include "python/ListWrapper.hpp"
 #include "python/Utility.hpp"
@@ -64,6 +65,31 @@ struct ListMethods
     return out_stream.str();
   }
 
+  static ArrayView array_view(const ListT& list, const bool read_only)
+  {
+    return ArrayView(list.shared_from_this(), list.array().data(), array_typestr<ValueT>(), make_tuple(list.size()), read_only);
+  }
+
+  static object to_array(ComponentWrapper& wrapped)
+  {
+    return array_view(wrapped.component<ListT>(), false).to_numpy();
+  }
+
+  static object to_array_dtype(ComponentWrapper& wrapped, const object& dtype)
+  {
+    return array_view(wrapped.component<ListT>(), false).to_numpy(dtype);
+  }
+
+  static object to_array_const(ComponentWrapperConst& wrapped)
+  {
+    return array_view(wrapped.component<ListT const>(), true).to_numpy();
+  }
+
+  static object to_array_const_dtype(ComponentWrapperConst& wrapped, const object& dtype)
+  {
+    return array_view(wrapped.component<ListT const>(), true).to_numpy(dtype);
+  }
+
 };
 
 template<typename ValueT>
@@ -77,12 +103,16 @@ void def_clist_types()
     .def("__setitem__", ListMethods<ValueT>::set_item)
     .def("__getitem__", ListMethods<ValueT>::get_item)
     .def("__len__", ListMethods<ValueT>::len)
-    .def("__str__", ListMethods<ValueT>::to_str);
+    .def("__str__", ListMethods<ValueT>::to_str)
+    .def("__array__", ListMethods<ValueT>::to_array, "Numpy array sharing the data of the list, without copying. Resizing the list invalidates the array.")
+    .def("__array__", ListMethods<ValueT>::to_array_dtype);
 
   boost::python::class_<ListWrapperConst, boost::python::bases<ComponentWrapperConst> >(("ListConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("__getitem__", ListMethods<ValueT>::get_item)
     .def("__len__", ListMethods<ValueT>::len)
-    .def("__str__", ListMethods<ValueT>::to_str);
+    .def("__str__", ListMethods<ValueT>::to_str)
+    .def("__array__", ListMethods<ValueT>::to_array_const, "Read-only numpy array sharing the data of the list, without copying. Resizing the list invalidates the array.")
+    .def("__array__", ListMethods<ValueT>::to_array_const_dtype);
 
   ComponentWrapperRegistry::instance().register_factory< DefaultComponentWrapperFactory< common::List<ValueT> > >();
 }
@@ -6,6 +6,7 @@
 
 #include "python/BoostPython.hpp"
 
+#include "python/ArrayView.hpp"
 #include "python/ComponentFilterPython.hpp"
 #include "python/ComponentWrapper.hpp"
 #include "python/CoreWrapper.hpp"
@@ -26,6 +27,7 @@ BOOST_PYTHON_MODULE(libcoolfluid_python)
   def_component();
   def_component_filter_methods();
   def_core();
+  def_array_view();
   def_clist_types();
   def_ctable_types();
   def_math();
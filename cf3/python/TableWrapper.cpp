@@ -15,6 +15,7 @@
 
 #include "common/Table.hpp"
 
+#include "python/ArrayView.hpp"
 #include "python/ComponentWrapper.hpp"
 #include "python/TableWrapper.hpp"
 #include "python/Utility.hpp"
@@ -138,6 +139,31 @@ struct TableMethods
     out_stream << wrapped.component<TableT>();
     return out_stream.str();
   }
+
+  static ArrayView array_view(const TableT& table, const bool read_only)
+  {
+    return ArrayView(table.shared_from_this(), table.array().data(), array_typestr<ValueT>(), make_tuple(table.size(), table.row_size()), read_only);
+  }
+
+  static object to_array(ComponentWrapper& wrapped)
+  {
+    return array_view(wrapped.component<TableT>(), false).to_numpy();
+  }
+
+  static object to_array_dtype(ComponentWrapper& wrapped, const object& dtype)
+  {
+    return array_view(wrapped.component<TableT>(), false).to_numpy(dtype);
+  }
+
+  static object to_array_const(ComponentWrapperConst& wrapped)
+  {
+    return array_view(wrapped.component<TableT const>(), true).to_numpy();
+  }
+
+  static object to_array_const_dtype(ComponentWrapperConst& wrapped, const object& dtype)
+  {
+    return array_view(wrapped.component<TableT const>(), true).to_numpy(dtype);
+  }
 };
 
 template<typename ValueT>
@@ -172,13 +198,17 @@ void def_ctable_types()
     .def("__setitem__", TableMethods<ValueT>::set_item)
     .def("__getitem__", TableMethods<ValueT>::get_item)
     .def("__len__", TableMethods<ValueT>::len)
-    .def("__str__", TableMethods<ValueT>::to_str);
+    .def("__str__", TableMethods<ValueT>::to_str)
+    .def("__array__", TableMethods<ValueT>::to_array, "Numpy array sharing the data of the table, without copying. Resizing the table invalidates the array.")
+    .def("__array__", TableMethods<ValueT>::to_array_dtype);
 
   boost::python::class_<TableWrapperConst, boost::python::bases<ComponentWrapperConst> >(("TableConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("row_size", TableMethods<ValueT>::row_size, "Return the number of columns the table can hold")
     .def("__getitem__", TableMethods<ValueT>::get_item_const)
     .def("__len__", TableMethods<ValueT>::len)
-    .def("__str__", TableMethods<ValueT>::to_str);
+    .def("__str__", TableMethods<ValueT>::to_str)
+    .def("__array__", TableMethods<ValueT>::to_array_const, "Read-only numpy array sharing the data of the table, without copying. Resizing the table invalidates the array.")
+    .def("__array__", TableMethods<ValueT>::to_array_const_dtype);
 
   ComponentWrapperRegistry::instance().register_factory< DefaultComponentWrapperFactory< common::Table<ValueT> > >();
 }
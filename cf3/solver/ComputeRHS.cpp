@@ -33,7 +33,9 @@ common::ComponentBuilder < ComputeRHS, common::Action, solver::LibSolver > Compu
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ComputeRHS::ComputeRHS ( const std::string& name ) : common::Action(name)
+ComputeRHS::ComputeRHS ( const std::string& name ) :
+  common::Action(name),
+  m_block_size(32u)
 {
   options().add("rhs",m_rhs).link_to(&m_rhs)
       .description("Right-Hand-Side of equations")
@@ -41,6 +43,8 @@ ComputeRHS::ComputeRHS ( const std::string& name ) : common::Action(name)
   options().add("wave_speed",m_ws).link_to(&m_ws)
       .description("Wave speed")
       .mark_basic();
+  options().add("block_size",m_block_size).link_to(&m_block_size)
+      .description("Number of elements computed together by term computers that support block computation");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -104,6 +108,42 @@ void ComputeRHS::compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void ComputeRHS::compute_rhs_block(const Uint begin_elem, TermBlock& rhs)
+{
+  rhs.set_zero();
+  const Uint nb_elems = rhs.nb_elems();
+  m_term_block.resize(rhs.max_elems(),rhs.nb_nodes(),rhs.nb_eqs());
+  m_term_block.set_nb_elems(nb_elems);
+
+  for (Uint t=0; t<m_term_computers.size(); ++t)
+  {
+    if (m_loop_cells[t])
+    {
+      m_term_computers[t]->compute_term_block(begin_elem,m_term_block);
+      for (Uint p=0; p<rhs.nb_nodes(); ++p)
+      {
+        for (Uint eq=0; eq<rhs.nb_eqs(); ++eq)
+        {
+          Real* rhs_span = rhs.term(p,eq);
+          const Real* term_span = m_term_block.term(p,eq);
+          for (Uint e=0; e<nb_elems; ++e)
+          {
+            rhs_span[e] += term_span[e];
+          }
+        }
+        Real* ws_span = rhs.wave_speed(p);
+        const Real* term_ws_span = m_term_block.wave_speed(p);
+        for (Uint e=0; e<nb_elems; ++e)
+        {
+          ws_span[e] = std::max(ws_span[e],term_ws_span[e]);
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void ComputeRHS::compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed)
 {
   const Uint nb_eqs = rhs.row_size();
@@ -114,29 +154,41 @@ void ComputeRHS::compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed)
     {
       const Space& space = dict.space(*cells);
 
-      // Element-loop
+      // Element-loop, in blocks of consecutive non-ghost elements
       const Uint nb_elems = cells->size();
       const Uint nb_sol_pts = space.shape_function().nb_nodes();
 
-      std::vector<RealVector> elem_rhs(nb_sol_pts,RealVector(nb_eqs));
-      std::vector<Real> elem_wave_speed(nb_sol_pts);
+      m_block.resize(std::max(m_block_size,1u),nb_sol_pts,nb_eqs);
 
-      for (Uint elem_idx=0; elem_idx<nb_elems; ++elem_idx)
+      Uint begin = 0;
+      while (begin < nb_elems)
       {
-        if (cells->is_ghost(elem_idx)==false)
+        if (cells->is_ghost(begin))
         {
-          compute_rhs(elem_idx,elem_rhs,elem_wave_speed);
+          ++begin;
+          continue;
+        }
 
-          mesh::Connectivity::ConstRow nodes = space.connectivity()[elem_idx];
+        Uint end = begin+1;
+        while (end < nb_elems && end-begin < m_block.max_elems() && cells->is_ghost(end)==false)
+          ++end;
+
+        m_block.set_nb_elems(end-begin);
+        compute_rhs_block(begin,m_block);
+
+        for (Uint e=0; e<m_block.nb_elems(); ++e)
+        {
+          mesh::Connectivity::ConstRow nodes = space.connectivity()[begin+e];
           for (Uint sol_pt=0; sol_pt<nb_sol_pts; ++sol_pt)
           {
             for (Uint eq=0; eq<nb_eqs; ++eq)
             {
-              rhs[nodes[sol_pt]][eq] = elem_rhs[sol_pt][eq];
+              rhs[nodes[sol_pt]][eq] = m_block.term(sol_pt,eq)[e];
             }
-            wave_speed[nodes[sol_pt]][0] = elem_wave_speed[sol_pt];
+            wave_speed[nodes[sol_pt]][0] = m_block.wave_speed(sol_pt)[e];
           }
         }
+        begin = end;
       }
     }
   }
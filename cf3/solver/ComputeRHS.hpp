@@ -10,6 +10,7 @@
 #include "common/Action.hpp"
 #include "math/MatrixTypes.hpp"
 #include "solver/LibSolver.hpp"
+#include "solver/TermComputer.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -20,9 +21,6 @@ namespace cf3 {
     class Field;
     class Dictionary;
   }
-  namespace solver {
-    class TermComputer;
-  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,7 +54,13 @@ public:
   virtual bool loop_cells(const Handle<mesh::Entities const>& cells);
 
   /// @brief Compute the complete rhs for a given element, as well as the wave-speeds
-  virtual void compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs, std::vector<Real>& wave_speed);
+  /// Not used by compute_rhs(Field&,Field&), which computes blocks of elements through compute_rhs_block,
+  /// so it is not virtual: customize compute_rhs_block instead.
+  void compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs, std::vector<Real>& wave_speed);
+
+  /// @brief Compute the complete rhs for the rhs.nb_elems() elements starting at begin_elem, as well as the wave-speeds
+  /// Term computers without a block implementation are evaluated element by element.
+  virtual void compute_rhs_block(const Uint begin_elem, TermBlock& rhs);
 
   /// @brief Compute the complete rhs in a field, as well as wave speeds
   virtual void compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed);
@@ -71,6 +75,10 @@ private:
 
   std::vector< RealVector > m_tmp_term;
   std::vector< Real > m_tmp_ws;
+
+  Uint m_block_size;         ///! Number of elements per block
+  TermBlock m_block;         ///! Complete rhs for a block of elements
+  TermBlock m_term_block;    ///! One term for a block of elements
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -19,8 +19,47 @@ namespace solver {
   
 /////////////////////////////////////////////////////////////////////////////////////
 
+void TermBlock::resize(const Uint max_elems, const Uint nb_nodes, const Uint nb_eqs)
+{
+  if (max_elems == m_max_elems && nb_nodes == m_nb_nodes && nb_eqs == m_nb_eqs)
+    return;
+  m_max_elems = max_elems;
+  m_nb_nodes = nb_nodes;
+  m_nb_eqs = nb_eqs;
+  m_nb_elems = 0;
+  m_term.resize(max_elems*nb_nodes*nb_eqs);
+  m_wave_speed.resize(max_elems*nb_nodes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void TermBlock::set_zero()
+{
+  std::fill(m_term.begin(), m_term.end(), 0.);
+  std::fill(m_wave_speed.begin(), m_wave_speed.end(), 0.);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void TermBlock::set_element(const Uint elem, const std::vector<RealVector>& term, const std::vector<Real>& wave_speed)
+{
+  cf3_assert(elem < m_max_elems);
+  for (Uint n=0; n<m_nb_nodes; ++n)
+  {
+    cf3_assert(term[n].size() == m_nb_eqs);
+    for (Uint eq=0; eq<m_nb_eqs; ++eq)
+    {
+      this->term(n,eq)[elem] = term[n][eq];
+    }
+    this->wave_speed(n)[elem] = wave_speed[n];
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
 TermComputer::TermComputer ( const std::string& name ) 
-  : common::Action(name) 
+  : common::Action(name),
+    m_block_size(32u)
 {
   options().add("field",m_term_field).link_to(&m_term_field)
     .description("Term that will be computed")
@@ -28,6 +67,8 @@ TermComputer::TermComputer ( const std::string& name )
   options().add("term_wave_speed_field",m_term_ws).link_to(&m_term_ws)
     .description("Term wave speed that will be computed")
     .mark_basic();
+  options().add("block_size",m_block_size).link_to(&m_block_size)
+    .description("Number of elements computed together by term computers that support block computation");
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -45,30 +86,53 @@ void TermComputer::execute()
 void TermComputer::compute_term(mesh::Field& term, mesh::Field& wave_speed)
 {
   term = 0.;
+  const Uint nb_eqs = term.row_size();
   boost_foreach( const Handle<mesh::Entities const>& cells, term.entities_range() )
   {
     if (loop_cells(cells))
     {
       const mesh::Space& space = term.space(*cells);
+      const mesh::Connectivity& connectivity = space.connectivity();
       const Uint nb_elems = space.size();
       const Uint nb_nodes_per_elem = space.shape_function().nb_nodes();
-      for (Uint e=0; e<nb_elems; ++e)
+      m_block.resize(std::max(m_block_size,1u),nb_nodes_per_elem,nb_eqs);
+      for (Uint begin=0; begin<nb_elems; begin+=m_block.max_elems())
       {
-        compute_term(e,m_tmp_term,m_tmp_ws);
-        for (Uint s=0; s<nb_nodes_per_elem; ++s)
+        m_block.set_nb_elems(std::min(m_block.max_elems(),nb_elems-begin));
+        compute_term_block(begin,m_block);
+        for (Uint e=0; e<m_block.nb_elems(); ++e)
         {
-          const Uint p=space.connectivity()[e][s];
-          for (Uint eq=0; eq<m_tmp_term[s].size(); ++eq)
+          for (Uint s=0; s<nb_nodes_per_elem; ++s)
           {
-            term[p][eq] += m_tmp_term[s][eq];
+            const Uint p=connectivity[begin+e][s];
+            for (Uint eq=0; eq<nb_eqs; ++eq)
+            {
+              term[p][eq] += m_block.term(s,eq)[e];
+            }
+            wave_speed[p][0] = m_block.wave_speed(s)[e];
           }
-          wave_speed[p][0] = m_tmp_ws[s]; 
         }
       }
     }
   }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+
+void TermComputer::compute_term_block(const Uint begin_elem, TermBlock& block)
+{
+  block.set_zero();
+  if (compute_term_block_impl(begin_elem,block))
+    return;
+
+  // Fall back to the per-element computation
+  for (Uint e=0; e<block.nb_elems(); ++e)
+  {
+    compute_term(begin_elem+e,m_tmp_term,m_tmp_ws);
+    block.set_element(e,m_tmp_term,m_tmp_ws);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // solver
@@ -28,6 +28,58 @@ namespace solver {
 
 /////////////////////////////////////////////////////////////////////////////////////
 
+/// @brief Storage for a term computed over a block of elements, in structure-of-arrays layout
+///
+/// The values of consecutive elements are contiguous for every (node, equation) pair,
+/// so that implementations can vectorize across the elements of the block.
+/// @author Willem Deconinck
+class solver_API TermBlock
+{
+public:
+
+  TermBlock() : m_max_elems(0), m_nb_nodes(0), m_nb_eqs(0), m_nb_elems(0) {}
+
+  /// @brief Allocate storage for at most max_elems elements. Does nothing if the size didn't change.
+  void resize(const Uint max_elems, const Uint nb_nodes, const Uint nb_eqs);
+
+  /// @brief Set all terms and wave speeds to zero
+  void set_zero();
+
+  /// @brief Maximum number of elements in a block
+  Uint max_elems() const { return m_max_elems; }
+
+  /// @brief Number of nodes per element
+  Uint nb_nodes() const { return m_nb_nodes; }
+
+  /// @brief Number of equations
+  Uint nb_eqs() const { return m_nb_eqs; }
+
+  /// @brief Number of elements in the current block
+  Uint nb_elems() const { return m_nb_elems; }
+  void set_nb_elems(const Uint nb_elems) { cf3_assert(nb_elems <= m_max_elems); m_nb_elems = nb_elems; }
+
+  /// @brief Span of max_elems contiguous term values for the given node and equation
+  Real* term(const Uint node, const Uint eq) { return &m_term[(node*m_nb_eqs + eq)*m_max_elems]; }
+  const Real* term(const Uint node, const Uint eq) const { return &m_term[(node*m_nb_eqs + eq)*m_max_elems]; }
+
+  /// @brief Span of max_elems contiguous wave speeds for the given node
+  Real* wave_speed(const Uint node) { return &m_wave_speed[node*m_max_elems]; }
+  const Real* wave_speed(const Uint node) const { return &m_wave_speed[node*m_max_elems]; }
+
+  /// @brief Copy the result of a per-element computation into the block
+  void set_element(const Uint elem, const std::vector<RealVector>& term, const std::vector<Real>& wave_speed);
+
+private:
+  Uint m_max_elems;
+  Uint m_nb_nodes;
+  Uint m_nb_eqs;
+  Uint m_nb_elems;
+  std::vector<Real> m_term;
+  std::vector<Real> m_wave_speed;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+
 /// @brief Computes a term of a system of equations by looping over elements
 /// @author Willem Deconinck
 class solver_API TermComputer : public common::Action
@@ -55,6 +107,16 @@ public:
   /// @brief Compute the term for given element in given vectors
   virtual void compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed) = 0;
 
+  /// @brief Compute the term for a block of elements, using the per-element compute_term if no block implementation exists
+  void compute_term_block(const Uint begin_elem, TermBlock& block);
+
+protected:
+
+  /// @brief Compute the term for the block.nb_elems() elements starting at begin_elem
+  /// The block is sized for the current cells and zeroed before the call.
+  /// @return false if this term computer has no block implementation, in which case the per-element compute_term is used
+  virtual bool compute_term_block_impl(const Uint begin_elem, TermBlock& block) { return false; }
+
  private:
 
   Handle<mesh::Field> m_term_field;
@@ -62,6 +124,10 @@ public:
   
   std::vector<RealVector> m_tmp_term;
   std::vector<Real>       m_tmp_ws;
+
+  /// Number of elements per block
+  Uint m_block_size;
+  TermBlock m_block;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
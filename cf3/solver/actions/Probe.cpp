@@ -8,6 +8,7 @@
 #include <boost/function.hpp>
 
 #include "common/Core.hpp"
+#include "common/EventHandler.hpp"
 #include "common/Builder.hpp"
 #include "common/PropertyList.hpp"
 #include "common/OptionList.hpp"
@@ -27,6 +28,8 @@
 #include "solver/actions/Probe.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Tags.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/PointInterpolator.hpp"
 
@@ -42,7 +45,10 @@ common::ComponentBuilder < Probe, common::Action, solver::actions::LibActions >
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
-Probe::Probe( const std::string& name  ) : common::Action(name)
+Probe::Probe( const std::string& name  ) :
+  common::Action(name),
+  m_plan_valid(false),
+  m_found_on_proc(-1)
 {
   mark_basic(); // by default probes are visible
 
@@ -54,7 +60,8 @@ Probe::Probe( const std::string& name  ) : common::Action(name)
   options().add("coordinate",std::vector<Real>())
     .pretty_name("Coordinate")
     .description("Coordinate to interpolate fields to")
-    .mark_basic();
+    .mark_basic()
+    .attach_trigger( boost::bind( &Probe::invalidate_plan, this ) );
     
   options().add("dict",m_dict)
       .description("Dictionary that will be probed")
@@ -70,6 +77,8 @@ Probe::Probe( const std::string& name  ) : common::Action(name)
 
   m_point_interpolator = create_component<PointInterpolator>("point_interpolator");
   m_variables = create_component<math::VariablesDescriptor>("variables");
+
+  Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &Probe::on_mesh_changed_event);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -77,46 +86,65 @@ Probe::Probe( const std::string& name  ) : common::Action(name)
 void Probe::configure_point_interpolator()
 {
   m_point_interpolator->options().set("dict",m_dict);
+  invalidate_plan();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void Probe::execute()
+void Probe::invalidate_plan()
+{
+  m_plan_valid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Probe::on_mesh_changed_event(SignalArgs& args)
 {
   if ( is_null(m_dict) )
-    throw SetupError(FromHere(), "Option \"dict\" was not configured in "+uri().string());
+    return;
 
+  SignalOptions options(args);
+  Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*m_dict);
+  if ( is_null(mesh) || options.value<URI>("mesh_uri") == mesh->uri() )
+    invalidate_plan();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Probe::compute_plan()
+{
   // Take the coordinate from the options
   std::vector<Real> opt_coord = options().value< std::vector<Real> >("coordinate");
   RealVector coord(opt_coord.size());
   math::copy(opt_coord,coord);
 
   // Find interpolation data for this coordinate
-  SpaceElem m_element;
-  std::vector<SpaceElem> m_stencil;
-  std::vector<Uint> m_points;
-  std::vector<Real> m_weights;
-
-  int found = m_point_interpolator->compute_storage(coord,m_element,m_stencil,m_points,m_weights);
+  SpaceElem element;
+  std::vector<SpaceElem> stencil;
 
-//  std::cout << PE::Comm::instance().rank() << ":  found = " << found << std::endl;
+  int found = m_point_interpolator->compute_storage(coord,element,stencil,m_points,m_weights);
 
-  int found_on_proc = found ? PE::Comm::instance().rank() : -1;
+  m_found_on_proc = found ? PE::Comm::instance().rank() : -1;
 
   if (PE::Comm::instance().is_active())
-    PE::Comm::instance().all_reduce(PE::max(), &found_on_proc, 1, &found_on_proc);
+    PE::Comm::instance().all_reduce(PE::max(), &m_found_on_proc, 1, &m_found_on_proc);
 
-//  std::cout << PE::Comm::instance().rank() << ":  found_on_proc = " << found_on_proc << std::endl;
-
-  if (found_on_proc<0)
+  if (m_found_on_proc<0)
     throw SetupError(FromHere(),"Cannot probe: coordinate ("+to_str(opt_coord)+") lies outside the domain");
 
+  // Only the interpolating rank needs the points and weights
+  if (m_found_on_proc != static_cast<int>(PE::Comm::instance().rank()))
+  {
+    m_points.clear();
+    m_weights.clear();
+  }
+
   PE::Buffer elem_comp_buffer;
-  if (found)
+  if (m_found_on_proc == static_cast<int>(PE::Comm::instance().rank()))
   {
-    elem_comp_buffer << m_element.comp->uri().path() << m_element.glb_idx();
+    elem_comp_buffer << element.comp->uri().path() << element.glb_idx();
   }
-  elem_comp_buffer.broadcast(found_on_proc);
+  elem_comp_buffer.broadcast(m_found_on_proc);
   std::string elem_comp;
   Uint glb_idx;
   elem_comp_buffer >> elem_comp >> glb_idx;
@@ -124,33 +152,94 @@ void Probe::execute()
   properties()["space"]=elem_comp;
   properties()["glb_elem_idx"]=glb_idx;
 
-//  std::cout << PE::Comm::instance().rank() << ":  elem_comp = " << elem_comp << std::endl;
-//  std::cout << PE::Comm::instance().rank() << ":  glb_idx = " << glb_idx << std::endl;
+  m_plan_valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
+Uint Probe::nb_values() const
+{
+  Uint result = 0;
   boost_foreach (const Handle<Field>& field, m_dict->fields())
   {
+    result += field->row_size();
+  }
+  return result;
+}
 
-    // Interpolate each field to the given point
-    std::vector<Real> interpolated(field->row_size());
+////////////////////////////////////////////////////////////////////////////////
 
-    if (found)
+void Probe::interpolate_local(Real* values) const
+{
+  if (m_found_on_proc != static_cast<int>(PE::Comm::instance().rank()))
+    return;
+
+  Uint field_begin = 0;
+  boost_foreach (const Handle<Field>& field, m_dict->fields())
+  {
+    const Field::ArrayT& array = field->array();
+    for(Uint i=0; i<m_points.size(); ++i)
     {
-      for(Uint v=0; v<interpolated.size(); ++v)
+      for(Uint v=0; v<field->row_size(); ++v)
       {
-        interpolated[v]=0.;
-        for(Uint i=0; i<m_points.size(); ++i)
-        {
-          interpolated[v] += field->array()[m_points[i]][v] * m_weights[i];
-        }
+        values[field_begin+v] += array[m_points[i]][v] * m_weights[i];
       }
     }
+    field_begin += field->row_size();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Probe::execute_probes(const std::vector< Handle<Probe> >& probes)
+{
+  const Uint nb_probes = probes.size();
+  std::vector<Uint> begin(nb_probes+1,0);
+  for (Uint p=0; p<nb_probes; ++p)
+  {
+    Probe& probe = *probes[p];
+    if ( is_null(probe.m_dict) )
+      throw SetupError(FromHere(), "Option \"dict\" was not configured in "+probe.uri().string());
+    if (!probe.m_plan_valid)
+      probe.compute_plan();
+    begin[p+1] = begin[p] + probe.nb_values();
+  }
+
+  // Every coordinate is interpolated on exactly one rank, so the values of all
+  // probes and all fields are gathered with a single sum
+  std::vector<Real> values(begin.back(),0.);
+  for (Uint p=0; p<nb_probes; ++p)
+  {
+    if (begin[p+1] != begin[p])
+      probes[p]->interpolate_local(&values[begin[p]]);
+  }
+  if (PE::Comm::instance().is_active() && !values.empty())
+    PE::Comm::instance().all_reduce(PE::plus(), values, values);
 
-    PE::Comm::instance().broadcast(interpolated,interpolated,found_on_proc);
+  for (Uint p=0; p<nb_probes; ++p)
+  {
+    probes[p]->store_values(values.empty() ? nullptr : &values[begin[p]]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Probe::execute()
+{
+  execute_probes(std::vector< Handle<Probe> >(1, handle<Probe>()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
-    // Set interpolated variables as properties
+void Probe::store_values(const Real* interpolated)
+{
+  // Set interpolated variables as properties
+  Uint field_begin = 0;
+  boost_foreach (const Handle<Field>& field, m_dict->fields())
+  {
     for (Uint var_idx=0; var_idx<field->nb_vars(); ++var_idx)
     {
-      Uint var_begin  = field->descriptor().offset(var_idx);
+      Uint var_begin  = field_begin + field->descriptor().offset(var_idx);
       Uint var_length = field->descriptor().var_length(var_idx);
       if (var_length==1)
       {
@@ -164,6 +253,7 @@ void Probe::execute()
         }
       }
     }
+    field_begin += field->row_size();
   }
 
   // Do all post-processing actions, which could add more properties to the probe,
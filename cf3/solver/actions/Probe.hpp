@@ -9,7 +9,6 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
-
 #include "common/Action.hpp"
 #include "solver/actions/LibActions.hpp"
 
@@ -28,6 +27,9 @@ class ProbePostProcessor;
 /// Interpolated values are stored as properties within the probe component.
 /// Actions can be added as child to the probe, and will be executed, after
 /// the probe is executed.
+/// The probed coordinate is located once, and the interpolation weights are reused
+/// until the coordinate, the dictionary or its mesh changes.
+/// Several probes can be evaluated with a single reduction by placing them in a ProbeGroup.
 /// @author Willem Deconinck
 class solver_actions_API Probe : public common::Action {
 friend class ProbePostProcessor;
@@ -57,6 +59,11 @@ public: // functions
   /// @brief Access to the description of the probed variables
   Handle<math::VariablesDescriptor> variables() { return m_variables; }
 
+  /// @brief Execute the given probes, interpolating the values of all of them with a single reduction
+  ///
+  /// This is a collective operation.
+  static void execute_probes(const std::vector< Handle<Probe> >& probes);
+
 private: // functions
 
   /// @brief Add a variable to the internal storage
@@ -74,12 +81,39 @@ private: // functions
   /// @brief Configure the point interpolator
   void configure_point_interpolator();
 
+  /// @brief Mark the stored interpolation plan as outdated
+  void invalidate_plan();
+
+  /// @brief Invalidate the interpolation plan if the probed mesh changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+  /// @brief Locate the probed coordinate and store the interpolation points and weights
+  ///
+  /// This is a collective operation, executed only when the plan is outdated.
+  void compute_plan();
+
+  /// @brief Number of values interpolated by this probe, for all fields of the dictionary
+  Uint nb_values() const;
+
+  /// @brief Interpolate all fields, if this rank interpolates the coordinate
+  /// @param [out] values Start of the nb_values() values of this probe, which are left unchanged on other ranks
+  void interpolate_local(Real* values) const;
+
+  /// @brief Store the interpolated values as properties and run the post processors
+  /// @param [in] values Start of the nb_values() values of this probe
+  void store_values(const Real* values);
+
 private: // data
 
   Handle<mesh::Dictionary>            m_dict;                ///< Dictionary to interpolate
   Handle<mesh::PointInterpolator>     m_point_interpolator;  ///< Interpolator for one point
   Handle< math::VariablesDescriptor > m_variables;           ///< Variable description
 
+  bool                                m_plan_valid;          ///< True if the stored plan can be used
+  int                                 m_found_on_proc;       ///< Rank that interpolates the coordinate
+  std::vector<Uint>                   m_points;              ///< Dictionary points used for interpolation
+  std::vector<Real>                   m_weights;             ///< Interpolation weights of m_points
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
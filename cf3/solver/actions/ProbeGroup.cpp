@@ -0,0 +1,108 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Signal.hpp"
+#include "common/XML/SignalOptions.hpp"
+
+#include "solver/actions/Probe.hpp"
+#include "solver/actions/ProbeGroup.hpp"
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+
+using namespace common;
+using namespace common::XML;
+
+common::ComponentBuilder < ProbeGroup, common::Action, solver::actions::LibActions > ProbeGroup_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ProbeGroup::ProbeGroup( const std::string& name  ) :
+  common::Action(name)
+{
+  mark_basic();
+
+  properties()["brief"] = std::string("Group of probes that are evaluated together");
+  std::string description =
+      "Executes all child probes with a single reduction, followed by the other child actions";
+  properties()["description"] = description;
+
+  regist_signal ( "create_probe" )
+      .description( "Create a probe in this group" )
+      .pretty_name("Create Probe" )
+      .connect   ( boost::bind ( &ProbeGroup::signal_create_probe,    this, _1 ) )
+      .signature ( boost::bind ( &ProbeGroup::signature_create_probe, this, _1 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ProbeGroup::~ProbeGroup() {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProbeGroup::execute()
+{
+  std::vector< Handle<Probe> > probes;
+  std::vector< Handle<common::Action> > other_actions;
+  boost_foreach (common::Action& action, find_components<common::Action>(*this))
+  {
+    Handle<Probe> probe(action.handle());
+    if (is_not_null(probe))
+      probes.push_back(probe);
+    else
+      other_actions.push_back(action.handle<common::Action>());
+  }
+
+  Probe::execute_probes(probes);
+
+  boost_foreach (const Handle<common::Action>& action, other_actions)
+  {
+    action->execute();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Handle<Probe> ProbeGroup::create_probe(const std::string& name)
+{
+  return create_component<Probe>(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProbeGroup::signal_create_probe(SignalArgs &args)
+{
+  SignalOptions signal_options(args);
+
+  Handle<Probe> probe = create_probe(signal_options.value<std::string>("name"));
+
+  SignalFrame reply = args.create_reply(uri());
+  SignalOptions reply_options(reply);
+  reply_options.add("created_component", probe->uri());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProbeGroup::signature_create_probe(SignalArgs &args)
+{
+  SignalOptions options(args);
+
+  options.add("name", std::string("probe"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
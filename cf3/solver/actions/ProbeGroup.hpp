@@ -0,0 +1,61 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_actions_ProbeGroup_hpp
+#define cf3_solver_actions_ProbeGroup_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Action.hpp"
+#include "solver/actions/LibActions.hpp"
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+
+class Probe;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Executes the probes it contains with a single reduction
+///
+/// All child probes are interpolated together each time the group is executed,
+/// after which their post processors run in the order of the probes.
+/// Other child actions are executed afterwards, in order.
+class solver_actions_API ProbeGroup : public common::Action {
+public: // functions
+
+  /// Contructor
+  /// @param name of the component
+  ProbeGroup ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ProbeGroup();
+
+  /// Get the class name
+  static std::string type_name () { return "ProbeGroup"; }
+
+  virtual void execute();
+
+  /// @brief Create a probe in this group
+  Handle<Probe> create_probe(const std::string& name);
+
+  /// @name SIGNALS
+  //@{
+  void signal_create_probe(common::SignalArgs& args);
+  void signature_create_probe(common::SignalArgs& args);
+  //@}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_solver_actions_ProbeGroup_hpp
@@ -8,6 +8,7 @@
 #include <boost/function.hpp>
 
 #include "common/Core.hpp"
+#include "common/EventHandler.hpp"
 #include "common/Builder.hpp"
 #include "common/PropertyList.hpp"
 #include "common/OptionList.hpp"
@@ -23,10 +24,13 @@
 #include "math/MatrixTypesConversion.hpp"
 #include "math/VariablesDescriptor.hpp"
 #include "math/Consts.hpp"
+#include "math/Defs.hpp"
 
 #include "solver/actions/ProbePoints.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Tags.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/PointInterpolator.hpp"
 
@@ -42,7 +46,10 @@ common::ComponentBuilder < ProbePoints, common::Action, solver::actions::LibActi
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
-ProbePoints::ProbePoints( const std::string& name  ) : common::Action(name)
+ProbePoints::ProbePoints( const std::string& name  ) :
+  common::Action(name),
+  m_plan_valid(false),
+  m_dim(0)
 {
   mark_basic(); // by default probes are visible
 
@@ -54,17 +61,20 @@ ProbePoints::ProbePoints( const std::string& name  ) : common::Action(name)
   options().add("x_coordinate",std::vector<Real>())
     .pretty_name("xcoordinate")
     .description("x-coordinate to interpolate fields to")
-    .mark_basic();
+    .mark_basic()
+    .attach_trigger( boost::bind( &ProbePoints::invalidate_plan, this ) );
 
   options().add("y_coordinate",std::vector<Real>())
     .pretty_name("ycoordinate")
     .description("y-coordinate to interpolate fields to")
-    .mark_basic();
+    .mark_basic()
+    .attach_trigger( boost::bind( &ProbePoints::invalidate_plan, this ) );
 
   options().add("z_coordinate",std::vector<Real>())
     .pretty_name("zcoordinate")
     .description("z-coordinate to interpolate fields to")
-    .mark_basic();
+    .mark_basic()
+    .attach_trigger( boost::bind( &ProbePoints::invalidate_plan, this ) );
     
   options().add("dict",m_dict)
       .description("Dictionary that will be probed")
@@ -80,6 +90,8 @@ ProbePoints::ProbePoints( const std::string& name  ) : common::Action(name)
 
   m_point_interpolator = create_component<PointInterpolator>("point_interpolator");
   m_variables = create_component<math::VariablesDescriptor>("variables");
+
+  Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &ProbePoints::on_mesh_changed_event);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,92 +99,160 @@ ProbePoints::ProbePoints( const std::string& name  ) : common::Action(name)
 void ProbePoints::configure_point_interpolator()
 {
   m_point_interpolator->options().set("dict",m_dict);
+  invalidate_plan();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void ProbePoints::execute()
+void ProbePoints::invalidate_plan()
 {
-  if ( is_null(m_dict) )
-    throw SetupError(FromHere(), "Option \"dict\" was not configured in "+uri().string());
-
-  // Take the coordinate from the options
-  std::vector<Real> opt_coord = options().value< std::vector<Real> >("coordinate");
-  RealVector coord(opt_coord.size()); //get the size
-  math::copy(opt_coord,coord);
+  m_plan_valid = false;
+}
 
-  // Find interpolation data for this coordinate
-  SpaceElem m_element;
-  std::vector<SpaceElem> m_stencil;
-  std::vector<Uint> m_points;
-  std::vector<Real> m_weights;
+////////////////////////////////////////////////////////////////////////////////
 
-  int found = m_point_interpolator->compute_storage(coord,m_element,m_stencil,m_points,m_weights);
+void ProbePoints::on_mesh_changed_event(SignalArgs& args)
+{
+  if ( is_null(m_dict) )
+    return;
 
-//  std::cout << PE::Comm::instance().rank() << ":  found = " << found << std::endl;
+  SignalOptions options(args);
+  Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*m_dict);
+  if ( is_null(mesh) || options.value<URI>("mesh_uri") == mesh->uri() )
+    invalidate_plan();
+}
 
-  int found_on_proc = found ? PE::Comm::instance().rank() : -1;
+////////////////////////////////////////////////////////////////////////////////
 
-  if (PE::Comm::instance().is_active())
-    PE::Comm::instance().all_reduce(PE::max(), &found_on_proc, 1, &found_on_proc);
+void ProbePoints::compute_plan()
+{
+  // Take the coordinates from the options, one option per direction
+  std::vector< std::vector<Real> > opt_coords(3);
+  opt_coords[XX] = options().value< std::vector<Real> >("x_coordinate");
+  opt_coords[YY] = options().value< std::vector<Real> >("y_coordinate");
+  opt_coords[ZZ] = options().value< std::vector<Real> >("z_coordinate");
+
+  m_dim = 0;
+  while (m_dim < 3 && !opt_coords[m_dim].empty())
+    ++m_dim;
+  if (m_dim == 0)
+    throw SetupError(FromHere(), "Option \"x_coordinate\" was not configured in "+uri().string());
+
+  const Uint nb_coords = opt_coords[XX].size();
+  for (Uint d=0; d<3; ++d)
+  {
+    if ( (d<m_dim && opt_coords[d].size() != nb_coords) || (d>=m_dim && !opt_coords[d].empty()) )
+      throw SetupError(FromHere(), "The coordinate options of "+uri().string()+" must all have "+to_str(nb_coords)+" entries");
+  }
 
-//  std::cout << PE::Comm::instance().rank() << ":  found_on_proc = " << found_on_proc << std::endl;
+  // Find interpolation data for each coordinate
+  RealVector coord(m_dim);
+  SpaceElem element;
+  std::vector<SpaceElem> stencil;
+  std::vector< std::vector<Uint> > points(nb_coords);
+  std::vector< std::vector<Real> > weights(nb_coords);
+  std::vector<int> found_on_proc(nb_coords,-1);
+  for (Uint c=0; c<nb_coords; ++c)
+  {
+    for (Uint d=0; d<m_dim; ++d)
+      coord[d] = opt_coords[d][c];
+    if (m_point_interpolator->compute_storage(coord,element,stencil,points[c],weights[c]))
+      found_on_proc[c] = PE::Comm::instance().rank();
+  }
 
-  if (found_on_proc<0)
-    throw SetupError(FromHere(),"Cannot probe: coordinate ("+to_str(opt_coord)+") lies outside the domain");
+  // All coordinates are located with one reduction
+  if (PE::Comm::instance().is_active())
+    PE::Comm::instance().all_reduce(PE::max(), found_on_proc, found_on_proc);
 
-  PE::Buffer elem_comp_buffer;
-  if (found)
+  m_owned.clear();
+  m_points.clear();
+  m_weights.clear();
+  for (Uint c=0; c<nb_coords; ++c)
   {
-    elem_comp_buffer << m_element.comp->uri().path() << m_element.glb_idx();
+    if (found_on_proc[c]<0)
+    {
+      std::vector<Real> point(m_dim);
+      for (Uint d=0; d<m_dim; ++d)
+        point[d] = opt_coords[d][c];
+      throw SetupError(FromHere(),"Cannot probe: coordinate ("+to_str(point)+") lies outside the domain");
+    }
+    if (found_on_proc[c] == static_cast<int>(PE::Comm::instance().rank()))
+    {
+      m_owned.push_back(c);
+      m_points.push_back(points[c]);
+      m_weights.push_back(weights[c]);
+    }
   }
-  elem_comp_buffer.broadcast(found_on_proc);
-  std::string elem_comp;
-  Uint glb_idx;
-  elem_comp_buffer >> elem_comp >> glb_idx;
 
-  properties()["space"]=elem_comp;
-  properties()["glb_elem_idx"]=glb_idx;
+  m_plan_valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProbePoints::execute()
+{
+  if ( is_null(m_dict) )
+    throw SetupError(FromHere(), "Option \"dict\" was not configured in "+uri().string());
+
+  if (!m_plan_valid)
+    compute_plan();
 
-//  std::cout << PE::Comm::instance().rank() << ":  elem_comp = " << elem_comp << std::endl;
-//  std::cout << PE::Comm::instance().rank() << ":  glb_idx = " << glb_idx << std::endl;
+  const Uint nb_coords = options().value< std::vector<Real> >("x_coordinate").size();
 
+  // Interpolate all fields to all coordinates, in one array with a row per coordinate
+  Uint nb_values = 0;
   boost_foreach (const Handle<Field>& field, m_dict->fields())
   {
+    nb_values += field->row_size();
+  }
+  std::vector<Real> interpolated(nb_coords*nb_values,0.);
 
-    // Interpolate each field to the given point
-    std::vector<Real> interpolated(field->row_size());
-
-    if (found)
+  for (Uint o=0; o<m_owned.size(); ++o)
+  {
+    Uint value_idx = m_owned[o]*nb_values;
+    boost_foreach (const Handle<Field>& field, m_dict->fields())
     {
-      for(Uint v=0; v<interpolated.size(); ++v)
+      const Field::ArrayT& array = field->array();
+      for(Uint i=0; i<m_points[o].size(); ++i)
       {
-        interpolated[v]=0.;
-        for(Uint i=0; i<m_points.size(); ++i)
+        for(Uint v=0; v<field->row_size(); ++v)
         {
-          interpolated[v] += field->array()[m_points[i]][v] * m_weights[i];
+          interpolated[value_idx+v] += array[m_points[o][i]][v] * m_weights[o][i];
         }
       }
+      value_idx += field->row_size();
     }
+  }
 
-    PE::Comm::instance().broadcast(interpolated,interpolated,found_on_proc);
+  // Every coordinate is interpolated on exactly one rank, so the values of all
+  // coordinates and all fields are gathered with a single sum
+  if (PE::Comm::instance().is_active())
+    PE::Comm::instance().all_reduce(PE::plus(), interpolated, interpolated);
 
-    // Set interpolated variables as properties
-    for (Uint var_idx=0; var_idx<field->nb_vars(); ++var_idx)
+  // Set interpolated variables as properties, suffixed with the coordinate index
+  for (Uint c=0; c<nb_coords; ++c)
+  {
+    Uint field_begin = c*nb_values;
+    boost_foreach (const Handle<Field>& field, m_dict->fields())
     {
-      Uint var_begin  = field->descriptor().offset(var_idx);
-      Uint var_length = field->descriptor().var_length(var_idx);
-      if (var_length==1)
-      {
-        set(field->descriptor().user_variable_name(var_idx) , interpolated[var_begin]);
-      }
-      else
+      for (Uint var_idx=0; var_idx<field->nb_vars(); ++var_idx)
       {
-        for (Uint i=0; i<var_length; ++i)
+        const std::string var_name = field->descriptor().user_variable_name(var_idx)+"_"+to_str(c);
+        Uint var_begin  = field_begin + field->descriptor().offset(var_idx);
+        Uint var_length = field->descriptor().var_length(var_idx);
+        if (var_length==1)
+        {
+          set(var_name , interpolated[var_begin]);
+        }
+        else
         {
-          set(field->descriptor().user_variable_name(var_idx)+"["+to_str(i)+"]" , interpolated[var_begin+i]);
+          for (Uint i=0; i<var_length; ++i)
+          {
+            set(var_name+"["+to_str(i)+"]" , interpolated[var_begin+i]);
+          }
         }
       }
+      field_begin += field->row_size();
     }
   }
 
@@ -193,7 +273,7 @@ void ProbePoints::set(const std::string& var_name, const Real& var_value)
   {
     if (m_variables->nb_vars() == 0)
     {
-      m_variables->options().set("dimension",(Uint)options().value<std::vector<Real> >("coordinate").size());
+      m_variables->options().set("dimension",m_dim);
     }
 
     m_variables->push_back(var_name,math::VariablesDescriptor::Dimensionalities::SCALAR);
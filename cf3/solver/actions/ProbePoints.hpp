@@ -28,6 +28,8 @@ class ProbePointsPostProcessor;
 /// Interpolated values are stored as properties within the probe component.
 /// Actions can be added as child to the probe, and will be executed, after
 /// the probe is executed.
+/// The probed coordinates are located once, and the interpolation weights are reused
+/// until the coordinates, the dictionary or its mesh changes.
 class solver_actions_API ProbePoints : public common::Action {
 friend class ProbePointsPostProcessor;
 public: // functions
@@ -73,12 +75,29 @@ private: // functions
   /// @brief Configure the point interpolator
   void configure_point_interpolator();
 
+  /// @brief Mark the stored interpolation plan as outdated
+  void invalidate_plan();
+
+  /// @brief Invalidate the interpolation plan if the probed mesh changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+  /// @brief Locate the probed coordinates and store the interpolation points and weights
+  ///
+  /// This is a collective operation, executed only when the plan is outdated.
+  void compute_plan();
+
 private: // data
 
   Handle<mesh::Dictionary>            m_dict;                ///< Dictionary to interpolate
   Handle<mesh::PointInterpolator>     m_point_interpolator;  ///< Interpolator for one point
   Handle< math::VariablesDescriptor > m_variables;           ///< Variable description
 
+  bool                                m_plan_valid;          ///< True if the stored plan can be used
+  Uint                                m_dim;                 ///< Dimension of the probed coordinates
+  std::vector<Uint>                   m_owned;               ///< Coordinates interpolated on this rank
+  std::vector< std::vector<Uint> >    m_points;              ///< Dictionary points used for each owned coordinate
+  std::vector< std::vector<Real> >    m_weights;             ///< Interpolation weights of m_points
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
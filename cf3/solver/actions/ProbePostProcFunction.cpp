@@ -74,7 +74,14 @@ void ProbePostProcFunction::update_function()
 
     boost::algorithm::replace_all(m_function_str,var_name,mod_var_name);
   }
+
+  // Parsing is expensive compared to the evaluation, so only do it when something changed
+  if (function.is_parsed() && m_function_str == m_parsed_function_str && vars.str() == m_parsed_vars_str)
+    return;
+
   function.parse(m_function_str, vars.str());
+  m_parsed_function_str = m_function_str;
+  m_parsed_vars_str = vars.str();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +47,10 @@ private:
   std::string m_var_str;
   std::string m_function_str;
 
+  /// Function and variables used in the last parse
+  std::string m_parsed_function_str;
+  std::string m_parsed_vars_str;
+
   std::vector<Real> m_params;
 };
 
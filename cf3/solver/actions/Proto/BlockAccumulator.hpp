@@ -19,6 +19,7 @@
 #include "math/LSS/BlockAccumulator.hpp"
 #include "math/LSS/Matrix.hpp"
 
+#include "ElementColoring.hpp"
 #include "LSSWrapper.hpp"
 #include "Terminals.hpp"
 
@@ -91,20 +92,24 @@ struct MatrixAssignOpsCases
   template<int Dummy> struct case_<boost::proto::tag::minus_assign, Dummy> : boost::proto::minus_assign<BlockLhsGrammar<SystemTagT> , boost::proto::_ > {};
 };
 
-/// Translate tag to operator
-inline void do_assign_op_matrix(boost::proto::tag::assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+/// Translate tag to operator. The dependency stamps of the system are cleared, since the matrix no longer corresponds to them.
+inline void do_assign_op_matrix(boost::proto::tag::assign, math::LSS::System& lss, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
+    lss.clear_dependency_stamps();
+    LSSAssemblyLock lock(lss_matrix);
     lss_matrix.set_values(block_accumulator);
   }
 }
 
 /// Translate tag to operator
-inline void do_assign_op_matrix(boost::proto::tag::plus_assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+inline void do_assign_op_matrix(boost::proto::tag::plus_assign, math::LSS::System& lss, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
+    lss.clear_dependency_stamps();
+    LSSAssemblyLock lock(lss_matrix);
     lss_matrix.add_values(block_accumulator);
   }
 }
@@ -114,6 +119,7 @@ inline void do_assign_op_rhs(boost::proto::tag::assign, math::LSS::Vector& lss_r
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
+    LSSAssemblyLock lock(lss_rhs);
     lss_rhs.set_rhs_values(block_accumulator);
   }
 }
@@ -123,6 +129,7 @@ inline void do_assign_op_rhs(boost::proto::tag::plus_assign, math::LSS::Vector&
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
+    LSSAssemblyLock lock(lss_rhs);
     lss_rhs.add_rhs_values(block_accumulator);
   }
 }
@@ -166,7 +173,7 @@ struct BlockAssignmentOp<SystemMatrixTag, OpTagT>
         block_accumulator.mat(block_row, block_col) = rhs(row, col);
       }
     }
-    do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator);
+    do_assign_op_matrix(OpTagT(), lss.lss(), lss.matrix(), block_accumulator);
   }
 };
 
@@ -0,0 +1,200 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+#include "ElementColoring.hpp"
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+namespace Proto {
+
+ElementColoring::ElementColoring(const mesh::Elements& elements)
+{
+  const mesh::Connectivity& connectivity = elements.geometry_space().connectivity();
+  const Uint nb_elems = connectivity.size();
+  const Uint nb_nodes = elements.geometry_fields().size();
+
+  // Ordered coloring: each element gets the color following the highest color of the earlier elements that share a node with it.
+  // node_colors holds the color of the last element that touched each node, shifted by one so 0 means "untouched".
+  std::vector<Uint> node_colors(nb_nodes, 0);
+  std::vector<Uint> element_colors(nb_elems);
+  Uint nb_colors = 0;
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    const mesh::Connectivity::ConstRow row = connectivity[elem];
+    Uint color = 0;
+    BOOST_FOREACH(const Uint node, row)
+    {
+      color = std::max(color, node_colors[node]);
+    }
+    BOOST_FOREACH(const Uint node, row)
+    {
+      node_colors[node] = color+1;
+    }
+    element_colors[elem] = color;
+    nb_colors = std::max(nb_colors, color+1);
+  }
+
+  // Group the elements per color, keeping them sorted within each color
+  m_color_offsets.assign(nb_colors+1, 0);
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+    ++m_color_offsets[element_colors[elem]+1];
+  for(Uint color = 0; color != nb_colors; ++color)
+    m_color_offsets[color+1] += m_color_offsets[color];
+
+  m_colored_elements.resize(nb_elems);
+  std::vector<Uint> positions(m_color_offsets.begin(), m_color_offsets.end()-1);
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+    m_colored_elements[positions[element_colors[elem]]++] = elem;
+}
+
+ElementThreading::ElementThreading() :
+  m_nb_threads(1),
+  m_nb_pool_threads(0),
+  m_task(0),
+  m_nb_active_threads(0),
+  m_nb_busy_threads(0),
+  m_generation(0),
+  m_stop(false)
+{
+  common::Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &ElementThreading::on_mesh_changed_event);
+}
+
+ElementThreading::~ElementThreading()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_pool_mutex);
+    m_stop = true;
+  }
+  m_start_condition.notify_all();
+  m_pool_threads.join_all();
+}
+
+ElementThreading& ElementThreading::instance()
+{
+  static ElementThreading instance;
+  return instance;
+}
+
+void ElementThreading::set_nb_threads(const Uint nb_threads)
+{
+  m_nb_threads = std::max(nb_threads, 1u);
+}
+
+void ElementThreading::run(const Uint nb_threads, const TaskT& task)
+{
+  if(nb_threads < 2)
+  {
+    task(0);
+    return;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_pool_mutex);
+    // The pool only grows, so loops with fewer threads leave the extra threads waiting
+    for(; m_nb_pool_threads + 1 < nb_threads; ++m_nb_pool_threads)
+      m_pool_threads.create_thread(boost::bind(&ElementThreading::work, this, m_nb_pool_threads + 1, m_generation));
+    m_task = &task;
+    m_nb_active_threads = nb_threads;
+    m_nb_busy_threads = m_nb_pool_threads;
+    ++m_generation;
+  }
+  m_start_condition.notify_all();
+
+  try
+  {
+    task(0);
+  }
+  catch(...)
+  {
+    wait_for_pool();
+    throw;
+  }
+  wait_for_pool();
+}
+
+void ElementThreading::wait_for_pool()
+{
+  boost::unique_lock<boost::mutex> lock(m_pool_mutex);
+  while(m_nb_busy_threads != 0)
+    m_done_condition.wait(lock);
+  m_task = 0;
+}
+
+void ElementThreading::work(const Uint thread_idx, Uint generation)
+{
+  while(true)
+  {
+    const TaskT* task = 0;
+    Uint nb_active_threads = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(m_pool_mutex);
+      while(!m_stop && m_generation == generation)
+        m_start_condition.wait(lock);
+      if(m_stop)
+        return;
+      generation = m_generation;
+      task = m_task;
+      nb_active_threads = m_nb_active_threads;
+    }
+
+    if(thread_idx < nb_active_threads)
+    {
+      try
+      {
+        (*task)(thread_idx);
+      }
+      catch(...)
+      {
+        // Tasks handle their own errors, this only keeps the pool alive
+      }
+    }
+
+    boost::lock_guard<boost::mutex> lock(m_pool_mutex);
+    if(--m_nb_busy_threads == 0)
+      m_done_condition.notify_one();
+  }
+}
+
+const ElementColoring& ElementThreading::coloring(const mesh::Elements& elements)
+{
+  boost::lock_guard<boost::mutex> lock(m_cache_mutex);
+
+  const std::string key = elements.uri().path();
+  ColoringsT::iterator it = m_colorings.find(key);
+  if(it != m_colorings.end() && it->second.first.get() == &elements && it->second.second->nb_elements() == elements.size())
+    return *it->second.second;
+
+  boost::shared_ptr<ElementColoring> result(new ElementColoring(elements));
+  m_colorings[key] = std::make_pair(elements.handle<mesh::Elements const>(), result);
+  return *result;
+}
+
+void ElementThreading::on_mesh_changed_event(common::SignalArgs& args)
+{
+  boost::lock_guard<boost::mutex> lock(m_cache_mutex);
+  m_colorings.clear();
+}
+
+} // namespace Proto
+} // namespace actions
+} // namespace solver
+} // namespace cf3
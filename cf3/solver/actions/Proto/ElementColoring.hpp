@@ -0,0 +1,192 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_actions_Proto_ElementColoring_hpp
+#define cf3_solver_actions_Proto_ElementColoring_hpp
+
+#include <map>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/ConnectionManager.hpp"
+#include "common/Handle.hpp"
+#include "common/SignalHandler.hpp"
+
+/// @file
+/// Element coloring and global settings for threaded element loops
+
+namespace cf3 {
+  namespace mesh { class Elements; }
+namespace solver {
+namespace actions {
+namespace Proto {
+
+/// Partitions the elements of an Elements component into colors, so that no two elements of the same color share a geometry node.
+/// The coloring is ordered: elements that share a node always have increasing colors in increasing index order. Processing the colors
+/// in sequence therefore adds the contributions to each node (or matrix entry) in the same order as the serial loop, and the result is
+/// bit-identical to it. The number of colors is the length of the longest chain of elements that share nodes in index order, so it
+/// depends on the element numbering.
+/// Continuous higher-order spaces only share nodes between elements that share a geometric entity, so the geometry connectivity is sufficient.
+class ElementColoring
+{
+public:
+  ElementColoring(const mesh::Elements& elements);
+
+  /// Number of colors
+  Uint nb_colors() const
+  {
+    return m_color_offsets.size() - 1;
+  }
+
+  /// Number of elements in the given color
+  Uint color_size(const Uint color) const
+  {
+    return m_color_offsets[color+1] - m_color_offsets[color];
+  }
+
+  /// Pointer to the first element index of the given color. Element indices in a color are sorted.
+  const Uint* color_begin(const Uint color) const
+  {
+    return &m_colored_elements[m_color_offsets[color]];
+  }
+
+  /// Number of elements that were colored
+  Uint nb_elements() const
+  {
+    return m_colored_elements.size();
+  }
+
+private:
+  /// Start of each color in m_colored_elements, with one extra entry for the end
+  std::vector<Uint> m_color_offsets;
+  /// Element indices, grouped by color
+  std::vector<Uint> m_colored_elements;
+};
+
+/// Settings and shared state for running element loops on multiple threads.
+/// The default of a single thread executes the original serial loop.
+class ElementThreading : public common::ConnectionManager, public boost::noncopyable
+{
+public:
+  /// Work for one thread, taking the thread index
+  typedef boost::function<void(const Uint)> TaskT;
+
+  /// Singleton implementation
+  static ElementThreading& instance();
+
+  ~ElementThreading();
+
+  /// Number of threads to use for element loops
+  Uint nb_threads() const
+  {
+    return m_nb_threads;
+  }
+
+  /// Set the number of threads. 0 is interpreted as 1.
+  void set_nb_threads(const Uint nb_threads);
+
+  /// Coloring for the given elements, computed on first access and cached until the mesh changes
+  const ElementColoring& coloring(const mesh::Elements& elements);
+
+  /// Run task on nb_threads threads, passing the thread index. Index 0 runs on the calling thread, the others on a pool
+  /// of threads that is started on first use and reused by the following loops. Returns when all threads are done.
+  /// The task must not throw, and must not start another threaded loop.
+  void run(const Uint nb_threads, const TaskT& task);
+
+  /// Number of threads in the pool, excluding the calling thread
+  Uint nb_pool_threads() const
+  {
+    return m_nb_pool_threads;
+  }
+
+  /// Mutex that protects the assembly calls to the given LSS matrix or vector, if it doesn't support concurrent assembly
+  boost::mutex& lss_mutex(const void* lss_object)
+  {
+    return m_lss_mutexes[(reinterpret_cast<std::size_t>(lss_object) / sizeof(void*)) % nb_lss_mutexes];
+  }
+
+  /// Clears the cached colorings
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+private:
+  ElementThreading();
+
+  /// Loop of the pool threads
+  void work(const Uint thread_idx, Uint generation);
+
+  /// Wait until the pool threads are done with the current task
+  void wait_for_pool();
+
+  Uint m_nb_threads;
+  boost::mutex m_cache_mutex;
+
+  /// The matrix and vectors use a mutex chosen by their address, so different objects rarely wait for each other
+  static const Uint nb_lss_mutexes = 16;
+  boost::mutex m_lss_mutexes[nb_lss_mutexes];
+
+  /// Thread pool state, protected by m_pool_mutex
+  boost::thread_group m_pool_threads;
+  Uint m_nb_pool_threads;
+  boost::mutex m_pool_mutex;
+  boost::condition_variable m_start_condition;
+  boost::condition_variable m_done_condition;
+  const TaskT* m_task;
+  Uint m_nb_active_threads;
+  Uint m_nb_busy_threads;
+  Uint m_generation;
+  bool m_stop;
+
+  typedef std::map< std::string, std::pair< Handle<mesh::Elements const>, boost::shared_ptr<ElementColoring> > > ColoringsT;
+  ColoringsT m_colorings;
+};
+
+/// Sets the number of threads for the lifetime of the object, restoring the previous value on destruction
+class ScopedElementThreads : public boost::noncopyable
+{
+public:
+  ScopedElementThreads(const Uint nb_threads) : m_old_nb_threads(ElementThreading::instance().nb_threads())
+  {
+    ElementThreading::instance().set_nb_threads(nb_threads);
+  }
+
+  ~ScopedElementThreads()
+  {
+    ElementThreading::instance().set_nb_threads(m_old_nb_threads);
+  }
+
+private:
+  const Uint m_old_nb_threads;
+};
+
+/// Serializes the assembly calls to an LSS matrix or vector while element loops run on multiple threads. Does nothing in the serial
+/// case, or if the object supports concurrent assembly: the elements of a color never share a node, so they write to different rows.
+class LSSAssemblyLock : public boost::noncopyable
+{
+public:
+  template<typename LSSObjectT>
+  explicit LSSAssemblyLock(LSSObjectT& lss_object) : m_lock(ElementThreading::instance().lss_mutex(&lss_object), boost::defer_lock)
+  {
+    if(ElementThreading::instance().nb_threads() > 1 && !lss_object.concurrent_assembly())
+      m_lock.lock();
+  }
+
+private:
+  boost::unique_lock<boost::mutex> m_lock;
+};
+
+} // namespace Proto
+} // namespace actions
+} // namespace solver
+} // namespace cf3
+
+#endif // cf3_solver_actions_Proto_ElementColoring_hpp
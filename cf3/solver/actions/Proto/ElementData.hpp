@@ -164,6 +164,42 @@ namespace detail
 
 }
 
+namespace detail
+{
+  /// Copy the rows of the given element nodes from a table into a fixed-size matrix.
+  /// The number of nodes and values are compile-time constants of the matrix type, so the loops are unrolled,
+  /// and the rows are read directly from the contiguous table storage instead of through multi_array row views.
+  template<typename MatrixT, typename RowT>
+  inline void gather_rows(MatrixT& to_fill, const common::Table<Real>& table, const RowT& element_row, const Uint start)
+  {
+    const Real* data = table.array().data();
+    const Uint row_size = table.row_size();
+    for(int node = 0; node != MatrixT::RowsAtCompileTime; ++node)
+    {
+      const Real* data_row = data + element_row[node]*row_size + start;
+      for(int j = 0; j != MatrixT::ColsAtCompileTime; ++j)
+        to_fill(node, j) = data_row[j];
+    }
+  }
+
+  /// Ask the processor to start loading the table rows of the element after element_idx,
+  /// so they are in cache by the time that element is gathered
+  template<typename ArrayT>
+  inline void prefetch_next_rows(const common::Table<Real>& table, const ArrayT& connectivity_array, const Uint element_idx, const Uint start)
+  {
+#ifdef __GNUC__
+    if(element_idx+1 >= connectivity_array.size())
+      return;
+    const Real* data = table.array().data();
+    const Uint row_size = table.row_size();
+    const typename ArrayT::const_reference next_row = connectivity_array[element_idx+1];
+    const Uint nb_nodes = next_row.size();
+    for(Uint node = 0; node != nb_nodes; ++node)
+      __builtin_prefetch(data + next_row[node]*row_size + start);
+#endif
+  }
+}
+
 /// Functions and operators associated with a geometric support
 template<typename ETYPE>
 class GeometricSupport
@@ -194,7 +230,8 @@ public:
     m_element_idx = element_idx;
     const mesh::Connectivity::ConstRow row = m_connectivity_array[element_idx];
     std::copy(row.begin(), row.end(), m_connectivity.begin());
-    mesh::fill(m_nodes, m_coordinates, m_connectivity);
+    detail::gather_rows(m_nodes, m_coordinates, m_connectivity, 0);
+    detail::prefetch_next_rows(m_coordinates, m_connectivity_array, element_idx, 0);
   }
 
   /// Reference to the current nodes
@@ -496,7 +533,8 @@ public:
   void set_element(const Uint element_idx)
   {
     m_element_idx = element_idx;
-    mesh::fill(m_element_values, m_field, m_connectivity_array[element_idx], offset);
+    detail::gather_rows(m_element_values, m_field, m_connectivity_array[element_idx], offset);
+    detail::prefetch_next_rows(m_field, m_connectivity_array, element_idx, offset);
     m_cache_computed = false;
   }
 
@@ -16,10 +16,27 @@
 #include <boost/mpl/for_each.hpp>
 #include <boost/mpl/filter_view.hpp>
 
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <exception>
+
+#include "ElementColoring.hpp"
 #include "ElementData.hpp"
 #include "ElementExpressionWrapper.hpp"
 #include "ElementGrammar.hpp"
 
+#include "common/List.hpp"
+#include "common/RegionProfiler.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/Space.hpp"
@@ -155,15 +172,223 @@ struct ExpressionRunner
 
 
 
+/// Collects the dictionaries of the variables used in an expression
+struct CollectDicts
+{
+  CollectDicts(const mesh::Mesh& mesh, std::vector< Handle<mesh::Dictionary const> >& dicts) : m_mesh(mesh), m_dicts(dicts)
+  {
+  }
+
+  template<typename VarT>
+  void operator()(const VarT& var) const
+  {
+    Handle<mesh::Dictionary const> dict = common::find_component_ptr_with_tag<mesh::Dictionary>(m_mesh, var.field_tag());
+    if(is_null(dict))
+      dict = m_mesh.geometry_fields().handle<mesh::Dictionary>(); // fall back to the geometry if the dict is not found by tag
+    if(std::find(m_dicts.begin(), m_dicts.end(), dict) == m_dicts.end())
+      m_dicts.push_back(dict);
+  }
+
+  void operator()(const boost::mpl::void_&) const
+  {
+  }
+
+  const mesh::Mesh& m_mesh;
+  std::vector< Handle<mesh::Dictionary const> >& m_dicts;
+};
+
+/// Split the elements into the ones that touch a node that is exchanged with other ranks or periodic, in any of the dictionaries used
+/// by the variables, and the others. The interior elements can run while the values changed by the boundary elements are exchanged.
+/// Returns false if the exchange can't be overlapped, i.e. in a serial run or if a dictionary has no communication pattern yet.
+template<typename VariablesT>
+bool split_boundary_elements(VariablesT& variables, const mesh::Elements& elements, std::vector<Uint>& boundary_elements, std::vector<Uint>& interior_elements)
+{
+  if(!common::PE::Comm::instance().is_active() || common::PE::Comm::instance().size() < 2)
+    return false;
+
+  const mesh::Mesh& mesh = common::find_parent_component<mesh::Mesh>(elements);
+  std::vector< Handle<mesh::Dictionary const> > dicts(1, mesh.geometry_fields().handle<mesh::Dictionary>());
+  boost::fusion::for_each(variables, CollectDicts(mesh, dicts));
+
+  const Uint nb_elems = elements.size();
+  std::vector<bool> is_boundary(nb_elems, false);
+  BOOST_FOREACH(const Handle<mesh::Dictionary const>& dict, dicts)
+  {
+    Handle<common::PE::CommPattern const> comm_pattern(dict->get_child("CommPattern"));
+    if(is_null(comm_pattern))
+      return false;
+
+    const Uint nb_nodes = dict->size();
+    std::vector<bool> is_exchanged(nb_nodes, false);
+    BOOST_FOREACH(const int node, comm_pattern->send_map())
+    {
+      is_exchanged[node] = true;
+    }
+    for(Uint node = 0; node != nb_nodes; ++node)
+    {
+      if(dict->is_ghost(node))
+        is_exchanged[node] = true;
+    }
+
+    // Periodic nodes are summed at the start of the exchange, so they must be complete by then
+    Handle< common::List<Uint> const > periodic_links_nodes(dict->get_child("periodic_links_nodes"));
+    Handle< common::List<bool> const > periodic_links_active(dict->get_child("periodic_links_active"));
+    if(is_not_null(periodic_links_nodes) && is_not_null(periodic_links_active))
+    {
+      for(Uint node = 0; node != nb_nodes; ++node)
+      {
+        if((*periodic_links_active)[node])
+        {
+          is_exchanged[node] = true;
+          is_exchanged[(*periodic_links_nodes)[node]] = true;
+        }
+      }
+    }
+
+    const mesh::Connectivity& connectivity = elements.space(*dict).connectivity();
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      if(is_boundary[elem])
+        continue;
+      BOOST_FOREACH(const Uint node, connectivity[elem])
+      {
+        if(is_exchanged[node])
+        {
+          is_boundary[elem] = true;
+          break;
+        }
+      }
+    }
+  }
+
+  boundary_elements.clear();
+  interior_elements.clear();
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    if(is_boundary[elem])
+      boundary_elements.push_back(elem);
+    else
+      interior_elements.push_back(elem);
+  }
+
+  return true;
+}
+
+/// Splits the elements of each color over the threads, so that elements that share a node are never processed concurrently.
+/// Each thread has its own ElementData and its own copy of the wrapped expression, and all threads synchronize after each color.
+template<typename ExprT, typename DataT>
+struct ColoredElementWorker
+{
+  ColoredElementWorker(const ExprT& e, boost::ptr_vector<DataT>& d, const ElementColoring& c, boost::barrier& b) :
+    expr(e),
+    datas(d),
+    coloring(c),
+    barrier(b),
+    failed(false)
+  {
+  }
+
+  void operator()(const Uint thread_idx)
+  {
+    DataT& data = datas[thread_idx];
+    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
+    run(WrapExpression()(expr, mapped_coords, data), data, thread_idx);
+  }
+
+  /// Rethrow the first exception that was caught on any of the threads
+  void rethrow_exception()
+  {
+    if(has_failed())
+      std::rethrow_exception(exception);
+  }
+
+private:
+  bool has_failed()
+  {
+    boost::lock_guard<boost::mutex> lock(exception_mutex);
+    return failed;
+  }
+
+  template<typename FilteredExprT>
+  void run(const FilteredExprT& wrapped_expr, DataT& data, const Uint thread_idx)
+  {
+    ElementGrammar grammar;
+    const Uint nb_threads = datas.size();
+    const Uint nb_colors = coloring.nb_colors();
+    for(Uint color = 0; color != nb_colors; ++color)
+    {
+      const Uint color_size = coloring.color_size(color);
+      const Uint chunk_size = (color_size + nb_threads - 1) / nb_threads;
+      const Uint chunk_begin = std::min(thread_idx*chunk_size, color_size);
+      const Uint chunk_end = std::min(chunk_begin + chunk_size, color_size);
+      const Uint* color_elements = coloring.color_begin(color);
+      if(!has_failed())
+      {
+        try
+        {
+          for(Uint i = chunk_begin; i != chunk_end; ++i)
+          {
+            const Uint elem = color_elements[i];
+            data.set_element(elem);
+            grammar(wrapped_expr, elem, data);
+          }
+        }
+        catch(...)
+        {
+          boost::lock_guard<boost::mutex> lock(exception_mutex);
+          if(!failed)
+            exception = std::current_exception();
+          failed = true;
+        }
+      }
+      // The next color may touch the same nodes, so wait until all threads are done
+      barrier.wait();
+    }
+  }
+
+  const ExprT& expr;
+  boost::ptr_vector<DataT>& datas;
+  const ElementColoring& coloring;
+  boost::barrier& barrier;
+
+  bool failed;
+  std::exception_ptr exception;
+  boost::mutex exception_mutex;
+};
+
 /// Helper struct to launch execution once all shape functions have been determined
 template<typename DataT>
 struct ElementLooperImpl
 {
-  template<typename ExprT>
-  void operator()(const ExprT& expr, DataT& data, const Uint nb_elems) const
+  template<typename ExprT, typename VariablesT>
+  void operator()(const ExprT& expr, VariablesT& variables, mesh::Elements& elements) const
   {
+    const Uint nb_threads = ElementThreading::instance().nb_threads();
+    if(nb_threads > 1 && elements.size() > 1)
+    {
+      run_threaded(expr, variables, elements, nb_threads);
+      return;
+    }
+
+    std::vector<Uint> boundary_elements, interior_elements;
+    if(split_boundary_elements(variables, elements, boundary_elements, interior_elements))
+    {
+      // The element data registers the fields to synchronize when it goes out of scope
+      run_elements(expr, variables, elements, boundary_elements);
+      FieldSynchronizer::instance().begin_synchronize();
+      {
+        common::ScopedRegion region(elements, "/for_each_element_interior");
+        run_elements(expr, variables, elements, interior_elements);
+      }
+      // Interior elements don't change values that are exchanged, so they don't need another synchronization
+      FieldSynchronizer::instance().clear();
+      FieldSynchronizer::instance().end_synchronize();
+      return;
+    }
+
+    DataT data(variables, elements);
     const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
-    run(WrapExpression()(expr, mapped_coords, data), data, nb_elems);
+    run(WrapExpression()(expr, mapped_coords, data), data, elements.size());
   }
 
 private:
@@ -179,6 +404,42 @@ private:
       grammar(expr, elem, data);
     }
   }
+
+  /// Run the expression for the given elements only
+  template<typename ExprT, typename VariablesT>
+  void run_elements(const ExprT& expr, VariablesT& variables, mesh::Elements& elements, const std::vector<Uint>& element_list) const
+  {
+    DataT data(variables, elements);
+    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords;
+    run_list(WrapExpression()(expr, mapped_coords, data), data, element_list);
+  }
+
+  template<typename FilteredExprT>
+  void run_list(const FilteredExprT& expr, DataT& data, const std::vector<Uint>& element_list) const
+  {
+    ElementGrammar grammar;
+    BOOST_FOREACH(const Uint elem, element_list)
+    {
+      data.set_element(elem);
+      grammar(expr, elem, data);
+    }
+  }
+
+  template<typename ExprT, typename VariablesT>
+  void run_threaded(const ExprT& expr, VariablesT& variables, mesh::Elements& elements, const Uint nb_threads) const
+  {
+    const ElementColoring& coloring = ElementThreading::instance().coloring(elements);
+
+    // Data construction registers fields for synchronization, so it is done here on the calling thread
+    boost::ptr_vector<DataT> datas;
+    for(Uint i = 0; i != nb_threads; ++i)
+      datas.push_back(new DataT(variables, elements));
+
+    boost::barrier barrier(nb_threads);
+    ColoredElementWorker<ExprT, DataT> worker(expr, datas, coloring, barrier);
+    ElementThreading::instance().run(nb_threads, boost::bind<void>(boost::ref(worker), _1));
+    worker.rethrow_exception();
+  }
 };
 
 /// When we recursed to the last variable, actually run the expression
@@ -197,9 +458,7 @@ struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, Variable
       INVALID_ELEMENT_EXPRESSION,
       (ElementGrammar));
 
-    DataT data(variables, elements);
-
-    ElementLooperImpl<DataT>()(expression, data, elements.size());
+    ElementLooperImpl<DataT>()(expression, variables, elements);
   }
 
 private:
@@ -238,6 +497,7 @@ struct ElementLooper
     if(!mesh::IsElementType<ETYPE>()(m_elements.element_type()))
       return;
 
+    common::ScopedRegion region(m_elements, "/for_each_element");
     dispatch(boost::mpl::int_<boost::mpl::size< boost::mpl::filter_view< ElementTypesT, mesh::IsCompatibleWith<ETYPE> > >::value>(), sf);
 
     FieldSynchronizer::instance().synchronize();
@@ -253,9 +513,7 @@ struct ElementLooper
     // Verify the types match, and throw an error if non-matching fields are found
     boost::fusion::for_each(m_variables, CheckSameEtype<ETYPE>(m_elements));
 
-    DataT data(m_variables, m_elements);
-
-    ElementLooperImpl<DataT>()(m_expr, data, m_elements.size());
+    ElementLooperImpl<DataT>()(m_expr, m_variables, m_elements);
   }
 
   /// Static dispatch in case different ETYPE are possible
@@ -32,6 +32,15 @@ void FieldSynchronizer::insert(mesh::Field& f, bool do_periodic_element_update)
 
 void FieldSynchronizer::synchronize()
 {
+  begin_synchronize();
+  end_synchronize();
+}
+
+void FieldSynchronizer::begin_synchronize()
+{
+  // A field can only have one synchronization in progress
+  end_synchronize();
+
   // Periodic update needed even in a sequential run
   for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
   {
@@ -88,10 +97,27 @@ void FieldSynchronizer::synchronize()
   {
     for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
     {
-      field_it->second.first->synchronize();
+      field_it->second.first->begin_synchronize();
     }
+    m_pending_fields.swap(m_fields);
+  }
+
+  m_fields.clear();
+}
+
+void FieldSynchronizer::end_synchronize()
+{
+  for(FieldsT::iterator field_it = m_pending_fields.begin(); field_it != m_pending_fields.end(); ++field_it)
+  {
+    if(is_not_null(field_it->second.first))
+      field_it->second.first->end_synchronize();
   }
 
+  m_pending_fields.clear();
+}
+
+void FieldSynchronizer::clear()
+{
   m_fields.clear();
 }
 
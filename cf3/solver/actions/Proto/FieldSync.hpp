@@ -32,6 +32,17 @@ public:
   /// Sync fields and clear the list
   void synchronize();
 
+  /// Apply the periodic updates and start the synchronization of the fields, then clear the list.
+  /// The ghost values may only be used after end_synchronize() was called, so other work can be done while communicating.
+  void begin_synchronize();
+
+  /// Wait for the synchronizations started by begin_synchronize() to complete
+  void end_synchronize();
+
+  /// Remove the fields that were inserted since the last synchronization, without synchronizing them.
+  /// Used when only values that are not sent to other ranks were changed.
+  void clear();
+
 private:
   FieldSynchronizer();
 
@@ -39,6 +50,9 @@ private:
   // on each cpu.
   typedef std::map< std::string, std::pair<Handle<mesh::Field>, bool> > FieldsT;
   FieldsT m_fields;
+
+  /// Fields with a synchronization in progress
+  FieldsT m_pending_fields;
 };
 
 
@@ -7,6 +7,9 @@
 #ifndef cf3_solver_actions_Proto_NodeLooper_hpp
 #define cf3_solver_actions_Proto_NodeLooper_hpp
 
+#include "common/RegionProfiler.hpp"
+#include "common/PE/CommPattern.hpp"
+
 #include "mesh/Functions.hpp"
 
 #include "FieldSync.hpp"
@@ -137,17 +140,6 @@ struct NodeLooperDim
       dict = mesh.geometry_fields().handle<mesh::Dictionary>(); // fall back to the geometry if the dict is not found by tag
 
     const mesh::Field& coordinates = dict->coordinates();
-    DataT node_data(m_variables, m_region, coordinates, m_expr);
-
-    // Wrap things up so that we can store the intermediate product results
-    do_run(WrapExpression()(m_expr, 0, node_data), node_data, *dict);
-  }
-
-private:
-  template<typename FilteredExprT>
-  void do_run(const FilteredExprT& expr, DataT& data, const mesh::Dictionary& dict) const
-  {
-    NodeGrammar grammar;
 
     // Build a list of used entities
     std::vector< Handle<mesh::Entities const> > used_entities;
@@ -156,9 +148,59 @@ private:
       used_entities.push_back(entities.handle<mesh::Entities>());
     }
 
-    boost::shared_ptr< common::List<Uint> > used_nodes_ptr = mesh::build_used_nodes_list(used_entities, dict, true);
-
+    boost::shared_ptr< common::List<Uint> > used_nodes_ptr = mesh::build_used_nodes_list(used_entities, *dict, true);
     const common::List<Uint>& nodes = *used_nodes_ptr;
+
+    Handle<common::PE::CommPattern const> comm_pattern(dict->get_child("CommPattern"));
+    if(common::PE::Comm::instance().is_active() && common::PE::Comm::instance().size() > 1 && is_not_null(comm_pattern))
+    {
+      // Nodes that are ghosts here or on another rank are visited first, so the fields they change can be synchronized
+      // while the remaining nodes are visited. This only changes the visiting order, since each node only uses its own values.
+      std::vector<bool> is_boundary(dict->size(), false);
+      BOOST_FOREACH(const int node, comm_pattern->send_map())
+      {
+        is_boundary[node] = true;
+      }
+      std::vector<Uint> boundary_nodes, interior_nodes;
+      const Uint nb_nodes = nodes.size();
+      for(Uint i = 0; i != nb_nodes; ++i)
+      {
+        const Uint node = nodes[i];
+        if(is_boundary[node] || dict->is_ghost(node))
+          boundary_nodes.push_back(node);
+        else
+          interior_nodes.push_back(node);
+      }
+
+      // The node data registers the fields to synchronize when it goes out of scope
+      {
+        DataT node_data(m_variables, m_region, coordinates, m_expr);
+        do_run(WrapExpression()(m_expr, 0, node_data), node_data, boundary_nodes);
+      }
+      FieldSynchronizer::instance().begin_synchronize();
+      {
+        common::ScopedRegion region(m_region, "/for_each_node_interior");
+        DataT node_data(m_variables, m_region, coordinates, m_expr);
+        do_run(WrapExpression()(m_expr, 0, node_data), node_data, interior_nodes);
+      }
+      // Interior nodes are not sent, so they don't need another synchronization
+      FieldSynchronizer::instance().clear();
+      FieldSynchronizer::instance().end_synchronize();
+      return;
+    }
+
+    DataT node_data(m_variables, m_region, coordinates, m_expr);
+
+    // Wrap things up so that we can store the intermediate product results
+    do_run(WrapExpression()(m_expr, 0, node_data), node_data, nodes.array());
+  }
+
+private:
+  template<typename FilteredExprT, typename NodesT>
+  void do_run(const FilteredExprT& expr, DataT& data, const NodesT& nodes) const
+  {
+    NodeGrammar grammar;
+
     const Uint nb_nodes = nodes.size();
     for(Uint i = 0; i != nb_nodes; ++i)
     {
@@ -223,7 +265,10 @@ struct NodeLooper
       return;
 
     // Execute with known dimension
-    NodeLooperDim<ExprT, NbDimsT>(m_expr, m_region, m_variables)();
+    {
+      common::ScopedRegion region(m_region, "/for_each_node");
+      NodeLooperDim<ExprT, NbDimsT>(m_expr, m_region, m_variables)();
+    }
 
     FieldSynchronizer::instance().synchronize();
   }
@@ -4,8 +4,13 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <cstring>
+#include <set>
+
 #include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/function.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 
 #include "common/Builder.hpp"
@@ -13,12 +18,16 @@
 #include "common/OptionComponent.hpp"
 #include "common/URI.hpp"
 
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 
 #include "physics/PhysModel.hpp"
 
 #include "solver/Tags.hpp"
 
+#include "ElementColoring.hpp"
 #include "ProtoAction.hpp"
 #include "Expression.hpp"
 
@@ -33,6 +42,24 @@ using namespace physics;
 
 ComponentBuilder < ProtoAction, common::Action, LibSolver > ProtoAction_Builder;
 
+namespace detail
+{
+  /// Combine the raw bits of all values in the field with the stamp, so even changes that compare equal as Real are detected
+  void hash_field(std::size_t& stamp, const Field& field)
+  {
+    const Field::ArrayT& array = field.array();
+    const Real* values = array.data();
+    const Uint nb_values = array.num_elements();
+    boost::hash_combine(stamp, nb_values);
+    for(Uint i = 0; i != nb_values; ++i)
+    {
+      boost::uint64_t bits = 0;
+      std::memcpy(&bits, values + i, sizeof(Real));
+      boost::hash_combine(stamp, bits);
+    }
+  }
+}
+
 struct ProtoAction::Implementation
 {
   Implementation(Component& comp, const Handle<PhysModel>& physical_model) :
@@ -101,12 +128,20 @@ struct ProtoAction::Implementation
   };
   
   boost::ptr_vector<PhysicsConstantLink> m_physics_links;
+
+  /// Dependencies declared using add_dependency
+  std::vector<const Real*> m_value_dependencies;
+  std::vector<const Option*> m_option_dependencies;
 };
 
 ProtoAction::ProtoAction(const std::string& name) :
   Action(name),
   m_implementation(new Implementation(*this, m_physical_model))
 {
+  options().add("element_threads", 1u)
+    .pretty_name("Element Threads")
+    .description("Number of threads for element loops. Values above 1 color the elements and require the expression to only modify fields and linear systems.");
+  options().option("element_threads").add_tag("performance");
 }
 
 ProtoAction::~ProtoAction()
@@ -118,6 +153,8 @@ void ProtoAction::execute()
   if(m_loop_regions.empty())
     CFwarn << "No regions to loop over for action " << uri().string() << CFendl;
 
+  ScopedElementThreads element_threads(options().value<Uint>("element_threads"));
+
   boost_foreach(const Handle< Region >& region, m_loop_regions)
   {
     if(is_null(m_implementation->m_expression))
@@ -151,6 +188,74 @@ void ProtoAction::insert_field_info(std::map<std::string, std::string>& tags) co
   m_implementation->m_expression->insert_field_info(tags);
 }
 
+void ProtoAction::add_dependency(const Real& value)
+{
+  m_implementation->m_value_dependencies.push_back(&value);
+}
+
+void ProtoAction::add_dependency(const Option& option)
+{
+  m_implementation->m_option_dependencies.push_back(&option);
+}
+
+std::size_t ProtoAction::dependency_stamp() const
+{
+  std::size_t stamp = 0;
+
+  if(is_null(m_implementation->m_expression))
+    return stamp;
+
+  // Fields are looked up by tag, like the expression does during the loop
+  std::map<std::string, std::string> field_info;
+  m_implementation->m_expression->insert_field_info(field_info);
+  std::set<std::string> tags;
+  for(std::map<std::string, std::string>::const_iterator it = field_info.begin(); it != field_info.end(); ++it)
+    tags.insert(it->second);
+
+  std::set<Mesh*> meshes;
+  boost_foreach(const Handle< Region >& region, m_loop_regions)
+  {
+    boost::hash_combine(stamp, region->uri().path());
+    Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*region);
+    if(is_null(mesh) || !meshes.insert(mesh.get()).second)
+      continue;
+
+    detail::hash_field(stamp, mesh->geometry_fields().coordinates());
+    boost_foreach(const std::string& tag, tags)
+    {
+      Handle<Field> field = find_component_ptr_recursively_with_tag<Field>(*mesh, tag);
+      if(is_not_null(field))
+        detail::hash_field(stamp, *field);
+    }
+  }
+
+  for(OptionList::const_iterator it = options().begin(); it != options().end(); ++it)
+  {
+    if(it->second->has_tag("performance"))
+      continue;
+    boost::hash_combine(stamp, it->first);
+    boost::hash_combine(stamp, it->second->value_str());
+  }
+
+  PhysicsConstantStorage::ScalarsT& physics_constants = m_implementation->m_expression->physics_constants().scalars();
+  for(PhysicsConstantStorage::ScalarsT::const_iterator it = physics_constants.begin(); it != physics_constants.end(); ++it)
+  {
+    boost::hash_combine(stamp, it->first);
+    boost::hash_combine(stamp, it->second);
+  }
+
+  boost_foreach(const Real* value, m_implementation->m_value_dependencies)
+  {
+    boost::hash_combine(stamp, *value);
+  }
+
+  boost_foreach(const Option* option, m_implementation->m_option_dependencies)
+  {
+    boost::hash_combine(stamp, option->value_str());
+  }
+
+  return stamp;
+}
 
 boost::shared_ptr< ProtoAction > create_proto_action(const std::string& name, const boost::shared_ptr< Expression >& expression)
 {
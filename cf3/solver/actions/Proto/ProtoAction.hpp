@@ -13,7 +13,7 @@
 #include "solver/Action.hpp"
 
 namespace cf3 {
-  namespace common { template<typename T> class OptionComponent; }
+  namespace common { template<typename T> class OptionComponent; class Option; }
   namespace mesh { class Region; }
   namespace physics { class PhysModel; }
 namespace solver {
@@ -47,6 +47,18 @@ public:
   /// Append the tags used in the expression
   void insert_field_info(std::map<std::string, std::string>& tags) const;
 
+  /// Declare a value that the expression uses through a literal, e.g. lit(dt), so it is part of the dependency stamp.
+  /// The referenced value must outlive this action.
+  void add_dependency(const Real& value);
+
+  /// Declare an option of another component that changes the result of the expression, e.g. a solver option linked to data used in the expression
+  void add_dependency(const common::Option& option);
+
+  /// Stamp that changes when any of the inputs of the expression changes: the coordinates and the fields it uses, its own options,
+  /// the physics constants and the declared dependencies. If the stamp is the same as for a previous execution, executing
+  /// again gives the same result. Options tagged "performance" (such as element_threads) don't change the result and are left out.
+  std::size_t dependency_stamp() const;
+
 private:
   class Implementation;
   boost::scoped_ptr<Implementation> m_implementation;
@@ -4,8 +4,11 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <cstring>
+
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "common/Builder.hpp"
 #include "common/OptionList.hpp"
@@ -38,6 +41,59 @@ common::ComponentBuilder < ReadRestartFile, common::Action, LibActions > ReadRes
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Read the fields from a single-file restart, as written by WriteRestartFile with the single_file option.
+/// The file is memory-mapped, and each local row (including ghosts) is copied from the position given by its
+/// global index, so no communication is needed and the number of CPUs may differ from the one used for writing.
+void read_single_file(const common::XML::XmlNode& restart_node, mesh::Mesh& mesh)
+{
+  const std::string path = restart_node.attribute_value("binary_file");
+  if(common::from_str<Uint>(restart_node.attribute_value("real_size")) != sizeof(Real))
+    throw common::FileFormatError(FromHere(), "File " + path + " was written with " + restart_node.attribute_value("real_size") + " byte reals, expected " + common::to_str(static_cast<Uint>(sizeof(Real))));
+
+  boost::iostreams::mapped_file_source mapped_file(path);
+  if(!mapped_file.is_open())
+    throw common::FileSystemError(FromHere(), "Could not map file " + path);
+
+  static const std::string magic("CF3RST02");
+  if(mapped_file.size() < magic.size() || std::strncmp(mapped_file.data(), magic.data(), magic.size()) != 0)
+    throw common::FileFormatError(FromHere(), "File " + path + " is not a single-file restart");
+
+  common::XML::XmlNode field_node(restart_node.content->first_node("field"));
+  for(; field_node.is_valid(); field_node.content = field_node.content->next_sibling("field"))
+  {
+    Handle<mesh::Field> field(mesh.access_component(common::URI(field_node.attribute_value("path"), common::URI::Scheme::CPATH)));
+    if(is_null(field))
+      throw common::SetupError(FromHere(), "Field " + field_node.attribute_value("path") + " was not found in mesh " + mesh.uri().path());
+
+    const std::size_t offset = common::from_str<std::size_t>(field_node.attribute_value("offset"));
+    const Uint nb_rows = common::from_str<Uint>(field_node.attribute_value("nb_rows"));
+    const Uint row_size = common::from_str<Uint>(field_node.attribute_value("row_size"));
+    if(row_size != field->row_size())
+      throw common::FileFormatError(FromHere(), "Field " + field->uri().path() + " has row size " + common::to_str(field->row_size()) + " but file " + path + " stores rows of size " + common::to_str(row_size));
+    if(offset + static_cast<std::size_t>(nb_rows) * row_size * sizeof(Real) > mapped_file.size())
+      throw common::FileFormatError(FromHere(), "File " + path + " is too small for field " + field->uri().path());
+
+    const Real* data = reinterpret_cast<const Real*>(mapped_file.data() + offset);
+    const common::List<Uint>& gids = field->dict().glb_idx();
+    const Uint nb_local_rows = field->size();
+    for(Uint i = 0; i != nb_local_rows; ++i)
+    {
+      const Uint gid = gids[i];
+      if(gid >= nb_rows)
+        throw common::FileFormatError(FromHere(), "Global index " + common::to_str(gid) + " of field " + field->uri().path() + " is not in file " + path);
+      const Real* row_begin = data + static_cast<std::size_t>(gid) * row_size;
+      std::copy(row_begin, row_begin + row_size, (*field)[i].begin());
+    }
+  }
+}
+
+} // detail
+
+///////////////////////////////////////////////////////////////////////////////////////
+
 ReadRestartFile::ReadRestartFile ( const std::string& name ) :
   common::Action(name)
 {  
@@ -88,7 +144,14 @@ void ReadRestartFile::execute()
     time->options().set("iteration", common::from_str<Uint>(restart_node.attribute_value("iteration")));
   }
 
-  if(common::from_str<Uint>(restart_node.attribute_value("version")) != 1)
+  const Uint version = common::from_str<Uint>(restart_node.attribute_value("version"));
+  if(version == 2)
+  {
+    detail::read_single_file(restart_node, *mesh);
+    return;
+  }
+
+  if(version != 1)
     throw common::FileFormatError(FromHere(), "File  " + filepath.path() + " has unsupported version");
 
   common::PE::Comm& comm = common::PE::Comm::instance();
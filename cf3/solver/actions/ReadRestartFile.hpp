@@ -19,6 +19,9 @@ namespace actions {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 /// Read out a restartfile, designed to be loaded into an already-created mesh
+///
+/// Single-file restarts are memory-mapped and every CPU reads the rows matching its global indices,
+/// so they can be loaded on a different number of CPUs than the one used for writing.
 class solver_actions_API ReadRestartFile : public common::Action
 {
 public: // functions
@@ -4,16 +4,26 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+#include <fstream>
+
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/Signal.hpp"
 #include "common/FindComponents.hpp"
 #include "common/OptionList.hpp"
 #include "common/List.hpp"
 #include "common/BinaryDataWriter.hpp"
 #include "common/XML/FileOperations.hpp"
 
+#include "common/PE/Comm.hpp"
+#include "common/PE/all_reduce.hpp"
+#include "common/PE/datatype.hpp"
+
 #include "mesh/Dictionary.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Field.hpp"
@@ -38,6 +48,195 @@ common::ComponentBuilder < WriteRestartFile, common::Action, LibActions > WriteR
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Layout of one field in a single-file restart
+struct RestartFieldLayout
+{
+  std::size_t offset;
+  Uint nb_rows;
+  Uint row_size;
+};
+
+/// Global number of rows of a dictionary, i.e. the largest global index plus one
+Uint global_nb_rows(const mesh::Dictionary& dict)
+{
+  const common::List<Uint>& gids = dict.glb_idx();
+  Uint local_max = 0;
+  const Uint nb_local_rows = gids.size();
+  for(Uint i = 0; i != nb_local_rows; ++i)
+    local_max = std::max(local_max, gids[i]+1);
+
+  Uint result = local_max;
+  if(common::PE::Comm::instance().is_active())
+    common::PE::Comm::instance().all_reduce(common::PE::max(), &local_max, 1, &result);
+  return result;
+}
+
+/// Local indices of the rows owned by this rank, sorted by global index
+void owned_rows_by_gid(const mesh::Dictionary& dict, std::vector<Uint>& owned_rows)
+{
+  const common::List<Uint>& gids = dict.glb_idx();
+  owned_rows.clear();
+  const Uint nb_local_rows = gids.size();
+  for(Uint i = 0; i != nb_local_rows; ++i)
+  {
+    if(!dict.is_ghost(i))
+      owned_rows.push_back(i);
+  }
+
+  std::vector< std::pair<Uint, Uint> > sorted(owned_rows.size());
+  for(Uint i = 0; i != owned_rows.size(); ++i)
+    sorted[i] = std::make_pair(gids[owned_rows[i]], owned_rows[i]);
+  std::sort(sorted.begin(), sorted.end());
+  for(Uint i = 0; i != owned_rows.size(); ++i)
+    owned_rows[i] = sorted[i].second;
+}
+
+/// Write the fields into a single file, in global index order, using collective MPI-IO.
+/// Each field is stored as a dense row-major array of Real, starting at layouts[i].offset.
+void write_single_file(const std::string& path, const std::vector< Handle<mesh::Field> >& fields, std::vector<RestartFieldLayout>& layouts)
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  static const std::string magic("CF3RST02");
+
+  // Compute the file layout, identical on all ranks
+  layouts.resize(fields.size());
+  std::size_t offset = magic.size();
+  for(Uint i = 0; i != fields.size(); ++i)
+  {
+    layouts[i].offset = offset;
+    layouts[i].nb_rows = global_nb_rows(fields[i]->dict());
+    layouts[i].row_size = fields[i]->row_size();
+    offset += static_cast<std::size_t>(layouts[i].nb_rows) * layouts[i].row_size * sizeof(Real);
+  }
+
+  std::vector<Uint> owned_rows;
+  std::vector<Real> buffer;
+
+  if(!comm.is_active())
+  {
+    std::ofstream out_file(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if(!out_file)
+      throw common::FileSystemError(FromHere(), "Could not open file " + path + " for writing");
+    out_file.write(magic.data(), magic.size());
+    for(Uint i = 0; i != fields.size(); ++i)
+    {
+      const mesh::Field& field = *fields[i];
+      const common::List<Uint>& gids = field.dict().glb_idx();
+      const Uint row_size = layouts[i].row_size;
+      buffer.assign(static_cast<std::size_t>(layouts[i].nb_rows) * row_size, 0.);
+      owned_rows_by_gid(field.dict(), owned_rows);
+      BOOST_FOREACH(const Uint row, owned_rows)
+        std::copy(field[row].begin(), field[row].end(), buffer.begin() + static_cast<std::size_t>(gids[row]) * row_size);
+      out_file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size() * sizeof(Real));
+    }
+    return;
+  }
+
+  MPI_File file_handle;
+  MPI_CHECK_RESULT(MPI_File_open, (comm.communicator(), const_cast<char*>(path.c_str()), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &file_handle));
+  MPI_CHECK_RESULT(MPI_File_set_size, (file_handle, static_cast<MPI_Offset>(offset)));
+
+  if(comm.rank() == 0)
+    MPI_CHECK_RESULT(MPI_File_write_at, (file_handle, 0, const_cast<char*>(magic.data()), magic.size(), MPI_CHAR, MPI_STATUS_IGNORE));
+
+  MPI_Datatype real_type = common::PE::get_mpi_datatype<Real>();
+  std::vector<MPI_Aint> displacements;
+  for(Uint i = 0; i != fields.size(); ++i)
+  {
+    const mesh::Field& field = *fields[i];
+    const common::List<Uint>& gids = field.dict().glb_idx();
+    const Uint row_size = layouts[i].row_size;
+    owned_rows_by_gid(field.dict(), owned_rows);
+    const Uint nb_owned = owned_rows.size();
+
+    // Pack the owned rows and describe where they go in the file
+    buffer.resize(static_cast<std::size_t>(nb_owned) * row_size);
+    displacements.resize(nb_owned);
+    for(Uint j = 0; j != nb_owned; ++j)
+    {
+      const Uint row = owned_rows[j];
+      std::copy(field[row].begin(), field[row].end(), buffer.begin() + static_cast<std::size_t>(j) * row_size);
+      displacements[j] = static_cast<MPI_Aint>(gids[row]) * row_size * sizeof(Real);
+    }
+
+    MPI_Datatype file_type;
+    MPI_CHECK_RESULT(MPI_Type_create_hindexed_block, (nb_owned, row_size, displacements.empty() ? 0 : &displacements[0], real_type, &file_type));
+    MPI_CHECK_RESULT(MPI_Type_commit, (&file_type));
+    MPI_CHECK_RESULT(MPI_File_set_view, (file_handle, static_cast<MPI_Offset>(layouts[i].offset), real_type, file_type, const_cast<char*>("native"), MPI_INFO_NULL));
+    MPI_CHECK_RESULT(MPI_File_write_all, (file_handle, buffer.empty() ? 0 : &buffer[0], buffer.size(), real_type, MPI_STATUS_IGNORE));
+    MPI_CHECK_RESULT(MPI_Type_free, (&file_type));
+  }
+
+  MPI_CHECK_RESULT(MPI_File_close, (&file_handle));
+}
+
+/// Write the XML restart file for the per-CPU format, on rank 0 only
+void write_restart_index(const common::URI& out_file_path, const common::URI& binfile, const Uint nb_procs, const Real current_time, const Real time_step, const Uint iteration,
+                         const std::vector<std::string>& relative_paths, const std::vector<Uint>& indices)
+{
+  if(common::PE::Comm::instance().rank() != 0)
+    return;
+
+  common::XML::XmlDoc xml_doc("1.0", "ISO-8859-1");
+  common::XML::XmlNode restart_node = xml_doc.add_node("restart");
+  restart_node.set_attribute("version", "1");
+  restart_node.set_attribute("binary_file", binfile.path());
+  restart_node.set_attribute("nb_procs", common::to_str(nb_procs));
+  restart_node.set_attribute("current_time", common::to_str(current_time));
+  restart_node.set_attribute("time_step", common::to_str(time_step));
+  restart_node.set_attribute("iteration", common::to_str(iteration));
+
+  for(Uint i = 0; i != relative_paths.size(); ++i)
+  {
+    common::XML::XmlNode field_node = restart_node.add_node("field");
+    field_node.set_attribute("path", relative_paths[i]);
+    field_node.set_attribute("index", common::to_str(indices[i]));
+  }
+
+  common::XML::to_file(xml_doc, out_file_path);
+}
+
+} // detail
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+/// Copy of the data for a restart that is written on a separate thread
+struct WriteRestartFile::PendingWrite
+{
+  /// Compress and write the snapshots. Runs on the I/O thread, without any communication
+  void run()
+  {
+    try
+    {
+      BOOST_FOREACH(const boost::shared_ptr< common::Table<Real> >& snapshot, snapshots)
+      {
+        writer->append_local_data(*snapshot);
+      }
+    }
+    catch(std::exception& e)
+    {
+      error = e.what();
+    }
+  }
+
+  boost::shared_ptr<common::BinaryDataWriter> writer;
+  std::vector< boost::shared_ptr< common::Table<Real> > > snapshots;
+  std::vector<std::string> relative_paths;
+  common::URI out_file_path;
+  common::URI binfile;
+  Uint nb_procs;
+  Real current_time;
+  Real time_step;
+  Uint iteration;
+  boost::thread thread;
+  std::string error;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+
 WriteRestartFile::WriteRestartFile ( const std::string& name ) :
   common::Action(name)
 {
@@ -55,6 +254,42 @@ WriteRestartFile::WriteRestartFile ( const std::string& name ) :
     .pretty_name("Time")
     .description("Time component, used to extract timing and iteration information")
     .mark_basic();
+
+  options().add("single_file", false)
+    .pretty_name("Single File")
+    .description("Write all data into one file, in global index order, using MPI-IO. Such a file can be read on any number of CPUs.")
+    .mark_basic();
+
+  options().add("asynchronous", false)
+    .pretty_name("Asynchronous")
+    .description("Copy the fields and compress and write them on a separate thread, while the solver continues")
+    .mark_basic();
+
+  options().add("max_pending_writes", 1u)
+    .pretty_name("Max Pending Writes")
+    .description("Maximum number of asynchronous restarts in progress. Each one holds a copy of the fields.");
+
+  options().add("compression_threads", 1u)
+    .pretty_name("Compression Threads")
+    .description("Number of threads used to compress large fields in the per-CPU format. 0 uses all hardware threads.");
+
+  regist_signal( "wait" )
+    .connect( boost::bind( &WriteRestartFile::signal_wait, this, _1 ) )
+    .description("Wait until all asynchronous writes are complete")
+    .pretty_name("Wait");
+}
+
+WriteRestartFile::~WriteRestartFile()
+{
+  // Completing a restart needs communication, which can't happen here, so unfinished restarts are dropped
+  if(!m_pending_writes.empty())
+    CFwarn << "Dropping " << m_pending_writes.size() << " incomplete asynchronous restart(s) in " << uri().path() << ". Call wait() before the end of the simulation." << CFendl;
+
+  BOOST_FOREACH(const boost::shared_ptr<PendingWrite>& pending, m_pending_writes)
+  {
+    pending->thread.join();
+    pending->writer->discard();
+  }
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -83,33 +318,141 @@ void WriteRestartFile::execute()
   cf3_assert(is_not_null(mesh));
   
   const common::URI out_file_path = options().value<common::URI>("file");
-  const common::URI binfile = out_file_path.base_path() / (out_file_path.base_name() + ".cfbinxml");
-  boost::shared_ptr<common::BinaryDataWriter> data_writer = common::allocate_component<common::BinaryDataWriter>("DataWriter");
-  data_writer->options().set("file", binfile);
-  
-  common::XML::XmlDoc xml_doc("1.0", "ISO-8859-1");
-  common::XML::XmlNode restart_node = xml_doc.add_node("restart");
-  restart_node.set_attribute("version", "1");
-  restart_node.set_attribute("binary_file", binfile.path());
-  restart_node.set_attribute("nb_procs", common::to_str(comm.size()));
-  restart_node.set_attribute("current_time", common::to_str(time->current_time()));
-  restart_node.set_attribute("time_step", common::to_str(time->dt()));
-  restart_node.set_attribute("iteration", common::to_str(time->iter()));
-  
+  const bool single_file = options().value<bool>("single_file");
+  const bool asynchronous = options().value<bool>("asynchronous");
+  if(single_file && asynchronous)
+    throw common::SetupError(FromHere(), "Asynchronous writing is not supported for single-file restarts in " + uri().path());
+
   const std::string base_path = mesh->uri().path() + "/";
-  
+  std::vector<std::string> relative_paths;
   BOOST_FOREACH(const Handle<mesh::Field>& field, fields)
   {
-    common::XML::XmlNode field_node = restart_node.add_node("field");
     std::string relative_path = field->uri().path();
     boost::replace_first(relative_path, base_path, "");
     cf3_assert(relative_path.size() == field->uri().path().size() - base_path.size());
-    field_node.set_attribute("path", relative_path);
-    field_node.set_attribute("index", common::to_str(data_writer->append_data(*field)));
+    relative_paths.push_back(relative_path);
   }
 
-  if(comm.rank() == 0)
-    common::XML::to_file(xml_doc, out_file_path);
+  if(single_file)
+  {
+    const common::URI binfile = out_file_path.base_path() / (out_file_path.base_name() + ".cfrestart");
+    std::vector<detail::RestartFieldLayout> layouts;
+    detail::write_single_file(binfile.path(), fields, layouts);
+
+    common::XML::XmlDoc xml_doc("1.0", "ISO-8859-1");
+    common::XML::XmlNode restart_node = xml_doc.add_node("restart");
+    restart_node.set_attribute("version", "2");
+    restart_node.set_attribute("binary_file", binfile.path());
+    restart_node.set_attribute("nb_procs", common::to_str(comm.size()));
+    restart_node.set_attribute("current_time", common::to_str(time->current_time()));
+    restart_node.set_attribute("time_step", common::to_str(time->dt()));
+    restart_node.set_attribute("iteration", common::to_str(time->iter()));
+    restart_node.set_attribute("real_size", common::to_str(static_cast<Uint>(sizeof(Real))));
+    for(Uint i = 0; i != fields.size(); ++i)
+    {
+      common::XML::XmlNode field_node = restart_node.add_node("field");
+      field_node.set_attribute("path", relative_paths[i]);
+      field_node.set_attribute("offset", common::to_str(layouts[i].offset));
+      field_node.set_attribute("nb_rows", common::to_str(layouts[i].nb_rows));
+      field_node.set_attribute("row_size", common::to_str(layouts[i].row_size));
+    }
+
+    if(comm.rank() == 0)
+      common::XML::to_file(xml_doc, out_file_path);
+    return;
+  }
+
+  const common::URI binfile = out_file_path.base_path() / (out_file_path.base_name() + ".cfbinxml");
+  boost::shared_ptr<common::BinaryDataWriter> data_writer = common::allocate_component<common::BinaryDataWriter>("DataWriter");
+  data_writer->options().set("file", binfile);
+  data_writer->options().set("compression_threads", options().value<Uint>("compression_threads"));
+
+  if(asynchronous)
+  {
+    // Make room for the new write
+    const Uint max_pending = std::max(1u, options().value<Uint>("max_pending_writes"));
+    while(m_pending_writes.size() >= max_pending)
+      complete_oldest_write();
+
+    boost::shared_ptr<PendingWrite> pending(new PendingWrite());
+    pending->writer = data_writer;
+    pending->relative_paths = relative_paths;
+    pending->out_file_path = out_file_path;
+    pending->binfile = binfile;
+    pending->nb_procs = comm.size();
+    pending->current_time = time->current_time();
+    pending->time_step = time->dt();
+    pending->iteration = time->iter();
+
+    // Snapshot the field data, so the solver can modify the fields while writing
+    BOOST_FOREACH(const Handle<mesh::Field>& field, fields)
+    {
+      boost::shared_ptr< common::Table<Real> > snapshot = common::allocate_component< common::Table<Real> >(field->name());
+      snapshot->set_row_size(field->row_size());
+      snapshot->resize(field->size());
+      snapshot->array() = field->array();
+      pending->snapshots.push_back(snapshot);
+    }
+
+    // Opening the file needs the rank, so this must happen on the main thread
+    data_writer->open();
+    pending->thread = boost::thread(boost::bind(&PendingWrite::run, pending.get()));
+    m_pending_writes.push_back(pending);
+    return;
+  }
+
+  std::vector<Uint> indices;
+  BOOST_FOREACH(const Handle<mesh::Field>& field, fields)
+  {
+    indices.push_back(data_writer->append_data(*field));
+  }
+  data_writer->close();
+
+  detail::write_restart_index(out_file_path, binfile, comm.size(), time->current_time(), time->dt(), time->iter(), relative_paths, indices);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void WriteRestartFile::complete_oldest_write()
+{
+  cf3_assert(!m_pending_writes.empty());
+  boost::shared_ptr<PendingWrite> pending = m_pending_writes.front();
+  m_pending_writes.pop_front();
+
+  pending->thread.join();
+
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  if(pending->nb_procs > 1 && !comm.is_active())
+    throw common::ParallelError(FromHere(), "Parallel environment was stopped before restart file " + pending->out_file_path.path() + " was completed");
+
+  // Error status must be known on all CPUs before the collective index writing
+  Uint local_error = pending->error.empty() ? 0 : 1;
+  Uint global_error = local_error;
+  if(comm.is_active())
+    comm.all_reduce(common::PE::max(), &local_error, 1, &global_error);
+  if(global_error != 0)
+    throw common::FileSystemError(FromHere(), "Asynchronous write of restart file " + pending->out_file_path.path() + " failed" + (pending->error.empty() ? std::string(" on another CPU") : ": " + pending->error));
+
+  const Uint first_index = pending->writer->register_local_blocks();
+  pending->writer->close();
+
+  std::vector<Uint> indices(pending->relative_paths.size());
+  for(Uint i = 0; i != indices.size(); ++i)
+    indices[i] = first_index + i;
+  detail::write_restart_index(pending->out_file_path, pending->binfile, pending->nb_procs, pending->current_time, pending->time_step, pending->iteration, pending->relative_paths, indices);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void WriteRestartFile::wait()
+{
+  while(!m_pending_writes.empty())
+    complete_oldest_write();
+}
+
+void WriteRestartFile::signal_wait(common::SignalArgs& args)
+{
+  wait();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,10 @@
 #ifndef cf3_solver_actions_WriteRestartFile_hpp
 #define cf3_solver_actions_WriteRestartFile_hpp
 
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+
 #include "common/Action.hpp"
 #include "solver/actions/LibActions.hpp"
 
@@ -19,6 +23,17 @@ namespace actions {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 /// Write out a restartfile, designed to be loaded into an already-created mesh
+///
+/// By default, each CPU writes its own compressed file through common::BinaryDataWriter, so the restart
+/// must be loaded on the same number of CPUs. With the single_file option, all CPUs write collectively
+/// into one uncompressed file, with the rows of each field stored in global index order. Such a file
+/// can be loaded on any number of CPUs, provided the global indices of the mesh are the same.
+///
+/// With the asynchronous option, the per-CPU format is used and execute only copies the fields. Compression and
+/// writing happen on a separate thread while the solver continues. At most max_pending_writes restarts can be in
+/// progress: the next execute waits for the oldest one. A restart is only complete after its index files are written,
+/// which happens on all CPUs together in execute or wait(), so the XML restart file never refers to incomplete data.
+/// wait() must therefore be called at the end of the simulation: restarts that are still pending on destruction are dropped.
 class solver_actions_API WriteRestartFile : public common::Action
 {
 public: // functions
@@ -26,14 +41,29 @@ public: // functions
   /// @param name of the component
   WriteRestartFile ( const std::string& name );
 
-  /// Virtual destructor
-  virtual ~WriteRestartFile() {}
+  /// Virtual destructor. Waits for the threads of asynchronous writes that are still in progress, but
+  /// does not complete their restart files, since that needs communication.
+  virtual ~WriteRestartFile();
 
   /// Get the class name
   static std::string type_name () { return "WriteRestartFile"; }
 
   /// execute the action
   virtual void execute ();
+
+  /// Wait until all asynchronous writes are complete. Must be called on all CPUs.
+  void wait();
+
+  void signal_wait(common::SignalArgs& args);
+
+private:
+  struct PendingWrite;
+
+  /// Finish the oldest asynchronous write and write its index files
+  void complete_oldest_write();
+
+  /// Asynchronous writes that were started but not yet completed, oldest first
+  std::deque< boost::shared_ptr<PendingWrite> > m_pending_writes;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////
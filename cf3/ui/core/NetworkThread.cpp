@@ -161,6 +161,7 @@ void NetworkThread::run()
   // [thread execution starts here]
 
   m_connection = TCPConnection::create( *m_io_service );
+  m_connection->set_binary_frames( true ); // XML is used until the other side supports it
   m_connection->socket().async_connect( *m_endpoint,
                                         boost::bind( &NetworkThread::callback_connect,
                                                      this,
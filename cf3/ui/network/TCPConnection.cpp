@@ -9,10 +9,14 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "common/BasicExceptions.hpp"
 #include "common/StringConversion.hpp"
 
+#include "rapidxml/rapidxml.hpp"
+
 #include "common/XML/SignalFrame.hpp"
 #include "common/XML/FileOperations.hpp"
+#include "common/XML/Protocol.hpp"
 
 #include "ui/network/ErrorHandler.hpp"
 #include "ui/network/TCPConnection.hpp"
@@ -30,6 +34,14 @@ namespace network {
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+  /// Attribute of the root node of XML frames that advertises binary frame support
+  const char * binary_attribute() { return "binary"; }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 TCPConnection::Ptr TCPConnection::create( asio::io_service & ios )
 {
   return Ptr( new TCPConnection(ios) );
@@ -39,6 +51,9 @@ TCPConnection::Ptr TCPConnection::create( asio::io_service & ios )
 
 TCPConnection::TCPConnection( asio::io_service & io_service )
   : m_socket(io_service),
+    m_incoming_binary(false),
+    m_binary_enabled(false),
+    m_peer_binary(false),
     m_incoming_data(nullptr),
     m_incoming_data_size(0)
 {
@@ -60,15 +75,51 @@ void TCPConnection::prepare_write_buffers( SignalArgs & args,
 {
   cf3_assert( args.node.is_valid() );
 
-  // prepare the outgoing data: flush to XML and convert to string
-  args.flush_maps();
+  std::ostringstream header_stream;
+  const Uint schema_size = m_encoder.schema_size();
 
-  XML::to_string( *args.xml_doc.get(), m_outgoing_data );
+  if( sends_binary_frames() )
+  {
+    // flushes the maps and encodes the frame
+    m_encoder.encode( args, m_outgoing_data );
 
-  // create the header on HEADER_LENGTH characters
-  std::ostringstream header_stream;
+    // create the header: the mark and the size in hexadecimal
+    header_stream << BINARY_HEADER_MARK << std::hex << std::setw(HEADER_LENGTH - 1)
+                  << m_outgoing_data.length();
+  }
+  else
+  {
+    // prepare the outgoing data: flush to XML and convert to string
+    args.flush_maps();
+
+    if( m_binary_enabled )
+    {
+      // advertise binary frames in the sent text only, the caller's document is restored afterwards
+      XmlNode doc_node = Protocol::goto_doc_node( *args.xml_doc.get() );
+      rapidxml::xml_attribute<>* old_attr = doc_node.content->first_attribute( binary_attribute() );
+      const std::string old_value = is_not_null(old_attr) ? std::string( old_attr->value(), old_attr->value_size() ) : std::string();
+
+      doc_node.set_attribute( binary_attribute(), "1" );
+      XML::to_string( *args.xml_doc.get(), m_outgoing_data );
+
+      if( is_not_null(old_attr) )
+        doc_node.set_attribute( binary_attribute(), old_value );
+      else
+        doc_node.content->remove_attribute( doc_node.content->first_attribute( binary_attribute() ) );
+    }
+    else
+      XML::to_string( *args.xml_doc.get(), m_outgoing_data );
+
+    // create the header on HEADER_LENGTH characters
+    header_stream << std::setw(HEADER_LENGTH) << m_outgoing_data.length();
+  }
 
-  header_stream << std::setw(HEADER_LENGTH) << m_outgoing_data.length();
+  if( header_stream.str().length() != HEADER_LENGTH )
+  {
+    // the frame is not sent, so the peer never sees the strings it added to the schema
+    m_encoder.rollback_schema( schema_size );
+    throw NotSupported( FromHere(), "Frame of " + to_str(m_outgoing_data.length()) + " bytes is too large to be sent." );
+  }
 
   m_outgoing_header = header_stream.str();
 
@@ -85,9 +136,22 @@ void TCPConnection::process_header( boost::system::error_code & error )
 
   try
   {
-    // trim the string to remove the leading spaces (cast fails if spaces are present)
-    boost::algorithm::trim( header_str );
-    m_incoming_data_size = boost::lexical_cast<cf3::Uint> ( header_str );
+    m_incoming_binary = ( m_incoming_header[0] == BINARY_HEADER_MARK );
+
+    if( m_incoming_binary )
+    {
+      std::istringstream size_stream( header_str.substr(1) );
+      size_stream >> std::hex >> m_incoming_data_size;
+
+      if( size_stream.fail() )
+        throw boost::bad_lexical_cast();
+    }
+    else
+    {
+      // trim the string to remove the leading spaces (cast fails if spaces are present)
+      boost::algorithm::trim( header_str );
+      m_incoming_data_size = boost::lexical_cast<cf3::Uint> ( header_str );
+    }
 
     // destroy old buffer and allocate the new one
     delete[] m_incoming_data;
@@ -122,9 +186,22 @@ void TCPConnection::parse_frame_data( SignalFrame & args, boost::system::error_c
 {
   try
   {
-    std::string frame( m_incoming_data, m_incoming_data_size );
+    if( m_incoming_binary )
+    {
+      args = SignalFrame( m_decoder.decode( m_incoming_data, m_incoming_data_size ) );
 
-    args = SignalFrame( cf3::common::XML::parse_string( frame ) );
+      // the remote entity can only send binary frames if it decodes them as well
+      m_peer_binary = true;
+    }
+    else
+    {
+      std::string frame( m_incoming_data, m_incoming_data_size );
+
+      args = SignalFrame( cf3::common::XML::parse_string( frame ) );
+
+      if( Protocol::goto_doc_node( *args.xml_doc.get() ).attribute_value( binary_attribute() ) == "1" )
+        m_peer_binary = true;
+    }
   }
 
   catch ( cf3::common::Exception & cfe )
@@ -176,6 +253,20 @@ void TCPConnection::set_error_handler( boost::weak_ptr<ErrorHandler> handler)
 
 //////////////////////////////////////////////////////////////////////////////
 
+void TCPConnection::set_binary_frames( bool enable )
+{
+  m_binary_enabled = enable;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+bool TCPConnection::sends_binary_frames() const
+{
+  return m_binary_enabled && m_peer_binary;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void TCPConnection::notify_error( const std::string & message ) const
 {
   if( !m_error_handler.expired() )
@@ -17,6 +17,8 @@
 #include <boost/tuple/tuple.hpp>           // for managing multiple callback fcts
 #include <boost/variant/get.hpp>           // for calling callback functions
 
+#include "common/XML/BinaryFrame.hpp"
+
 #include "ui/network/LibNetwork.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -54,6 +56,13 @@ class ErrorHandler;
 /// data.
 /// @li Frame data: actual data that is sent, in XML format.@n@n
 ///
+/// If binary frames are enabled with @c #set_binary_frames(), XML frames
+/// advertise it with an attribute on the root node. Once the remote entity
+/// has advertised it as well (or sent a binary frame), frames are sent in the
+/// format of @link cf3::common::XML::BinaryFrameCodec @c BinaryFrameCodec @endlink,
+/// with a header made of a 'B' followed by the data size in hexadecimal on 7
+/// characters. Both formats are always accepted when reading. @n@n
+///
 /// The header is completely tansparent to the calling code and is used as a
 /// safeguard to check that all data has arrived and allocate the correct buffer
 /// for the reading process. @n@n
@@ -231,6 +240,15 @@ public:
   /// @param handler Error handler to set. Can be expired.
   void set_error_handler ( boost::weak_ptr<ErrorHandler> handler );
 
+  /// Allows sending binary frames, once the remote entity is known to support them.
+  /// @param enable If @c false, only XML frames are sent.
+  void set_binary_frames ( bool enable );
+
+  /// Checks if frames are sent in binary format.
+  /// @return Returns @c true if binary frames are enabled and the remote entity
+  /// supports them.
+  bool sends_binary_frames () const;
+
 private: // functions
 
   /// @brief Function called when a frame header has been read, successfully or not.
@@ -313,7 +331,7 @@ private: // functions
   /// the data buffer to this size.
   void process_header ( boost::system::error_code & error );
 
-  /// @brief Parses frame data from string to XML.
+  /// @brief Parses frame data from string or binary data to XML.
   /// @param args Object where the parsed XML will be written.
   void parse_frame_data ( common::XML::SignalFrame & args,
                           boost::system::error_code & error);
@@ -336,9 +354,27 @@ private: // data
   /// Nameless enum for header length
   enum { HEADER_LENGTH = 8 };
 
+  /// First character of the header of a binary frame
+  static const char BINARY_HEADER_MARK = 'B';
+
   /// Buffer the receiving header.
   char m_incoming_header[HEADER_LENGTH];
 
+  /// Indicates whether the frame being received is binary
+  bool m_incoming_binary;
+
+  /// Indicates whether binary frames may be sent
+  bool m_binary_enabled;
+
+  /// Indicates whether the remote entity supports binary frames
+  bool m_peer_binary;
+
+  /// Codec for the sent frames. Its schema follows the one of the remote decoder.
+  common::XML::BinaryFrameCodec m_encoder;
+
+  /// Codec for the received frames
+  common::XML::BinaryFrameCodec m_decoder;
+
   /// Size of the receiving buffer.
   unsigned int m_incoming_data_size;
 
@@ -122,6 +122,7 @@ bool ServerNetworkComm::open_port( unsigned short port )
 void ServerNetworkComm::init_accept()
 {
   TCPConnection::Ptr conn = TCPConnection::create( *m_io_service );
+  conn->set_binary_frames( true ); // XML is used until the other side supports it
 
   m_acceptor->async_accept( conn->socket(),
                             boost::bind( &ServerNetworkComm::callback_accept,
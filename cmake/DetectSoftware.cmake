@@ -67,6 +67,8 @@ coolfluid_log_file( "  ZLIB_LIBRARIES:    [${ZLIB_LIBRARIES}]" )
 
 coolfluid_set_package( PACKAGE ZLIB DESCRIPTION "file compression" VARS ZLIB_LIBRARIES ZLIB_INCLUDE_DIRS QUIET )
 
+find_package(LZ4 QUIET)      # fast compression for VTK XML output
+
 find_package(BZip2 QUIET)    # file compression support
 
 coolfluid_log_file( "BZIP2_FOUND: [${BZIP2_FOUND}]" )
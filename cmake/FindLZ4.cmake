@@ -0,0 +1,32 @@
+# Sets:
+# LZ4_INCLUDE_DIRS  = where lz4.h can be found
+# LZ4_LIBRARIES     = the library to link against
+# CF3_HAVE_LZ4      = set to true after finding the library
+
+option( CF3_SKIP_LZ4 "Skip search for LZ4 library" OFF )
+
+if( NOT CF3_SKIP_LZ4 )
+
+  coolfluid_set_trial_include_path("") # clear include search path
+  coolfluid_set_trial_library_path("") # clear library search path
+
+  coolfluid_add_trial_include_path( ${LZ4_HOME}/include )
+  coolfluid_add_trial_include_path( $ENV{LZ4_HOME}/include )
+  coolfluid_add_trial_library_path( ${LZ4_HOME}/lib )
+  coolfluid_add_trial_library_path( $ENV{LZ4_HOME}/lib )
+
+  find_path(LZ4_INCLUDE_DIRS lz4.h ${TRIAL_INCLUDE_PATHS}  NO_DEFAULT_PATH)
+  find_path(LZ4_INCLUDE_DIRS lz4.h)
+
+  find_library(LZ4_LIBRARIES lz4 ${TRIAL_LIBRARY_PATHS} NO_DEFAULT_PATH)
+  find_library(LZ4_LIBRARIES lz4 )
+
+endif( NOT CF3_SKIP_LZ4 )
+
+coolfluid_set_package( PACKAGE LZ4
+                       DESCRIPTION "fast compression"
+                       URL "http://lz4.github.io/lz4"
+                       TYPE OPTIONAL
+                       VARS LZ4_INCLUDE_DIRS LZ4_LIBRARIES
+                       QUIET
+                     )
@@ -13,12 +13,17 @@
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
 #include "common/Signal.hpp"
+#include "common/StringConversion.hpp"
 #include "common/Builder.hpp"
 #include "common/OptionT.hpp"
 #include <common/EventHandler.hpp>
 
 #include "math/LSS/System.hpp"
 
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/LagrangeP0/LibLagrangeP0.hpp"
 #include "mesh/LagrangeP0/Quad.hpp"
@@ -28,7 +33,7 @@
 #include "AdjacentCellToFace.hpp"
 #include "Tags.hpp"
 
-#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/NodeData.hpp"
 
 namespace cf3
 {
@@ -79,29 +84,53 @@ void BCDirichletFunction::execute()
   }
   
   cf3_assert(is_not_null(options().value< Handle<math::LSS::System> >("lss")));
-  
-  if(!expression_is_set())
+
+  const std::string variable_name = options().value<std::string>("variable_name");
+  const std::string field_tag = options().value<std::string>("field_tag");
+  const bool solving_for_difference = options().value<bool>("solving_for_difference");
+  const Uint nb_funcs = vector_function().nbfuncs();
+
+  LSSWrapperImpl<DirichletBCTag>& dirichlet = boost::proto::value(m_dirichlet);
+  math::LSS::System& lss = dirichlet.lss();
+
+  // The function is evaluated for all nodes of a region at once, instead of node by node in a Proto expression,
+  // so the values for a time-dependent boundary condition are computed in a few passes over the compiled function.
+  RealMatrix values;
+  boost_foreach(const Handle<mesh::Region>& region, m_loop_regions)
   {
-    const Uint dim = common::find_parent_component<mesh::Mesh>(*regions().front()).dimension();
-    if(vector_function().nbfuncs() == 1)
-    {
-      FieldVariable<0, ScalarField> var(options().value<std::string>("variable_name"), options().value<std::string>("field_tag"), options().value<std::string>("space"));
-      if(options().value<bool>("solving_for_difference"))
-        set_expression(nodes_expression(m_dirichlet(var)  = scalar_function()));
-      else
-        set_expression(nodes_expression(m_dirichlet(var)  = scalar_function() + var));
-    }
-    else if(vector_function().nbfuncs() == dim)
+    const Uint dim = common::find_parent_component<mesh::Mesh>(*region).dimension();
+    if(nb_funcs != 1 && nb_funcs != dim)
+      throw common::SetupError(FromHere(), "Function for " + uri().path() + " has " + common::to_str(nb_funcs) + " components, expected 1 or " + common::to_str(dim));
+
+    const mesh::Field& field = find_field(*region, field_tag);
+    const math::VariablesDescriptor& descriptor = field.descriptor();
+    if(descriptor.size(variable_name) != nb_funcs)
+      throw common::SetupError(FromHere(), "Variable " + variable_name + " used in " + uri().path() + " has " + common::to_str(descriptor.size(variable_name)) + " components, but the function has " + common::to_str(nb_funcs));
+    const Uint offset = descriptor.offset(variable_name);
+
+    const mesh::Dictionary& dict = field.dict();
+    boost::shared_ptr< common::List<Uint> > nodes_ptr = mesh::build_used_nodes_list(*region, dict, true);
+    const common::List<Uint>& nodes = *nodes_ptr;
+
+    evaluate_nodes(dict.coordinates(), nodes, values);
+
+    const Uint nb_nodes = nodes.size();
+    for(Uint i = 0; i != nb_nodes; ++i)
     {
-      FieldVariable<0, VectorField> var(options().value<std::string>("variable_name"), options().value<std::string>("field_tag"), options().value<std::string>("space"));
-      if(options().value<bool>("solving_for_difference"))
-        set_expression(nodes_expression(m_dirichlet(var)  = vector_function()));
-      else
-        set_expression(nodes_expression(m_dirichlet(var)  = vector_function() + var));
+      const Uint node = nodes[i];
+      const int node_idx = dirichlet.node_to_lss(node);
+      if(node_idx < 0)
+        continue;
+      const common::Table<Real>::ConstRow row = field[node];
+      for(Uint j = 0; j != nb_funcs; ++j)
+      {
+        const Real old_value = row[offset+j];
+        // Same values as the former expressions m_dirichlet(var) = f and m_dirichlet(var) = f + var
+        const Real new_value = solving_for_difference ? values(i, j) : values(i, j) + old_value;
+        lss.dirichlet(node_idx, offset+j, new_value - old_value, true);
+      }
     }
   }
-  
-  cf3::solver::actions::Proto::ProtoAction::execute();
 }
 
 } // namespace UFEM
@@ -114,6 +114,23 @@ const solver::actions::Proto::ScalarFunction& ParsedFunctionExpression::scalar_f
   return m_function;
 }
 
+void ParsedFunctionExpression::evaluate_nodes(const common::Table<Real>& coordinates, const common::List<Uint>& nodes, RealMatrix& result) const
+{
+  // The variables are the coordinates followed by the time
+  const Uint nb_nodes = nodes.size();
+  const Uint dim = m_function.nbvars() - 1;
+  const Real time = m_function.predefined_values.back();
+  RealMatrix vars(nb_nodes, dim+1);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const common::Table<Real>::ConstRow row = coordinates[nodes[i]];
+    for(Uint j = 0; j != dim; ++j)
+      vars(i, j) = row[j];
+    vars(i, dim) = time;
+  }
+
+  m_function.evaluate_batch(vars, result);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
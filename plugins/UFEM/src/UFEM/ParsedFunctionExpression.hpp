@@ -9,7 +9,9 @@
 
 #include "UFEM/LibUFEM.hpp"
 
+#include "common/List.hpp"
 #include "common/Option.hpp"
+#include "common/Table.hpp"
 
 #include "math/VectorialFunction.hpp"
 
@@ -39,6 +41,13 @@ public:
   /// Get the stored function as a scalar. This requires that the values option has exactly one element
   const solver::actions::Proto::ScalarFunction& scalar_function();
 
+  /// Evaluate the function at the current time in all of the given nodes at once, using the compiled form of the function.
+  /// Proto expressions using vector_function() or scalar_function() evaluate the function one point at a time.
+  /// @param coordinates Coordinates of the nodes
+  /// @param nodes Rows of coordinates for which to evaluate the function
+  /// @param result Output, with one row for each node and one column for each component of the function
+  void evaluate_nodes(const common::Table<Real>& coordinates, const common::List<Uint>& nodes, RealMatrix& result) const;
+
 private:
   void trigger_value();
   void trigger_time_component();
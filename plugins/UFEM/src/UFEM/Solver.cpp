@@ -573,6 +573,12 @@ void Solver::execute()
     CFinfo << "Running the solver over a mesh with " << mesh().geometry_fields().size() << " nodes." << CFendl;
   }
   solver::SimpleSolver::execute();
+
+  // Asynchronous restarts are completed here, while the parallel environment is still running
+  BOOST_FOREACH(WriteRestartManager& writer, common::find_components_recursively<WriteRestartManager>(*this))
+  {
+    writer.wait();
+  }
 }
 
 
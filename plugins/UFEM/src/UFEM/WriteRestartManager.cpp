@@ -45,6 +45,11 @@ WriteRestartManager::~WriteRestartManager()
 {
 }
 
+void WriteRestartManager::wait()
+{
+  m_write_restart->wait();
+}
+
 void WriteRestartManager::trigger_setup()
 {
   Handle<mesh::Mesh> mesh = options().value< Handle<mesh::Mesh> >("mesh");
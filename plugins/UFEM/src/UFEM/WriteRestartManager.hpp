@@ -16,6 +16,8 @@ namespace cf3 {
 namespace UFEM {
 
 /// Helper class to manage the writing of restart files
+/// Set Writer.asynchronous to write the restart files on a separate thread while the time loop continues.
+/// Pending writes are completed by wait(), which the UFEM Solver calls at the end of its execute.
 class UFEM_API WriteRestartManager : public solver::actions::TimeSeriesWriter
 {
 public: // functions
@@ -25,6 +27,9 @@ public: // functions
   WriteRestartManager ( const std::string& name );
   virtual ~WriteRestartManager();
   static std::string type_name () { return "WriteRestartManager"; }
+
+  /// Complete all asynchronous restart writes. Must be called on all CPUs.
+  void wait();
   
 private:
   Handle<solver::actions::WriteRestartFile> m_write_restart;
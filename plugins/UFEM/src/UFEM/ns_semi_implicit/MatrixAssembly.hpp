@@ -434,7 +434,8 @@ void NavierStokesSemiImplicit::set_elements_expressions( const std::string& name
   
 
   // Assembly of the velocity matrices
-  m_velocity_assembly->create_component<ProtoAction>(name)->set_expression(elements_expression(ElementsT(),
+  Handle<ProtoAction> velocity_action = m_velocity_assembly->create_component<ProtoAction>(name);
+  velocity_action->set_expression(elements_expression(ElementsT(),
     group
     (
       _T(u,u) = _0, M(u,u) = _0,
@@ -455,6 +456,15 @@ void NavierStokesSemiImplicit::set_elements_expressions( const std::string& name
 //  m_u_lss->system_matrix += _T + lit(theta) * lit(dt) * (M + _A)
     )
   ));
+
+  // Inputs the action can't see by itself, so the inner loop can skip the assembly if none of them changed
+  velocity_action->add_dependency(dt);
+  velocity_action->add_dependency(theta);
+  const std::vector<std::string> tau_options = {"alpha_ps", "alpha_su", "alpha_bu", "supg_type", "c1", "c2", "u_ref"};
+  for(const std::string& option_name : tau_options)
+  {
+    velocity_action->add_dependency(options().option(option_name));
+  }
   
   // Assembly of velocity RHS
   if(!options().value<bool>("enable_body_force"))
@@ -54,6 +54,7 @@ private:
   
   void trigger_theta();
   void trigger_nb_iterations();
+  void trigger_reuse_velocity_matrix();
   void trigger_time();
   void trigger_timestep();
   void trigger_reset_assembly();
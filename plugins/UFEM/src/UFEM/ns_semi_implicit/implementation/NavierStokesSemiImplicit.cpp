@@ -22,9 +22,11 @@
 
 #include "common/Component.hpp"
 #include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
 #include "common/OptionT.hpp"
 #include "common/OptionArray.hpp"
 #include "common/PropertyList.hpp"
+#include "common/PE/Comm.hpp"
 
 #include "math/LSS/SolveLSS.hpp"
 #include "math/LSS/ZeroLSS.hpp"
@@ -98,6 +100,7 @@ struct InnerLoop : solver::Action
       .link_to(&m_time);
     
     nb_iterations = 2;
+    reuse_velocity_matrix = true;
     m_u_rhs_assembly = create_component<solver::ActionDirector>("URHSAssembly");
     m_p_rhs_assembly = create_component<solver::ActionDirector>("PRHSAssembly");
     m_apply_aup = create_component<solver::ActionDirector>("ApplyAup");
@@ -121,8 +124,7 @@ struct InnerLoop : solver::Action
       u_lss->rhs()->reset(0.);
 
       // Computing m_velocity_assembly in the loop. Modified for the ABL implementation.
-      u_lss->matrix()->reset(0.);
-      m_velocity_assembly->execute();
+      assemble_velocity_matrix();
 
       // Velocity system: compute delta_a_star
       m_u_rhs_assembly->execute();
@@ -199,6 +201,48 @@ struct InnerLoop : solver::Action
     p_lss->solution()->assign(*p);
   }
 
+  /// Assemble the velocity matrix, unless none of its inputs changed since the previous assembly on any process. The kept matrix
+  /// still has the velocity BC applied, which is applied again using the column values cached by the matrix. BCs that modify
+  /// the matrix in a Proto expression clear the stamps, forcing a new assembly.
+  void assemble_velocity_matrix()
+  {
+    typedef std::pair<std::string, std::size_t> StampT;
+    std::vector<StampT> stamps;
+    int changed = !reuse_velocity_matrix;
+    if(reuse_velocity_matrix)
+    {
+      BOOST_FOREACH(const ProtoAction& action, common::find_components_recursively<ProtoAction>(*m_velocity_assembly))
+      {
+        stamps.push_back(StampT(action.uri().path(), action.dependency_stamp()));
+        if(u_lss->dependency_changed(stamps.back().first, stamps.back().second))
+          changed = 1;
+      }
+      if(stamps.empty())
+        changed = 1;
+
+      if(common::PE::Comm::instance().is_active())
+      {
+        int global_changed = changed;
+        common::PE::Comm::instance().all_reduce(common::PE::max(), &changed, 1, &global_changed);
+        changed = global_changed;
+      }
+    }
+
+    if(!changed)
+    {
+      CFdebug << "Reusing the velocity matrix, its inputs are unchanged" << CFendl;
+      return;
+    }
+
+    u_lss->matrix()->reset(0.);
+    m_velocity_assembly->execute();
+
+    BOOST_FOREACH(const StampT& stamp, stamps)
+    {
+      u_lss->set_dependency_stamp(stamp.first, stamp.second);
+    }
+  }
+
   // Data members are public, because these are initialized where appropriate
   Handle<math::LSS::System> p_lss;
   Handle<math::LSS::System> u_lss;
@@ -216,6 +260,9 @@ struct InnerLoop : solver::Action
 
   int nb_iterations;
 
+  /// Skip the velocity assembly when its inputs are unchanged
+  bool reuse_velocity_matrix;
+
   Teuchos::RCP<const Thyra::LinearOpBase<Real> > lumped_m_op;
 
   Handle< math::LSS::Vector > u;
@@ -305,6 +352,11 @@ NavierStokesSemiImplicit::NavierStokesSemiImplicit(const std::string& name) :
     .description("The number of iterations for the inner loop")
     .attach_trigger(boost::bind(&NavierStokesSemiImplicit::trigger_nb_iterations, this));
     
+  options().add("reuse_velocity_matrix", true)
+    .pretty_name("Reuse Velocity Matrix")
+    .description("Skip the velocity matrix assembly in the inner loop if the fields, options and time step it depends on did not change since the previous assembly")
+    .attach_trigger(boost::bind(&NavierStokesSemiImplicit::trigger_reuse_velocity_matrix, this));
+
   options().add("initial_conditions", m_initial_conditions)
     .pretty_name("Initial Conditions")
     .description("The component that is used to manage the initial conditions in the solver this action belongs to")
@@ -585,6 +637,11 @@ void NavierStokesSemiImplicit::trigger_nb_iterations()
   Handle<InnerLoop>(m_inner_loop)->nb_iterations = options().option("nb_iterations").value<int>();
 }
 
+void NavierStokesSemiImplicit::trigger_reuse_velocity_matrix()
+{
+  Handle<InnerLoop>(m_inner_loop)->reuse_velocity_matrix = options().option("reuse_velocity_matrix").value<bool>();
+}
+
 void NavierStokesSemiImplicit::trigger_time()
 {
   if(is_null(m_time))
@@ -0,0 +1,184 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+//
+// Measures the ghost synchronization bandwidth of the commpattern as a function of the number of values per item.
+// Run it on many cores, for example: mpirun -np 4 ./ptest-parallel-commpattern-bandwidth
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Benchmark for the synchronization bandwidth of cf3::common::PE::CommPattern"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "common/BoostArray.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/Timer.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::PE;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Gives access to the original all_to_all based synchronization, as a reference
+class ReferenceCommPattern : public CommPattern
+{
+public:
+  ReferenceCommPattern(const std::string& name) : CommPattern(name) {}
+  static std::string type_name () { return "ReferenceCommPattern"; }
+
+  void synchronize_all_to_all(const std::string& name)
+  {
+    std::vector<unsigned char> sndbuf(1);
+    std::vector<unsigned char> rcvbuf(1);
+    synchronize_this(*Handle<CommWrapper>(get_child(name)),sndbuf,rcvbuf);
+  }
+};
+
+struct CommPatternBandwidthFixture
+{
+  CommPatternBandwidthFixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// Report a measurement in the same format as Tools::Testing::TimedTestFixture
+  void report(const std::string& name, const Real nb_bytes, const Real time)
+  {
+    if(PE::Comm::instance().rank() == 0)
+    {
+      std::cout << "<DartMeasurement name=\"" << name << " bandwidth\" type=\"numeric/double\">" << nb_bytes / time / 1e6 << "</DartMeasurement>" << std::endl;
+      CFinfo << name << ": " << nb_bytes / time / 1e6 << " MB/s" << CFendl;
+    }
+  }
+
+  int m_argc;
+  char** m_argv;
+
+  /// Number of updatable items per rank
+  static const Uint nb_owned = 50000;
+  /// Number of ghost items per rank
+  static const Uint nb_ghosts = 10000;
+  /// Number of synchronizations to time
+  static const Uint nb_repeats = 50;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( CommPatternBandwidthSuite, CommPatternBandwidthFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init )
+{
+  PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK_EQUAL( PE::Comm::instance().is_active() , true );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( bandwidth )
+{
+  const Uint nproc=PE::Comm::instance().size();
+  const Uint irank=PE::Comm::instance().rank();
+  const Uint next_rank=(irank+1)%nproc;
+  const Uint nb_ghosts_here = nproc > 1 ? nb_ghosts : 0;
+  const Uint nb_items=nb_owned+nb_ghosts_here;
+
+  // owned items first, then ghosts of the first items of the next rank
+  std::vector<Uint> gid(nb_items);
+  std::vector<Uint> rank(nb_items);
+  for (Uint i=0; i<nb_owned; ++i)
+  {
+    gid[i]=irank*nb_owned+i;
+    rank[i]=irank;
+  }
+  for (Uint i=0; i<nb_ghosts_here; ++i)
+  {
+    gid[nb_owned+i]=next_rank*nb_owned+i;
+    rank[nb_owned+i]=next_rank;
+  }
+
+  boost::shared_ptr<ReferenceCommPattern> pecp_ptr = allocate_component<ReferenceCommPattern>("CommPattern");
+  ReferenceCommPattern& pecp = *pecp_ptr;
+  pecp.insert("gid",gid,1,false);
+
+  const Uint widths[] = {1, 2, 4, 8, 16, 32};
+  const Uint nb_widths = sizeof(widths)/sizeof(Uint);
+  std::vector< boost::shared_ptr< boost::multi_array<Real,2> > > arrays;
+  for (Uint w=0; w<nb_widths; ++w)
+  {
+    arrays.push_back(boost::shared_ptr< boost::multi_array<Real,2> >(new boost::multi_array<Real,2>(boost::extents[nb_items][widths[w]])));
+    boost::multi_array<Real,2>& array = *arrays.back();
+    for (Uint i=0; i<nb_owned; ++i)
+      for (Uint j=0; j<widths[w]; ++j)
+        array[i][j]=gid[i]+0.01*j;
+    pecp.insert("width_"+to_str(widths[w]),array,true);
+  }
+
+  pecp.setup(Handle<CommWrapper>(pecp.get_child("gid")),rank);
+
+  for (Uint w=0; w<nb_widths; ++w)
+  {
+    const std::string name="width_"+to_str(widths[w]);
+    // bytes sent plus received by this rank per synchronization
+    const Real nb_bytes = 2.*nb_repeats*nb_ghosts_here*widths[w]*sizeof(Real);
+
+    PE::Comm::instance().barrier();
+    Timer timer;
+    for (Uint r=0; r<nb_repeats; ++r)
+      pecp.synchronize_all_to_all(name);
+    PE::Comm::instance().barrier();
+    report(name+" all_to_all", nb_bytes, timer.elapsed());
+
+    pecp.options().set("indexed_datatypes",false);
+    pecp.synchronize(name);
+    PE::Comm::instance().barrier();
+    timer.restart();
+    for (Uint r=0; r<nb_repeats; ++r)
+      pecp.synchronize(name);
+    PE::Comm::instance().barrier();
+    report(name+" persistent buffers", nb_bytes, timer.elapsed());
+
+    pecp.options().set("indexed_datatypes",true);
+    pecp.synchronize(name);
+    PE::Comm::instance().barrier();
+    timer.restart();
+    for (Uint r=0; r<nb_repeats; ++r)
+      pecp.synchronize(name);
+    PE::Comm::instance().barrier();
+    report(name+" indexed datatypes", nb_bytes, timer.elapsed());
+
+    // all methods must give the same result
+    const boost::multi_array<Real,2>& array = *arrays[w];
+    for (Uint i=0; i<nb_ghosts_here; ++i)
+      BOOST_CHECK_EQUAL(array[nb_owned+i][widths[w]-1], gid[nb_owned+i]+0.01*(widths[w]-1));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize )
+{
+  PE::Comm::instance().finalize();
+  BOOST_CHECK_EQUAL( PE::Comm::instance().is_active() , false );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
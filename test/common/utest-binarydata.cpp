@@ -173,6 +173,31 @@ BOOST_AUTO_TEST_CASE( ReadBinaryData )
   BOOST_CHECK_EQUAL(empty_real_table.row_size(), 8);
 }
 
+BOOST_AUTO_TEST_CASE( ThreadedCompression )
+{
+  common::Component& group = *common::Core::instance().root().create_component("ThreadedGroup", "cf3.common.Group");
+
+  // Large enough to be split in several compression chunks
+  common::Table<Real>& real_table = *group.create_component< common::Table<Real> >("LargeRealTable");
+  real_table.set_row_size(real_table_cols);
+  real_table.resize(10*real_table_size);
+  fill_table(real_table);
+
+  common::BinaryDataWriter& writer = *group.create_component<common::BinaryDataWriter>("Writer");
+  writer.options().set("file", common::URI("binary_data_threaded.cfbinxml"));
+  writer.options().set("compression_threads", 4u);
+  const Uint index = writer.append_data(real_table);
+  writer.close();
+
+  common::BinaryDataReader& reader = *group.create_component<common::BinaryDataReader>("Reader");
+  reader.options().set("file", common::URI("binary_data_threaded.cfbinxml"));
+  common::Table<Real>& read_real_table = *group.create_component< common::Table<Real> >("ReadRealTable");
+  reader.read_table(read_real_table, index);
+
+  BOOST_CHECK_EQUAL(read_real_table.size(), real_table.size());
+  BOOST_CHECK(read_real_table.array() == real_table.array());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()
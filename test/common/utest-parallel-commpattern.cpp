@@ -26,6 +26,8 @@
 #include "common/PE/CommPattern.hpp"
 #include "common/PE/debug.hpp"
 #include "common/Group.hpp"
+#include "common/OptionList.hpp"
+#include "common/RegionProfiler.hpp"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -212,6 +214,81 @@ BOOST_AUTO_TEST_CASE( commpattern_mainstream )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( commpattern_split_phase )
+{
+  // general constants in this routine
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // commpattern
+  boost::shared_ptr<CommPattern> pecp_ptr = allocate_component<CommPattern>("CommPattern");
+  CommPattern& pecp = *pecp_ptr;
+
+  // setup gid & rank
+  std::vector<Uint> gid;
+  std::vector<Uint> rank;
+  setupGidAndRank(gid,rank);
+  pecp.insert("gid",gid,1,false);
+
+  // additional arrays for testing
+  std::vector<int> v1;
+  for(int i=0;i<6*nproc;i++) v1.push_back(-((irank+1)*1000+i+1));
+  pecp.insert("v1",v1,1,true);
+  std::vector<double> v2;
+  for(int i=0;i<12*nproc;i++) v2.push_back((double)((irank+1)*1000+i+1));
+  pecp.insert("v2",v2,2,true);
+
+  // initial setup
+  pecp.setup(Handle<CommWrapper>(pecp.get_child("gid")),rank);
+
+  // two exchanges in flight at the same time, completed in reverse order, twice to reuse the persistent requests
+  // and then twice more, exchanging in place using indexed datatypes
+  for (int pass=0; pass<4; pass++)
+  {
+    if (pass==2) pecp.options().set("indexed_datatypes",true);
+    for(int i=0;i<6*nproc;i++) v1[i]=-((irank+1)*1000+i+1);
+    for(int i=0;i<12*nproc;i++) v2[i]=(double)((irank+1)*1000+i+1);
+
+    CommPattern::SyncHandle h1=pecp.begin_synchronize("v1");
+    CommPattern::SyncHandle h2=pecp.begin_synchronize("v2");
+    BOOST_CHECK(h1.is_active());
+    BOOST_CHECK(h2.is_active());
+    pecp.end_synchronize(h2);
+    pecp.end_synchronize(h1);
+
+    // check results, same as for the blocking synchronization
+    Uint idx=0;
+    Uint i;
+    for (i=0; i<  nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-0*nproc)/1)+1)*1000+idx+1)) );
+    for (   ; i<3*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-1*nproc)/2)+1)*1000+idx+1)) );
+    for (   ; i<6*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-3*nproc)/3)+1)*1000+idx+1)) );
+    idx=0;
+    for (i=0; i< 2*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-0*nproc)/2)+1)*1000+idx+1) );
+    for (   ; i< 6*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-2*nproc)/4)+1)*1000+idx+1) );
+    for (   ; i<12*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-6*nproc)/6)+1)*1000+idx+1) );
+  }
+
+  // data that does not need update gives an inactive handle
+  BOOST_CHECK(!pecp.begin_synchronize("gid").is_active());
+
+  // both phases are profiled, per wrapper
+  RegionProfiler::instance().enable();
+  pecp.synchronize("v1");
+  RegionProfiler::instance().disable();
+  const std::vector<RegionSummary> regions=RegionProfiler::instance().summary();
+  Uint nb_begin=0, nb_end=0;
+  for (std::vector<RegionSummary>::const_iterator it=regions.begin(); it!=regions.end(); ++it)
+  {
+    if (it->name==pecp.get_child("v1")->uri().path()+"/begin_synchronize") nb_begin=it->count;
+    if (it->name==pecp.get_child("v1")->uri().path()+"/end_synchronize") nb_end=it->count;
+  }
+  BOOST_CHECK_EQUAL(nb_begin,(Uint)nproc);
+  BOOST_CHECK_EQUAL(nb_end,(Uint)nproc);
+  RegionProfiler::instance().reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( commpattern_external_synchronization )
 {
 /*
@@ -0,0 +1,160 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for RegionProfiler"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/CF.hpp"
+#include "common/ActionDirector.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/OptionList.hpp"
+#include "common/RegionProfiler.hpp"
+#include "common/URI.hpp"
+#include "common/WriteRegionProfile.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Action that contains a nested region
+struct NestedRegionAction : Action
+{
+  NestedRegionAction(const std::string& name) : Action(name) {}
+  static std::string type_name () { return "NestedRegionAction"; }
+  virtual void execute()
+  {
+    ScopedRegion region("nested");
+  }
+};
+
+/// Find a region in the summary
+const RegionSummary& find_region(const std::vector<RegionSummary>& regions, const std::string& name)
+{
+  for(std::vector<RegionSummary>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+  {
+    if(it->name == name)
+      return *it;
+  }
+  throw ValueNotFound(FromHere(), "Region " + name + " not found");
+}
+
+/// Read a whole file
+std::string file_contents(const std::string& filename)
+{
+  std::ifstream file(filename.c_str());
+  std::stringstream result;
+  result << file.rdbuf();
+  return result.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( RegionProfilerSuite )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Disabled )
+{
+  BOOST_CHECK(!RegionProfiler::is_enabled());
+  {
+    ScopedRegion region("disabled");
+  }
+  BOOST_CHECK(RegionProfiler::instance().summary().empty());
+}
+
+BOOST_AUTO_TEST_CASE( ActionRegions )
+{
+  Core::instance().environment().options().set("profile_regions", true);
+  Core::instance().environment().options().set("profile_trace", true);
+  BOOST_CHECK(RegionProfiler::is_enabled());
+
+  Component& root = Core::instance().root();
+  Handle<ActionDirector> director = root.create_component<ActionDirector>("director");
+  director->create_component<NestedRegionAction>("action");
+
+  for(Uint i = 0; i != 3; ++i)
+    director->execute();
+
+  Core::instance().environment().options().set("profile_regions", false);
+  director->execute();
+
+  const std::vector<RegionSummary> regions = RegionProfiler::instance().summary();
+  BOOST_CHECK_EQUAL(regions.size(), 2);
+
+  const RegionSummary& action_region = find_region(regions, "/director/action");
+  BOOST_CHECK_EQUAL(action_region.count, 3);
+  BOOST_CHECK(action_region.call_min <= action_region.call_max);
+  BOOST_CHECK_CLOSE(action_region.imbalance, 1., 1e-8);
+
+  const RegionSummary& nested_region = find_region(regions, "nested");
+  BOOST_CHECK_EQUAL(nested_region.count, 3);
+  BOOST_CHECK(nested_region.total_max <= action_region.total_max);
+}
+
+BOOST_AUTO_TEST_CASE( Output )
+{
+  Handle<WriteRegionProfile> writer = Core::instance().root().create_component<WriteRegionProfile>("writer");
+  writer->options().set("file", URI("region-profile.json"));
+  writer->options().set("trace_file", URI("region-profile-trace.json"));
+  writer->options().set("reset", true);
+  writer->execute();
+
+  const std::string summary = file_contents("region-profile.json");
+  BOOST_CHECK(summary.find("\"name\": \"/director/action\", \"count\": 3") != std::string::npos);
+
+  // One complete event per call
+  const std::string trace = file_contents("region-profile-trace.json");
+  Uint nb_events = 0;
+  for(std::string::size_type pos = trace.find("\"ph\": \"X\""); pos != std::string::npos; pos = trace.find("\"ph\": \"X\"", pos+1))
+    ++nb_events;
+  BOOST_CHECK_EQUAL(nb_events, 6);
+
+  // The trace starts at the first event
+  BOOST_CHECK(trace.find("\"ts\": 0.000,") != std::string::npos);
+
+  // Reset keeps the regions, without calls
+  BOOST_CHECK_EQUAL(find_region(RegionProfiler::instance().summary(), "nested").count, 0);
+  RegionProfiler::instance().print_summary(std::cout);
+}
+
+BOOST_AUTO_TEST_CASE( HardwareCounters )
+{
+  // Counters may be unavailable, e.g. in containers, but enabling them must never fail
+  Core::instance().environment().options().set("profile_hardware_counters", true);
+  Core::instance().environment().options().set("profile_regions", true);
+  {
+    ScopedRegion region("counted");
+    Real sum = 0.;
+    for(Uint i = 0; i != 100000; ++i)
+      sum += i;
+    BOOST_CHECK(sum > 0.);
+  }
+  Core::instance().environment().options().set("profile_regions", false);
+
+  // The option is switched off again if the counters are not available
+  BOOST_CHECK_EQUAL(Core::instance().environment().options().value<bool>("profile_hardware_counters"), RegionProfiler::instance().is_hardware_counters_enabled());
+
+  const RegionSummary& counted = find_region(RegionProfiler::instance().summary(), "counted");
+  BOOST_CHECK_EQUAL(counted.count, 1);
+  if(RegionProfiler::instance().is_hardware_counters_enabled())
+    BOOST_CHECK(counted.cycles > 0.);
+  else
+    BOOST_CHECK_EQUAL(counted.cycles, 0.);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+//////////////////////////////////////////////////////////////////////////////
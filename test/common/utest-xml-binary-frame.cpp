@@ -0,0 +1,194 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for binary signal frames"
+
+#include <boost/algorithm/string/join.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+#include "common/URI.hpp"
+
+#include "common/XML/BinaryFrame.hpp"
+#include "common/XML/FileOperations.hpp"
+#include "common/XML/SignalFrame.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::XML;
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Frame with options of each type, as used to configure a component
+void fill_frame ( SignalFrame & frame, const Real factor )
+{
+  frame.main_map.set_value( "real_option", "real", to_str(factor * 0.1) );
+  frame.main_map.set_value( "int_option", "integer", to_str(-3) );
+  frame.main_map.set_value( "uint_option", "unsigned", to_str(42u) );
+  frame.main_map.set_value( "bool_option", "bool", to_str(true) );
+  frame.main_map.set_value( "string_option", "string", "some text" );
+  frame.main_map.set_value( "uri_option", "uri", "cpath:/some/component" );
+
+  // a value that is not written by to_str stays text
+  frame.main_map.set_value( "short_real", "real", "1.5" );
+
+  std::vector<std::string> reals;
+  for( Uint i = 0; i != 100; ++i )
+    reals.push_back( to_str(factor * i / 3.) );
+  frame.main_map.set_array( "real_array", "real", boost::algorithm::join(reals, ";"), ";" );
+  frame.main_map.set_array( "int_array", "integer", "1;-2;3", ";" );
+  frame.main_map.set_array( "bool_array", "bool", "true,false,true", "," );
+
+  frame.map("sub_map").main_map.set_value( "sub_option", "unsigned", to_str(7u) );
+}
+
+std::string xml_string ( const XmlDoc & doc )
+{
+  std::string result;
+  XML::to_string( doc, result );
+  return result;
+}
+
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( XmlBinaryFrame_TestSuite )
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( round_trip )
+{
+  SignalFrame frame( "configure", URI("cpath:/sender"), URI("cpath:/receiver") );
+  fill_frame( frame, 1. );
+
+  BinaryFrameCodec encoder;
+  BinaryFrameCodec decoder;
+
+  std::string data;
+  encoder.encode( frame, data );
+
+  BOOST_CHECK( BinaryFrameCodec::is_binary( data.data(), data.size() ) );
+
+  SignalFrame decoded( decoder.decode( data ) );
+
+  // the document is restored exactly
+  BOOST_CHECK_EQUAL( xml_string( *decoded.xml_doc ), xml_string( *frame.xml_doc ) );
+
+  BOOST_CHECK_EQUAL( decoded.get_option<Real>("real_option"), 0.1 );
+  BOOST_CHECK_EQUAL( decoded.get_option<int>("int_option"), -3 );
+  BOOST_CHECK_EQUAL( decoded.get_option<Uint>("uint_option"), 42u );
+  BOOST_CHECK_EQUAL( decoded.get_option<bool>("bool_option"), true );
+  BOOST_CHECK_EQUAL( decoded.get_option<std::string>("string_option"), "some text" );
+  BOOST_CHECK_EQUAL( decoded.get_option<Real>("short_real"), 1.5 );
+  BOOST_CHECK_EQUAL( decoded.get_array<Real>("real_array").size(), 100u );
+  BOOST_CHECK_EQUAL( decoded.get_array<int>("int_array")[1], -2 );
+  BOOST_CHECK( decoded.has_map("sub_map") );
+  BOOST_CHECK_EQUAL( decoded.map("sub_map").get_option<Uint>("sub_option"), 7u );
+
+  // binary values are smaller than their text
+  BOOST_CHECK_LT( data.size(), xml_string( *frame.xml_doc ).size() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( schema_cache )
+{
+  BinaryFrameCodec encoder;
+  BinaryFrameCodec decoder;
+
+  std::vector<std::string> data(3);
+  std::vector<std::string> xml(3);
+  for( Uint i = 0; i != 3; ++i )
+  {
+    SignalFrame frame( "configure", URI("cpath:/sender"), URI("cpath:/receiver") );
+    fill_frame( frame, i + 1. );
+    encoder.encode( frame, data[i] );
+    xml[i] = xml_string( *frame.xml_doc );
+  }
+
+  // the names are only sent with the first frame
+  BOOST_CHECK_LT( data[1].size(), data[0].size() );
+  BOOST_CHECK_LT( data[2].size(), data[0].size() );
+
+  // frames are decoded in order, each with the schema of the previous ones
+  for( Uint i = 0; i != 3; ++i )
+    BOOST_CHECK_EQUAL( xml_string( *decoder.decode( data[i] ) ), xml[i] );
+
+  BOOST_CHECK_EQUAL( decoder.schema_size(), encoder.schema_size() );
+
+  // a decoder without the schema can't decode later frames
+  BinaryFrameCodec fresh_decoder;
+  BOOST_CHECK_THROW( fresh_decoder.decode( data[1] ), XmlError );
+
+  // after a reset on both sides, the names are sent again
+  encoder.reset();
+  decoder.reset();
+  SignalFrame frame( "configure", URI("cpath:/sender"), URI("cpath:/receiver") );
+  fill_frame( frame, 1. );
+  std::string reset_data;
+  encoder.encode( frame, reset_data );
+  BOOST_CHECK_GT( reset_data.size(), data[1].size() );
+  BOOST_CHECK_EQUAL( xml_string( *decoder.decode( reset_data ) ), xml_string( *frame.xml_doc ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( invalid_data )
+{
+  BinaryFrameCodec decoder;
+
+  const std::string xml = "<?xml version=\"1.0\"?><cfxml/>";
+  BOOST_CHECK( !BinaryFrameCodec::is_binary( xml.data(), xml.size() ) );
+  BOOST_CHECK_THROW( decoder.decode( xml ), XmlError );
+
+  SignalFrame frame( "configure", URI("cpath:/sender"), URI("cpath:/receiver") );
+  fill_frame( frame, 1. );
+  BinaryFrameCodec encoder;
+  std::string data;
+  encoder.encode( frame, data );
+
+  BOOST_CHECK_THROW( decoder.decode( data.substr( 0, data.size() / 2 ) ), XmlError );
+
+  // the failed frame left nothing in the schema, so the complete frame still decodes
+  BOOST_CHECK_EQUAL( decoder.schema_size(), 0u );
+  BOOST_CHECK_EQUAL( xml_string( *decoder.decode( data ) ), xml_string( *frame.xml_doc ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( rollback )
+{
+  BinaryFrameCodec encoder;
+  BinaryFrameCodec decoder;
+
+  SignalFrame frame( "configure", URI("cpath:/sender"), URI("cpath:/receiver") );
+  fill_frame( frame, 1. );
+
+  // a frame that is encoded but never sent is undone
+  std::string unsent;
+  encoder.encode( frame, unsent );
+  BOOST_CHECK_GT( encoder.schema_size(), 0u );
+  encoder.rollback_schema( 0 );
+  BOOST_CHECK_EQUAL( encoder.schema_size(), 0u );
+
+  // the next frame sends the strings again, so a decoder that never saw the first one can read it
+  std::string data;
+  encoder.encode( frame, data );
+  BOOST_CHECK_EQUAL( data.size(), unsent.size() );
+  BOOST_CHECK_EQUAL( xml_string( *decoder.decode( data ) ), xml_string( *frame.xml_doc ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/////////////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 
 #include "common/BoostAssign.hpp"
 
+#include "math/AnalyticalFunction.hpp"
 #include "math/VectorialFunction.hpp"
 
 using namespace std;
@@ -81,7 +82,84 @@ BOOST_AUTO_TEST_CASE( function_2 )
 
 }
 
+BOOST_AUTO_TEST_CASE( compiled_function )
+{
+  FunctionParser fp;
+  fp.Parse("sqrt(x*x + y*y)", "x,y");
+  CompiledFunction compiled;
+  compiled.compile(fp);
+  BOOST_CHECK(compiled.is_vectorized());
+  BOOST_CHECK_EQUAL(compiled.nb_vars(), 2);
+
+  // variables stored with a stride larger than the number of points
+  const double variables[6] = { 1.5, 3., 0., 2.9, 4., 0. };
+  double result[2];
+  compiled.evaluate(variables, 3, 2, result);
+  BOOST_CHECK_CLOSE( result[0], sqrt(1.5*1.5 + 2.9*2.9) , 1e-6);
+  BOOST_CHECK_CLOSE( result[1], 5. , 1e-6);
+
+  fp.Parse("if(x<y, x, y)", "x,y");
+  compiled.compile(fp);
+  BOOST_CHECK(!compiled.is_vectorized());
+  compiled.evaluate(variables, 3, 2, result);
+  BOOST_CHECK_EQUAL( result[0], 1.5 );
+  BOOST_CHECK_EQUAL( result[1], 3. );
+}
 
+BOOST_AUTO_TEST_CASE( evaluate_batch )
+{
+  // Functions covering most opcodes, with domain errors for some points
+  cf3::math::VectorialFunction f ("[x+y*z-x/y][sin(x)*cos(x)+tan(y)][sqrt(x)+log(y)+exp(-z)][x^2+z^y+hypot(x,y)][atan2(x,y)+asin(z)+acosh(y)][(x<y)+(x>=z)*2+!(x=y)+abs(min(x,y)-max(y,z))][x%y+floor(z)+ceil(x)+trunc(y)+int(z)]","x,y,z");
+
+  // Spans more than one block, with an incomplete last block
+  const Uint nb_points = 2*CompiledFunction::block_size + 17;
+  RealMatrix vars(nb_points, 3);
+  for(Uint p = 0; p != nb_points; ++p)
+  {
+    vars(p,0) = -2. + 4.*p/nb_points;
+    vars(p,1) = p % 7 == 0 ? 0. : 0.5 + 3.*p/nb_points;
+    vars(p,2) = 1. - 2.5*p/nb_points;
+  }
+
+  RealMatrix results;
+  f.evaluate_batch(vars, results);
+  BOOST_CHECK_EQUAL(results.rows(), nb_points);
+  BOOST_CHECK_EQUAL(results.cols(), 7);
+
+  RealVector u(3);
+  for(Uint p = 0; p != nb_points; ++p)
+  {
+    u = vars.row(p);
+    const RealVector& r = f(u);
+    for(Uint i = 0; i != 7; ++i)
+      BOOST_CHECK_CLOSE(results(p,i), r[i], 1e-12);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( evaluate_batch_fallback )
+{
+  // if can't be vectorized, and is evaluated point by point
+  cf3::math::AnalyticalFunction f("if(x<0, -x, 1/x) + t", "x,t");
+
+  RealMatrix vars(100, 2);
+  for(Uint p = 0; p != 100; ++p)
+  {
+    vars(p,0) = -1. + 0.02*p;
+    vars(p,1) = 0.5;
+  }
+
+  RealVector results;
+  f.evaluate_batch(vars, results);
+  BOOST_CHECK_EQUAL(results.size(), 100);
+
+  RealVector u(2);
+  for(Uint p = 0; p != 100; ++p)
+  {
+    u = vars.row(p);
+    BOOST_CHECK_CLOSE(results[p], f(u), 1e-12);
+  }
+  BOOST_CHECK_EQUAL(results[50], 0.);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
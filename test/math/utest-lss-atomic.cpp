@@ -17,6 +17,7 @@
 #include <boost/lexical_cast.hpp>
 
 #include "common/Log.hpp"
+#include "common/OptionList.hpp"
 #include "math/LSS/System.hpp"
 #include "math/VariablesDescriptor.hpp"
 
@@ -474,6 +475,67 @@ BOOST_AUTO_TEST_CASE( test_matrix_only )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( test_assembly_plan )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp_ptr = common::allocate_component<common::PE::CommPattern>("commpattern");
+  common::PE::CommPattern& cp = *cp_ptr;
+  build_commpattern(cp);
+  boost::shared_ptr<LSS::System> sys(common::allocate_component<LSS::System>("sys"));
+  sys->options().option("matrix_builder").change_value(matrix_builder);
+  build_system(*sys,cp);
+  Handle<LSS::Matrix> mat=sys->matrix();
+
+  // blocks with owned and ghost rows, with the last one repeating the first
+  std::vector< std::vector<Uint> > blocks(3);
+  if (irank==0)
+  {
+    blocks[0] += 1,2,5;
+    blocks[1] += 3,1,7;
+    blocks[2] += 1,2,5;
+  } else {
+    blocks[0] += 2,5,8;
+    blocks[1] += 3,2,7;
+    blocks[2] += 2,5,8;
+  }
+
+  std::vector<Uint> rows, cols, ref_rows, ref_cols;
+  std::vector<Real> vals, ref_vals;
+
+  // reference assembly, without plan
+  mat->reset();
+  for (Uint b=0; b<blocks.size(); b++)
+  {
+    LSS::BlockAccumulator ba;
+    ba.resize(blocks[b].size(),neq);
+    for (int i=0; i<(const int)ba.size()*ba.size(); i++) ba.mat.data()[i]=b*1000.+i;
+    ba.neighbour_indices(blocks[b]);
+    mat->add_values(ba);
+  }
+  mat->debug_data(ref_rows,ref_cols,ref_vals);
+
+  // the first pass records the plan, the second one uses it, and the last one checks that the plan is rebuilt after create
+  mat->options().set("assembly_plan",true);
+  for (Uint pass=0; pass<3; pass++)
+  {
+    if (pass==2) build_system(*sys,cp);
+    mat->reset();
+    for (Uint b=0; b<blocks.size(); b++)
+    {
+      LSS::BlockAccumulator ba;
+      ba.resize(blocks[b].size(),neq);
+      for (int i=0; i<(const int)ba.size()*ba.size(); i++) ba.mat.data()[i]=b*1000.+i;
+      ba.neighbour_indices(blocks[b]);
+      mat->add_values(ba);
+    }
+    mat->debug_data(rows,cols,vals);
+    BOOST_CHECK(rows==ref_rows);
+    BOOST_CHECK(cols==ref_cols);
+    BOOST_CHECK(vals==ref_vals);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( test_vector_only )
 {
   // build a commpattern and the two vectors
@@ -0,0 +1,471 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the native LSS backend"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Action.hpp"
+#include "common/Core.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/PE/CommWrapper.hpp"
+
+#include "math/LSS/System.hpp"
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::PE;
+using namespace cf3::math;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Assembles a 1D chain edge by edge, through add_values as a Proto element expression would
+class EdgeAssembly : public common::Action
+{
+public:
+  EdgeAssembly(const std::string& name) : common::Action(name)
+  {
+  }
+
+  static std::string type_name() { return "EdgeAssembly"; }
+
+  void execute()
+  {
+    const Uint neq = lss->matrix()->neq();
+    const Uint nb_nodes = lss->matrix()->blockcol_size();
+    LSS::BlockAccumulator acc;
+    acc.resize(2, neq);
+    for(Uint i = 0; i != nb_nodes-1; ++i)
+    {
+      acc.indices[0] = i;
+      acc.indices[1] = i+1;
+      acc.mat.setZero();
+      for(Uint n = 0; n != 2; ++n)
+      {
+        for(Uint a = 0; a != neq; ++a)
+        {
+          acc.mat(n*neq + a, n*neq + a) = 1.1;
+          acc.mat(n*neq + a, (1-n)*neq + a) = -1.;
+          for(Uint b = 0; b != neq; ++b)
+          {
+            if(b != a)
+              acc.mat(n*neq + a, n*neq + b) = 0.05;
+          }
+        }
+      }
+      acc.rhs.setConstant(1.);
+      lss->matrix()->add_values(acc);
+      lss->rhs()->add_rhs_values(acc);
+    }
+  }
+
+  Handle<LSS::System> lss;
+};
+
+struct NativeFixture
+{
+  NativeFixture() : nb_nodes(2500)
+  {
+    Component& root = Core::instance().root();
+    if(is_null(root.get_child("commpattern")))
+    {
+      CommPattern& cp = *root.create_component<CommPattern>("commpattern");
+      std::vector<Uint> gid(nb_nodes), rnk(nb_nodes, 0);
+      for(Uint i = 0; i != nb_nodes; ++i)
+        gid[i] = i;
+      cp.insert("gid",gid,1,false);
+      cp.setup(cp.get_child("gid")->handle<common::PE::CommWrapper>(),rnk);
+    }
+
+    // 1D chain: each node is connected to its left and right neighbour
+    startidx.push_back(0);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      if(i != 0)
+        conn.push_back(i-1);
+      if(i != nb_nodes-1)
+        conn.push_back(i+1);
+      startidx.push_back(conn.size());
+    }
+  }
+
+  /// Build a system with the native backend, filled with a block tridiagonal matrix that is diagonally dominant.
+  /// Unless symmetric is true, the coupling to the right neighbour differs from the coupling to the left neighbour.
+  Handle<LSS::System> build_system(const std::string& name, const Uint neq, const bool symmetric = false)
+  {
+    Component& root = Core::instance().root();
+    if(is_not_null(root.get_child(name)))
+      root.remove_component(name);
+
+    Handle<LSS::System> lss = root.create_component<LSS::System>(name);
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeCrsMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    lss->create(*root.get_child("commpattern")->handle<CommPattern>(), neq, conn, startidx);
+
+    LSS::Matrix& mat = *lss->matrix();
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      for(Uint a = 0; a != neq; ++a)
+      {
+        const Uint irow = i*neq + a;
+        mat.set_value(irow, irow, 4.);
+        for(Uint b = 0; b != neq; ++b)
+        {
+          if(b != a)
+            mat.set_value(i*neq + b, irow, 0.5);
+        }
+        if(i != 0)
+          mat.set_value((i-1)*neq + a, irow, -1.);
+        if(i != nb_nodes-1)
+          mat.set_value((i+1)*neq + a, irow, symmetric ? -1. : -1.2);
+      }
+    }
+
+    return lss;
+  }
+
+  /// Fill the RHS so that the exact solution is known, and reset the solution
+  void set_exact_solution(LSS::System& lss)
+  {
+    const Uint neq = lss.matrix()->neq();
+    for(Uint i = 0; i != nb_nodes*neq; ++i)
+      lss.solution()->set_value(i, exact_value(i));
+    lss.matrix()->apply(lss.rhs(), lss.solution());
+    lss.solution()->reset(0.);
+  }
+
+  /// Connect the first and the last node of the chain, so their rows have the same columns and can be tied together
+  void connect_ends()
+  {
+    const Uint last = nb_nodes-1;
+    std::vector< std::vector<Uint> > node_conn(nb_nodes);
+    for(Uint i = 0; i != nb_nodes; ++i)
+      node_conn[i].assign(conn.begin() + startidx[i], conn.begin() + startidx[i+1]);
+    node_conn[0].push_back(last-1);
+    node_conn[0].push_back(last);
+    node_conn[1].push_back(last);
+    node_conn[last-1].push_back(0);
+    node_conn[last].push_back(0);
+    node_conn[last].push_back(1);
+
+    conn.clear();
+    startidx.assign(1, 0);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      conn.insert(conn.end(), node_conn[i].begin(), node_conn[i].end());
+      startidx.push_back(conn.size());
+    }
+  }
+
+  /// Build a system assembled by an EdgeAssembly
+  Handle<LSS::System> build_edge_system(const std::string& name, const Uint neq, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>())
+  {
+    Component& root = Core::instance().root();
+    if(is_not_null(root.get_child(name)))
+      root.remove_component(name);
+
+    Handle<LSS::System> lss = root.create_component<LSS::System>(name);
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeCrsMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    lss->create(*root.get_child("commpattern")->handle<CommPattern>(), neq, conn, startidx, periodic_links_nodes, periodic_links_active);
+
+    Handle<EdgeAssembly> assembly = lss->create_component<EdgeAssembly>("Assembly");
+    assembly->lss = lss;
+
+    lss->reset();
+    assembly->execute();
+    return lss;
+  }
+
+  static Real exact_value(const Uint i)
+  {
+    return 1. + 0.01*static_cast<Real>(i%17);
+  }
+
+  void check_solution(LSS::System& lss)
+  {
+    const Uint neq = lss.matrix()->neq();
+    for(Uint i = 0; i != nb_nodes*neq; ++i)
+    {
+      Real value;
+      lss.solution()->get_value(i, value);
+      BOOST_CHECK_CLOSE(value, exact_value(i), 1e-4);
+    }
+  }
+
+  const Uint nb_nodes;
+  std::vector<Uint> conn, startidx;
+};
+
+BOOST_FIXTURE_TEST_SUITE( NativeLSSSuite, NativeFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK_EQUAL(Comm::instance().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( apply )
+{
+  Handle<LSS::System> lss = build_system("apply", 2);
+  lss->matrix()->options().set("nb_threads", 3u);
+
+  std::vector<Real> x(nb_nodes*2);
+  for(Uint i = 0; i != x.size(); ++i)
+  {
+    x[i] = static_cast<Real>(i%7) - 2.5;
+    lss->solution()->set_value(i, x[i]);
+    lss->rhs()->set_value(i, 1.);
+  }
+
+  // y = 2*A*x + 0.5*y, with enough rows to split the product over the threads
+  lss->matrix()->apply(lss->rhs(), lss->solution(), 2., 0.5);
+
+  for(Uint irow = 0; irow != x.size(); ++irow)
+  {
+    Real expected = 0.5;
+    const Uint inode = irow/2;
+    const Uint col_begin = inode == 0 ? 0 : (inode-1)*2;
+    const Uint col_end = std::min(inode+2, nb_nodes)*2;
+    for(Uint icol = col_begin; icol != col_end; ++icol)
+    {
+      Real a_ij;
+      lss->matrix()->get_value(icol, irow, a_ij);
+      expected += 2.*a_ij*x[icol];
+    }
+    Real y;
+    lss->rhs()->get_value(irow, y);
+    BOOST_CHECK_CLOSE(y, expected, 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( solvers )
+{
+  const std::string solvers[] = {"GMRES", "BiCGStab"};
+  const std::string preconditioners[] = {"None", "Jacobi", "ILU0", "SGS"};
+  for(Uint s = 0; s != 2; ++s)
+  {
+    for(Uint p = 0; p != 4; ++p)
+    {
+      BOOST_TEST_MESSAGE("Solving with " << solvers[s] << " and preconditioner " << preconditioners[p]);
+      Handle<LSS::System> lss = build_system("solvers", 1);
+      lss->solution_strategy()->options().set("solver", solvers[s]);
+      lss->solution_strategy()->options().set("preconditioner", preconditioners[p]);
+      lss->solution_strategy()->options().set("tolerance", 1e-12);
+      set_exact_solution(*lss);
+      lss->solve();
+      check_solution(*lss);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( blocks )
+{
+  Handle<LSS::System> lss = build_system("blocks", 3);
+  lss->solution_strategy()->options().set("solver", std::string("GMRES"));
+  lss->solution_strategy()->options().set("preconditioner", std::string("ILU0"));
+  lss->solution_strategy()->options().set("tolerance", 1e-12);
+  set_exact_solution(*lss);
+  lss->solve();
+  check_solution(*lss);
+
+  const LSS::NativeStrategy& strategy = *Handle<LSS::NativeStrategy>(lss->solution_strategy());
+  BOOST_CHECK(strategy.relative_residual() < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( conjugate_gradient )
+{
+  Handle<LSS::System> lss = build_system("cg", 2, true);
+
+  // CG needs a symmetric matrix
+  LSS::Matrix& mat = *lss->matrix();
+  for(Uint irow = 0; irow != nb_nodes*2; ++irow)
+  {
+    const Uint inode = irow/2;
+    const Uint col_begin = inode == 0 ? 0 : (inode-1)*2;
+    const Uint col_end = std::min(inode+2, nb_nodes)*2;
+    for(Uint icol = col_begin; icol != col_end; ++icol)
+    {
+      Real a_ij, a_ji;
+      mat.get_value(icol, irow, a_ij);
+      mat.get_value(irow, icol, a_ji);
+      BOOST_CHECK_EQUAL(a_ij, a_ji);
+    }
+  }
+
+  const std::string preconditioners[] = {"None", "Jacobi", "ILU0", "SGS"};
+  for(Uint p = 0; p != 4; ++p)
+  {
+    lss->solution_strategy()->options().set("solver", std::string("CG"));
+    lss->solution_strategy()->options().set("preconditioner", preconditioners[p]);
+    lss->solution_strategy()->options().set("tolerance", 1e-12);
+    set_exact_solution(*lss);
+    lss->solve();
+    check_solution(*lss);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( symmetric_dirichlet )
+{
+  Handle<LSS::System> lss = build_system("dirichlet", 1);
+  lss->rhs()->reset(1.);
+  lss->dirichlet(0, 0, 3., true);
+  lss->dirichlet(nb_nodes-1, 0, -2., true);
+  lss->dirichlet_apply(true);
+
+  Real value;
+  lss->matrix()->get_value(1, 0, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  lss->matrix()->get_value(0, 1, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  lss->matrix()->get_value(0, 0, value);
+  BOOST_CHECK_EQUAL(value, 1.);
+  lss->rhs()->get_value(0, value);
+  BOOST_CHECK_EQUAL(value, 3.);
+  lss->rhs()->get_value(1, value);
+  BOOST_CHECK_CLOSE(value, 1. + 1.*3., 1e-10);
+
+  lss->solution_strategy()->options().set("tolerance", 1e-12);
+  lss->solve();
+  lss->solution()->get_value(0, value);
+  BOOST_CHECK_CLOSE(value, 3., 1e-6);
+  lss->solution()->get_value(nb_nodes-1, value);
+  BOOST_CHECK_CLOSE(value, -2., 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE( symmetric_dirichlet_matrix )
+{
+  Handle<LSS::System> lss = build_system("symmetric_dirichlet_matrix", 2, true);
+  LSS::Matrix& mat = *lss->matrix();
+  LSS::Vector& rhs = *lss->rhs();
+
+  // Column of equation 1 of node 5, which only has entries in the rows of nodes 4, 5 and 6
+  const Uint bc_idx = 5*2 + 1;
+  const Uint row_begin = 4*2;
+  const Uint row_end = 7*2;
+  std::vector<Real> column(row_end, 0.);
+  for(Uint irow = row_begin; irow != row_end; ++irow)
+    mat.get_value(bc_idx, irow, column[irow]);
+
+  rhs.reset(1.);
+  mat.symmetric_dirichlet(5, 1, 2., rhs);
+
+  Real value;
+  for(Uint irow = row_begin; irow != row_end; ++irow)
+  {
+    mat.get_value(bc_idx, irow, value);
+    BOOST_CHECK_EQUAL(value, irow == bc_idx ? 1. : 0.);
+    mat.get_value(irow, bc_idx, value);
+    BOOST_CHECK_EQUAL(value, irow == bc_idx ? 1. : 0.);
+    rhs.get_value(irow, value);
+    BOOST_CHECK_CLOSE(value, irow == bc_idx ? 2. : 1. - 2.*column[irow], 1e-10);
+  }
+  rhs.get_value(row_begin-1, value);
+  BOOST_CHECK_EQUAL(value, 1.);
+  rhs.get_value(row_end, value);
+  BOOST_CHECK_EQUAL(value, 1.);
+
+  // A second application uses the column values that were eliminated the first time
+  rhs.reset(1.);
+  mat.symmetric_dirichlet(5, 1, -1., rhs);
+  for(Uint irow = row_begin; irow != row_end; ++irow)
+  {
+    rhs.get_value(irow, value);
+    BOOST_CHECK_CLOSE(value, irow == bc_idx ? -1. : 1. + column[irow], 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( tie_blockrow_pairs )
+{
+  connect_ends();
+  Handle<LSS::System> lss = build_edge_system("tie", 1);
+  const Uint last = nb_nodes-1;
+
+  // Tying the ends turns the chain into a ring
+  lss->periodicity(0, last);
+
+  Real value;
+  lss->matrix()->get_value(0, 0, value);
+  BOOST_CHECK_CLOSE(value, 2.2, 1e-10);
+  lss->matrix()->get_value(last, 0, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  lss->matrix()->get_value(last-1, 0, value);
+  BOOST_CHECK_EQUAL(value, -1.);
+  lss->matrix()->get_value(last, last, value);
+  BOOST_CHECK_EQUAL(value, 1.);
+  lss->matrix()->get_value(0, last, value);
+  BOOST_CHECK_EQUAL(value, -1.);
+  lss->matrix()->get_value(last-1, last, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  lss->rhs()->get_value(0, value);
+  BOOST_CHECK_EQUAL(value, 2.);
+  lss->rhs()->get_value(last, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+
+  // Each node of the ring has the same equation, so the solution is constant
+  lss->solution_strategy()->options().set("solver", std::string("GMRES"));
+  lss->solution_strategy()->options().set("preconditioner", std::string("Jacobi"));
+  lss->solution_strategy()->options().set("tolerance", 1e-12);
+  lss->solve();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    lss->solution()->get_value(i, value);
+    BOOST_CHECK_CLOSE(value, 10., 1e-6);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( periodic )
+{
+  // The last node shares the row of the first node, which turns the chain into a ring
+  const Uint last = nb_nodes-1;
+  std::vector<Uint> periodic_links_nodes(nb_nodes, 0);
+  std::vector<bool> periodic_links_active(nb_nodes, false);
+  periodic_links_active[last] = true;
+
+  Handle<LSS::System> lss = build_edge_system("periodic", 1, periodic_links_nodes, periodic_links_active);
+  BOOST_CHECK_EQUAL(lss->matrix()->blockrow_size(), last);
+  BOOST_CHECK_EQUAL(lss->matrix()->blockcol_size(), nb_nodes);
+
+  // The contributions of the last node are added to the row of the first node
+  Real value;
+  lss->matrix()->get_value(0, 0, value);
+  BOOST_CHECK_CLOSE(value, 2.2, 1e-10);
+  lss->matrix()->get_value(last-1, 0, value);
+  BOOST_CHECK_EQUAL(value, -1.);
+  lss->matrix()->get_value(0, last-1, value);
+  BOOST_CHECK_EQUAL(value, -1.);
+  lss->rhs()->get_value(last, value);
+  BOOST_CHECK_EQUAL(value, 2.);
+
+  lss->solution_strategy()->options().set("solver", std::string("CG"));
+  lss->solution_strategy()->options().set("preconditioner", std::string("SGS"));
+  lss->solution_strategy()->options().set("tolerance", 1e-12);
+  lss->solve();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    lss->solution()->get_value(i, value);
+    BOOST_CHECK_CLOSE(value, 10., 1e-6);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,151 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::Renumber"
+
+#include <algorithm>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+#include "common/BoostAssign.hpp"
+
+#include "common/Core.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace boost::assign;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Node global indices of each element, by element global index
+typedef std::map< Uint, std::vector<Uint> > ElementNodesT;
+
+ElementNodesT element_nodes(const Mesh& mesh)
+{
+  ElementNodesT result;
+  const Dictionary& geometry = mesh.geometry_fields();
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    const Connectivity& connectivity = entities->geometry_space().connectivity();
+    for(Uint e = 0; e != connectivity.size(); ++e)
+    {
+      std::vector<Uint>& nodes = result[entities->glb_idx()[e]];
+      boost_foreach(const Uint node, connectivity[e])
+        nodes.push_back(geometry.glb_idx()[node]);
+    }
+  }
+  return result;
+}
+
+/// Largest difference between the node indices of an element
+Uint bandwidth(const Mesh& mesh)
+{
+  Uint result = 0;
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    boost_foreach(Connectivity::ConstRow nodes, entities->geometry_space().connectivity().array())
+    {
+      const Uint min_node = *std::min_element(nodes.begin(), nodes.end());
+      const Uint max_node = *std::max_element(nodes.begin(), nodes.end());
+      result = std::max(result, max_node - min_node);
+    }
+  }
+  return result;
+}
+
+void check_renumber(const std::string& algorithm)
+{
+  Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator_"+algorithm);
+  mesh_generator->options().set("mesh",Core::instance().root().uri()/("mesh_"+algorithm));
+  mesh_generator->options().set("lengths",std::vector<Real>(2,10.));
+  std::vector<Uint> nb_cells = list_of(40)(3);
+  mesh_generator->options().set("nb_cells",nb_cells);
+  Mesh& mesh = mesh_generator->generate();
+
+  Dictionary& geometry = mesh.geometry_fields();
+  Field& field = geometry.create_field("test_field");
+  for(Uint i = 0; i != geometry.size(); ++i)
+    field[i][0] = geometry.coordinates()[i][0] + 100.*geometry.coordinates()[i][1];
+
+  const ElementNodesT nodes_before = element_nodes(mesh);
+  const Uint bandwidth_before = bandwidth(mesh);
+
+  boost::shared_ptr<MeshTransformer> renumber = boost::dynamic_pointer_cast<MeshTransformer>(build_component("cf3.mesh.actions.Renumber","renumber"));
+  renumber->options().set("algorithm",algorithm);
+  renumber->transform(mesh);
+
+  // Fields are moved along with the nodes
+  for(Uint i = 0; i != geometry.size(); ++i)
+    BOOST_CHECK_EQUAL(field[i][0], geometry.coordinates()[i][0] + 100.*geometry.coordinates()[i][1]);
+
+  // The global to local map is rebuilt
+  for(Uint i = 0; i != geometry.size(); ++i)
+    BOOST_CHECK_EQUAL(geometry.glb_to_loc()[geometry.glb_idx()[i]], i);
+
+  // Elements still use the same nodes
+  BOOST_CHECK(element_nodes(mesh) == nodes_before);
+
+  // The long rows of the structured mesh give a large bandwidth with the original numbering
+  if(algorithm == "RCM")
+    BOOST_CHECK_LT(bandwidth(mesh), bandwidth_before);
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( Renumber_TestSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( renumber_hilbert )
+{
+  check_renumber("Hilbert");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( renumber_rcm )
+{
+  check_renumber("RCM");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  Core::instance().terminate();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -14,6 +14,7 @@
 #include "common/OptionList.hpp"
 #include "common/Core.hpp"
 #include "common/FindComponents.hpp"
+#include "common/List.hpp"
 
 #include "Tools/Testing/TimedTestFixture.hpp"
 
@@ -114,6 +115,33 @@ BOOST_AUTO_TEST_CASE( face_elem_connectivity )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( threaded_face_elem_connectivity )
+{
+  Handle<FaceCellConnectivity> serial = m_mesh->create_component<FaceCellConnectivity>("serial_face_cell_connectivity");
+  serial->setup( find_component<Region>(*m_mesh) );
+
+  // Hashing the faces of several element ranges on several threads must give the same face numbering
+  Handle<FaceCellConnectivity> threaded = m_mesh->create_component<FaceCellConnectivity>("threaded_face_cell_connectivity");
+  threaded->options().set("nb_threads",3u);
+  threaded->setup( find_component<Region>(*m_mesh) );
+
+  BOOST_CHECK_EQUAL(threaded->size(), serial->size());
+  for (Uint f=0; f<serial->size(); ++f)
+  {
+    BOOST_CHECK(threaded->face_nodes(f) == serial->face_nodes(f));
+    BOOST_CHECK_EQUAL(threaded->is_bdry_face()[f], serial->is_bdry_face()[f]);
+    for (Uint i=0; i<2; ++i)
+    {
+      BOOST_CHECK(threaded->connectivity()[f][i].comp == serial->connectivity()[f][i].comp);
+      BOOST_CHECK_EQUAL(threaded->connectivity()[f][i].idx, serial->connectivity()[f][i].idx);
+      BOOST_CHECK_EQUAL(threaded->face_number()[f][i], serial->face_number()[f][i]);
+      BOOST_CHECK_EQUAL(threaded->cell_rotation()[f][i], serial->cell_rotation()[f][i]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,9 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::gmsh::Reader"
 
+#include <fstream>
+#include <sstream>
+
 #include <boost/test/unit_test.hpp>
 
 #include "common/Log.hpp"
@@ -15,6 +18,7 @@
 
 #include "common/Core.hpp"
 #include "common/Environment.hpp"
+#include "common/FindComponents.hpp"
 
 #include "math/VariablesDescriptor.hpp"
 
@@ -25,6 +29,8 @@
 #include "mesh/MeshTransformer.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Entities.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Connectivity.hpp"
 #include "mesh/Space.hpp"
 #include "common/DynTable.hpp"
 #include "common/List.hpp"
@@ -63,6 +69,82 @@ struct gmshReaderMPITests_Fixture
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Write a copy of an ASCII gmsh file in the binary format.
+/// Consecutive elements with the same type and number of tags are grouped in one block.
+void convert_to_binary(const std::string& ascii_file, const std::string& binary_file)
+{
+  std::ifstream in(ascii_file.c_str());
+  std::ofstream out(binary_file.c_str(), std::ios_base::binary);
+  const int one = 1;
+  std::string line;
+  while (std::getline(in,line))
+  {
+    if (line == "$MeshFormat")
+    {
+      std::getline(in,line);
+      out << "$MeshFormat\n2.2 1 8\n";
+      out.write(reinterpret_cast<const char*>(&one),sizeof(int));
+      out << "\n";
+    }
+    else if (line == "$Nodes")
+    {
+      int nb_nodes;
+      in >> nb_nodes;
+      out << "$Nodes\n" << nb_nodes << "\n";
+      for (int n=0; n<nb_nodes; ++n)
+      {
+        int number;
+        double coords[3];
+        in >> number >> coords[0] >> coords[1] >> coords[2];
+        out.write(reinterpret_cast<const char*>(&number),sizeof(int));
+        out.write(reinterpret_cast<const char*>(coords),3*sizeof(double));
+      }
+      std::getline(in,line);
+      out << "\n";
+    }
+    else if (line == "$Elements")
+    {
+      int nb_elems;
+      in >> nb_elems;
+      std::getline(in,line);
+      // each element as type, number of tags and the record: number, tags, nodes
+      std::vector< std::vector<int> > elements(nb_elems);
+      for (int e=0; e<nb_elems; ++e)
+      {
+        std::getline(in,line);
+        std::istringstream element_line(line);
+        int value;
+        while (element_line >> value)
+          elements[e].push_back(value);
+      }
+      out << "$Elements\n" << nb_elems << "\n";
+      int e=0;
+      while (e<nb_elems)
+      {
+        const int type = elements[e][1];
+        const int nb_tags = elements[e][2];
+        int block_end = e;
+        while (block_end<nb_elems && elements[block_end][1] == type && elements[block_end][2] == nb_tags)
+          ++block_end;
+        const int header[3] = {type, block_end-e, nb_tags};
+        out.write(reinterpret_cast<const char*>(header),3*sizeof(int));
+        for (; e<block_end; ++e)
+        {
+          out.write(reinterpret_cast<const char*>(&elements[e][0]),sizeof(int));
+          out.write(reinterpret_cast<const char*>(&elements[e][3]),(elements[e].size()-3)*sizeof(int));
+        }
+      }
+      out << "\n";
+    }
+    else
+    {
+      out << line << "\n";
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_FIXTURE_TEST_SUITE( gmshReaderMPITests_TestSuite, gmshReaderMPITests_Fixture )
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -245,6 +327,80 @@ BOOST_AUTO_TEST_CASE( read_2d_mesh_mix_p2 )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( read_2d_mesh_mix_p1_binary )
+{
+  convert_to_binary("../../resources/rectangle-mix-p1.msh","rectangle-mix-p1-binary.msh");
+
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+
+  Mesh& ascii_mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_mix_p1_ascii");
+  meshreader->read_mesh_into("../../resources/rectangle-mix-p1.msh",ascii_mesh);
+
+  Mesh& binary_mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_mix_p1_binary");
+  meshreader->read_mesh_into("rectangle-mix-p1-binary.msh",binary_mesh);
+
+  // Both meshes have the known numbers of nodes and elements of the file
+  Mesh* meshes[] = { &ascii_mesh, &binary_mesh };
+  boost_foreach(Mesh* mesh, meshes)
+  {
+    BOOST_CHECK_EQUAL( mesh->geometry_fields().size() , 177u );
+    Uint nb_elements = 0;
+    boost_foreach(const Elements& elements, find_components_recursively<Elements>(mesh->topology()))
+      nb_elements += elements.size();
+    BOOST_CHECK_EQUAL( nb_elements , 310u );
+
+    Handle<Elements> inlet (mesh->access_component("topology/inlet/elements_cf3.mesh.LagrangeP1.Line2D"));
+    Handle<Elements> outlet(mesh->access_component("topology/outlet/elements_cf3.mesh.LagrangeP1.Line2D"));
+    Handle<Elements> wall  (mesh->access_component("topology/wall/elements_cf3.mesh.LagrangeP1.Line2D"));
+    Handle<Elements> left_triag (mesh->access_component("topology/left/elements_cf3.mesh.LagrangeP1.Triag2D"));
+    Handle<Elements> left_quad  (mesh->access_component("topology/left/elements_cf3.mesh.LagrangeP1.Quad2D"));
+    Handle<Elements> right_triag(mesh->access_component("topology/right/elements_cf3.mesh.LagrangeP1.Triag2D"));
+    BOOST_REQUIRE( is_not_null(inlet) && is_not_null(outlet) && is_not_null(wall) );
+    BOOST_REQUIRE( is_not_null(left_triag) && is_not_null(left_quad) && is_not_null(right_triag) );
+    BOOST_CHECK_EQUAL( inlet->size() , 6u );
+    BOOST_CHECK_EQUAL( outlet->size() , 6u );
+    BOOST_CHECK_EQUAL( wall->size() , 42u );
+    BOOST_CHECK_EQUAL( left_triag->size() , 106u );
+    BOOST_CHECK_EQUAL( left_quad->size() , 42u );
+    BOOST_CHECK_EQUAL( right_triag->size() , 108u );
+  }
+
+  // Both meshes must be identical
+  const Field& ascii_coords = ascii_mesh.geometry_fields().coordinates();
+  const Field& binary_coords = binary_mesh.geometry_fields().coordinates();
+  BOOST_CHECK_EQUAL( binary_coords.size() , ascii_coords.size() );
+  BOOST_CHECK_EQUAL( binary_coords.row_size() , 2u );
+  for (Uint n=0; n<ascii_coords.size(); ++n)
+  {
+    BOOST_CHECK_EQUAL( binary_mesh.geometry_fields().glb_idx()[n] , ascii_mesh.geometry_fields().glb_idx()[n] );
+    for (Uint d=0; d<ascii_coords.row_size(); ++d)
+      BOOST_CHECK_EQUAL( binary_coords[n][d] , ascii_coords[n][d] );
+  }
+
+  std::vector< Handle<Elements> > ascii_elements;
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(ascii_mesh.topology()))
+    ascii_elements.push_back(elements.handle<Elements>());
+  Uint elements_idx = 0;
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(binary_mesh.topology()))
+  {
+    BOOST_REQUIRE( elements_idx < ascii_elements.size() );
+    const Elements& reference = *ascii_elements[elements_idx++];
+    BOOST_CHECK_EQUAL( elements.uri().path().substr(binary_mesh.uri().path().size()) , reference.uri().path().substr(ascii_mesh.uri().path().size()) );
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    const Connectivity& reference_connectivity = reference.geometry_space().connectivity();
+    BOOST_CHECK_EQUAL( connectivity.size() , reference_connectivity.size() );
+    for (Uint e=0; e<reference_connectivity.size(); ++e)
+    {
+      BOOST_CHECK_EQUAL( elements.glb_idx()[e] , reference.glb_idx()[e] );
+      for (Uint n=0; n<reference_connectivity.row_size(); ++n)
+        BOOST_CHECK_EQUAL( connectivity[e][n] , reference_connectivity[e][n] );
+    }
+  }
+  BOOST_CHECK_EQUAL( elements_idx , ascii_elements.size() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( read_2d_mesh_mix_p1_out )
 {
   BOOST_CHECK(true);
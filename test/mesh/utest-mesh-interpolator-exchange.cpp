@@ -0,0 +1,106 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests the sparse exchange used by the mesh interpolator"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Interpolator.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct InterpolatorExchange_Fixture
+{
+  InterpolatorExchange_Fixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// Number of values that rank from sends to rank to in the given exchange
+  static Uint message_size(const Uint from, const Uint to, const Uint exchange)
+  {
+    // Skip some pairs, so not every rank receives from every other rank
+    if ((from + 2*to + exchange) % 3 == 0)
+      return 0;
+    return 1 + (from + 3*to + 7*exchange) % 11;
+  }
+
+  int m_argc;
+  char** m_argv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( InterpolatorExchange_TestSuite, InterpolatorExchange_Fixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init )
+{
+  PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK(PE::Comm::instance().size() >= 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Exchanges of Real and Uint data directly follow each other, as in Interpolator::store,
+/// so the messages of a fast rank for the next exchange may arrive while another rank is still
+/// receiving those of the current exchange. Every message must end up in its own exchange.
+BOOST_AUTO_TEST_CASE( back_to_back_exchanges )
+{
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint rank = PE::Comm::instance().rank();
+
+  for (Uint exchange=0; exchange<200; exchange+=2)
+  {
+    std::vector< std::vector<Real> > send_reals(nb_procs), recv_reals;
+    std::vector< std::vector<Uint> > send_uints(nb_procs), recv_uints;
+    for (Uint pid=0; pid<nb_procs; ++pid)
+    {
+      for (Uint i=0; i<message_size(rank,pid,exchange); ++i)
+        send_reals[pid].push_back(0.5 + rank*1000. + i);
+      for (Uint i=0; i<message_size(rank,pid,exchange+1); ++i)
+        send_uints[pid].push_back(rank*1000 + i);
+    }
+
+    Interpolator_sparse_exchange(send_reals,recv_reals);
+    Interpolator_sparse_exchange(send_uints,recv_uints);
+
+    BOOST_REQUIRE_EQUAL(recv_reals.size(), nb_procs);
+    BOOST_REQUIRE_EQUAL(recv_uints.size(), nb_procs);
+    for (Uint pid=0; pid<nb_procs; ++pid)
+    {
+      BOOST_REQUIRE_EQUAL(recv_reals[pid].size(), message_size(pid,rank,exchange));
+      for (Uint i=0; i<recv_reals[pid].size(); ++i)
+        BOOST_CHECK_EQUAL(recv_reals[pid][i], 0.5 + pid*1000. + i);
+      BOOST_REQUIRE_EQUAL(recv_uints[pid].size(), message_size(pid,rank,exchange+1));
+      for (Uint i=0; i<recv_uints[pid].size(); ++i)
+        BOOST_CHECK_EQUAL(recv_uints[pid][i], pid*1000 + i);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -7,11 +7,14 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Tests cf3::mesh::NodeElementConnectivity"
 
+#include <algorithm>
+
 #include <boost/test/unit_test.hpp>
 
 #include "common/Log.hpp"
 #include "common/Core.hpp"
 #include "common/FindComponents.hpp"
+#include "common/CompressedDynTable.hpp"
 
 #include "mesh/Mesh.hpp"
 #include "mesh/Elements.hpp"
@@ -20,6 +23,7 @@
 #include "mesh/MeshReader.hpp"
 #include "mesh/NodeElementConnectivity.hpp"
 #include "mesh/Connectivity.hpp"
+#include "mesh/Space.hpp"
 
 using namespace boost;
 using namespace cf3;
@@ -85,7 +89,7 @@ BOOST_AUTO_TEST_CASE( node_elem_connectivity )
   CFinfo << c->connectivity() << CFendl;
 
   // Output connectivity of node 10
-  DynTable<Uint>::ConstRow elements = c->connectivity()[10];
+  CompressedDynTable<Uint>::ConstRow elements = c->connectivity()[10];
   CFinfo << CFendl << "node 10 is connected to elements: \n";
   boost_foreach(const Uint elem, elements)
   {
@@ -99,6 +103,63 @@ BOOST_AUTO_TEST_CASE( node_elem_connectivity )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( compressed_connectivity_matches_elements )
+{
+  Handle<Mesh> mesh(Core::instance().root().get_child("quadtriag"));
+  Handle<NodeElementConnectivity> c(mesh->get_child("node_elem_connectivity"));
+  const CompressedDynTable<Uint>& node2elem = c->connectivity();
+
+  BOOST_CHECK(node2elem.is_frozen());
+  BOOST_CHECK_EQUAL(node2elem.size(), mesh->geometry_fields().size());
+  BOOST_CHECK_EQUAL(node2elem.offsets().back(), node2elem.nb_values());
+
+  // Every node of every element must list that element, and the total must match
+  Uint nb_entries = 0;
+  for (Uint e=0; e<c->elements().size(); ++e)
+  {
+    Handle< Component > comp;
+    Uint idx;
+    tie(comp,idx) = c->elements().location(e);
+    boost_foreach(const Uint node, Handle<Entities>(comp)->geometry_space().connectivity()[idx])
+    {
+      CompressedDynTable<Uint>::ConstRow elems = node2elem[node];
+      BOOST_CHECK(std::find(elems.begin(), elems.end(), e) != elems.end());
+      ++nb_entries;
+    }
+  }
+  BOOST_CHECK_EQUAL(nb_entries, node2elem.nb_values());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( compressed_table_lifecycle )
+{
+  boost::shared_ptr< DynTable<Uint> > dyn = allocate_component< DynTable<Uint> >("dyn");
+  dyn->resize(3);
+  (*dyn)[0].push_back(4);
+  (*dyn)[0].push_back(2);
+  (*dyn)[2].push_back(7);
+
+  boost::shared_ptr< CompressedDynTable<Uint> > table = allocate_component< CompressedDynTable<Uint> >("table");
+  table->freeze(*dyn);
+  BOOST_CHECK(table->is_frozen());
+  BOOST_CHECK_EQUAL(table->size(), 3u);
+  BOOST_CHECK_EQUAL(table->row_size(0), 2u);
+  BOOST_CHECK_EQUAL(table->row_size(1), 0u);
+  BOOST_CHECK_EQUAL((*table)[0][0], 4u);
+  BOOST_CHECK_EQUAL((*table)[0][1], 2u);
+  BOOST_CHECK_EQUAL((*table)[2][0], 7u);
+
+  // Freezing with incomplete rows is an error
+  std::vector<Uint> row_sizes(2, 1u);
+  table->allocate(row_sizes);
+  BOOST_CHECK(!table->is_frozen());
+  table->push_back(1, 3u);
+  BOOST_CHECK_THROW(table->freeze(), InvalidStructure);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -7,8 +7,25 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::tecplot::Writer"
 
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <zlib.h>
+
+#include "coolfluid-packages.hpp"
+
+#ifdef CF3_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "common/BasicExceptions.hpp"
+#include "common/BlockCompressor.hpp"
+#include "common/BoostFilesystem.hpp"
+#include "common/Foreach.hpp"
 #include "common/List.hpp"
 #include "common/Log.hpp"
 #include "common/Core.hpp"
@@ -16,7 +33,10 @@
 #include "common/OptionComponent.hpp"
 #include "common/OptionArray.hpp"
 #include "common/OptionURI.hpp"
+#include "common/PE/Comm.hpp"
 #include "mesh/MeshWriter.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/VTKXML/Writer.hpp"
 
 #include "Tools/MeshGeneration/MeshGeneration.hpp"
 
@@ -31,10 +51,146 @@ using namespace cf3::common;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Reads back a vtu file written by the VTKXML writer
+struct VtuFile
+{
+  VtuFile(const std::string& path)
+  {
+    std::ifstream in(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    BOOST_REQUIRE(in);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string contents = buffer.str();
+
+    const std::string data_begin = "<AppendedData encoding=\"raw\">\n_";
+    const std::string data_end = "\n</AppendedData>";
+    const std::size_t begin = contents.find(data_begin);
+    const std::size_t end = contents.rfind(data_end);
+    BOOST_REQUIRE(begin != std::string::npos && end != std::string::npos);
+    BOOST_REQUIRE(end >= begin + data_begin.size());
+    xml = contents.substr(0, begin);
+    data = contents.substr(begin + data_begin.size(), end - begin - data_begin.size());
+    lz4 = xml.find("vtkLZ4DataCompressor") != std::string::npos;
+  }
+
+  /// Values of all attributes with the given name, in the order they appear in the XML
+  std::vector<std::string> attributes(const std::string& name) const
+  {
+    std::vector<std::string> result;
+    const std::string key = " " + name + "=\"";
+    for(std::size_t pos = xml.find(key); pos != std::string::npos; pos = xml.find(key, pos + 1))
+    {
+      const std::size_t value_begin = pos + key.size();
+      result.push_back(xml.substr(value_begin, xml.find('"', value_begin) - value_begin));
+    }
+    return result;
+  }
+
+  /// Offset of the point coordinates of each piece
+  std::vector<unsigned long long> points_offsets() const
+  {
+    std::vector<unsigned long long> result;
+    const std::string key = "offset=\"";
+    for(std::size_t pos = xml.find("<Points>"); pos != std::string::npos; pos = xml.find("<Points>", pos + 1))
+    {
+      const std::size_t value_begin = xml.find(key, pos) + key.size();
+      result.push_back(from_str<unsigned long long>(xml.substr(value_begin, xml.find('"', value_begin) - value_begin)));
+    }
+    return result;
+  }
+
+  /// Decompressed contents of the array at the given offset in the appended data
+  std::string array(const unsigned long long offset) const
+  {
+    BOOST_REQUIRE_LT(offset + 12, data.size());
+    boost::uint32_t header[3];
+    std::memcpy(header, data.data() + offset, 12);
+    const boost::uint32_t nb_blocks = header[0];
+    std::vector<boost::uint32_t> compressed_sizes(nb_blocks);
+    if(nb_blocks != 0)
+      std::memcpy(&compressed_sizes[0], data.data() + offset + 12, 4*nb_blocks);
+
+    std::string result;
+    std::size_t block_begin = offset + 12 + 4*nb_blocks;
+    for(Uint i = 0; i != nb_blocks; ++i)
+    {
+      BOOST_REQUIRE_LE(block_begin + compressed_sizes[i], data.size());
+      uLongf block_size = i+1 == nb_blocks ? header[2] : header[1];
+      std::string block(block_size, '\0');
+      if(lz4)
+      {
+#ifdef CF3_HAVE_LZ4
+        block_size = LZ4_decompress_safe(data.data() + block_begin, &block[0], compressed_sizes[i], block.size());
+#else
+        BOOST_FAIL("LZ4 data in a build without LZ4");
+#endif
+      }
+      else
+      {
+        BOOST_CHECK_EQUAL(uncompress(reinterpret_cast<Bytef*>(&block[0]), &block_size, reinterpret_cast<const Bytef*>(data.data() + block_begin), compressed_sizes[i]), Z_OK);
+      }
+      BOOST_CHECK_EQUAL(block_size, block.size());
+      result += block;
+      block_begin += compressed_sizes[i];
+    }
+    return result;
+  }
+
+  std::string xml;
+  std::string data;
+  bool lz4;
+};
+
+/// Check that the points written by the VTKXML writer are the given coordinates
+void check_points(const std::string& points, const Field& coords)
+{
+  const Uint nb_points = coords.size();
+  const Uint dim = coords.row_size();
+  BOOST_REQUIRE_EQUAL(points.size(), 3*nb_points*sizeof(Real));
+  std::vector<Real> values(3*nb_points);
+  if(nb_points != 0)
+    std::memcpy(&values[0], points.data(), points.size());
+
+  Uint nb_wrong = 0;
+  for(Uint i = 0; i != nb_points; ++i)
+  {
+    for(Uint j = 0; j != 3; ++j)
+    {
+      if(values[3*i+j] != (j < dim ? coords[i][j] : 0.))
+        ++nb_wrong;
+    }
+  }
+  BOOST_CHECK_EQUAL(nb_wrong, 0u);
+}
+
+/// Mesh generated in parallel, with a given number of cells
+Handle<Mesh> create_parallel_mesh(const std::string& name, const Uint nb_cells_x, const Uint nb_cells_y)
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>(name);
+  boost::shared_ptr<MeshGenerator> mesh_gen = allocate_component<SimpleMeshGenerator>("meshgen");
+  std::vector<Uint> nb_cells(2); nb_cells[0] = nb_cells_x; nb_cells[1] = nb_cells_y;
+  std::vector<Real> lengths(2); lengths[0] = 2.; lengths[1] = 1.;
+  mesh_gen->options().set("nb_cells", nb_cells);
+  mesh_gen->options().set("lengths", lengths);
+  mesh_gen->options().set("mesh", mesh->uri());
+  mesh_gen->execute();
+  return mesh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE( VTKXMLSuite )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( WriteGrid )
 {
   Component& root = Core::instance().root();
@@ -55,6 +211,109 @@ BOOST_AUTO_TEST_CASE( WriteGrid )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( CompressedRoundTrip )
+{
+  // Large enough for several compression blocks
+  Handle<Mesh> mesh = create_parallel_mesh("compressed_mesh", 80, 40);
+  const Field& coords = mesh->geometry_fields().coordinates();
+  BOOST_CHECK_GT(3*coords.size()*sizeof(Real), 32768u);
+
+  std::vector<std::string> compressors(1, "zlib");
+  if(BlockCompressor::has_lz4())
+    compressors.push_back("lz4");
+
+  boost_foreach(const std::string& compressor, compressors)
+  {
+    boost::shared_ptr< MeshWriter > vtk_writer = build_component_abstract_type<MeshWriter>("cf3.mesh.VTKXML.Writer","compressed_writer");
+    vtk_writer->options().set("mesh",mesh);
+    vtk_writer->options().set("file",URI("compressed_" + compressor + ".vtu"));
+    vtk_writer->options().set("compressor",compressor);
+    vtk_writer->options().set("compression_threads",4u);
+    vtk_writer->execute();
+
+    VtuFile vtu("compressed_" + compressor + "_P" + to_str(PE::Comm::instance().rank()) + ".vtu");
+    BOOST_CHECK_EQUAL(vtu.lz4, compressor == "lz4");
+    const std::vector<unsigned long long> points_offsets = vtu.points_offsets();
+    BOOST_REQUIRE_EQUAL(points_offsets.size(), 1u);
+    check_points(vtu.array(points_offsets[0]), coords);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( AggregatedFiles )
+{
+  PE::Comm& comm = PE::Comm::instance();
+  Handle<Mesh> mesh = create_parallel_mesh("aggregated_mesh", 20, 10);
+  const Field& coords = mesh->geometry_fields().coordinates();
+
+  if(comm.rank() == 0)
+    boost::filesystem::remove("aggregated_P1.vtu");
+  comm.barrier();
+
+  boost::shared_ptr< MeshWriter > vtk_writer = build_component_abstract_type<MeshWriter>("cf3.mesh.VTKXML.Writer","aggregated_writer");
+  vtk_writer->options().set("mesh",mesh);
+  vtk_writer->options().set("file",URI("aggregated.vtu"));
+  vtk_writer->options().set("nb_files",1u);
+  vtk_writer->options().set("background_write",true);
+  vtk_writer->execute();
+  Handle<VTKXML::Writer>(vtk_writer->handle())->wait();
+  comm.barrier();
+
+  // All pieces end up in the file of rank 0, in rank order
+  BOOST_CHECK(boost::filesystem::exists("aggregated_P0.vtu"));
+  if(comm.size() > 1)
+    BOOST_CHECK(!boost::filesystem::exists("aggregated_P1.vtu"));
+
+  VtuFile vtu("aggregated_P0.vtu");
+  const std::vector<std::string> nb_points = vtu.attributes("NumberOfPoints");
+  BOOST_REQUIRE_EQUAL(nb_points.size(), comm.size());
+  BOOST_CHECK_EQUAL(from_str<Uint>(nb_points[comm.rank()]), coords.size());
+
+  // The offsets of the later pieces are shifted past the data of the earlier ones
+  const std::vector<std::string> offsets = vtu.attributes("offset");
+  for(Uint i = 1; i < offsets.size(); ++i)
+    BOOST_CHECK_LT(from_str<unsigned long long>(offsets[i-1]), from_str<unsigned long long>(offsets[i]));
+
+  const std::vector<unsigned long long> points_offsets = vtu.points_offsets();
+  BOOST_REQUIRE_EQUAL(points_offsets.size(), comm.size());
+  check_points(vtu.array(points_offsets[comm.rank()]), coords);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( BackgroundWriteError )
+{
+  PE::Comm& comm = PE::Comm::instance();
+  Handle<Mesh> mesh = create_parallel_mesh("error_mesh", 4, 2);
+
+  // A directory in the place of the vtu file makes the write fail on the background thread
+  const std::string vtu_path = "background_error_P" + to_str(comm.rank()) + ".vtu";
+  boost::filesystem::create_directory(vtu_path);
+
+  boost::shared_ptr< MeshWriter > vtk_writer = build_component_abstract_type<MeshWriter>("cf3.mesh.VTKXML.Writer","error_writer");
+  vtk_writer->options().set("mesh",mesh);
+  vtk_writer->options().set("file",URI("background_error.vtu"));
+  vtk_writer->options().set("background_write",true);
+  vtk_writer->execute();
+  BOOST_CHECK_THROW(Handle<VTKXML::Writer>(vtk_writer->handle())->wait(), FileSystemError);
+
+  // The error is only reported once
+  BOOST_CHECK_NO_THROW(Handle<VTKXML::Writer>(vtk_writer->handle())->wait());
+
+  boost::filesystem::remove(vtu_path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
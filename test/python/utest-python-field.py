@@ -0,0 +1,48 @@
+from coolfluid import *
+
+root = Core.root()
+env = Core.environment()
+
+env.options().set('assertion_backtrace', False)
+env.options().set('exception_backtrace', False)
+env.options().set('regist_signal_handlers', False)
+env.options().set('exception_log_level', 0)
+env.options().set('log_level', 4)
+env.options().set('exception_outputs', False)
+
+# Zero-copy access to mesh fields through numpy, when it is installed
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
+if numpy is not None:
+  mesh = root.create_component('mesh', 'cf3.mesh.Mesh')
+  mesh_generator = root.create_component('mesh_generator', 'cf3.mesh.SimpleMeshGenerator')
+  mesh_generator.options().set('mesh', mesh.uri())
+  mesh_generator.options().set('nb_cells', [4, 3])
+  mesh_generator.options().set('lengths', [1., 1.])
+  mesh_generator.options().set('offsets', [0., 0.])
+  mesh_generator.execute()
+
+  coordinates = mesh.geometry.coordinates
+  coords = numpy.asarray(coordinates)
+  cf_check_equal(coords.shape, (20, 2), 'Incorrect shape for the coordinates')
+  cf_check_equal(coords[7, 1], coordinates[7][1], 'Numpy array does not contain the coordinates')
+
+  field = mesh.geometry.create_field(name = 'velocity', variables = 'Velocity[vector]')
+  values = numpy.asarray(field)
+  cf_check_equal(values.shape, (20, 2), 'Incorrect shape for the field')
+  cf_check_equal(values.dtype, numpy.float64, 'Incorrect field dtype')
+
+  # vectorized writes through the view change the field itself
+  values[:, 0] = coords[:, 1] * (1. - coords[:, 1])
+  values[:, 1] = -1.
+  for i in range(len(field)):
+    y = coordinates[i][1]
+    cf_check_close(field[i][0], y * (1. - y), 1e-12, 'Writing to the numpy array did not modify the field')
+    cf_check_equal(field[i][1], -1., 'Writing to the numpy array did not modify the field')
+
+  # and writes to the field show up in the view, which shares the storage
+  field[3][1] = 5.
+  cf_check_equal(values[3, 1], 5., 'Numpy array is not a view on the field')
@@ -20,3 +20,16 @@ cf_check(not list[1], 'Second table row is incorrect')
 
 print 'Full list:'
 print list
+
+# Zero-copy access through numpy, when it is installed
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
+if numpy is not None:
+  values = numpy.asarray(list)
+  cf_check_equal(values.shape, (5,), 'Incorrect numpy array shape')
+  cf_check(values[0] and not values[1], 'Numpy array does not contain the list values')
+  values[2] = True
+  cf_check(list[2], 'Writing to the numpy array did not modify the list')
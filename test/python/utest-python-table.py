@@ -37,3 +37,27 @@ cf_check_equal(table[0][0],2,'Table increment failed')
 
 print 'Full table:'
 print table
+
+# Zero-copy access through numpy, when it is installed
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
+if numpy is not None:
+  values = numpy.asarray(table)
+  cf_check_equal(values.shape, (10, 2), 'Incorrect numpy array shape')
+  cf_check_equal(values[0,0], 2, 'Numpy array does not contain the table values')
+  values[2,:] = [5, 6]
+  cf_check(table[2][0] == 5 and table[2][1] == 6, 'Writing to the numpy array did not modify the table')
+
+  real_table = root.create_component("real_table", "cf3.common.Table<Real>")
+  real_table.set_row_size(3)
+  real_table.resize(4)
+  real_values = numpy.asarray(real_table)
+  real_values[:] = numpy.arange(12.).reshape(4, 3)
+  cf_check_equal(real_table[3][2], 11., 'Vectorized assignment to the numpy array did not modify the table')
+  cf_check_equal(numpy.asarray(real_table, dtype=numpy.float32).dtype, numpy.float32, 'Conversion to a different dtype failed')
+
+  empty_table = root.create_component("empty_table", "cf3.common.Table<Real>")
+  cf_check_equal(numpy.asarray(empty_table).size, 0, 'Empty table gave a non-empty array')
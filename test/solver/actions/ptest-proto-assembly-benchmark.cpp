@@ -0,0 +1,237 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for benchmarking the proto element assembly"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/Timer.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Cells.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Connectivity.hpp"
+
+#include "mesh/LagrangeP1/Hexa3D.hpp"
+#include "mesh/LagrangeP1/Tetra3D.hpp"
+
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/Functions.hpp"
+#include "solver/actions/Proto/NodeLooper.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+#include "Tools/Testing/ProfiledTestFixture.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+using boost::proto::lit;
+
+////////////////////////////////////////////////////
+
+/// Structured unit box with hexahedra, or with each hexahedron split into 6 tetrahedra around its 0-6 diagonal
+void create_box(Mesh& mesh, const Uint x_segs, const Uint y_segs, const Uint z_segs, const bool tetras)
+{
+  Dictionary& nodes = mesh.geometry_fields();
+  mesh.initialize_nodes((x_segs+1)*(y_segs+1)*(z_segs+1), DIM_3D);
+
+  for(Uint k = 0; k <= z_segs; ++k)
+  {
+    for(Uint j = 0; j <= y_segs; ++j)
+    {
+      for(Uint i = 0; i <= x_segs; ++i)
+      {
+        Table<Real>::Row row = nodes.coordinates()[(k*(y_segs+1) + j)*(x_segs+1) + i];
+        row[XX] = static_cast<Real>(i) / static_cast<Real>(x_segs);
+        row[YY] = static_cast<Real>(j) / static_cast<Real>(y_segs);
+        row[ZZ] = static_cast<Real>(k) / static_cast<Real>(z_segs);
+      }
+    }
+  }
+
+  static const Uint tetra_nodes[6][4] = { {0,1,2,6}, {0,2,3,6}, {0,3,7,6}, {0,7,4,6}, {0,4,5,6}, {0,5,1,6} };
+
+  Handle<Cells> cells = mesh.topology().create_region("interior").create_component<Cells>(tetras ? "Tetra" : "Hexa");
+  cells->initialize(tetras ? "cf3.mesh.LagrangeP1.Tetra3D" : "cf3.mesh.LagrangeP1.Hexa3D", nodes);
+  cells->resize(x_segs*y_segs*z_segs*(tetras ? 6 : 1));
+  Table<Uint>& connectivity = cells->geometry_space().connectivity();
+  Uint elem = 0;
+  for(Uint k = 0; k < z_segs; ++k)
+  {
+    for(Uint j = 0; j < y_segs; ++j)
+    {
+      for(Uint i = 0; i < x_segs; ++i)
+      {
+        Uint hexa[8];
+        hexa[0] = (k*(y_segs+1) + j)*(x_segs+1) + i;
+        hexa[1] = hexa[0] + 1;
+        hexa[2] = hexa[1] + (x_segs+1);
+        hexa[3] = hexa[0] + (x_segs+1);
+        for(Uint n = 0; n != 4; ++n)
+          hexa[n+4] = hexa[n] + (x_segs+1)*(y_segs+1);
+
+        if(tetras)
+        {
+          for(Uint t = 0; t != 6; ++t, ++elem)
+            for(Uint n = 0; n != 4; ++n)
+              connectivity[elem][n] = hexa[tetra_nodes[t][n]];
+        }
+        else
+        {
+          std::copy(hexa, hexa+8, connectivity[elem++].begin());
+        }
+      }
+    }
+  }
+
+  // Serial global indices
+  const Uint nb_nodes = nodes.size();
+  List<Uint>& gids = nodes.glb_idx(); gids.resize(nb_nodes);
+  List<Uint>& ranks = nodes.rank(); ranks.resize(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    ranks[i] = 0;
+    gids[i] = i;
+  }
+
+  mesh.raise_mesh_loaded();
+
+  mesh.geometry_fields().create_field("laplacian", "T").add_tag("laplacian_solution");
+  mesh.geometry_fields().create_field("navier_stokes", "u[vector],p").add_tag("navier_stokes_solution");
+}
+
+struct ProtoAssemblyBenchmarkFixture :
+  public Tools::Testing::ProfiledTestFixture
+{
+  ProtoAssemblyBenchmarkFixture() :
+    root(Core::instance().root())
+  {
+    int argc = boost::unit_test::framework::master_test_suite().argc;
+    char** argv = boost::unit_test::framework::master_test_suite().argv;
+
+    cf3_assert(argc == 4);
+    x_segs = boost::lexical_cast<Uint>(argv[1]);
+    y_segs = boost::lexical_cast<Uint>(argv[2]);
+    z_segs = boost::lexical_cast<Uint>(argv[3]);
+  }
+
+  Mesh& mesh(const std::string& name, const bool tetras)
+  {
+    if(Handle<Mesh> existing = Handle<Mesh>(root.get_child(name)))
+      return *existing;
+
+    Mesh& result = *root.create_component<Mesh>(name);
+    create_box(result, x_segs, y_segs, z_segs, tetras);
+    return result;
+  }
+
+  /// Print the time per element, both readable and in CDash format
+  void report(const std::string& name, const Real elapsed, const Uint nb_elems)
+  {
+    const Real ns_per_element = elapsed * 1e9 / static_cast<Real>(nb_elems);
+    std::cout << name << ": " << ns_per_element << " ns per element for " << nb_elems << " elements" << std::endl;
+    std::cout << "<DartMeasurement name=\"" << name << " ns per element\" type=\"numeric/double\">" << ns_per_element << "</DartMeasurement>" << std::endl;
+  }
+
+  template<typename ElementsT>
+  void benchmark_laplacian(const std::string& name, Mesh& mesh)
+  {
+    FieldVariable<0, ScalarField> T("T", "laplacian_solution");
+
+    Timer timer;
+    for_each_element<ElementsT>
+    (
+      mesh.topology(),
+      group
+      (
+        _A = _0,
+        element_quadrature( _A(T,T) += transpose(nabla(T)) * nabla(T) )
+      )
+    );
+    report(name, timer.elapsed(), mesh.topology().recursive_elements_count(true));
+  }
+
+  template<typename ElementsT>
+  void benchmark_navier_stokes(const std::string& name, Mesh& mesh)
+  {
+    FieldVariable<0, VectorField> u("u", "navier_stokes_solution");
+    FieldVariable<1, ScalarField> p("p", "navier_stokes_solution");
+
+    const Real nu = 1e-3;
+    const Real tau = 0.1;
+
+    for_each_node(mesh.topology(), group(u[0] = 1., u[1] = 0.5, u[2] = 0.25, p = 0.));
+
+    Timer timer;
+    for_each_element<ElementsT>
+    (
+      mesh.topology(),
+      group
+      (
+        _A = _0, _T = _0,
+        element_quadrature
+        (
+          _A(p    , u[_i]) += transpose(N(p)) * nabla(u)[_i] + lit(tau) * transpose(nabla(p)[_i]) * u*nabla(u),
+          _A(p    , p)     += lit(tau) * transpose(nabla(p)) * nabla(p),
+          _A(u[_i], u[_i]) += lit(nu) * transpose(nabla(u)) * nabla(u) + transpose(N(u) + lit(tau)*u*nabla(u)) * u*nabla(u),
+          _A(u[_i], p)     += transpose(N(u)) * nabla(p)[_i],
+          _T(u[_i], u[_i]) += transpose(N(u)) * N(u)
+        )
+      )
+    );
+    report(name, timer.elapsed(), mesh.topology().recursive_elements_count(true));
+  }
+
+  Component& root;
+  Uint x_segs;
+  Uint y_segs;
+  Uint z_segs;
+};
+
+BOOST_FIXTURE_TEST_SUITE( ProtoAssemblyBenchmarkSuite, ProtoAssemblyBenchmarkFixture )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( LaplacianHexa )
+{
+  benchmark_laplacian< boost::mpl::vector1<LagrangeP1::Hexa3D> >("Laplacian Hexa3D", mesh("HexaMesh", false));
+}
+
+BOOST_AUTO_TEST_CASE( LaplacianTetra )
+{
+  benchmark_laplacian< boost::mpl::vector1<LagrangeP1::Tetra3D> >("Laplacian Tetra3D", mesh("TetraMesh", true));
+}
+
+BOOST_AUTO_TEST_CASE( NavierStokesHexa )
+{
+  benchmark_navier_stokes< boost::mpl::vector1<LagrangeP1::Hexa3D> >("Navier-Stokes Hexa3D", mesh("HexaMesh", false));
+}
+
+BOOST_AUTO_TEST_CASE( NavierStokesTetra )
+{
+  benchmark_navier_stokes< boost::mpl::vector1<LagrangeP1::Tetra3D> >("Navier-Stokes Tetra3D", mesh("TetraMesh", true));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/List.hpp"
 #include "common/Log.hpp"
 
 #include "common/PE/all_reduce.hpp"
@@ -27,6 +29,7 @@
 #include "mesh/Elements.hpp"
 #include "mesh/MeshWriter.hpp"
 #include "mesh/ElementData.hpp"
+#include "mesh/Field.hpp"
 #include "mesh/FieldManager.hpp"
 #include "mesh/Dictionary.hpp"
 
@@ -172,6 +175,95 @@ BOOST_FIXTURE_TEST_CASE( SimulateNoOverlap, ProtoParallelFixture )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Node loops visit the nodes that are exchanged first, and the others while the exchange is in progress
+BOOST_FIXTURE_TEST_CASE( NodeLoopSync, ProtoParallelFixture )
+{
+  const Real rank = static_cast<Real>(PE::Comm::instance().rank());
+
+  Mesh& mesh = find_component_recursively_with_name<Mesh>(*root.get_child("NoOverlap"), "mesh");
+  Dictionary& geometry = mesh.geometry_fields();
+  geometry.comm_pattern(); // the loop only overlaps if the pattern already exists
+  geometry.create_field("node_loop_sync", "NodeRank").add_tag("node_loop_sync");
+
+  FieldVariable<0, ScalarField> N("NodeRank", "node_loop_sync");
+
+  const Field& field = find_component_with_tag<Field>(geometry, "node_loop_sync");
+  const Field& coords = geometry.coordinates();
+  const common::List<Uint>& ranks = geometry.rank();
+  for(Uint i = 0; i != 2; ++i)
+  {
+    for_each_node(mesh.topology(), N = coordinates[0] + 100.*(rank + i));
+
+    // Ghosts get the value computed by their owner
+    const Uint nb_nodes = geometry.size();
+    Uint nb_ghosts = 0;
+    for(Uint node = 0; node != nb_nodes; ++node)
+    {
+      BOOST_CHECK_EQUAL(field[node][0], coords[node][0] + 100.*(static_cast<Real>(ranks[node]) + i));
+      if(geometry.is_ghost(node))
+        ++nb_ghosts;
+    }
+    if(PE::Comm::instance().size() > 1)
+      BOOST_CHECK(nb_ghosts > 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Element loops run the elements that change exchanged values first, and the others while the exchange is in progress
+BOOST_FIXTURE_TEST_CASE( ElementLoopSync, ProtoParallelFixture )
+{
+  Mesh& mesh = find_component_recursively_with_name<Mesh>(*root.get_child("NoOverlap"), "mesh");
+  Dictionary& geometry = mesh.geometry_fields();
+  geometry.comm_pattern(); // the loop only overlaps if the pattern already exists
+  geometry.create_field("element_loop_input", "T").add_tag("element_loop_input");
+  geometry.create_field("element_loop_overlapped", "S").add_tag("element_loop_overlapped");
+  geometry.create_field("element_loop_threaded", "R").add_tag("element_loop_threaded");
+  Field& copy = geometry.create_field("element_loop_copy", "C");
+
+  FieldVariable<0, ScalarField> T("T", "element_loop_input");
+  FieldVariable<1, ScalarField> S("S", "element_loop_overlapped");
+  FieldVariable<2, ScalarField> R("R", "element_loop_threaded");
+
+  for_each_node(mesh.topology(), T = coordinates[0]*coordinates[1] + 0.1);
+
+  typedef boost::mpl::vector1<LagrangeP1::Hexa3D> HexasT;
+  for_each_element<HexasT>(mesh.topology(), group
+  (
+    _A(T) = _0,
+    element_quadrature(_A(T) += transpose(nabla(T))*nabla(T) + transpose(N(T))*N(T)),
+    S += _A(T)*nodal_values(T)
+  ));
+
+  // Threaded loops don't overlap the exchange, and sum in the serial order
+  {
+    ScopedElementThreads threads(2);
+    for_each_element<HexasT>(mesh.topology(), group
+    (
+      _A(T) = _0,
+      element_quadrature(_A(T) += transpose(nabla(T))*nabla(T) + transpose(N(T))*N(T)),
+      R += _A(T)*nodal_values(T)
+    ));
+  }
+
+  const Field& overlapped = find_component_with_tag<Field>(geometry, "element_loop_overlapped");
+  const Field& threaded = find_component_with_tag<Field>(geometry, "element_loop_threaded");
+  const Uint nb_nodes = geometry.size();
+  for(Uint node = 0; node != nb_nodes; ++node)
+  {
+    // Elements next to the exchanged nodes are summed first, which can change the last bits
+    BOOST_CHECK_SMALL(overlapped[node][0] - threaded[node][0], 1e-10);
+    copy[node][0] = overlapped[node][0];
+  }
+
+  // The ghosts already have the values of their owner
+  copy.synchronize();
+  for(Uint node = 0; node != nb_nodes; ++node)
+    BOOST_CHECK_EQUAL(copy[node][0], overlapped[node][0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_FIXTURE_TEST_CASE( SetupOverlap, ProtoParallelFixture )
 {
   Model& model = setup("Overlap");
@@ -0,0 +1,418 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for proto assembly into the native LSS backend"
+
+#include <set>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/FindComponents.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "math/LSS/System.hpp"
+#include "math/LSS/SolveLSS.hpp"
+
+#include "mesh/Domain.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/FieldManager.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/ElementTypes.hpp"
+
+#include "physics/PhysModel.hpp"
+
+#include "solver/Model.hpp"
+#include "solver/Tags.hpp"
+
+#include "solver/actions/Proto/DirichletBC.hpp"
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/NodeLooper.hpp"
+#include "solver/actions/Proto/ProtoAction.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+
+struct ProtoNativeLSSFixture
+{
+  ProtoNativeLSSFixture() :
+    root(Core::instance().root())
+  {
+    if(is_null(model))
+    {
+      common::PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+      model = root.create_component<Model>("Model");
+      physical_model = Handle<physics::PhysModel>(model->create_physics("cf3.physics.DynamicModel").handle());
+      Domain& dom = model->create_domain("Domain");
+      mesh = dom.create_component<Mesh>("mesh");
+      Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 20, 20);
+
+      field_manager = model->create_component<FieldManager>("FieldManager");
+      field_manager->options().set("variable_manager", model->physics().variable_manager().handle<math::VariableManager>());
+
+      // Build node connectivity
+      const Uint nb_nodes = mesh->geometry_fields().size();
+      std::vector< std::set<Uint> > connectivity_sets(nb_nodes);
+      BOOST_FOREACH(const Entities& elements, common::find_components_recursively_with_filter<Entities>(*mesh, IsElementsVolume()))
+      {
+        const Connectivity& connectivity = elements.geometry_space().connectivity();
+        const Uint nb_elems = connectivity.size();
+        for(Uint elem = 0; elem != nb_elems; ++elem)
+        {
+          BOOST_FOREACH(const Uint node_a, connectivity[elem])
+          {
+            BOOST_FOREACH(const Uint node_b, connectivity[elem])
+            {
+              if(node_a != node_b)
+                connectivity_sets[node_a].insert(node_b);
+            }
+          }
+        }
+      }
+
+      starting_indices.push_back(0);
+      BOOST_FOREACH(const std::set<Uint>& nodes, connectivity_sets)
+      {
+        starting_indices.push_back(starting_indices.back() + nodes.size());
+        node_connectivity.insert(node_connectivity.end(), nodes.begin(), nodes.end());
+      }
+
+      loop_regions.push_back(mesh->topology().uri());
+      boundary_regions.push_back(mesh->topology().uri() / URI("left"));
+      boundary_regions.push_back(mesh->topology().uri() / URI("right"));
+      boundary_regions.push_back(mesh->topology().uri() / URI("top"));
+      boundary_regions.push_back(mesh->topology().uri() / URI("bottom"));
+    }
+  }
+
+  /// System using the native backend
+  Handle<math::LSS::System> create_lss(const std::string& name)
+  {
+    Handle<math::LSS::System> lss = root.create_component<math::LSS::System>(name);
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeCrsMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    return lss;
+  }
+
+  Handle<ProtoAction> create_action(const std::string& name, const boost::shared_ptr<Expression>& expression, const std::vector<URI>& regions)
+  {
+    Handle<ProtoAction> action = root.create_component<ProtoAction>(name);
+    action->set_expression(expression);
+    action->options().set("physical_model", physical_model);
+    action->options().set(solver::Tags::regions(), regions);
+    return action;
+  }
+
+  /// Solve through a SolveLSS action, as a solver would
+  void solve(math::LSS::System& lss, const std::string& solver)
+  {
+    lss.solution_strategy()->options().set("solver", solver);
+    lss.solution_strategy()->options().set("preconditioner", std::string("Jacobi"));
+    lss.solution_strategy()->options().set("tolerance", 1e-12);
+
+    Handle<math::LSS::SolveLSS> solve_action = root.create_component<math::LSS::SolveLSS>("Solve" + lss.name());
+    solve_action->options().set("lss", lss.handle<math::LSS::System>());
+    solve_action->execute();
+  }
+
+  Component& root;
+  static Handle<Model> model;
+  static Handle<physics::PhysModel> physical_model;
+  static Handle<Mesh> mesh;
+  static Handle<FieldManager> field_manager;
+  static std::vector<URI> loop_regions;
+  static std::vector<URI> boundary_regions;
+
+  static std::vector<Uint> node_connectivity;
+  static std::vector<Uint> starting_indices;
+};
+
+Handle<Model> ProtoNativeLSSFixture::model;
+Handle<physics::PhysModel> ProtoNativeLSSFixture::physical_model;
+Handle<Mesh> ProtoNativeLSSFixture::mesh;
+Handle<FieldManager> ProtoNativeLSSFixture::field_manager;
+std::vector<URI> ProtoNativeLSSFixture::loop_regions;
+std::vector<URI> ProtoNativeLSSFixture::boundary_regions;
+
+std::vector<Uint> ProtoNativeLSSFixture::node_connectivity;
+std::vector<Uint> ProtoNativeLSSFixture::starting_indices;
+
+BOOST_FIXTURE_TEST_SUITE( ProtoNativeLSSSuite, ProtoNativeLSSFixture )
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Laplace problem with a linear solution, which linear elements reproduce exactly
+BOOST_AUTO_TEST_CASE( ScalarLaplace )
+{
+  Handle<math::LSS::System> lss = create_lss("scalar_lss");
+  lss->create(mesh->geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+
+  FieldVariable<0, ScalarField> T("NativeT", "native_scalar");
+  SystemMatrix matrix(*lss);
+  DirichletBC dirichlet(*lss);
+  SolutionVector solution(*lss);
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> etype;
+
+  Handle<ProtoAction> assembly = create_action("ScalarAssembly", elements_expression(etype,
+    group
+    (
+      _A = _0,
+      element_quadrature
+      (
+        _A(T,T) += transpose(nabla(T)) * nabla(T)
+      ),
+      matrix += _A
+    )
+  ), loop_regions);
+  Handle<ProtoAction> bc = create_action("ScalarBC", nodes_expression(dirichlet(T) = 1. + coordinates[0] + 2.*coordinates[1]), boundary_regions);
+  Handle<ProtoAction> update = create_action("ScalarUpdate", nodes_expression(T += solution(T)), loop_regions);
+
+  field_manager->create_field("native_scalar", mesh->geometry_fields());
+
+  assembly->execute();
+  bc->execute();
+  solve(*lss, "CG");
+  update->execute();
+
+  const Field& coords = mesh->geometry_fields().coordinates();
+  const Field& T_field = find_component_recursively_with_tag<Field>(*mesh, "native_scalar");
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_CLOSE(T_field[i][0], 1. + coords[i][0] + 2.*coords[i][1], 1e-6);
+  }
+}
+
+/// Two equations per node, assembled per component as in the UFEM solvers
+BOOST_AUTO_TEST_CASE( BlockedLaplace )
+{
+  Handle<math::LSS::System> lss = create_lss("vector_lss");
+
+  FieldVariable<0, VectorField> u("NativeU", "native_vector");
+  SystemMatrix matrix(*lss);
+  DirichletBC dirichlet(*lss);
+  SolutionVector solution(*lss);
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> etype;
+
+  Handle<ProtoAction> assembly = create_action("VectorAssembly", elements_expression(etype,
+    group
+    (
+      _A = _0,
+      element_quadrature
+      (
+        _A(u[_i],u[_i]) += transpose(nabla(u)) * nabla(u)
+      ),
+      matrix += _A
+    )
+  ), loop_regions);
+  Handle<ProtoAction> bc = create_action("VectorBC", nodes_expression(group
+  (
+    dirichlet(u[0]) = 1. + coordinates[0] + 2.*coordinates[1],
+    dirichlet(u[1]) = 3.*coordinates[0] - coordinates[1]
+  )), boundary_regions);
+  Handle<ProtoAction> update = create_action("VectorUpdate", nodes_expression(u += solution(u)), loop_regions);
+
+  field_manager->create_field("native_vector", mesh->geometry_fields());
+  lss->create_blocked(mesh->geometry_fields().comm_pattern(), *Handle<math::VariablesDescriptor>(physical_model->variable_manager().get_child("native_vector")), node_connectivity, starting_indices);
+
+  assembly->execute();
+  bc->execute();
+  solve(*lss, "GMRES");
+  update->execute();
+
+  const Field& coords = mesh->geometry_fields().coordinates();
+  const Field& u_field = find_component_recursively_with_tag<Field>(*mesh, "native_vector");
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_CLOSE(u_field[i][0], 1. + coords[i][0] + 2.*coords[i][1], 1e-6);
+    BOOST_CHECK_SMALL(u_field[i][1] - (3.*coords[i][0] - coords[i][1]), 1e-8);
+  }
+}
+
+/// Matrix-free system, with a Proto expression as operator
+BOOST_AUTO_TEST_CASE( MatrixFree )
+{
+  FieldVariable<0, ScalarField> T("NativeMF", "native_matrix_free");
+  field_manager->create_field("native_matrix_free", mesh->geometry_fields());
+
+  Handle<math::LSS::System> stored = create_lss("stored_lss");
+  Handle<math::LSS::System> matrix_free = create_lss("matrix_free_lss");
+  matrix_free->options().set("matrix_builder", std::string("cf3.math.LSS.NativeMatrixFree"));
+  stored->create(mesh->geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+  matrix_free->create(mesh->geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+
+  SystemMatrix stored_matrix(*stored);
+  SystemRHS stored_rhs(*stored);
+  SystemMatrix matrix_free_matrix(*matrix_free);
+  SystemRHS matrix_free_rhs(*matrix_free);
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> etype;
+
+  // The same assembly for both systems. The mass term makes the matrix definite without boundary conditions.
+  Handle<ProtoAction> stored_assembly = create_action("StoredAssembly", elements_expression(etype,
+    group
+    (
+      _A = _0, _a = _0,
+      element_quadrature
+      (
+        _A(T,T) += transpose(nabla(T)) * nabla(T) + transpose(N(T)) * N(T),
+        _a[T] += transpose(N(T))
+      ),
+      stored_matrix += _A,
+      stored_rhs += _a
+    )
+  ), loop_regions);
+  Handle<ProtoAction> matrix_free_assembly = create_action("MatrixFreeAssembly", elements_expression(etype,
+    group
+    (
+      _A = _0, _a = _0,
+      element_quadrature
+      (
+        _A(T,T) += transpose(nabla(T)) * nabla(T) + transpose(N(T)) * N(T),
+        _a[T] += transpose(N(T))
+      ),
+      matrix_free_matrix += _A,
+      matrix_free_rhs += _a
+    )
+  ), loop_regions);
+  matrix_free->matrix()->options().set("operator", Handle<common::Action>(matrix_free_assembly));
+
+  // As a regular assembly, the operator only fills the RHS of the matrix-free system
+  stored_assembly->execute();
+  matrix_free_assembly->execute();
+
+  const Uint nb_nodes = mesh->geometry_fields().size();
+  Real rhs_stored, rhs_matrix_free;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    stored->rhs()->get_value(i, rhs_stored);
+    matrix_free->rhs()->get_value(i, rhs_matrix_free);
+    BOOST_CHECK_CLOSE(rhs_matrix_free, rhs_stored, 1e-10);
+  }
+
+  // Products with the assembled and the matrix-free operator match
+  const Field& coords = mesh->geometry_fields().coordinates();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Real x = 1. + coords[i][0] - 2.*coords[i][1] + static_cast<Real>(i%5);
+    stored->solution()->set_value(i, x);
+    matrix_free->solution()->set_value(i, x);
+  }
+  stored->matrix()->apply(stored->rhs(), stored->solution());
+  matrix_free->matrix()->apply(matrix_free->rhs(), matrix_free->solution());
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    stored->rhs()->get_value(i, rhs_stored);
+    matrix_free->rhs()->get_value(i, rhs_matrix_free);
+    BOOST_CHECK_CLOSE(rhs_matrix_free, rhs_stored, 1e-10);
+  }
+
+  std::vector<Real> diag_stored, diag_matrix_free;
+  stored->matrix()->get_diagonal(diag_stored);
+  matrix_free->matrix()->get_diagonal(diag_matrix_free);
+  BOOST_CHECK_EQUAL(diag_matrix_free.size(), diag_stored.size());
+  for(Uint i = 0; i != diag_stored.size(); ++i)
+    BOOST_CHECK_CLOSE(diag_matrix_free[i], diag_stored[i], 1e-10);
+
+  // Solving recovers the vector the RHS was computed from
+  const std::string preconditioners[] = {"None", "Jacobi", "Chebyshev"};
+  for(Uint p = 0; p != 3; ++p)
+  {
+    BOOST_TEST_MESSAGE("Solving matrix-free with preconditioner " << preconditioners[p]);
+    matrix_free->solution()->reset(0.);
+    matrix_free->solution_strategy()->options().set("solver", std::string("CG"));
+    matrix_free->solution_strategy()->options().set("preconditioner", preconditioners[p]);
+    matrix_free->solution_strategy()->options().set("tolerance", 1e-12);
+    matrix_free->solve();
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      Real value;
+      matrix_free->solution()->get_value(i, value);
+      BOOST_CHECK_CLOSE(value, 1. + coords[i][0] - 2.*coords[i][1] + static_cast<Real>(i%5), 1e-6);
+    }
+  }
+
+  BOOST_CHECK_THROW(matrix_free->matrix()->set_value(0, 0, 1.), common::NotSupported);
+  matrix_free->solution_strategy()->options().set("preconditioner", std::string("ILU0"));
+  BOOST_CHECK_THROW(matrix_free->solve(), common::NotSupported);
+}
+
+/// Dirichlet conditions on a matrix-free system, which must not preserve symmetry
+BOOST_AUTO_TEST_CASE( MatrixFreeDirichlet )
+{
+  FieldVariable<0, ScalarField> T("NativeMFD", "native_matrix_free_dirichlet");
+  field_manager->create_field("native_matrix_free_dirichlet", mesh->geometry_fields());
+
+  Handle<math::LSS::System> lss = create_lss("matrix_free_dirichlet_lss");
+  lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeMatrixFree"));
+  lss->options().set("preserve_symmetry", false);
+  lss->create(mesh->geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+
+  SystemMatrix matrix(*lss);
+  DirichletBC dirichlet(*lss);
+  SolutionVector solution(*lss);
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> etype;
+
+  Handle<ProtoAction> assembly = create_action("MatrixFreeDirichletAssembly", elements_expression(etype,
+    group
+    (
+      _A = _0,
+      element_quadrature
+      (
+        _A(T,T) += transpose(nabla(T)) * nabla(T)
+      ),
+      matrix += _A
+    )
+  ), loop_regions);
+  Handle<ProtoAction> bc = create_action("MatrixFreeBC", nodes_expression(dirichlet(T) = 1. + coordinates[0] + 2.*coordinates[1]), boundary_regions);
+  Handle<ProtoAction> update = create_action("MatrixFreeUpdate", nodes_expression(T += solution(T)), loop_regions);
+  lss->matrix()->options().set("operator", Handle<common::Action>(assembly));
+
+  assembly->execute();
+  bc->execute();
+  solve(*lss, "GMRES");
+  update->execute();
+
+  const Field& coords = mesh->geometry_fields().coordinates();
+  const Field& T_field = find_component_recursively_with_tag<Field>(*mesh, "native_matrix_free_dirichlet");
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_CLOSE(T_field[i][0], 1. + coords[i][0] + 2.*coords[i][1], 1e-6);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( CleanUp )
+{
+  root.remove_component("scalar_lss");
+  root.remove_component("vector_lss");
+  root.remove_component("stored_lss");
+  root.remove_component("matrix_free_lss");
+  root.remove_component("matrix_free_dirichlet_lss");
+  common::PE::Comm::instance().finalize();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+//////////////////////////////////////////////////////////////////////////////
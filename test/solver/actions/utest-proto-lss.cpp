@@ -48,6 +48,7 @@
 #include "mesh/ElementData.hpp"
 #include "mesh/FieldManager.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
 
 #include "mesh/Integrators/Gauss.hpp"
 #include "mesh/ElementTypes.hpp"
@@ -538,6 +539,76 @@ BOOST_AUTO_TEST_CASE( MassMatrix )
   lss->matrix()->print(std::cout);
 }
 
+BOOST_AUTO_TEST_CASE( DependencyStamp )
+{
+  Handle<math::LSS::System> lss = root.create_component<math::LSS::System>("stamp_lss");
+  lss->options().set("matrix_builder", std::string("cf3.math.LSS.TrilinosCrsMatrix"));
+  lss->create(mesh->geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+
+  Handle<ProtoAction> action = root.create_component<ProtoAction>("StampAssembly");
+
+  FieldVariable<0, ScalarField> T("StampVar", "stampvar");
+  FieldVariable<1, ScalarField> nu("StampNu", "stampnu");
+  SystemMatrix matrix(*lss);
+  Real factor = 2.;
+  ConfigurableConstant<Real> scale("StampScale", "Scale factor, exposed as an option of the action", 1.);
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> etype;
+
+  action->set_expression(elements_expression(etype,
+    group
+    (
+      _A = _0,
+      element_quadrature
+      (
+        _A(T,T) += lit(factor) * scale * nu * transpose(N(T)) * N(T)
+      ),
+      matrix += _A
+    )
+  ));
+  action->add_dependency(factor);
+
+  action->options().set("physical_model", physical_model);
+  action->options().set(solver::Tags::regions(), loop_regions);
+
+  field_manager->create_field("stampvar", mesh->geometry_fields());
+  field_manager->create_field("stampnu", mesh->geometry_fields());
+  Field& nu_field = find_component_recursively_with_tag<Field>(*mesh, "stampnu");
+
+  const std::size_t initial_stamp = action->dependency_stamp();
+  BOOST_CHECK(lss->dependency_changed("assembly", initial_stamp));
+  action->execute();
+  lss->set_dependency_stamp("assembly", initial_stamp);
+  BOOST_CHECK(!lss->dependency_changed("assembly", action->dependency_stamp()));
+
+  // Fields, declared values and options are all part of the stamp
+  const Real old_nu = nu_field[0][0];
+  nu_field[0][0] = old_nu + 1.;
+  const std::size_t field_stamp = action->dependency_stamp();
+  BOOST_CHECK(lss->dependency_changed("assembly", field_stamp));
+  factor = 3.;
+  BOOST_CHECK(action->dependency_stamp() != field_stamp);
+  factor = 2.;
+  nu_field[0][0] = old_nu;
+  BOOST_CHECK_EQUAL(action->dependency_stamp(), initial_stamp);
+  action->options().set("StampScale", 3.);
+  BOOST_CHECK(action->dependency_stamp() != initial_stamp);
+  action->options().set("StampScale", 1.);
+  BOOST_CHECK_EQUAL(action->dependency_stamp(), initial_stamp);
+
+  // Options that only affect performance are not part of the stamp
+  action->options().set("element_threads", 2u);
+  BOOST_CHECK_EQUAL(action->dependency_stamp(), initial_stamp);
+  action->options().set("element_threads", 1u);
+
+  // Any write to the matrix from an expression or a reset of the system forgets the stamps
+  action->execute();
+  BOOST_CHECK(lss->dependency_changed("assembly", initial_stamp));
+  lss->set_dependency_stamp("assembly", initial_stamp);
+  lss->reset();
+  BOOST_CHECK(lss->dependency_changed("assembly", initial_stamp));
+}
+
 BOOST_AUTO_TEST_CASE( DirichletMatrix )
 {
   // set up a scalar problem
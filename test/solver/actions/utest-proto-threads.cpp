@@ -0,0 +1,279 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for threaded proto element loops"
+
+#include <set>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "math/LSS/System.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/LagrangeP1/Triag2D.hpp"
+
+#include "solver/actions/Proto/BlockAccumulator.hpp"
+#include "solver/actions/Proto/ElementColoring.hpp"
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/NodeLooper.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+typedef boost::mpl::vector1<LagrangeP1::Triag2D> ElementsT;
+
+/// Native system with the node connectivity of the mesh
+Handle<math::LSS::System> create_native_lss(Mesh& mesh, const std::string& name)
+{
+  const Uint nb_nodes = mesh.geometry_fields().size();
+  std::vector< std::set<Uint> > connectivity_sets(nb_nodes);
+  BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(mesh, IsElementsVolume()))
+  {
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    for(Uint elem = 0; elem != connectivity.size(); ++elem)
+    {
+      BOOST_FOREACH(const Uint node_a, connectivity[elem])
+      {
+        BOOST_FOREACH(const Uint node_b, connectivity[elem])
+        {
+          if(node_a != node_b)
+            connectivity_sets[node_a].insert(node_b);
+        }
+      }
+    }
+  }
+
+  std::vector<Uint> node_connectivity, starting_indices(1, 0);
+  BOOST_FOREACH(const std::set<Uint>& nodes, connectivity_sets)
+  {
+    node_connectivity.insert(node_connectivity.end(), nodes.begin(), nodes.end());
+    starting_indices.push_back(node_connectivity.size());
+  }
+
+  Handle<math::LSS::System> lss = Core::instance().root().create_component<math::LSS::System>(name);
+  lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeCrsMatrix"));
+  lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+  lss->create(mesh.geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+  return lss;
+}
+
+/// Assemble a matrix and RHS that depend on the field T, with the given number of threads
+void assemble(Mesh& mesh, math::LSS::System& lss, const Uint nb_threads)
+{
+  FieldVariable<0, ScalarField> T("T", "input");
+  SystemMatrix matrix(lss);
+  SystemRHS rhs(lss);
+
+  ScopedElementThreads threads(nb_threads);
+  for_each_element<ElementsT>(mesh.topology(), group
+  (
+    _A(T) = _0, _a[T] = _0,
+    element_quadrature
+    (
+      _A(T) += transpose(nabla(T))*nabla(T) + T*transpose(N(T))*N(T),
+      _a[T] += transpose(N(T))*T
+    ),
+    matrix += _A,
+    rhs += _a
+  ));
+}
+
+/// Check that the matrix and RHS of both systems are identical, for all entries of the sparsity pattern
+void check_same_system(Mesh& mesh, math::LSS::System& expected, math::LSS::System& actual)
+{
+  BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(mesh, IsElementsVolume()))
+  {
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    for(Uint elem = 0; elem != connectivity.size(); ++elem)
+    {
+      BOOST_FOREACH(const Uint row, connectivity[elem])
+      {
+        BOOST_FOREACH(const Uint col, connectivity[elem])
+        {
+          Real expected_value, actual_value;
+          expected.matrix()->get_value(col, row, expected_value);
+          actual.matrix()->get_value(col, row, actual_value);
+          BOOST_CHECK_EQUAL(actual_value, expected_value);
+        }
+      }
+    }
+  }
+
+  const Uint nb_nodes = mesh.geometry_fields().size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    Real expected_value, actual_value;
+    expected.rhs()->get_value(i, expected_value);
+    actual.rhs()->get_value(i, actual_value);
+    BOOST_CHECK_EQUAL(actual_value, expected_value);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( ProtoThreadsSuite )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+BOOST_AUTO_TEST_CASE( Coloring )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("coloring_mesh");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 20, 20);
+
+  BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(*mesh, IsElementsVolume()))
+  {
+    const ElementColoring coloring(elements);
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    BOOST_CHECK_EQUAL(coloring.nb_elements(), elements.size());
+
+    std::vector<Uint> last_color_of_node(elements.geometry_fields().size(), 0);
+    std::vector<Uint> last_element_of_node(elements.geometry_fields().size(), 0);
+    std::set<Uint> seen_elements;
+    for(Uint color = 0; color != coloring.nb_colors(); ++color)
+    {
+      std::set<Uint> color_nodes;
+      const Uint* color_elements = coloring.color_begin(color);
+      for(Uint i = 0; i != coloring.color_size(color); ++i)
+      {
+        const Uint elem = color_elements[i];
+        seen_elements.insert(elem);
+        BOOST_FOREACH(const Uint node, connectivity[elem])
+        {
+          // No two elements in a color share a node
+          BOOST_CHECK(color_nodes.insert(node).second);
+          // Elements sharing a node are visited in their original order
+          if(last_color_of_node[node] != 0)
+            BOOST_CHECK(last_element_of_node[node] < elem);
+          last_color_of_node[node] = color+1;
+          last_element_of_node[node] = elem;
+        }
+      }
+    }
+    BOOST_CHECK_EQUAL(seen_elements.size(), elements.size());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadedMatchesSerial )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("threads_mesh");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 40, 40);
+
+  mesh->geometry_fields().create_field("input", "T").add_tag("input");
+  mesh->geometry_fields().create_field("serial", "S").add_tag("serial");
+  mesh->geometry_fields().create_field("threaded", "R").add_tag("threaded");
+  mesh->geometry_fields().create_field("threaded2", "R2").add_tag("threaded2");
+
+  FieldVariable<0, ScalarField> T("T", "input");
+  FieldVariable<1, ScalarField> S("S", "serial");
+  FieldVariable<2, ScalarField> R("R", "threaded");
+  FieldVariable<3, ScalarField> R2("R2", "threaded2");
+
+  for_each_node(mesh->topology(), T = coordinates[0]*coordinates[1] + 0.1);
+
+  for_each_element<ElementsT>(mesh->topology(), group
+  (
+    _A(T) = _0,
+    element_quadrature(_A(T) += transpose(nabla(T))*nabla(T)),
+    S += _A(T)*nodal_values(T)
+  ));
+
+  {
+    ScopedElementThreads threads(4);
+    BOOST_CHECK_EQUAL(ElementThreading::instance().nb_threads(), 4);
+    for_each_element<ElementsT>(mesh->topology(), group
+    (
+      _A(T) = _0,
+      element_quadrature(_A(T) += transpose(nabla(T))*nabla(T)),
+      R += _A(T)*nodal_values(T)
+    ));
+  }
+  BOOST_CHECK_EQUAL(ElementThreading::instance().nb_threads(), 1);
+
+  // The pool threads are kept for the next loop
+  BOOST_CHECK_EQUAL(ElementThreading::instance().nb_pool_threads(), 3);
+  {
+    ScopedElementThreads threads(2);
+    for_each_element<ElementsT>(mesh->topology(), group
+    (
+      _A(T) = _0,
+      element_quadrature(_A(T) += transpose(nabla(T))*nabla(T)),
+      R2 += _A(T)*nodal_values(T)
+    ));
+  }
+  BOOST_CHECK_EQUAL(ElementThreading::instance().nb_pool_threads(), 3);
+
+  const Field& serial = find_component_with_tag<Field>(mesh->geometry_fields(), "serial");
+  const Field& threaded = find_component_with_tag<Field>(mesh->geometry_fields(), "threaded");
+  const Field& threaded2 = find_component_with_tag<Field>(mesh->geometry_fields(), "threaded2");
+  const Uint nb_nodes = serial.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    // Summation order is the same, so the results must be bit-identical
+    BOOST_CHECK_EQUAL(threaded[i][0], serial[i][0]);
+    BOOST_CHECK_EQUAL(threaded[i][0], threaded2[i][0]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadedLSSMatchesSerial )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("lss_threads_mesh");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 40, 40);
+  mesh->geometry_fields().create_field("input", "T").add_tag("input");
+  FieldVariable<0, ScalarField> T("T", "input");
+  for_each_node(mesh->topology(), T = coordinates[0]*coordinates[1] + 0.1);
+
+  Handle<math::LSS::System> serial = create_native_lss(*mesh, "serial_lss");
+  Handle<math::LSS::System> threaded = create_native_lss(*mesh, "threaded_lss");
+  Handle<math::LSS::System> locked = create_native_lss(*mesh, "locked_lss");
+
+  // The native matrix takes concurrent writes, unless the assembly plan is enabled
+  BOOST_CHECK(threaded->matrix()->concurrent_assembly());
+  BOOST_CHECK(threaded->rhs()->concurrent_assembly());
+  locked->matrix()->options().set("assembly_plan", true);
+  BOOST_CHECK(!locked->matrix()->concurrent_assembly());
+
+  assemble(*mesh, *serial, 1);
+  assemble(*mesh, *threaded, 4);
+  assemble(*mesh, *locked, 4);
+
+  check_same_system(*mesh, *serial, *threaded);
+  check_same_system(*mesh, *serial, *locked);
+}
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+//////////////////////////////////////////////////////////////////////////////
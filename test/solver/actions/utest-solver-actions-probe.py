@@ -0,0 +1,114 @@
+import coolfluid as cf
+
+env = cf.Core.environment()
+env.log_level = 4
+env.only_cpu0_writes = True
+
+root = cf.Core.root()
+domain = root.create_component('Domain', 'cf3.mesh.Domain')
+mesh = domain.create_component('Mesh','cf3.mesh.Mesh')
+
+blocks = root.create_component('model', 'cf3.mesh.BlockMesh.BlockArrays')
+points = blocks.create_points(dimensions = 2, nb_points = 4)
+points[0]  = [0., 0.]
+points[1]  = [1., 0.]
+points[2]  = [1., 1.]
+points[3]  = [0., 1.]
+block_nodes = blocks.create_blocks(1)
+block_nodes[0] = [0, 1, 2, 3]
+block_subdivs = blocks.create_block_subdivisions()
+block_subdivs[0] = [20,20]
+gradings = blocks.create_block_gradings()
+gradings[0] = [1., 1., 1., 1.]
+blocks.create_patch_nb_faces(name = 'bottom', nb_faces = 1)[0] = [0, 1]
+blocks.create_patch_nb_faces(name = 'right', nb_faces = 1)[0] = [1, 2]
+blocks.create_patch_nb_faces(name = 'top', nb_faces = 1)[0] = [2, 3]
+blocks.create_patch_nb_faces(name = 'left', nb_faces = 1)[0] = [3, 0]
+
+blocks.create_mesh(mesh.uri())
+
+# Fields that are linear in the coordinates, so the interpolation is exact
+coords = mesh.geometry.coordinates
+scalar = mesh.geometry.create_field(name = 'probe_scalar', variables = 'u[scalar]')
+vector = mesh.geometry.create_field(name = 'probe_vector', variables = 'v[vector]')
+
+def fill_fields(factor):
+  for i in range(len(coords)):
+    x = coords[i][0]
+    y = coords[i][1]
+    scalar[i][0] = factor * (x + 2.*y)
+    vector[i][0] = factor * x
+    vector[i][1] = -factor * y
+
+fill_fields(1.)
+
+# Probes in a group are evaluated together
+probe_coords = [[0.13, 0.27], [0.5, 0.5], [0.91, 0.42], [0.05, 0.95]]
+group = domain.create_component('Probes', 'cf3.solver.actions.ProbeGroup')
+probes = []
+for i in range(len(probe_coords)):
+  probe = group.create_probe(name = 'Probe' + str(i))
+  probe.dict = mesh.geometry
+  probe.coordinate = probe_coords[i]
+  probes.append(probe)
+
+def check_probe(probe, coord, factor):
+  x = coord[0]
+  y = coord[1]
+  cf.cf_check_close(probe.properties()['u'], factor * (x + 2.*y), 1e-10, 'Wrong scalar value for ' + probe.name())
+  cf.cf_check_close(probe.properties()['v[0]'], factor * x, 1e-10, 'Wrong vector value for ' + probe.name())
+  cf.cf_check_close(probe.properties()['v[1]'], -factor * y, 1e-10, 'Wrong vector value for ' + probe.name())
+
+group.execute()
+for i in range(len(probes)):
+  check_probe(probes[i], probe_coords[i], 1.)
+
+# Later executions reuse the plans, but must see the new field values
+fill_fields(2.)
+group.execute()
+for i in range(len(probes)):
+  check_probe(probes[i], probe_coords[i], 2.)
+
+# Probes executed on their own always interpolate the current field values
+fill_fields(3.)
+probes[0].execute()
+check_probe(probes[0], probe_coords[0], 3.)
+fill_fields(5.)
+probes[1].execute()
+check_probe(probes[1], probe_coords[1], 5.)
+fill_fields(3.)
+
+# Moving a probe relocates it
+probe_coords[1] = [0.75, 0.25]
+probes[1].coordinate = probe_coords[1]
+group.execute()
+for i in range(len(probes)):
+  check_probe(probes[i], probe_coords[i], 3.)
+
+# Probes in a director are independent, so a probe outside the domain doesn't affect the others
+director = domain.create_component('Director', 'cf3.common.ActionDirector')
+single = director.create_component('Single', 'cf3.solver.actions.Probe')
+single.dict = mesh.geometry
+single.coordinate = [0.3, 0.6]
+outside = director.create_component('Outside', 'cf3.solver.actions.Probe')
+outside.dict = mesh.geometry
+outside.coordinate = [2., 2.]
+single.execute()
+check_probe(single, [0.3, 0.6], 3.)
+
+# ProbePoints interpolates all its points at once, suffixing the variables with the point index
+probe_points = domain.create_component('ProbePoints', 'cf3.solver.actions.ProbePoints')
+probe_points.dict = mesh.geometry
+probe_points.x_coordinate = [c[0] for c in probe_coords]
+probe_points.y_coordinate = [c[1] for c in probe_coords]
+probe_points.execute()
+for i in range(len(probe_coords)):
+  x = probe_coords[i][0]
+  y = probe_coords[i][1]
+  cf.cf_check_close(probe_points.properties()['u_' + str(i)], 3. * (x + 2.*y), 1e-10, 'Wrong scalar value for point ' + str(i))
+  cf.cf_check_close(probe_points.properties()['v_' + str(i) + '[0]'], 3. * x, 1e-10, 'Wrong vector value for point ' + str(i))
+  cf.cf_check_close(probe_points.properties()['v_' + str(i) + '[1]'], -3. * y, 1e-10, 'Wrong vector value for point ' + str(i))
+
+fill_fields(4.)
+probe_points.execute()
+cf.cf_check_close(probe_points.properties()['u_0'], 4. * (probe_coords[0][0] + 2.*probe_coords[0][1]), 1e-10, 'ProbePoints did not see the new field values')
@@ -101,4 +101,60 @@ if not differ.properties()['arrays_equal']:
   raise Exception('Element GIDS do not match')
 
 if time.current_time != 2. or time.time_step != 0.2 or time.iteration != 10:
-  raise Exception('Error in time data')
\ No newline at end of file
+  raise Exception('Error in time data')
+
+# Same round trip with the single-file format, starting from the data that was just read back
+single_restart_file = cf.URI('restart-test-single.cf3restart')
+writer.single_file = True
+writer.file = single_restart_file
+writer.execute()
+
+for i in range(len(ref_node_gids)):
+  mesh.geometry.node_gids[i][0] = 0
+for i in range(len(ref_element_gids)):
+  mesh.elems_P0.element_gids[i][0] = 0
+
+reader.file = single_restart_file
+reader.execute()
+
+differ.left = ref_node_gids
+differ.right = mesh.geometry.node_gids
+differ.execute()
+if not differ.properties()['arrays_equal']:
+  raise Exception('Node GIDS do not match for the single-file restart')
+
+differ.left = ref_element_gids
+differ.right = mesh.elems_P0.element_gids
+differ.execute()
+if not differ.properties()['arrays_equal']:
+  raise Exception('Element GIDS do not match for the single-file restart')
+
+# Asynchronous writing in the per-CPU format
+async_restart_file = cf.URI('restart-test-async.cf3restart')
+writer.single_file = False
+writer.asynchronous = True
+writer.file = async_restart_file
+writer.execute()
+
+# The data was copied, so changing the fields must not affect the written file
+for i in range(len(ref_node_gids)):
+  mesh.geometry.node_gids[i][0] = 0
+for i in range(len(ref_element_gids)):
+  mesh.elems_P0.element_gids[i][0] = 0
+
+writer.wait()
+
+reader.file = async_restart_file
+reader.execute()
+
+differ.left = ref_node_gids
+differ.right = mesh.geometry.node_gids
+differ.execute()
+if not differ.properties()['arrays_equal']:
+  raise Exception('Node GIDS do not match for the asynchronous restart')
+
+differ.left = ref_element_gids
+differ.right = mesh.elems_P0.element_gids
+differ.execute()
+if not differ.properties()['arrays_equal']:
+  raise Exception('Element GIDS do not match for the asynchronous restart')
@@ -0,0 +1,168 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::solver::TermComputer"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/ShapeFunction.hpp"
+#include "mesh/Space.hpp"
+
+#include "solver/ComputeRHS.hpp"
+#include "solver/TermComputer.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::solver;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Value of the dummy term, depending on element, node and equation
+inline Real dummy_term(const Uint elem, const Uint node, const Uint eq)
+{
+  return 0.1*elem + 0.01*node + eq;
+}
+
+/// Term computer that only implements the per-element interface
+class LegacyTerm : public TermComputer
+{
+public:
+  LegacyTerm(const std::string& name) : TermComputer(name) {}
+  static std::string type_name() { return "LegacyTerm"; }
+
+  using TermComputer::compute_term;
+
+  virtual bool loop_cells(const Handle<mesh::Entities const>& cells)
+  {
+    m_nb_nodes = cells->element_type().nb_nodes();
+    return true;
+  }
+
+  virtual void compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed)
+  {
+    term.resize(m_nb_nodes, RealVector(2));
+    wave_speed.resize(m_nb_nodes);
+    for (Uint n=0; n<m_nb_nodes; ++n)
+    {
+      for (Uint eq=0; eq<2; ++eq)
+        term[n][eq] = dummy_term(elem_idx,n,eq);
+      wave_speed[n] = elem_idx;
+    }
+  }
+
+  Uint m_nb_nodes;
+};
+
+/// Term computer that also implements the block interface
+class BlockTerm : public LegacyTerm
+{
+public:
+  BlockTerm(const std::string& name) : LegacyTerm(name), nb_block_calls(0) {}
+  static std::string type_name() { return "BlockTerm"; }
+
+  virtual bool compute_term_block_impl(const Uint begin_elem, TermBlock& block)
+  {
+    ++nb_block_calls;
+    for (Uint n=0; n<block.nb_nodes(); ++n)
+    {
+      for (Uint eq=0; eq<block.nb_eqs(); ++eq)
+      {
+        Real* term = block.term(n,eq);
+        for (Uint e=0; e<block.nb_elems(); ++e)
+          term[e] = dummy_term(begin_elem+e,n,eq);
+      }
+      Real* ws = block.wave_speed(n);
+      for (Uint e=0; e<block.nb_elems(); ++e)
+        ws[e] = begin_elem+e;
+    }
+    return true;
+  }
+
+  Uint nb_block_calls;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( TermComputerSuite )
+
+BOOST_AUTO_TEST_CASE( BlockMatchesLegacy )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 1., 1., 7, 5);
+
+  Field& legacy_term = mesh->geometry_fields().create_field("legacy_term", 2);
+  Field& legacy_ws = mesh->geometry_fields().create_field("legacy_ws", 1);
+  Field& block_term = mesh->geometry_fields().create_field("block_term", 2);
+  Field& block_ws = mesh->geometry_fields().create_field("block_ws", 1);
+
+  boost::shared_ptr<LegacyTerm> legacy = allocate_component<LegacyTerm>("legacy");
+  boost::shared_ptr<BlockTerm> block = allocate_component<BlockTerm>("block");
+  block->options().set("block_size", 4u);
+
+  legacy->compute_term(legacy_term, legacy_ws);
+  block->compute_term(block_term, block_ws);
+
+  BOOST_CHECK(block->nb_block_calls > 0);
+
+  for (Uint i=0; i<legacy_term.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(legacy_term[i][0], block_term[i][0]);
+    BOOST_CHECK_EQUAL(legacy_term[i][1], block_term[i][1]);
+    BOOST_CHECK_EQUAL(legacy_ws[i][0], block_ws[i][0]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ComputeRHSMixedTerms )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("rhs_mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 1., 1., 6, 6);
+
+  Dictionary& dict = mesh->create_discontinuous_space("rhs_space", "cf3.mesh.LagrangeP1");
+  Field& rhs = dict.create_field("rhs", 2);
+  Field& ws = dict.create_field("ws", 1);
+
+  Handle<ComputeRHS> compute_rhs = Core::instance().root().create_component<ComputeRHS>("compute_rhs");
+  compute_rhs->create_component<LegacyTerm>("legacy");
+  Handle<BlockTerm> block = compute_rhs->create_component<BlockTerm>("block");
+  compute_rhs->options().set("block_size", 5u);
+
+  compute_rhs->compute_rhs(rhs, ws);
+
+  BOOST_CHECK(block->nb_block_calls > 0);
+
+  boost_foreach(const Handle<Entities>& cells, dict.entities_range())
+  {
+    const Space& space = dict.space(*cells);
+    for (Uint e=0; e<space.size(); ++e)
+    {
+      for (Uint n=0; n<space.shape_function().nb_nodes(); ++n)
+      {
+        const Uint p = space.connectivity()[e][n];
+        BOOST_CHECK_EQUAL(rhs[p][0], 2.*dummy_term(e,n,0));
+        BOOST_CHECK_EQUAL(rhs[p][1], 2.*dummy_term(e,n,1));
+        BOOST_CHECK_EQUAL(ws[p][0], e);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+//////////////////////////////////////////////////////////////////////////////
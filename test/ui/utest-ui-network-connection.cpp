@@ -7,6 +7,7 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for the ui network Connection class"
 
+#include <iomanip>
 #include <iostream>
 
 #include "common/BoostAssign.hpp"
@@ -15,6 +16,8 @@
 #include "common/TypeInfo.hpp"
 #include "common/XML/SignalFrame.hpp"
 #include "common/XML/FileOperations.hpp"
+#include "common/XML/BinaryFrame.hpp"
+#include "common/XML/Protocol.hpp"
 
 #include "ui/network/TCPConnection.hpp"
 #include "ui/network/ErrorHandler.hpp"
@@ -78,6 +81,62 @@ std::string get_message( const SignalFrame & frame )
 
 //////////////////////////////////////////////////////////////////////////////
 
+void store_error( boost::system::error_code & result, const boost::system::error_code & error )
+{
+  result = error;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Writes a frame on a plain socket, with the given header
+void write_raw_frame( tcp::socket & socket, const std::string & header, const std::string & data )
+{
+  BOOST_REQUIRE_EQUAL( header.size(), 8u );
+  asio::write( socket, asio::buffer(header) );
+  asio::write( socket, asio::buffer(data) );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Reads a frame from a plain socket. Binary frame headers have a 'B' and the size in hexadecimal.
+std::string read_raw_frame( tcp::socket & socket, std::string & header )
+{
+  header.resize( 8 );
+  asio::read( socket, asio::buffer(&header[0], header.size()) );
+
+  const bool binary = header[0] == 'B';
+  std::istringstream size_stream( binary ? header.substr(1) : header );
+  if( binary )
+    size_stream >> std::hex;
+
+  cf3::Uint size = 0;
+  size_stream >> size;
+
+  std::string data( size, '\0' );
+  asio::read( socket, asio::buffer(&data[0], size) );
+  return data;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::string xml_header( const std::string & data )
+{
+  std::ostringstream header;
+  header << std::setw(8) << data.size();
+  return header.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::string binary_header( const std::string & data )
+{
+  std::ostringstream header;
+  header << 'B' << std::hex << std::setw(7) << data.size();
+  return header.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 class Client
 {
 
@@ -506,6 +565,168 @@ BOOST_AUTO_TEST_CASE( multi_client_send )
 
 //////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( binary_negotiation )
+{
+  // a TCPConnection that allows binary frames, talking to a plain socket that
+  // checks the bytes on the wire
+  asio::io_service ios;
+  tcp::acceptor acceptor( ios, tcp::endpoint( tcp::v4(), NETWORK_PORT + 1 ) );
+  TCPConnection::Ptr conn = TCPConnection::create( ios );
+  conn->set_binary_frames( true );
+
+  boost::system::error_code error = asio::error::would_block;
+  acceptor.async_accept( conn->socket(), boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+
+  tcp::socket peer( ios );
+  peer.connect( tcp::endpoint( address::from_string(NETWORK_HOST), NETWORK_PORT + 1 ) );
+  ios.run();
+  BOOST_REQUIRE( !error );
+
+  std::string header;
+  std::string data;
+
+  //////////////////
+  // 1. until the peer advertises binary frames, XML is sent, with the advertisement
+  //////////////////
+
+  BOOST_CHECK( !conn->sends_binary_frames() );
+
+  SignalFrame first = generate_message_frame( "first" );
+  conn->send( first, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+
+  data = read_raw_frame( peer, header );
+  BOOST_CHECK( header[0] != 'B' );
+  SignalFrame first_read( parse_string( data ) );
+  BOOST_CHECK_EQUAL( get_message( first_read ), "first" );
+  BOOST_CHECK_EQUAL( Protocol::goto_doc_node( *first_read.xml_doc ).attribute_value( "binary" ), "1" );
+  // the advertisement is only added to the sent text, not to the caller's frame
+  BOOST_CHECK( Protocol::goto_doc_node( *first.xml_doc ).attribute_value( "binary" ).empty() );
+
+  //////////////////
+  // 2. an XML frame without the advertisement does not switch
+  //////////////////
+
+  SignalFrame buffer;
+
+  SignalFrame plain = generate_message_frame( "plain" );
+  plain.flush_maps();
+  to_string( *plain.xml_doc, data );
+  write_raw_frame( peer, xml_header(data), data );
+
+  conn->read( buffer, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+  BOOST_CHECK_EQUAL( get_message( buffer ), "plain" );
+  BOOST_CHECK( !conn->sends_binary_frames() );
+
+  //////////////////
+  // 3. the peer advertises binary frames in an XML frame
+  //////////////////
+
+  SignalFrame advertise = generate_message_frame( "advertise" );
+  advertise.flush_maps();
+  Protocol::goto_doc_node( *advertise.xml_doc ).set_attribute( "binary", "1" );
+  to_string( *advertise.xml_doc, data );
+  write_raw_frame( peer, xml_header(data), data );
+
+  conn->read( buffer, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+  BOOST_CHECK_EQUAL( get_message( buffer ), "advertise" );
+  BOOST_CHECK( conn->sends_binary_frames() );
+
+  //////////////////
+  // 4. frames are now sent binary, with the schema kept between frames
+  //////////////////
+
+  BinaryFrameCodec peer_decoder;
+  std::vector<std::string> messages;
+  messages.push_back( "second" );
+  messages.push_back( "third" );
+  std::vector<cf3::Uint> sizes;
+
+  for( cf3::Uint i = 0; i != messages.size(); ++i )
+  {
+    SignalFrame frame = generate_message_frame( messages[i] );
+    conn->send( frame, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+    ios.reset();
+    ios.run();
+    BOOST_REQUIRE( !error );
+
+    data = read_raw_frame( peer, header );
+    BOOST_CHECK_EQUAL( header, binary_header(data) );
+    BOOST_CHECK( BinaryFrameCodec::is_binary( data.data(), data.size() ) );
+    BOOST_CHECK_EQUAL( get_message( SignalFrame( peer_decoder.decode( data ) ) ), messages[i] );
+    sizes.push_back( data.size() );
+  }
+
+  BOOST_CHECK_LT( sizes[1], sizes[0] );
+
+  //////////////////
+  // 5. both formats are accepted on read, in any order
+  //////////////////
+
+  BinaryFrameCodec peer_encoder;
+
+  SignalFrame binary_frame = generate_message_frame( "binary" );
+  peer_encoder.encode( binary_frame, data );
+  write_raw_frame( peer, binary_header(data), data );
+
+  conn->read( buffer, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+  BOOST_CHECK_EQUAL( get_message( buffer ), "binary" );
+
+  SignalFrame xml_frame = generate_message_frame( "xml again" );
+  xml_frame.flush_maps();
+  to_string( *xml_frame.xml_doc, data );
+  write_raw_frame( peer, xml_header(data), data );
+
+  conn->read( buffer, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+  BOOST_CHECK_EQUAL( get_message( buffer ), "xml again" );
+
+  // the second binary frame relies on the schema of the first one
+  SignalFrame binary_frame2 = generate_message_frame( "binary again" );
+  peer_encoder.encode( binary_frame2, data );
+  write_raw_frame( peer, binary_header(data), data );
+
+  conn->read( buffer, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+  BOOST_CHECK_EQUAL( get_message( buffer ), "binary again" );
+
+  //////////////////
+  // 6. a connection that does not allow binary frames keeps sending XML
+  //////////////////
+
+  conn->set_binary_frames( false );
+  BOOST_CHECK( !conn->sends_binary_frames() );
+
+  SignalFrame last = generate_message_frame( "last" );
+  conn->send( last, boost::bind( &store_error, boost::ref(error), asio::placeholders::error ) );
+  ios.reset();
+  ios.run();
+  BOOST_REQUIRE( !error );
+
+  data = read_raw_frame( peer, header );
+  BOOST_CHECK_EQUAL( header, xml_header(data) );
+  SignalFrame last_read( parse_string( data ) );
+  BOOST_CHECK_EQUAL( get_message( last_read ), "last" );
+  BOOST_CHECK( Protocol::goto_doc_node( *last_read.xml_doc ).attribute_value( "binary" ).empty() );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( disconnect )
 {
   // 1. server closes the connection, client should throw an error (eof)